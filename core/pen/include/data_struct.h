@@ -181,6 +181,34 @@ namespace pen
         T&     operator[](size_t slot);
     };
 
+    // open addressing hash map with linear probing for integer keys such as hash_id or handles - single threaded
+    // values are copied with memcpy so should be pod, indices or pointers. insert replaces existing values
+    template <typename K, typename V>
+    struct hash_map
+    {
+        K*  _keys = nullptr;
+        V*  _values = nullptr;
+        u8* _states = nullptr; // empty, occupied or erased
+        u32 _capacity = 0;     // power of 2
+        u32 _size = 0;
+        u32 _erased = 0;
+
+        hash_map() = default;
+        ~hash_map();
+
+        // owns its arrays
+        hash_map(const hash_map&) = delete;
+        hash_map& operator=(const hash_map&) = delete;
+
+        void insert(K key, const V& value);
+        V*   find(K key);
+        bool erase(K key);
+        void clear();
+        void reserve(u32 capacity);
+        u32  size();
+        u32  _bucket(K key);
+    };
+
     // function impls with always inline for fast data structs
     template <typename T>
     pen_inline void stack<T>::clear()
@@ -461,4 +489,155 @@ namespace pen
     {
         return _data[_fb][slot];
     }
+
+    namespace e_hash_map_state
+    {
+        enum hash_map_state_t
+        {
+            empty = 0,
+            occupied,
+            erased
+        };
+    }
+
+    template <typename K, typename V>
+    pen_inline hash_map<K, V>::~hash_map()
+    {
+        pen::memory_free(_keys);
+        pen::memory_free(_values);
+        pen::memory_free(_states);
+    }
+
+    template <typename K, typename V>
+    pen_inline u32 hash_map<K, V>::_bucket(K key)
+    {
+        // fibonacci hashing spreads sequential handles as well as hashes
+        return (u32)(((u64)key * 0x9E3779B97F4A7C15ull) >> 32) & (_capacity - 1);
+    }
+
+    template <typename K, typename V>
+    inline void hash_map<K, V>::reserve(u32 capacity)
+    {
+        u32 new_cap = 16;
+        while (new_cap < capacity)
+            new_cap <<= 1;
+
+        if (new_cap < _capacity)
+            return;
+
+        K*  old_keys = _keys;
+        V*  old_values = _values;
+        u8* old_states = _states;
+        u32 old_cap = _capacity;
+
+        _keys = (K*)pen::memory_alloc(sizeof(K) * new_cap);
+        _values = (V*)pen::memory_alloc(sizeof(V) * new_cap);
+        _states = (u8*)pen::memory_alloc(new_cap);
+        memset(_states, 0x0, new_cap);
+
+        _capacity = new_cap;
+        _size = 0;
+        _erased = 0;
+
+        // rehash, dropping erased entries
+        for (u32 i = 0; i < old_cap; ++i)
+            if (old_states[i] == e_hash_map_state::occupied)
+                insert(old_keys[i], old_values[i]);
+
+        pen::memory_free(old_keys);
+        pen::memory_free(old_values);
+        pen::memory_free(old_states);
+    }
+
+    template <typename K, typename V>
+    pen_inline void hash_map<K, V>::insert(K key, const V& value)
+    {
+        // keep load including erased slots below 3/4 so probes terminate, grow or just drop erased slots
+        if ((_size + _erased + 1) * 4 > _capacity * 3)
+            reserve(_size * 4 > _capacity ? _capacity * 2 : _capacity);
+
+        u32 mask = _capacity - 1;
+        u32 i = _bucket(key);
+        s32 first_erased = -1;
+        for (;;)
+        {
+            u8 state = _states[i];
+            if (state == e_hash_map_state::empty)
+                break;
+
+            if (state == e_hash_map_state::erased)
+            {
+                if (first_erased == -1)
+                    first_erased = (s32)i;
+            }
+            else if (_keys[i] == key)
+            {
+                memcpy(&_values[i], &value, sizeof(V));
+                return;
+            }
+
+            i = (i + 1) & mask;
+        }
+
+        if (first_erased != -1)
+        {
+            i = (u32)first_erased;
+            _erased--;
+        }
+
+        _keys[i] = key;
+        memcpy(&_values[i], &value, sizeof(V));
+        _states[i] = e_hash_map_state::occupied;
+        _size++;
+    }
+
+    template <typename K, typename V>
+    pen_inline V* hash_map<K, V>::find(K key)
+    {
+        if (_size == 0)
+            return nullptr;
+
+        u32 mask = _capacity - 1;
+        u32 i = _bucket(key);
+        for (;;)
+        {
+            u8 state = _states[i];
+            if (state == e_hash_map_state::empty)
+                return nullptr;
+
+            if (state == e_hash_map_state::occupied && _keys[i] == key)
+                return &_values[i];
+
+            i = (i + 1) & mask;
+        }
+    }
+
+    template <typename K, typename V>
+    pen_inline bool hash_map<K, V>::erase(K key)
+    {
+        V* v = find(key);
+        if (!v)
+            return false;
+
+        _states[v - _values] = e_hash_map_state::erased;
+        _size--;
+        _erased++;
+        return true;
+    }
+
+    template <typename K, typename V>
+    pen_inline void hash_map<K, V>::clear()
+    {
+        if (_states)
+            memset(_states, 0x0, _capacity);
+
+        _size = 0;
+        _erased = 0;
+    }
+
+    template <typename K, typename V>
+    pen_inline u32 hash_map<K, V>::size()
+    {
+        return _size;
+    }
 } // namespace pen
@@ -0,0 +1,65 @@
+// file_pack.h
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Read only archive of many files with a hashed table of contents, built with tools/code/pack_files.
+
+// Mounted packs are searched by filesystem_read_file_to_buffer and filesystem_map_file before the loose files,
+// so loaders do not need to know whether data is packed. data.pack in the resource directory is mounted
+// automatically the first time a file is read, unless a loose data directory exists so edits are not hidden from
+// hot loading. Mounting is thread safe, unmounting must wait until no loads are in flight.
+// Entries are aligned so uncompressed files are mapped straight out of the pack, compressed entries are
+// decompressed into memory.
+
+#pragma once
+
+#include "file_system.h"
+
+namespace pen
+{
+    static const u32 k_pack_magic = 0x4b504d50; // PMPK
+    static const u32 k_pack_version = 2;
+    static const u32 k_pack_check_seed = 0x9e3779b9; // second path hash, verified on lookup
+
+    namespace e_pack_entry_flags
+    {
+        enum pack_entry_flags_t
+        {
+            compressed = 1 << 0
+        };
+    }
+
+    struct pack_header
+    {
+        u32 magic;
+        u32 version;
+        u32 num_entries;
+        u32 alignment;
+    };
+
+    // num_entries follow the header sorted by hash
+    struct pack_entry
+    {
+        hash_id hash;        // pack_path_hash of the path relative to the working directory
+        u32     flags;       // e_pack_entry_flags
+        u32     size;        // uncompressed
+        u32     stored_size; // in the pack
+        u64     offset;      // from the start of the pack
+        u32     mtime;
+        hash_id check_hash; // pack_path_hash with k_pack_check_seed, tells apart paths which share a hash
+    };
+
+    pen_error filesystem_mount_pack(const c8* filename); // later mounts take precedence
+    void      filesystem_unmount_packs();
+    hash_id   pack_path_hash(const c8* filename, u32 seed = 0); // forward slashes, without a leading ./
+
+    // lz4 style block compression for pack entries, compress returns 0 if the output would not fit
+    u32  pack_compress_bound(u32 size);
+    u32  pack_compress(const void* src, u32 src_size, void* dst, u32 dst_capacity);
+    bool pack_decompress(const void* src, u32 src_size, void* dst, u32 dst_size);
+
+    // used by the platform file systems, return false when the file is not in a mounted pack
+    bool pack_read_file(const c8* filename, void** p_buffer, u32& buffer_size);
+    bool pack_map_file(const c8* filename, file_view& view);
+
+} // namespace pen
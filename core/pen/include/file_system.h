@@ -7,6 +7,9 @@
 // Can read files and also enumerate file system and volumes as an fs_tree_node.
 // Make sure to free p_buffer yourself allocated from filesystem_read_file_to_buffer.
 // Make sure to call filesystem_enum_free_mem with your fs_tree_node once finished with it.
+// filesystem_map_file maps a file read only so loaders can pass sub ranges straight to the renderer without a heap copy,
+// release pages of a view once they have been uploaded, and unmap with filesystem_unmap_file.
+// A file must not be truncated or rewritten in place while it is mapped.
 
 // Implemented with:
 //      win32 (windows)
@@ -26,8 +29,22 @@ namespace pen
         u32           num_children = 0;
     };
 
+    struct file_view
+    {
+        void*  data = nullptr;
+        size_t size = 0;
+        bool   mapped = false; // false when the platform fell back to reading into a heap buffer
+        bool   packed = false; // points into a mounted pack, see file_pack.h
+    };
+
+    struct file_watcher;
+    typedef void (*file_watcher_callback)(const c8* path, void* user_data);
+
     bool       filesystem_file_exists(const c8* filename);
     pen_error  filesystem_read_file_to_buffer(const c8* filename, void** p_buffer, u32& buffer_size);
+    pen_error  filesystem_map_file(const c8* filename, file_view& view);
+    void       filesystem_release_pages(const file_view& view, size_t offset, size_t size); // hint, data stays readable
+    void       filesystem_unmap_file(file_view& view);
     pen_error  filesystem_getmtime(const c8* filename, u32& mtime_out);
     size_t     filesystem_getsize(const c8* filename);
     void       filesystem_toggle_hidden_files();
@@ -39,4 +56,13 @@ namespace pen
     const c8** filesystem_get_user_directory(s32& directory_depth); // returns array of directories like the above
     s32        filesystem_exclude_slash_depth();
 
+    // change notifications for files written or moved into watched directories, inotify on linux.
+    // create returns nullptr where unsupported so callers can fall back to polling mtimes.
+    // read waits up to timeout_ms and calls back with each changed path, or nullptr if events were dropped.
+    // directories can be watched from a different thread to the one reading.
+    file_watcher* filesystem_create_watcher();
+    void          filesystem_destroy_watcher(file_watcher* watcher);
+    bool          filesystem_watch_directory(file_watcher* watcher, const c8* directory);
+    void          filesystem_read_watcher(file_watcher* watcher, u32 timeout_ms, file_watcher_callback changed, void* user_data);
+
 } // namespace pen
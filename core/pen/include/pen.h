@@ -52,6 +52,8 @@ namespace pen
         const c8*        window_title = "pen_app";
         pen_create_flags flags = e_pen_create_flags::renderer;
         u32              max_renderer_commands = 1 << 16; // space for max commands in cmd buffer
+        u32              renderer_cmd_payload_size = 32 << 20; // bytes of per frame memory for cmd payload data
+        u32              max_frames_in_flight = 1; // frames the user thread may run ahead of the render thread (1-3)
         void* (*user_thread_function)(void*) = nullptr;
         void* user_data = nullptr;
     };
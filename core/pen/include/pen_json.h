@@ -7,6 +7,10 @@
 // json file is kept in a char buffer and jsmn tokens are used to iterate.
 // this api does not use any vectors or maps to store the json data.
 
+// A json_doc is parsed once into a flat token array with precomputed subtree skips, child tables and key hashes.
+// json_view is a non-owning read only view into a doc, member lookup compares cached key hashes and array
+// or member indexing is O(1). json is a ref counted wrapper over the same doc, so [] and copies do not allocate.
+
 // Examples:
 // Load:
 // json j = load_from_file("filename");
@@ -33,6 +37,12 @@
 //
 // Print:
 // printf(j.dumps().c_str())
+//
+// Read only views:
+// json_doc* doc = json_doc_load_from_file("filename");
+// json_view v = json_doc_root(doc);
+// u32 value = v["key"][0].as_u32();
+// json_doc_release(doc);
 
 // To use unstrict json without the need for quotes around keys and string values
 // care must be taken with filenames, colons (:) need to be stripped from filenames (ie C:\windows)
@@ -54,7 +64,8 @@
 
 namespace pen
 {
-    struct json_object;
+    struct json_doc;
+    class json_view;
     class json;
 
     // functions
@@ -65,12 +76,59 @@ namespace pen
     Str to_str(const bool val);
     Str to_str(const json& val);
 
+    // docs are ref counted, load returns a doc with a single reference, or nullptr if the file or string fails to parse
+    json_doc* json_doc_load_from_file(const c8* filename);
+    json_doc* json_doc_load(const c8* json_str);
+    void      json_doc_add_ref(json_doc* doc);
+    void      json_doc_release(json_doc* doc);
+    json_view json_doc_root(const json_doc* doc);
+
+    class json_view
+    {
+      public:
+        json_view();
+        json_view(const json_doc* doc, s32 token, s32 key_token = -1);
+
+        Str        dumps() const;
+        Str        raw() const; // source text of this value, containers include the brackets
+        Str        key() const;
+        Str        name() const; // same as key
+        const c8*  key_cstr() const;
+        jsmntype_t type() const;
+        bool       is_null() const; // jsmntype_t == JSMN_UNDEFINED
+        u32        size() const;
+
+        json_view operator[](const c8* name) const;
+        json_view operator[](const u32 index) const;
+        json_view operator[](const s32 index) const;
+
+        // strings point into the doc and are null terminated, containers return default_value
+        const c8* as_cstr(const c8* default_value = nullptr) const;
+        Str       as_str(const c8* default_value = nullptr) const;
+        hash_id   as_hash_id(hash_id default_value = 0) const;
+        u32       as_u32(u32 default_value = 0) const;
+        s32       as_s32(s32 default_value = 0) const;
+        u64       as_u64(u64 default_value = 0) const;
+        s64       as_s64(s64 default_value = 0) const;
+        bool      as_bool(bool default_value = false) const;
+        f32       as_f32(f32 default_value = 0.0f) const;
+        u8        as_u8_hex(u8 default_value = 0) const;
+        u32       as_u32_hex(u32 default_value = 0) const;
+        Str       as_filename(const c8* default_value = nullptr) const;
+
+      private:
+        const json_doc* m_doc;
+        s32             m_token;
+        s32             m_key_token;
+    };
+
     class json
     {
       public:
         ~json();
         json();
         json(const json& other);
+        json(json_doc* doc, const json_view& view);
 
         static json load_from_file(const c8* filename);
         static json load(const c8* json_str);
@@ -82,6 +140,7 @@ namespace pen
         jsmntype_t type() const;
         bool       is_null() const; // jsmntype_t == JSMN_UNDEFINED
         u32        size() const;
+        json_view  view() const;
 
         json  operator[](const c8* name) const;
         json  operator[](const u32 index) const;
@@ -126,8 +185,10 @@ namespace pen
         }
 
       private:
-        json_object* m_internal_object;
-        void         copy(json* dst, const json& other);
+        json_doc*   m_doc;
+        json_view   m_view;
+        mutable c8* m_raw; // null terminated copy of container text for as_cstr
+        void        copy(json* dst, const json& other);
     };
 
     // inline functions
@@ -9,6 +9,7 @@
 //      OpenGLES3.1+ (android) (ios now depracated in favour of metal)
 //      Metal (osx, ios)
 //      Vulkan (win32) [wip]
+//      Null (any platform, no gpu or window, for cpu benchmarking)
 
 // Public api used by the user thread will store function call arguments in a command buffer
 // A dedicated thread will wait for commands and pass arguments to the direct:: functions.
@@ -26,6 +27,7 @@
 #define PEN_CAPS_TEXTURE_CUBE_ARRAY (1 << 4)
 #define PEN_CAPS_BACKBUFFER_BGRA (1 << 5)
 #define PEN_CAPS_VUP (1 << 6) // opengl viewport y-up
+#define PEN_CAPS_STRUCTURED_BUFFER (1 << 7) // read only structured buffers can be bound to the vertex shader
 
 // Texture format caps
 #define PEN_CAPS_TEX_FORMAT_BC1 (1 << 31)
@@ -368,14 +370,36 @@ namespace pen
         float padding_0, padding_1;
     };
 
+    // counts of what the render thread executed in one frame. commands are counted by the null renderer and the
+    // framebuffer cache by opengl, counters a backend does not track are zero
+    struct renderer_frame_stats
+    {
+        u64 frame = 0;
+        u32 cmds = 0;            // every direct:: call
+        u32 binds = 0;           // shaders, buffers, textures, targets and states
+        u32 draws = 0;
+        u32 dispatches = 0;
+        u64 vertices = 0;        // vertex or index count multiplied by instances
+        u32 instances = 0;
+        u32 creates = 0;
+        u32 releases = 0;
+        u64 bytes_uploaded = 0;  // buffer and texture data passed to create and update
+        u32 invalid_handles = 0; // unallocated or mismatched resource types
+        u32 framebuffer_hits = 0;
+        u32 framebuffer_misses = 0;
+        u32 framebuffer_evictions = 0; // released for being unused, over budget or referencing a released target
+        u32 framebuffers = 0;          // cached at the end of the frame
+    };
+
     // general accessors
     const c8*            renderer_get_shader_platform();
     bool                 renderer_viewport_vup();
     bool                 renderer_depth_0_to_1();
     const renderer_info& renderer_get_info();
+    renderer_frame_stats renderer_get_frame_stats(); // last completed frame
 
     // setup / hook functions
-    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands);
+    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands, u32 cmd_payload_size = 0);
     bool renderer_dispatch();
     void renderer_test_run();
     void renderer_test_enable();
@@ -384,6 +408,24 @@ namespace pen
     void       renderer_new_frame();
     void       renderer_set_current_ctx(render_ctx ctx);
     render_ctx renderer_get_main_context();
+
+    // deferred command lists, while a list is recording renderer_* calls made on the calling thread are appended to it.
+    // any thread can record, the main thread submits lists to the render thread in the order submit is called.
+    struct cmd_list;
+    cmd_list* renderer_cmd_list_create();
+    void      renderer_cmd_list_release(cmd_list* list);
+    void      renderer_cmd_list_begin(cmd_list* list);
+    void      renderer_cmd_list_end(cmd_list* list);
+    void      renderer_cmd_list_submit(cmd_list* list);
+    u32       renderer_cmd_list_size(const cmd_list* list);
+
+    // frame pipelining, consume_cmd_buffer blocks only while more than max frames (1-3) are queued on the render thread.
+    // more frames in flight trades input latency for throughput, the cmd buffer and payload ring are shared by all of them
+    void renderer_set_max_frames_in_flight(u32 frames);
+    u32  renderer_get_max_frames_in_flight();
+    u32  renderer_frames_in_flight();
+
+    // commands
     u32        renderer_create_clear_state(const clear_state& cs);
     void       renderer_clear(u32 clear_state_index, u32 array_index = 0);
     void       renderer_clear_texture(u32 clear_state_index, u32 texture);
@@ -4,6 +4,7 @@
 
 // Minimalist cross platform thread wrapper api.
 // Includes functions to create jobs, threads, mutex and semaphore.
+// And a task scheduler for many small units of work to be spread over a pool of worker threads.
 
 #pragma once
 
@@ -51,6 +52,19 @@ namespace pen
     }
     typedef e_thread_start_flags::thread_start_flags_t thread_start_flags;
 
+    // Tasks are executed by a pool of worker threads sized to the hardware.
+    // Each worker owns a deque, the owner pushes and pops at the back and idle workers steal from the front.
+    // A counter tracks completion of a group of tasks, it can be waited on or used as a dependency for other tasks.
+    // Waiting threads help execute tasks until the counter reaches zero.
+
+    struct task_counter
+    {
+        a_u32 value = {0};
+    };
+
+    typedef void (*task_func)(void* user_data, u32 thread_index);
+    typedef void (*task_range_func)(void* user_data, u32 start, u32 end, u32 thread_index);
+
     struct default_thread_info
     {
         u32   flags;
@@ -63,6 +77,7 @@ namespace pen
     thread* thread_create(dispatch_thread thread_func, u32 stack_size, void* thread_params, thread_start_flags flags);
     void    thread_sleep_ms(u32 milliseconds);
     void    thread_sleep_us(u32 microseconds);
+    u32     thread_get_hardware_threads();
 
     // Jobs
     bool jobs_terminate_all();
@@ -71,6 +86,18 @@ namespace pen
     void jobs_create_single_thread_update(single_thread_update_func func);
     void jobs_run_single_threaded();
 
+    // Tasks
+    // thread_index is unique for each pool worker in the range [1, tasks_num_threads), threads outside the pool share 0
+    // unless they register, which gives them their own queue and an index >= tasks_num_threads. waiting threads outside
+    // the pool only run tasks from their own queue, pool workers run any.
+    u32  tasks_num_threads();
+    u32  tasks_get_thread_index();
+    void tasks_register_thread();
+    void tasks_submit(task_func func, void* user_data, task_counter* counter, task_counter* dependency = nullptr);
+    void tasks_parallel_for(u32 count, u32 grain_size, task_range_func func, void* user_data, task_counter* counter);
+    void tasks_wait(task_counter* counter);
+    bool tasks_complete(task_counter* counter);
+
     // Mutex
     mutex* mutex_create();
     void   mutex_destroy(mutex* p_mutex);
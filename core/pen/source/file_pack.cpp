@@ -0,0 +1,429 @@
+// file_pack.cpp
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "file_pack.h"
+#include "console.h"
+#include "hash.h"
+#include "memory.h"
+#include "threads.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace pen;
+
+namespace
+{
+    struct mounted_pack
+    {
+        Str               filename;
+        file_view         view;
+        const pack_entry* entries;
+        u32               num_entries;
+    };
+    std::vector<mounted_pack> s_packs; // guarded by packs_mutex, lookups run on the async load threads
+
+    mutex* packs_mutex()
+    {
+        static mutex* s_mutex = mutex_create();
+        return s_mutex;
+    }
+
+    // set while the default pack is being mapped so its own reads go to the loose file system
+    thread_local bool t_mounting = false;
+
+    bool auto_mount_default_pack()
+    {
+        // loose data takes precedence so edits are picked up by hot loading, the pack is for shipped builds
+        fs_tree_node node;
+        if (filesystem_enum_directory("data", node) == PEN_ERR_OK)
+        {
+            filesystem_enum_free_mem(node);
+            return false;
+        }
+
+        t_mounting = true;
+        filesystem_mount_pack("data.pack");
+        t_mounting = false;
+        return true;
+    }
+
+    // copies the pack out under the lock, entries and views point into the mapping which stays valid until unmount
+    const pack_entry* find_entry(const c8* filename, mounted_pack& pack_out)
+    {
+        if (t_mounting)
+            return nullptr;
+
+        // thread safe one time init, before any lookups
+        static bool s_auto_mounted = auto_mount_default_pack();
+        (void)s_auto_mounted;
+
+        hash_id hh = pack_path_hash(filename);
+        hash_id check = pack_path_hash(filename, k_pack_check_seed);
+
+        const pack_entry* found = nullptr;
+
+        mutex_lock(packs_mutex());
+
+        for (s32 p = (s32)s_packs.size() - 1; p >= 0 && !found; --p)
+        {
+            const mounted_pack& pack = s_packs[p];
+
+            // toc is sorted by hash
+            s32 lo = 0;
+            s32 hi = (s32)pack.num_entries - 1;
+            while (lo <= hi)
+            {
+                s32 mid = (lo + hi) / 2;
+                if (pack.entries[mid].hash == hh)
+                {
+                    // a different path with the same hash is not in this pack
+                    if (pack.entries[mid].check_hash == check)
+                    {
+                        pack_out = pack;
+                        found = &pack.entries[mid];
+                    }
+                    break;
+                }
+
+                if (pack.entries[mid].hash < hh)
+                    lo = mid + 1;
+                else
+                    hi = mid - 1;
+            }
+        }
+
+        mutex_unlock(packs_mutex());
+        return found;
+    }
+
+    inline u32 read_u32(const u8* p)
+    {
+        u32 v;
+        memcpy(&v, p, sizeof(u32));
+        return v;
+    }
+
+    // lz4 style sequence: token (literal length << 4 | match length - 4), literals, u16 offset, extended lengths
+    u8* write_length(u8* op, u8* oend, u32 len)
+    {
+        while (len >= 255)
+        {
+            if (op >= oend)
+                return nullptr;
+
+            *op++ = 255;
+            len -= 255;
+        }
+
+        if (op >= oend)
+            return nullptr;
+
+        *op++ = (u8)len;
+        return op;
+    }
+
+    u8* write_sequence(u8* op, u8* oend, const u8* literals, u32 num_literals, u32 offset, u32 match_len)
+    {
+        if (op >= oend)
+            return nullptr;
+
+        u8* token = op++;
+        *token = (u8)((num_literals >= 15 ? 15 : num_literals) << 4);
+
+        if (num_literals >= 15)
+            if (!(op = write_length(op, oend, num_literals - 15)))
+                return nullptr;
+
+        if (op + num_literals > oend)
+            return nullptr;
+
+        memcpy(op, literals, num_literals);
+        op += num_literals;
+
+        // last sequence is literals only
+        if (match_len == 0)
+            return op;
+
+        if (op + 2 > oend)
+            return nullptr;
+
+        *op++ = (u8)(offset & 0xff);
+        *op++ = (u8)(offset >> 8);
+
+        u32 ml = match_len - 4;
+        *token |= (u8)(ml >= 15 ? 15 : ml);
+
+        if (ml >= 15)
+            if (!(op = write_length(op, oend, ml - 15)))
+                return nullptr;
+
+        return op;
+    }
+} // namespace
+
+namespace pen
+{
+    hash_id pack_path_hash(const c8* filename, u32 seed)
+    {
+        if (filename[0] == '.' && (filename[1] == '/' || filename[1] == '\\'))
+            filename += 2;
+
+        hash_murmur hm;
+        hm.begin(seed);
+
+        for (const c8* c = filename; *c; ++c)
+        {
+            c8 cc = *c == '\\' ? '/' : *c;
+            hm.add(&cc, 1);
+        }
+
+        return hm.end();
+    }
+
+    pen_error filesystem_mount_pack(const c8* filename)
+    {
+        mounted_pack pack;
+        pack.filename = filename;
+
+        pen_error err = filesystem_map_file(filename, pack.view);
+        if (err != PEN_ERR_OK)
+            return err;
+
+        const pack_header* header = (const pack_header*)pack.view.data;
+        if (pack.view.size < sizeof(pack_header) || header->magic != k_pack_magic || header->version != k_pack_version ||
+            pack.view.size < sizeof(pack_header) + (size_t)header->num_entries * sizeof(pack_entry))
+        {
+            PEN_LOG("[error] file pack - invalid pack file: %s", filename);
+            filesystem_unmap_file(pack.view);
+            return PEN_ERR_FAILED;
+        }
+
+        pack.entries = (const pack_entry*)(header + 1);
+        pack.num_entries = header->num_entries;
+
+        mutex_lock(packs_mutex());
+        s_packs.push_back(pack);
+        mutex_unlock(packs_mutex());
+
+        return PEN_ERR_OK;
+    }
+
+    void filesystem_unmount_packs()
+    {
+        mutex_lock(packs_mutex());
+
+        for (auto& pack : s_packs)
+            filesystem_unmap_file(pack.view);
+
+        s_packs.clear();
+
+        mutex_unlock(packs_mutex());
+    }
+
+    bool pack_read_file(const c8* filename, void** p_buffer, u32& buffer_size)
+    {
+        mounted_pack      pack;
+        const pack_entry* entry = find_entry(filename, pack);
+        if (!entry)
+            return false;
+
+        const u8* src = (const u8*)pack.view.data + entry->offset;
+
+        // null terminated like the loose file reads
+        u8* data = (u8*)memory_alloc(entry->size + 1);
+        data[entry->size] = '\0';
+
+        if (entry->flags & e_pack_entry_flags::compressed)
+        {
+            if (!pack_decompress(src, entry->stored_size, data, entry->size))
+            {
+                PEN_LOG("[error] file pack - corrupt entry %s in %s", filename, pack.filename.c_str());
+                memory_free(data);
+                return false;
+            }
+        }
+        else
+        {
+            memcpy(data, src, entry->size);
+        }
+
+        *p_buffer = data;
+        buffer_size = entry->size;
+        return true;
+    }
+
+    bool pack_map_file(const c8* filename, file_view& view)
+    {
+        mounted_pack      pack;
+        const pack_entry* entry = find_entry(filename, pack);
+        if (!entry)
+            return false;
+
+        if (entry->flags & e_pack_entry_flags::compressed)
+        {
+            u32 size = 0;
+            if (!pack_read_file(filename, &view.data, size))
+                return false;
+
+            view.size = size;
+            view.mapped = false;
+            view.packed = false;
+            return true;
+        }
+
+        // points straight into the pack
+        view.data = (u8*)pack.view.data + entry->offset;
+        view.size = entry->size;
+        view.mapped = pack.view.mapped;
+        view.packed = true;
+        return true;
+    }
+
+    u32 pack_compress_bound(u32 size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    u32 pack_compress(const void* src, u32 src_size, void* dst, u32 dst_capacity)
+    {
+        static const u32 k_hash_bits = 14;
+        static const u32 k_min_match = 4;
+        static const u32 k_last_literals = 5;   // the final bytes are always literals
+        static const u32 k_match_safe_end = 12; // no match may start this close to the end
+        static const u32 k_max_offset = 65535;
+
+        const u8* ip = (const u8*)src;
+        const u8* iend = ip + src_size;
+        const u8* anchor = ip;
+        u8*       op = (u8*)dst;
+        u8*       oend = op + dst_capacity;
+
+        if (src_size > k_match_safe_end)
+        {
+            u32* table = (u32*)memory_alloc(sizeof(u32) << k_hash_bits);
+            memset(table, 0, sizeof(u32) << k_hash_bits);
+
+            const u8* base = (const u8*)src;
+            const u8* match_limit = iend - k_last_literals;
+            const u8* mf_limit = iend - k_match_safe_end;
+
+            while (ip < mf_limit)
+            {
+                u32 seq = read_u32(ip);
+                u32 h = (seq * 2654435761u) >> (32 - k_hash_bits);
+
+                const u8* ref = base + table[h];
+                table[h] = (u32)(ip - base);
+
+                if (ref >= ip || (u32)(ip - ref) > k_max_offset || read_u32(ref) != seq)
+                {
+                    ++ip;
+                    continue;
+                }
+
+                const u8* mp = ip + k_min_match;
+                const u8* rp = ref + k_min_match;
+                while (mp < match_limit && *mp == *rp)
+                {
+                    ++mp;
+                    ++rp;
+                }
+
+                op = write_sequence(op, oend, anchor, (u32)(ip - anchor), (u32)(ip - ref), (u32)(mp - ip));
+                if (!op)
+                    break;
+
+                ip = mp;
+                anchor = ip;
+            }
+
+            memory_free(table);
+
+            if (!op)
+                return 0;
+        }
+
+        op = write_sequence(op, oend, anchor, (u32)(iend - anchor), 0, 0);
+        if (!op)
+            return 0;
+
+        return (u32)(op - (u8*)dst);
+    }
+
+    bool pack_decompress(const void* src, u32 src_size, void* dst, u32 dst_size)
+    {
+        const u8* ip = (const u8*)src;
+        const u8* iend = ip + src_size;
+        u8*       op = (u8*)dst;
+        u8*       oend = op + dst_size;
+
+        while (ip < iend)
+        {
+            u8 token = *ip++;
+
+            // literals
+            u32 num_literals = token >> 4;
+            if (num_literals == 15)
+            {
+                u8 b;
+                do
+                {
+                    if (ip >= iend)
+                        return false;
+
+                    b = *ip++;
+                    num_literals += b;
+                } while (b == 255);
+            }
+
+            if (num_literals > (u32)(iend - ip) || num_literals > (u32)(oend - op))
+                return false;
+
+            memcpy(op, ip, num_literals);
+            ip += num_literals;
+            op += num_literals;
+
+            // last sequence has no match
+            if (ip >= iend)
+                break;
+
+            // match
+            if (iend - ip < 2)
+                return false;
+
+            u32 offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+
+            if (offset == 0 || offset > (u32)(op - (u8*)dst))
+                return false;
+
+            u32 match_len = token & 15;
+            if (match_len == 15)
+            {
+                u8 b;
+                do
+                {
+                    if (ip >= iend)
+                        return false;
+
+                    b = *ip++;
+                    match_len += b;
+                } while (b == 255);
+            }
+            match_len += 4;
+
+            if (match_len > (u32)(oend - op))
+                return false;
+
+            // matches may overlap the output, copy forwards
+            const u8* mp = op - offset;
+            for (u32 i = 0; i < match_len; ++i)
+                *op++ = *mp++;
+        }
+
+        return op == oend;
+    }
+
+} // namespace pen
@@ -241,7 +241,9 @@ namespace
 - (instancetype)initWithView:(nonnull MTKView*)view
 {
     [super init];
-    pen::renderer_init((void*)view, false, s_context.creation_params.max_renderer_commands);
+    pen::renderer_set_max_frames_in_flight(s_context.creation_params.max_frames_in_flight);
+    pen::renderer_init((void*)view, false, s_context.creation_params.max_renderer_commands,
+                       s_context.creation_params.renderer_cmd_payload_size);
     return self;
 }
 - (void)mtkView:(nonnull MTKView*)view drawableSizeWillChange:(CGSize)size
@@ -7,6 +7,9 @@
 #include "renderer.h"
 #include "threads.h"
 
+#include <algorithm>
+#include <thread>
+
 #define MAX_THREADS 32 // lazy fixed sized array to avoid any thread saftey issues
 
 using namespace pen;
@@ -16,6 +19,294 @@ namespace
     job                        s_jt[MAX_THREADS];
     u32                        s_num_active_threads = 0;
     single_thread_update_func* s_single_thread_funcs = nullptr;
+
+#if !PEN_SINGLE_THREADED
+    struct task
+    {
+        task_func       func;
+        task_range_func range_func;
+        void*           user_data;
+        u32             start;
+        u32             end;
+        task_counter*   counter;
+        task_counter*   dependency;
+    };
+
+    void run_task(const task& t, u32 thread_index)
+    {
+        if (t.range_func)
+            t.range_func(t.user_data, t.start, t.end, thread_index);
+        else
+            t.func(t.user_data, thread_index);
+    }
+
+    static const u32 k_max_task_workers = 63;
+    static const u32 k_max_task_external = 4;  // threads outside the pool which register for their own queue
+    static const u32 k_task_queue_size = 4096; // per thread, power of 2. tasks run inline when a queue is full
+    static const u32 k_task_spin_count = 64;   // yields before a worker goes to sleep
+
+    struct task_queue
+    {
+        pen::mutex* lock = nullptr;
+        task*       tasks = nullptr;
+        u32         front = 0; // thieves take from the front
+        u32         back = 0;  // owner pushes and pops at the back
+    };
+
+    struct task_scheduler
+    {
+        // queue 0 is shared by threads outside the pool, registered threads have queues after the workers
+        task_queue      queues[k_max_task_workers + 1 + k_max_task_external];
+        u32             worker_index[k_max_task_workers + 1];
+        u32             num_workers = 0;
+        a_u32           num_external = {0};
+        pen::semaphore* sem_wake = nullptr;
+        a_u32           num_sleeping = {0};
+        a_u32           num_exited = {0};
+        a_bool          exit = {false};
+        pen::mutex*     deferred_lock = nullptr;
+        task*           deferred = nullptr; // tasks waiting on a dependency
+        a_u32           num_deferred = {0};
+    };
+    task_scheduler   s_tasks;
+    thread_local u32 s_task_thread_index = 0;
+
+    bool queue_push(task_queue& q, const task& t)
+    {
+        pen::mutex_lock(q.lock);
+
+        if (q.back - q.front >= k_task_queue_size)
+        {
+            pen::mutex_unlock(q.lock);
+            return false;
+        }
+
+        q.tasks[q.back++ & (k_task_queue_size - 1)] = t;
+        pen::mutex_unlock(q.lock);
+        return true;
+    }
+
+    bool queue_pop(task_queue& q, task& t)
+    {
+        pen::mutex_lock(q.lock);
+
+        if (q.back == q.front)
+        {
+            pen::mutex_unlock(q.lock);
+            return false;
+        }
+
+        t = q.tasks[--q.back & (k_task_queue_size - 1)];
+        pen::mutex_unlock(q.lock);
+        return true;
+    }
+
+    bool queue_steal(task_queue& q, task& t)
+    {
+        pen::mutex_lock(q.lock);
+
+        if (q.back == q.front)
+        {
+            pen::mutex_unlock(q.lock);
+            return false;
+        }
+
+        t = q.tasks[q.front++ & (k_task_queue_size - 1)];
+        pen::mutex_unlock(q.lock);
+        return true;
+    }
+
+    u32 num_queues()
+    {
+        return s_tasks.num_workers + 1 + std::min<u32>(pen_atomic_load(s_tasks.num_external), k_max_task_external);
+    }
+
+    bool has_tasks()
+    {
+        u32 nq = num_queues();
+        for (u32 i = 0; i < nq; ++i)
+        {
+            task_queue& q = s_tasks.queues[i];
+
+            pen::mutex_lock(q.lock);
+            bool empty = q.back == q.front;
+            pen::mutex_unlock(q.lock);
+
+            if (!empty)
+                return true;
+        }
+
+        return false;
+    }
+
+    // own queue first (most recently pushed), then pool workers steal the oldest task from others. threads outside
+    // the pool only run their own tasks while waiting, so they are not held up by unrelated work
+    bool get_task(u32 thread_index, task& t)
+    {
+        if (queue_pop(s_tasks.queues[thread_index], t))
+            return true;
+
+        if (thread_index == 0 || thread_index > s_tasks.num_workers)
+            return false;
+
+        u32 nq = num_queues();
+        for (u32 i = 1; i < nq; ++i)
+            if (queue_steal(s_tasks.queues[(thread_index + i) % nq], t))
+                return true;
+
+        return false;
+    }
+
+    void complete_task(const task& t, u32 thread_index);
+
+    void wake_workers(u32 count)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        u32 n = std::min<u32>(count, s_tasks.num_sleeping);
+        for (u32 i = 0; i < n; ++i)
+            pen::semaphore_post(s_tasks.sem_wake, 1);
+    }
+
+    void enqueue_task(const task& t)
+    {
+        // without workers, tasks run at the point of submission
+        if (s_tasks.num_workers == 0 || !queue_push(s_tasks.queues[s_task_thread_index], t))
+        {
+            complete_task(t, s_task_thread_index);
+            return;
+        }
+
+        wake_workers(1);
+    }
+
+    void release_deferred_tasks()
+    {
+        // tasks are enqueued outside of the lock, they may run inline and release more
+        task* ready = nullptr;
+
+        pen::mutex_lock(s_tasks.deferred_lock);
+
+        u32 i = 0;
+        while (i < (u32)sb_count(s_tasks.deferred))
+        {
+            task t = s_tasks.deferred[i];
+            if (pen_atomic_load(t.dependency->value) > 0)
+            {
+                ++i;
+                continue;
+            }
+
+            // swap remove
+            s_tasks.deferred[i] = sb_last(s_tasks.deferred);
+            stb__sbn(s_tasks.deferred)--;
+            s_tasks.num_deferred--;
+
+            sb_push(ready, t);
+        }
+
+        pen::mutex_unlock(s_tasks.deferred_lock);
+
+        u32 num_ready = sb_count(ready);
+        for (u32 r = 0; r < num_ready; ++r)
+            enqueue_task(ready[r]);
+
+        sb_free(ready);
+    }
+
+    void complete_task(const task& t, u32 thread_index)
+    {
+        run_task(t, thread_index);
+
+        if (!t.counter)
+            return;
+
+        if (--t.counter->value == 0 && pen_atomic_load(s_tasks.num_deferred) > 0)
+            release_deferred_tasks();
+    }
+
+    void* task_worker_thread(void* params)
+    {
+        u32 thread_index = *(u32*)params;
+        s_task_thread_index = thread_index;
+
+        task t;
+        u32  spin = 0;
+        while (!s_tasks.exit)
+        {
+            if (get_task(thread_index, t))
+            {
+                complete_task(t, thread_index);
+                spin = 0;
+                continue;
+            }
+
+            if (++spin < k_task_spin_count)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // publish sleeping before the final check, so a submitter will either see us or we will see its task
+            spin = 0;
+            s_tasks.num_sleeping++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!has_tasks() && !s_tasks.exit)
+                pen::semaphore_wait(s_tasks.sem_wake);
+
+            s_tasks.num_sleeping--;
+        }
+
+        s_tasks.num_exited++;
+        return PEN_THREAD_OK;
+    }
+
+    bool init_tasks()
+    {
+        // callers of tasks_wait help out, so leave them a core
+        u32 hw = pen::thread_get_hardware_threads();
+        u32 num_workers = hw > 1 ? std::min<u32>(hw - 1, k_max_task_workers) : 0;
+
+        for (u32 i = 0; i < num_workers + 1 + k_max_task_external; ++i)
+        {
+            s_tasks.queues[i].lock = pen::mutex_create();
+            s_tasks.queues[i].tasks = (task*)pen::memory_alloc(sizeof(task) * k_task_queue_size);
+        }
+
+        s_tasks.deferred_lock = pen::mutex_create();
+        s_tasks.sem_wake = pen::semaphore_create(0, k_max_task_workers * k_task_queue_size);
+        s_tasks.num_workers = num_workers;
+
+        for (u32 i = 0; i < num_workers; ++i)
+        {
+            s_tasks.worker_index[i] = i + 1;
+            pen::thread_create(task_worker_thread, 1024 * 1024, &s_tasks.worker_index[i],
+                               pen::e_thread_start_flags::detached);
+        }
+
+        return true;
+    }
+
+    void tasks_init()
+    {
+        // thread safe one time init on first use
+        static bool s_initialised = init_tasks();
+        PEN_UNUSED(s_initialised);
+    }
+
+    bool tasks_terminate()
+    {
+        if (s_tasks.num_workers == 0)
+            return true;
+
+        s_tasks.exit = true;
+        for (u32 i = 0; i < s_tasks.num_workers; ++i)
+            pen::semaphore_post(s_tasks.sem_wake, 1);
+
+        return pen_atomic_load(s_tasks.num_exited) == s_tasks.num_workers;
+    }
+#endif
 } // namespace
 
 namespace pen
@@ -63,7 +354,12 @@ namespace pen
             }
         }
 
+#if !PEN_SINGLE_THREADED
+        // task workers go last, jobs may still be waiting on tasks
+        return tasks_terminate();
+#else
         return true;
+#endif
     }
 
     void jobs_create_single_thread_update(single_thread_update_func func)
@@ -79,4 +375,143 @@ namespace pen
             ((single_thread_update_func)s_single_thread_funcs[i])();
         }
     }
+
+#if !PEN_SINGLE_THREADED
+    u32 tasks_num_threads()
+    {
+        tasks_init();
+        return s_tasks.num_workers + 1;
+    }
+
+    u32 tasks_get_thread_index()
+    {
+        return s_task_thread_index;
+    }
+
+    void tasks_register_thread()
+    {
+        tasks_init();
+
+        if (s_task_thread_index != 0)
+            return;
+
+        u32 slot = s_tasks.num_external++;
+        if (slot >= k_max_task_external)
+        {
+            PEN_LOG("[warning] tasks - more than %i threads registered, sharing queue 0", k_max_task_external);
+            return;
+        }
+
+        s_task_thread_index = s_tasks.num_workers + 1 + slot;
+    }
+
+    void tasks_submit(task_func func, void* user_data, task_counter* counter, task_counter* dependency)
+    {
+        tasks_init();
+
+        if (counter)
+            counter->value++;
+
+        task t = {func, nullptr, user_data, 0, 0, counter, dependency};
+
+        if (dependency && pen_atomic_load(dependency->value) > 0)
+        {
+            // publish the deferred count before re-checking, so the dependency completing will see this task
+            pen::mutex_lock(s_tasks.deferred_lock);
+            s_tasks.num_deferred++;
+
+            if (pen_atomic_load(dependency->value) > 0)
+            {
+                sb_push(s_tasks.deferred, t);
+                pen::mutex_unlock(s_tasks.deferred_lock);
+                return;
+            }
+
+            s_tasks.num_deferred--;
+            pen::mutex_unlock(s_tasks.deferred_lock);
+        }
+
+        enqueue_task(t);
+    }
+
+    void tasks_parallel_for(u32 count, u32 grain_size, task_range_func func, void* user_data, task_counter* counter)
+    {
+        tasks_init();
+
+        if (count == 0)
+            return;
+
+        grain_size = std::max<u32>(grain_size, 1);
+        u32 num_tasks = (count + grain_size - 1) / grain_size;
+
+        if (counter)
+            counter->value += num_tasks;
+
+        u32 thread_index = s_task_thread_index;
+        for (u32 i = 0; i < num_tasks; ++i)
+        {
+            u32  start = i * grain_size;
+            task t = {nullptr, func, user_data, start, std::min<u32>(start + grain_size, count), counter, nullptr};
+
+            if (s_tasks.num_workers == 0 || !queue_push(s_tasks.queues[thread_index], t))
+                complete_task(t, thread_index);
+        }
+
+        wake_workers(num_tasks);
+    }
+
+    void tasks_wait(task_counter* counter)
+    {
+        u32  thread_index = s_task_thread_index;
+        task t;
+
+        while (pen_atomic_load(counter->value) > 0)
+        {
+            if (s_tasks.num_workers > 0 && get_task(thread_index, t))
+                complete_task(t, thread_index);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    bool tasks_complete(task_counter* counter)
+    {
+        return pen_atomic_load(counter->value) == 0;
+    }
+#else
+    // single threaded platforms run tasks at the point of submission
+    u32 tasks_num_threads()
+    {
+        return 1;
+    }
+
+    u32 tasks_get_thread_index()
+    {
+        return 0;
+    }
+
+    void tasks_register_thread()
+    {
+    }
+
+    void tasks_submit(task_func func, void* user_data, task_counter* counter, task_counter* dependency)
+    {
+        func(user_data, 0);
+    }
+
+    void tasks_parallel_for(u32 count, u32 grain_size, task_range_func func, void* user_data, task_counter* counter)
+    {
+        if (count > 0)
+            func(user_data, 0, count, 0);
+    }
+
+    void tasks_wait(task_counter* counter)
+    {
+    }
+
+    bool tasks_complete(task_counter* counter)
+    {
+        return true;
+    }
+#endif
 } // namespace pen
@@ -9,6 +9,7 @@
 #include "os.h"
 #include "pen.h"
 #include "renderer.h"
+#include "renderer_shared.h"
 #include "threads.h"
 #include "timer.h"
 #include "types.h"
@@ -73,6 +74,8 @@ namespace
     u32                 s_error_code = 0;
     bool                s_pen_terminate_app = false;
     bool                s_windowed = false;
+    bool                s_headless = false;
+    u64                 s_headless_frames = 0; // terminate after this many frames, 0 runs until the app exits
     pen_creation_params s_creation_params;
 
     void users()
@@ -228,7 +231,9 @@ namespace
         }
 
         // inits renderer and loops in wait for jobs, calling os update
-        renderer_init(nullptr, true, s_creation_params.max_renderer_commands);
+        renderer_set_max_frames_in_flight(s_creation_params.max_frames_in_flight);
+        renderer_init(nullptr, true, s_creation_params.max_renderer_commands,
+                      s_creation_params.renderer_cmd_payload_size);
 
         // exit, kill other threads and wait
         pen::jobs_terminate_all();
@@ -239,6 +244,24 @@ namespace
         return s_error_code;
     }
 
+    // no display or gl context, requires the null renderer
+    int pen_run_headless(int argc, char** argv)
+    {
+        renderer_set_max_frames_in_flight(s_creation_params.max_frames_in_flight);
+        renderer_init(nullptr, true, s_creation_params.max_renderer_commands,
+                      s_creation_params.renderer_cmd_payload_size);
+
+        pen::jobs_terminate_all();
+
+        renderer_frame_stats fs = renderer_get_frame_stats();
+        PEN_LOG("headless: %llu frames, last frame: %u cmds, %u binds, %u draws, %u dispatches, %llu vertices, %llu "
+                "bytes uploaded, %u invalid handles",
+                (unsigned long long)_renderer_frame_index(), fs.cmds, fs.binds, fs.draws, fs.dispatches, (unsigned long long)fs.vertices,
+                (unsigned long long)fs.bytes_uploaded, fs.invalid_handles);
+
+        return s_error_code;
+    }
+
     int pen_run_console_app()
     {
         for (;;)
@@ -525,7 +548,31 @@ int main(int argc, char* argv[])
     pen_window.sample_count = pc.window_sample_count;
     s_creation_params = pc;
 
-    if (pc.flags & e_pen_create_flags::renderer)
+    for (s32 i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-headless") == 0)
+        {
+            s_headless = true;
+        }
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+        {
+            s_headless_frames = strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+
+#ifndef PEN_RENDERER_NULL
+    if (s_headless)
+    {
+        PEN_LOG("[error] -headless requires a build with --renderer=null, running windowed");
+        s_headless = false;
+    }
+#endif
+
+    if (pc.flags & e_pen_create_flags::renderer && s_headless)
+    {
+        pen_run_headless(argc, argv);
+    }
+    else if (pc.flags & e_pen_create_flags::renderer)
     {
         pen_run_windowed(argc, argv);
     }
@@ -558,6 +605,9 @@ namespace pen
         if (s_windowed)
             update_window();
 
+        if (s_headless && s_headless_frames && _renderer_frame_index() >= s_headless_frames)
+            os_terminate(0);
+
         // Check for terminate and poll terminated jobs
         if (s_pen_terminate_app)
         {
@@ -1110,6 +1110,7 @@ namespace pen
                 info.caps |= PEN_CAPS_COMPUTE;
                 info.caps |= PEN_CAPS_TEXTURE_CUBE_ARRAY;
                 info.caps |= PEN_CAPS_BACKBUFFER_BGRA;
+                info.caps |= PEN_CAPS_STRUCTURED_BUFFER;
             }
         }
 
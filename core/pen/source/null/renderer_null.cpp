@@ -0,0 +1,523 @@
+// renderer_null.cpp
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Renderer backend with no gpu or window, build with --renderer=null.
+// Resources only allocate a slot which records their type, so handles can be validated as they are bound, and every
+// direct:: call is counted into renderer_frame_stats. Everything up to the point of submission to a gpu runs the same
+// as it would on a real backend, which makes the cpu side of the engine measurable on machines without a display.
+
+#include "console.h"
+#include "data_struct.h"
+#include "memory.h"
+#include "os.h"
+#include "pen.h"
+#include "renderer.h"
+#include "renderer_shared.h"
+#include "threads.h"
+
+#include <string.h>
+
+using namespace pen;
+
+namespace
+{
+    namespace e_null_resource
+    {
+        enum null_resource_t
+        {
+            none = 0,
+            clear_state,
+            shader,
+            program,
+            input_layout,
+            buffer,
+            texture,
+            render_target,
+            sampler,
+            raster_state,
+            blend_state,
+            depth_stencil_state,
+            count
+        };
+    }
+    typedef e_null_resource::null_resource_t null_resource_type;
+
+    const c8* k_null_resource_names[] = {"none",
+                                         "clear_state",
+                                         "shader",
+                                         "program",
+                                         "input_layout",
+                                         "buffer",
+                                         "texture",
+                                         "render_target",
+                                         "sampler",
+                                         "raster_state",
+                                         "blend_state",
+                                         "depth_stencil_state"};
+    static_assert(PEN_ARRAY_SIZE(k_null_resource_names) == e_null_resource::count, "mismatched resource names");
+
+    const u32 k_buffer_mask = 1 << e_null_resource::buffer;
+    const u32 k_texture_mask = 1 << e_null_resource::texture | 1 << e_null_resource::render_target;
+    const u32 k_shader_mask = 1 << e_null_resource::shader | 1 << e_null_resource::program;
+
+    struct null_resource
+    {
+        u32 type;
+        u32 size; // bytes for buffers
+    };
+
+    res_pool<null_resource>               _res_pool;
+    renderer_frame_stats                  s_frame; // recording on the render thread
+    multi_buffer<renderer_frame_stats, 2> s_frame_stats;
+    renderer_info                         s_renderer_info;
+
+    void create_resource(u32 slot, null_resource_type type, u32 size = 0)
+    {
+        _res_pool.grow(slot);
+        _res_pool[slot].type = type;
+        _res_pool[slot].size = size;
+
+        s_frame.cmds++;
+        s_frame.creates++;
+    }
+
+    void release_resource(u32 slot, u32 type_mask, const c8* usage)
+    {
+        s_frame.cmds++;
+        s_frame.releases++;
+
+        if (slot >= _res_pool._capacity || !(type_mask & (1 << _res_pool[slot].type)))
+        {
+            s_frame.invalid_handles++;
+            PEN_LOG("[error] null renderer - %s with invalid handle %u", usage, slot);
+            return;
+        }
+
+        _res_pool[slot].type = e_null_resource::none;
+        _res_pool[slot].size = 0;
+    }
+
+    // 0 and PEN_INVALID_HANDLE unbind, anything else must be a live resource of one of the types in the mask
+    bool validate(u32 slot, u32 type_mask, const c8* usage)
+    {
+        if (is_invalid_or_null(slot))
+            return true;
+
+        if (slot < _res_pool._capacity && (type_mask & (1 << _res_pool[slot].type)))
+            return true;
+
+        s_frame.invalid_handles++;
+
+        u32 type = slot < _res_pool._capacity ? _res_pool[slot].type : (u32)e_null_resource::none;
+        PEN_LOG("[error] null renderer - %s with invalid handle %u (%s)", usage, slot, k_null_resource_names[type]);
+        return false;
+    }
+
+    void bind(u32 slot, u32 type_mask, const c8* usage)
+    {
+        s_frame.cmds++;
+        s_frame.binds++;
+        validate(slot, type_mask, usage);
+    }
+
+    void draw(u64 vertices, u32 instances)
+    {
+        s_frame.cmds++;
+        s_frame.draws++;
+        s_frame.vertices += vertices * instances;
+        s_frame.instances += instances;
+    }
+} // namespace
+
+namespace pen
+{
+    a_u64 g_gpu_total;
+
+    u32 direct::renderer_initialise(void*, u32 bb_res, u32 bb_depth_res)
+    {
+        _res_pool.init(2048);
+
+        s_renderer_info.api_version = "null";
+        s_renderer_info.shader_version = "none";
+        s_renderer_info.renderer = "null";
+        s_renderer_info.vendor = "pmtech";
+        s_renderer_info.renderer_cmd = "-renderer null";
+
+        // report the caps of the desktop opengl backend, so headless runs take the same code paths as the linux build.
+        // there are no timer queries to back PEN_CAPS_GPU_TIMER
+        s_renderer_info.caps |= PEN_CAPS_VUP;
+        s_renderer_info.caps |= PEN_CAPS_DEPTH_CLAMP;
+        s_renderer_info.caps |= PEN_CAPS_TEXTURE_CUBE_ARRAY;
+        s_renderer_info.caps |= PEN_CAPS_COMPUTE;
+        s_renderer_info.caps |= PEN_CAPS_TEX_FORMAT_BC1;
+        s_renderer_info.caps |= PEN_CAPS_TEX_FORMAT_BC2;
+        s_renderer_info.caps |= PEN_CAPS_TEX_FORMAT_BC3;
+
+        create_resource(bb_res, e_null_resource::render_target);
+        create_resource(bb_depth_res, e_null_resource::render_target);
+
+        s_frame = renderer_frame_stats();
+        return PEN_ERR_OK;
+    }
+
+    void direct::renderer_shutdown()
+    {
+        memset(_res_pool._resources, 0x0, sizeof(null_resource) * _res_pool._capacity);
+    }
+
+    const renderer_info& renderer_get_info()
+    {
+        return s_renderer_info;
+    }
+
+    renderer_frame_stats renderer_get_frame_stats()
+    {
+        return s_frame_stats.frontbuffer();
+    }
+
+    const c8* renderer_get_shader_platform()
+    {
+        // shader data is loaded for reflection info only, the glsl build is used as it is built on every platform
+        return "glsl";
+    }
+
+    bool renderer_viewport_vup()
+    {
+        return true;
+    }
+
+    bool renderer_depth_0_to_1()
+    {
+        return false;
+    }
+
+    void direct::renderer_sync()
+    {
+        // nothing to sync with
+    }
+
+    void direct::renderer_retain()
+    {
+        // no auto release objects
+    }
+
+    void direct::renderer_new_frame()
+    {
+        _renderer_new_frame();
+    }
+
+    void direct::renderer_end_frame()
+    {
+        _renderer_end_frame();
+    }
+
+    void direct::renderer_present()
+    {
+        s_frame.cmds++;
+        s_frame.frame = _renderer_frame_index();
+
+        s_frame_stats.backbuffer() = s_frame;
+        s_frame_stats.swap_buffers();
+
+        s_frame = renderer_frame_stats();
+    }
+
+    void direct::renderer_create_clear_state(const clear_state& cs, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::clear_state);
+    }
+
+    void direct::renderer_clear(u32 clear_state_index, u32 colour_slice, u32 depth_slice)
+    {
+        s_frame.cmds++;
+        validate(clear_state_index, 1 << e_null_resource::clear_state, "clear");
+    }
+
+    void direct::renderer_clear_texture(u32 clear_state_index, u32 texture)
+    {
+        s_frame.cmds++;
+        validate(clear_state_index, 1 << e_null_resource::clear_state, "clear_texture");
+        validate(texture, k_texture_mask, "clear_texture");
+    }
+
+    void direct::renderer_load_shader(const shader_load_params& params, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::shader);
+    }
+
+    void direct::renderer_set_shader(u32 shader_index, u32 shader_type)
+    {
+        bind(shader_index, k_shader_mask, "set_shader");
+    }
+
+    void direct::renderer_create_input_layout(const input_layout_creation_params& params, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::input_layout);
+    }
+
+    void direct::renderer_set_input_layout(u32 layout_index)
+    {
+        bind(layout_index, 1 << e_null_resource::input_layout, "set_input_layout");
+    }
+
+    void direct::renderer_link_shader_program(const shader_link_params& params, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::program);
+    }
+
+    void direct::renderer_create_buffer(const buffer_creation_params& params, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::buffer, params.buffer_size);
+
+        if (params.data)
+            s_frame.bytes_uploaded += params.buffer_size;
+    }
+
+    void direct::renderer_set_vertex_buffers(u32* buffer_indices, u32 num_buffers, u32 start_slot, const u32* strides,
+                                             const u32* offsets)
+    {
+        for (u32 i = 0; i < num_buffers; ++i)
+            bind(buffer_indices[i], k_buffer_mask, "set_vertex_buffers");
+    }
+
+    void direct::renderer_set_index_buffer(u32 buffer_index, u32 format, u32 offset)
+    {
+        bind(buffer_index, k_buffer_mask, "set_index_buffer");
+    }
+
+    void direct::renderer_set_constant_buffer(u32 buffer_index, u32 unit, u32 flags)
+    {
+        bind(buffer_index, k_buffer_mask, "set_constant_buffer");
+    }
+
+    void direct::renderer_set_structured_buffer(u32 buffer_index, u32 unit, u32 flags)
+    {
+        bind(buffer_index, k_buffer_mask, "set_structured_buffer");
+    }
+
+    void direct::renderer_update_buffer(u32 buffer_index, const void* data, u32 data_size, u32 offset)
+    {
+        s_frame.cmds++;
+        s_frame.bytes_uploaded += data_size;
+
+        if (!validate(buffer_index, k_buffer_mask, "update_buffer") || is_invalid_or_null(buffer_index))
+            return;
+
+        if (offset + data_size > _res_pool[buffer_index].size)
+        {
+            s_frame.invalid_handles++;
+            PEN_LOG("[error] null renderer - update_buffer writes %u bytes at offset %u of buffer %u (%u bytes)",
+                    data_size, offset, buffer_index, _res_pool[buffer_index].size);
+        }
+    }
+
+    void direct::renderer_create_texture(const texture_creation_params& tcp, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::texture);
+
+        if (tcp.data)
+            s_frame.bytes_uploaded += tcp.data_size;
+    }
+
+    void direct::renderer_create_sampler(const sampler_creation_params& scp, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::sampler);
+    }
+
+    void direct::renderer_set_texture(u32 texture_index, u32 sampler_index, u32 unit, u32 bind_flags)
+    {
+        bind(texture_index, k_texture_mask, "set_texture");
+        validate(sampler_index, 1 << e_null_resource::sampler, "set_texture sampler");
+    }
+
+    void direct::renderer_create_raster_state(const raster_state_creation_params& rscp, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::raster_state);
+    }
+
+    void direct::renderer_set_raster_state(u32 raster_state_index)
+    {
+        bind(raster_state_index, 1 << e_null_resource::raster_state, "set_raster_state");
+    }
+
+    void direct::renderer_set_viewport(const viewport& vp)
+    {
+        s_frame.cmds++;
+    }
+
+    void direct::renderer_set_scissor_rect(const rect& r)
+    {
+        s_frame.cmds++;
+    }
+
+    void direct::renderer_create_blend_state(const blend_creation_params& bcp, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::blend_state);
+    }
+
+    void direct::renderer_set_blend_state(u32 blend_state_index)
+    {
+        bind(blend_state_index, 1 << e_null_resource::blend_state, "set_blend_state");
+    }
+
+    void direct::renderer_create_depth_stencil_state(const depth_stencil_creation_params& dscp, u32 resource_slot)
+    {
+        create_resource(resource_slot, e_null_resource::depth_stencil_state);
+    }
+
+    void direct::renderer_set_depth_stencil_state(u32 depth_stencil_state)
+    {
+        bind(depth_stencil_state, 1 << e_null_resource::depth_stencil_state, "set_depth_stencil_state");
+    }
+
+    void direct::renderer_set_stencil_ref(u8 ref)
+    {
+        s_frame.cmds++;
+    }
+
+    void direct::renderer_draw(u32 vertex_count, u32 start_vertex, u32 primitive_topology)
+    {
+        draw(vertex_count, 1);
+    }
+
+    void direct::renderer_draw_indexed(u32 index_count, u32 start_index, u32 base_vertex, u32 primitive_topology)
+    {
+        draw(index_count, 1);
+    }
+
+    void direct::renderer_draw_indexed_instanced(u32 instance_count, u32 start_instance, u32 index_count, u32 start_index,
+                                                 u32 base_vertex, u32 primitive_topology)
+    {
+        draw(index_count, instance_count);
+    }
+
+    void direct::renderer_draw_auto()
+    {
+        draw(0, 1);
+    }
+
+    void direct::renderer_dispatch_compute(uint3 grid, uint3 num_threads)
+    {
+        s_frame.cmds++;
+        s_frame.dispatches++;
+    }
+
+    void direct::renderer_create_render_target(const texture_creation_params& tcp, u32 resource_slot, bool track)
+    {
+        if (track)
+            _renderer_track_managed_render_target(tcp, resource_slot);
+
+        create_resource(resource_slot, e_null_resource::render_target);
+    }
+
+    void direct::renderer_set_targets(const u32* const colour_targets, u32 num_colour_targets, u32 depth_target,
+                                      u32 colour_slice, u32 depth_slice)
+    {
+        for (u32 i = 0; i < num_colour_targets; ++i)
+            bind(colour_targets[i], k_texture_mask, "set_targets colour");
+
+        bind(depth_target, k_texture_mask, "set_targets depth");
+    }
+
+    void direct::renderer_set_resolve_targets(u32 colour_target, u32 depth_target)
+    {
+        bind(colour_target, k_texture_mask, "set_resolve_targets colour");
+        bind(depth_target, k_texture_mask, "set_resolve_targets depth");
+    }
+
+    void direct::renderer_set_stream_out_target(u32 buffer_index)
+    {
+        bind(buffer_index, k_buffer_mask, "set_stream_out_target");
+    }
+
+    void direct::renderer_resolve_target(u32 target, e_msaa_resolve_type type, resolve_resources res)
+    {
+        s_frame.cmds++;
+        validate(target, k_texture_mask, "resolve_target");
+    }
+
+    void direct::renderer_read_back_resource(const resource_read_back_params& rrbp)
+    {
+        s_frame.cmds++;
+
+        if (!validate(rrbp.resource_index, k_texture_mask | k_buffer_mask, "read_back_resource"))
+            return;
+
+        // callers wait on the callback, so return zeroed data
+        void* data = memory_alloc(rrbp.data_size);
+        memset(data, 0x0, rrbp.data_size);
+        rrbp.call_back_function(data, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
+        memory_free(data);
+    }
+
+    void direct::renderer_push_perf_marker(const c8* name)
+    {
+        s_frame.cmds++;
+    }
+
+    void direct::renderer_pop_perf_marker()
+    {
+        s_frame.cmds++;
+    }
+
+    void direct::renderer_replace_resource(u32 dest, u32 src, e_renderer_resource type)
+    {
+        s_frame.cmds++;
+
+        _res_pool.grow(dest);
+        _res_pool[dest] = _res_pool[src];
+    }
+
+    void direct::renderer_release_shader(u32 shader_index, u32 shader_type)
+    {
+        release_resource(shader_index, k_shader_mask, "release_shader");
+    }
+
+    void direct::renderer_release_clear_state(u32 clear_state)
+    {
+        release_resource(clear_state, 1 << e_null_resource::clear_state, "release_clear_state");
+    }
+
+    void direct::renderer_release_buffer(u32 buffer_index)
+    {
+        release_resource(buffer_index, k_buffer_mask, "release_buffer");
+    }
+
+    void direct::renderer_release_texture(u32 texture_index)
+    {
+        release_resource(texture_index, k_texture_mask, "release_texture");
+    }
+
+    void direct::renderer_release_sampler(u32 sampler)
+    {
+        release_resource(sampler, 1 << e_null_resource::sampler, "release_sampler");
+    }
+
+    void direct::renderer_release_raster_state(u32 raster_state_index)
+    {
+        release_resource(raster_state_index, 1 << e_null_resource::raster_state, "release_raster_state");
+    }
+
+    void direct::renderer_release_blend_state(u32 blend_state)
+    {
+        release_resource(blend_state, 1 << e_null_resource::blend_state, "release_blend_state");
+    }
+
+    void direct::renderer_release_render_target(u32 render_target)
+    {
+        _renderer_untrack_managed_render_target(render_target);
+        release_resource(render_target, k_texture_mask, "release_render_target");
+    }
+
+    void direct::renderer_release_input_layout(u32 input_layout)
+    {
+        release_resource(input_layout, 1 << e_null_resource::input_layout, "release_input_layout");
+    }
+
+    void direct::renderer_release_depth_stencil_state(u32 depth_stencil_state)
+    {
+        release_resource(depth_stencil_state, 1 << e_null_resource::depth_stencil_state,
+                         "release_depth_stencil_state");
+    }
+} // namespace pen
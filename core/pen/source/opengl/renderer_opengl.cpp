@@ -18,6 +18,7 @@
 #include "threads.h"
 #include "timer.h"
 
+#include <algorithm>
 #include <stdlib.h>
 #include <vector>
 
@@ -66,6 +67,13 @@
 #define PEN_GL_MSAA_SUPPORT true
 #endif
 
+// dynamic buffer updates are written to a persistently mapped ring when gl 4.4 / ARB_buffer_storage is available
+#if !defined(PEN_GLES3) && defined(GLEW_ARB_buffer_storage)
+#define PEN_GL_PERSISTENT_RING 1
+#else
+#define PEN_GL_PERSISTENT_RING 0
+#endif
+
 #define MAX_VERTEX_BUFFERS 4
 #define MAX_VERTEX_ATTRIBUTES 16
 #define MAX_UNIFORM_BUFFERS 32
@@ -806,12 +814,109 @@ namespace
         u32                      invalidate;
     };
 
+    // framebuffers are cached by a hash of their attachments, unused ones are evicted least recently used first
+    static const u32 k_max_framebuffers = 128;
+    static const u32 k_framebuffer_max_idle_frames = 120;
+
     struct framebuffer
     {
         hash_id hash;
         GLuint  _framebuffer;
+        u64     last_used; // frame index
+        u32     num_targets;
+        u32     targets[MAX_MRT + 1]; // render target slots attached
     };
-    framebuffer* s_framebuffers = nullptr;
+    framebuffer*                          s_framebuffers = nullptr;
+    hash_map<hash_id, u32>                s_framebuffer_lookup; // hash -> index into s_framebuffers
+    renderer_frame_stats                  s_framebuffer_stats;  // current frame
+    multi_buffer<renderer_frame_stats, 2> s_frame_stats;
+
+    GLuint _find_framebuffer(hash_id hash)
+    {
+        u32* i = s_framebuffer_lookup.find(hash);
+        if (!i)
+        {
+            s_framebuffer_stats.framebuffer_misses++;
+            return 0;
+        }
+
+        s_framebuffer_stats.framebuffer_hits++;
+        s_framebuffers[*i].last_used = _renderer_frame_index();
+        return s_framebuffers[*i]._framebuffer;
+    }
+
+    void _add_framebuffer(hash_id hash, GLuint fbo, const u32* targets, u32 num_targets)
+    {
+        framebuffer fb;
+        fb.hash = hash;
+        fb._framebuffer = fbo;
+        fb.last_used = _renderer_frame_index();
+        fb.num_targets = num_targets;
+        memcpy(fb.targets, targets, sizeof(u32) * num_targets);
+
+        s_framebuffer_lookup.insert(hash, sb_count(s_framebuffers));
+        sb_push(s_framebuffers, fb);
+    }
+
+    void _release_framebuffer(u32 index)
+    {
+        framebuffer& fb = s_framebuffers[index];
+        CHECK_CALL(glDeleteFramebuffers(1, &fb._framebuffer));
+        s_framebuffer_lookup.erase(fb.hash);
+
+        // swap the last into the gap
+        u32 last = sb_count(s_framebuffers) - 1;
+        if (index != last)
+        {
+            s_framebuffers[index] = s_framebuffers[last];
+            s_framebuffer_lookup.insert(s_framebuffers[index].hash, index);
+        }
+        stb__sbn(s_framebuffers) = last;
+
+        s_framebuffer_stats.framebuffer_evictions++;
+    }
+
+    void _release_framebuffers()
+    {
+        while (sb_count(s_framebuffers) > 0)
+            _release_framebuffer(sb_count(s_framebuffers) - 1);
+    }
+
+    // framebuffers referencing a released render target are stale
+    void _invalidate_framebuffers(u32 render_target)
+    {
+        for (s32 i = (s32)sb_count(s_framebuffers) - 1; i >= 0; --i)
+        {
+            framebuffer& fb = s_framebuffers[i];
+            for (u32 t = 0; t < fb.num_targets; ++t)
+            {
+                if (fb.targets[t] == render_target)
+                {
+                    _release_framebuffer(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    void _evict_framebuffers()
+    {
+        u64 frame = _renderer_frame_index();
+        for (s32 i = (s32)sb_count(s_framebuffers) - 1; i >= 0; --i)
+            if (frame - s_framebuffers[i].last_used > k_framebuffer_max_idle_frames)
+                _release_framebuffer(i);
+
+        while (sb_count(s_framebuffers) > k_max_framebuffers)
+        {
+            u32 lru = 0;
+            u32 num_fb = sb_count(s_framebuffers);
+            for (u32 i = 1; i < num_fb; ++i)
+                if (s_framebuffers[i].last_used < s_framebuffers[lru].last_used)
+                    lru = i;
+
+            _release_framebuffer(lru);
+        }
+    }
 
     enum resource_type : s32
     {
@@ -848,10 +953,22 @@ namespace
         bool compare;
     };
 
+    // cpu copy of a dynamic buffer, updates write the whole valid range into the ring so partial updates keep the rest
+    struct dynamic_buffer
+    {
+        u8*  shadow;
+        u32  size;
+        u32  valid_size;  // high water mark of updates
+        u32  ring_offset;
+        u64  ring_frame;  // frame of the segment holding the contents
+        bool resident;    // contents are at ring_offset in the ring, otherwise in the buffer itself
+    };
+
     struct resource_allocation
     {
-        u8     asigned_flag;
-        GLuint type;
+        u8              asigned_flag;
+        GLuint          type;
+        dynamic_buffer* dynamic;
         union {
             clear_state_internal           clear_state;
             ::input_layout*                input_layout;
@@ -895,12 +1012,152 @@ namespace
     viewport      s_current_vp;
     context_state s_ctx;
 
+    // persistent coherent ring, split into a segment per frame in flight. each segment is fenced at present and waited
+    // on before it is written again, so updates never stall on the buffer being read by the gpu
+    static const u32 k_ring_segments = 3;
+    static const u32 k_ring_segment_size = 8 * 1024 * 1024;
+    static const u32 k_ring_max_buffer_size = 64 * 1024; // larger buffers keep updating in place
+
+    struct persistent_ring
+    {
+        GLuint handle = 0;
+        u8*    mapped = nullptr;
+        u32    alignment = 256;
+        u32    segment = 0;
+        u32    pos = 0;
+        u64    frame = 0;
+        bool   overflowed = false;
+#if PEN_GL_PERSISTENT_RING
+        GLsync fences[k_ring_segments] = {0};
+#endif
+    };
+    persistent_ring s_ring;
+
+    u32 s_bound_cbuffers[MAX_UNIFORM_BUFFERS] = {0}; // buffer slot by unit, rebound when a ring update moves them
+
     void _clear_resource_table()
     {
         // reserve resource 0 for NULL binding.
         _res_pool[0].asigned_flag |= 0xff;
     }
 
+    void _create_persistent_ring()
+    {
+#if PEN_GL_PERSISTENT_RING
+        if (!GLEW_ARB_buffer_storage && !GLEW_VERSION_4_4)
+            return;
+
+        GLint alignment = 0;
+        CHECK_CALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        s_ring.alignment = std::max<u32>(alignment, 16);
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const u32        size = k_ring_segment_size * k_ring_segments;
+
+        CHECK_CALL(glGenBuffers(1, &s_ring.handle));
+        CHECK_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, s_ring.handle));
+        CHECK_CALL(glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags));
+        s_ring.mapped = (u8*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        CHECK_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+        if (!s_ring.mapped)
+        {
+            PEN_LOG("[warning] opengl - failed to map persistent buffer, dynamic buffers will update in place");
+            CHECK_CALL(glDeleteBuffers(1, &s_ring.handle));
+            s_ring.handle = 0;
+        }
+#endif
+    }
+
+    void _advance_persistent_ring()
+    {
+#if PEN_GL_PERSISTENT_RING
+        if (!s_ring.mapped)
+            return;
+
+        s_ring.fences[s_ring.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s_ring.segment = (s_ring.segment + 1) % k_ring_segments;
+        s_ring.pos = 0;
+        s_ring.frame++;
+        s_ring.overflowed = false;
+
+        GLsync& fence = s_ring.fences[s_ring.segment];
+        if (fence)
+        {
+            for (;;)
+            {
+                GLenum res = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                if (res == GL_ALREADY_SIGNALED || res == GL_CONDITION_SATISFIED || res == GL_WAIT_FAILED)
+                    break;
+            }
+
+            glDeleteSync(fence);
+            fence = 0;
+        }
+#endif
+    }
+
+    // returns the offset of size bytes in the current frame's segment, or -1 when the segment is full
+    u32 _alloc_persistent_ring(u32 size)
+    {
+        u32 aligned = PEN_ALIGN(s_ring.pos, s_ring.alignment);
+        if (aligned + size > k_ring_segment_size)
+        {
+            if (!s_ring.overflowed)
+                PEN_LOG("[warning] opengl - persistent ring segment full, updating buffers in place this frame");
+
+            s_ring.overflowed = true;
+            return PEN_INVALID_HANDLE;
+        }
+
+        s_ring.pos = aligned + size;
+        return s_ring.segment * k_ring_segment_size + aligned;
+    }
+
+    // copies the shadow into the current segment, or into the buffer itself when the segment is full
+    void _write_dynamic_buffer(resource_allocation& res)
+    {
+        dynamic_buffer* db = res.dynamic;
+
+        u32 ring_offset = _alloc_persistent_ring(db->size);
+        if (ring_offset == PEN_INVALID_HANDLE)
+        {
+            CHECK_CALL(glBindBuffer(res.type, res.handle));
+            CHECK_CALL(glBufferSubData(res.type, 0, db->valid_size, db->shadow));
+            CHECK_CALL(glBindBuffer(res.type, 0));
+            db->resident = false;
+            return;
+        }
+
+        memcpy(s_ring.mapped + ring_offset, db->shadow, db->valid_size);
+        db->ring_offset = ring_offset;
+        db->ring_frame = s_ring.frame;
+        db->resident = true;
+    }
+
+    // fences only cover the frame which wrote a segment, so buffers written in an earlier frame are copied forward
+    // into the current segment on their first bind of the frame, before their old region can be reused
+    void _refresh_dynamic_buffer(resource_allocation& res)
+    {
+        if (res.dynamic && res.dynamic->resident && res.dynamic->ring_frame != s_ring.frame)
+            _write_dynamic_buffer(res);
+    }
+
+    // handle and offset to bind for a buffer, dynamic buffers may currently live in the ring
+    GLuint _buffer_binding(resource_allocation& res, size_t& offset)
+    {
+        _refresh_dynamic_buffer(res);
+
+        if (res.dynamic && res.dynamic->resident)
+        {
+            offset = res.dynamic->ring_offset;
+            return s_ring.handle;
+        }
+
+        offset = 0;
+        return res.handle;
+    }
+
     // support for gles to allow almost correct wireframe, by using line strip
     u32 _gles_wireframe(u32 primitve_topology)
     {
@@ -1091,9 +1348,10 @@ namespace pen
         if (_renderer_resize_index() != rs)
         {
             rs = _renderer_resize_index();
-            sb_free(s_framebuffers);
-            s_framebuffers = nullptr;
+            _release_framebuffers();
         }
+
+        _evict_framebuffers();
     }
 
     void direct::renderer_end_frame()
@@ -1166,6 +1424,22 @@ namespace pen
     void direct::renderer_present()
     {
         pen_gl_swap_buffers();
+        _advance_persistent_ring();
+
+        // units left bound across frames would keep reading the old region
+        for (u32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
+        {
+            resource_allocation& res = _res_pool[s_bound_cbuffers[i]];
+            if (s_bound_cbuffers[i] && res.dynamic && res.dynamic->resident)
+                direct::renderer_set_constant_buffer(s_bound_cbuffers[i], i, 0);
+        }
+
+        s_framebuffer_stats.frame = _renderer_frame_index();
+        s_framebuffer_stats.framebuffers = sb_count(s_framebuffers);
+        s_frame_stats.backbuffer() = s_framebuffer_stats;
+        s_frame_stats.swap_buffers();
+        s_framebuffer_stats = renderer_frame_stats();
+
         _renderer_end_frame();
 
         s_state = {};
@@ -1279,6 +1553,34 @@ namespace pen
         CHECK_CALL(glBufferData(gl_bind, params.buffer_size, params.data, usage));
 
         res.type = gl_bind;
+        res.dynamic = nullptr;
+
+        // small dynamic buffers are updated through the persistent ring
+        bool ring_bind = gl_bind == GL_ARRAY_BUFFER || gl_bind == GL_ELEMENT_ARRAY_BUFFER || gl_bind == GL_UNIFORM_BUFFER;
+        if (s_ring.mapped && ring_bind && params.usage_flags == PEN_USAGE_DYNAMIC &&
+            (params.cpu_access_flags & PEN_CPU_ACCESS_WRITE) && !(params.bind_flags & PEN_STREAM_OUT_VERTEX_BUFFER) &&
+            params.buffer_size > 0 && params.buffer_size <= k_ring_max_buffer_size)
+        {
+            dynamic_buffer* db = (dynamic_buffer*)memory_alloc(sizeof(dynamic_buffer));
+            db->shadow = (u8*)memory_alloc(params.buffer_size);
+            db->size = params.buffer_size;
+            db->valid_size = 0;
+            db->ring_offset = 0;
+            db->ring_frame = 0;
+            db->resident = false;
+
+            if (params.data)
+            {
+                memcpy(db->shadow, params.data, params.buffer_size);
+                db->valid_size = params.buffer_size;
+            }
+            else
+            {
+                memset(db->shadow, 0x0, params.buffer_size);
+            }
+
+            res.dynamic = db;
+        }
     }
 
     void direct::renderer_link_shader_program(const shader_link_params& params, u32 resource_slot)
@@ -1531,8 +1833,10 @@ namespace pen
             {
                 s_state.vertex_buffer[v] = s_live_state.vertex_buffer[v];
                 s_state.vertex_buffer_stride[v] = s_live_state.vertex_buffer_stride[v];
+                s_state.vertex_buffer_offset[v] = s_live_state.vertex_buffer_offset[v];
 
-                auto& res = _res_pool[s_state.vertex_buffer[v]].handle;
+                size_t ring_offset = 0;
+                GLuint res = _buffer_binding(_res_pool[s_state.vertex_buffer[v]], ring_offset);
                 CHECK_CALL(glBindBuffer(GL_ARRAY_BUFFER, res));
 
                 u32 num_attribs = sb_count(input_res->attributes);
@@ -1546,7 +1850,8 @@ namespace pen
 
                     CHECK_CALL(glEnableVertexAttribArray(attribute.location));
 
-                    u32 base_vertex_offset = s_state.vertex_buffer_stride[v] * s_state.base_vertex;
+                    size_t base_vertex_offset = s_state.vertex_buffer_stride[v] * s_state.base_vertex;
+                    base_vertex_offset += s_state.vertex_buffer_offset[v] + ring_offset;
 
                     CHECK_CALL(glVertexAttribPointer(attribute.location, attribute.num_elements, attribute.type,
                                                      attribute.type == GL_UNSIGNED_BYTE ? true : false,
@@ -1663,10 +1968,11 @@ namespace pen
         primitive_topology = PEN_GLES_WIREFRAME_TOPOLOGY(primitive_topology);
 
         // bind index buffer -this must always be re-bound
-        GLuint res = _res_pool[s_state.index_buffer].handle;
+        size_t ring_offset = 0;
+        GLuint res = _buffer_binding(_res_pool[s_state.index_buffer], ring_offset);
         CHECK_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, res));
 
-        void* offset = (void*)(size_t)(start_index * 2);
+        void* offset = (void*)(ring_offset + start_index * 2);
 
         CHECK_CALL(glDrawElementsBaseVertex(primitive_topology, index_count, s_state.index_format, offset, base_vertex));
     }
@@ -1681,11 +1987,12 @@ namespace pen
         primitive_topology = PEN_GLES_WIREFRAME_TOPOLOGY(primitive_topology);
 
         // bind index buffer -this must always be re-bound
-        GLuint res = _res_pool[s_state.index_buffer].handle;
+        size_t ring_offset = 0;
+        GLuint res = _buffer_binding(_res_pool[s_state.index_buffer], ring_offset);
         CHECK_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, res));
 
         // todo this needs to check index size 32 or 16 bit
-        void* offset = (void*)(size_t)(start_index * 2);
+        void* offset = (void*)(ring_offset + start_index * 2);
 
         CHECK_CALL(glDrawElementsInstancedBaseVertex(primitive_topology, index_count, s_state.index_format, offset,
                                                      instance_count, base_vertex));
@@ -1985,17 +2292,12 @@ namespace pen
 
         hash_id h = hh.end();
 
-        u32 num_fb = sb_count(s_framebuffers);
-        for (u32 i = 0; i < num_fb; ++i)
+        GLuint cached = _find_framebuffer(h);
+        if (cached)
         {
-            auto& fb = s_framebuffers[i];
-
-            if (fb.hash == h)
-            {
-                CHECK_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb._framebuffer));
-                CHECK_CALL(glDrawBuffers(num_colour_targets, k_draw_buffers));
-                return;
-            }
+            CHECK_CALL(glBindFramebuffer(GL_FRAMEBUFFER, cached));
+            CHECK_CALL(glDrawBuffers(num_colour_targets, k_draw_buffers));
+            return;
         }
 
         GLuint fbh;
@@ -2066,11 +2368,15 @@ namespace pen
         GLenum status = CHECK_CALL(glCheckFramebufferStatus(GL_FRAMEBUFFER));
         PEN_ASSERT(status == GL_FRAMEBUFFER_COMPLETE);
 
-        framebuffer new_fb;
-        new_fb.hash = h;
-        new_fb._framebuffer = fbh;
+        u32 targets[MAX_MRT + 1];
+        u32 num_targets = 0;
+        for (s32 i = 0; i < num_colour_targets; ++i)
+            targets[num_targets++] = colour_targets[i];
 
-        sb_push(s_framebuffers, new_fb);
+        if (depth_target != PEN_NULL_DEPTH_BUFFER)
+            targets[num_targets++] = depth_target;
+
+        _add_framebuffer(h, fbh, targets, num_targets);
     }
 
     void direct::renderer_resolve_target(u32 target, e_msaa_resolve_type type, resolve_resources res)
@@ -2121,14 +2427,8 @@ namespace pen
         hash[1] = hh.end();
 
         GLuint fbos[2] = {0, 0};
-        u32    num_fb = sb_count(s_framebuffers);
-        for (u32 i = 0; i < num_fb; ++i)
-        {
-            auto& fb = s_framebuffers[i];
-            for (s32 i = 0; i < 2; ++i)
-                if (fb.hash == hash[i])
-                    fbos[i] = fb._framebuffer;
-        }
+        for (s32 i = 0; i < 2; ++i)
+            fbos[i] = _find_framebuffer(hash[i]);
 
         for (s32 i = 0; i < 2; ++i)
         {
@@ -2148,8 +2448,7 @@ namespace pen
                                                       colour_res.render_target.texture.handle, 0));
                 }
 
-                framebuffer fb = {hash[i], fbos[i]};
-                sb_push(s_framebuffers, fb);
+                _add_framebuffer(hash[i], fbos[i], &target, 1);
             }
         }
 
@@ -2467,6 +2766,16 @@ namespace pen
     void direct::renderer_set_constant_buffer(u32 buffer_index, u32 unit, u32 flags)
     {
         resource_allocation& res = _res_pool[buffer_index];
+        s_bound_cbuffers[unit] = buffer_index;
+
+        _refresh_dynamic_buffer(res);
+        if (res.dynamic && res.dynamic->resident)
+        {
+            CHECK_CALL(
+                glBindBufferRange(GL_UNIFORM_BUFFER, unit, s_ring.handle, res.dynamic->ring_offset, res.dynamic->size));
+            return;
+        }
+
         CHECK_CALL(glBindBufferBase(GL_UNIFORM_BUFFER, unit, res.handle));
     }
 
@@ -2475,12 +2784,35 @@ namespace pen
         PEN_ASSERT(0); // stubbed.. use metal on mac or d3d / vulkan on windows
     }
 
+    bool update_dynamic_buffer(u32 buffer_index, resource_allocation& res, const void* data, u32 data_size, u32 offset)
+    {
+        dynamic_buffer* db = res.dynamic;
+        if (offset + data_size > db->size)
+            return false;
+
+        memcpy(db->shadow + offset, data, data_size);
+        db->valid_size = std::max(db->valid_size, offset + data_size);
+
+        _write_dynamic_buffer(res);
+
+        // bindings refer to the old location
+        if (res.type == GL_UNIFORM_BUFFER)
+            for (u32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
+                if (s_bound_cbuffers[i] == buffer_index)
+                    direct::renderer_set_constant_buffer(buffer_index, i, 0);
+
+        return true;
+    }
+
     void direct::renderer_update_buffer(u32 buffer_index, const void* data, u32 data_size, u32 offset)
     {
         resource_allocation& res = _res_pool[buffer_index];
         if (res.type == 0 || data_size == 0)
             return;
 
+        if (res.dynamic && update_dynamic_buffer(buffer_index, res, data, data_size, offset))
+            return;
+
         CHECK_CALL(glBindBuffer(res.type, res.handle));
 
 #ifndef PEN_GLES3
@@ -2584,6 +2916,11 @@ namespace pen
 
             memory_free(data);
         }
+        else if (res.dynamic)
+        {
+            // the shadow copy is the latest contents
+            rrbp.call_back_function(res.dynamic->shadow, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
+        }
         else if (t == GL_ELEMENT_ARRAY_BUFFER || t == GL_UNIFORM_BUFFER || t == GL_ARRAY_BUFFER)
         {
             CHECK_CALL(glBindBuffer(t, res.handle));
@@ -2646,6 +2983,17 @@ namespace pen
         CHECK_CALL(glDeleteBuffers(1, &res.handle));
 
         res.handle = 0;
+
+        if (res.dynamic)
+        {
+            memory_free(res.dynamic->shadow);
+            memory_free(res.dynamic);
+            res.dynamic = nullptr;
+        }
+
+        for (u32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
+            if (s_bound_cbuffers[i] == buffer_index)
+                s_bound_cbuffers[i] = 0;
     }
 
     void direct::renderer_release_texture(u32 texture_index)
@@ -2680,6 +3028,7 @@ namespace pen
     void direct::renderer_release_render_target(u32 render_target)
     {
         _renderer_untrack_managed_render_target(render_target);
+        _invalidate_framebuffers(render_target);
 
         resource_allocation& res = _res_pool[render_target];
 
@@ -2799,9 +3148,16 @@ namespace pen
         if (major >= 4 && minor >= 6)
             s_renderer_info.caps |= PEN_CAPS_COMPUTE;
 #endif
+        _create_persistent_ring();
+
         return PEN_ERR_OK;
     }
 
+    renderer_frame_stats renderer_get_frame_stats()
+    {
+        return s_frame_stats.frontbuffer();
+    }
+
     const renderer_info& renderer_get_info()
     {
         return s_renderer_info;
@@ -158,7 +158,9 @@ void pen_window_resize()
 
 void run()
 {
-    pen::renderer_init(_metal_view, false, s_ctx.creation_params.max_renderer_commands);
+    pen::renderer_set_max_frames_in_flight(s_ctx.creation_params.max_frames_in_flight);
+    pen::renderer_init(_metal_view, false, s_ctx.creation_params.max_renderer_commands,
+                       s_ctx.creation_params.renderer_cmd_payload_size);
 
     for (;;)
     {
@@ -268,7 +270,9 @@ void pen_window_resize()
 void run()
 {
     // enters render loop and wait for jobs, will call os_update
-    pen::renderer_init(nullptr, true, s_ctx.creation_params.max_renderer_commands);
+    pen::renderer_set_max_frames_in_flight(s_ctx.creation_params.max_frames_in_flight);
+    pen::renderer_init(nullptr, true, s_ctx.creation_params.max_renderer_commands,
+                       s_ctx.creation_params.renderer_cmd_payload_size);
 }
 #endif
 
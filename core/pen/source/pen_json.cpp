@@ -14,18 +14,18 @@ using namespace pen;
 
 namespace pen
 {
-    struct json_object
-    {
-        jsmntok_t* tokens;
-        s32        num_tokens;
-        c8*        data;
-        u32        size;
-        c8*        name;
-
-        json_object get_object_by_name(const c8* name);
-        json_object get_object_by_index(const u32 index);
-
-        Str get_name() const;
+    struct json_doc
+    {
+        c8*        data = nullptr;    // source text, containers are dumped from here
+        c8*        strings = nullptr; // copy of data with every leaf token null terminated
+        u32        size = 0;
+        jsmntok_t* tokens = nullptr;
+        s32        num_tokens = 0;
+        u32*       skip = nullptr;        // index of the token after this token's subtree
+        u32*       first_child = nullptr; // offset into children for containers
+        u32*       children = nullptr;    // value token of each element or member, contiguous per container
+        hash_id*   key_hash = nullptr;    // hash of each key token
+        a_u32      ref_count = {1};
     };
 } // namespace pen
 
@@ -39,47 +39,6 @@ namespace
 #define NON_STRICT_NAME(V)
 #define JSON_NAME NON_STRICT_NAME
 
-    union json_value {
-        bool        b;
-        u32         u;
-        s32         s;
-        f32         f;
-        u64         ul;
-        s64         sl;
-        const c8*   str;
-        json_object object;
-    };
-
-    enum PRIMITIVE_TYPE
-    {
-        JSON_STR = 0,
-        JSON_U32,
-        JSON_S32,
-        JSON_F32,
-        JSON_U32_HEX,
-        JSON_BOOL,
-        JSON_U64,
-        JSON_S64
-    };
-
-    struct enumerate_params
-    {
-        bool       get_next;
-        int        return_value;
-        jsmntok_t* name_token;
-    };
-
-    void create_json_object(json_object& jo);
-
-    int jsoneq(const char* json, jsmntok_t* tok, const char* s)
-    {
-        if ((int)strlen(s) == tok->end - tok->start && strncmp(json + tok->start, s, tok->end - tok->start) == 0)
-        {
-            return 0;
-        }
-        return -1;
-    }
-
     int _dump(Str& output, const char* js, jsmntok_t* t, size_t count, int indent)
     {
         int i, j, k;
@@ -136,332 +95,407 @@ namespace
         return 0;
     }
 
-    bool enumerate_primitve(const char* js, jsmntok_t* t, json_value& result, PRIMITIVE_TYPE type)
+    // fills skip, first_child and children for the subtree at token t and returns the index after it
+    u32 build_tables(json_doc* doc, u32 t, u32& num_children)
     {
-        if (t->type == JSMN_PRIMITIVE)
+        const jsmntok_t& tok = doc->tokens[t];
+        if (tok.type != JSMN_OBJECT && tok.type != JSMN_ARRAY)
         {
-            switch (type)
-            {
-                case JSON_STR:
-                    result.str = js;
-                    break;
-
-                case JSON_U32:
-                case JSON_S32:
-                case JSON_U64:
-                case JSON_S64:
-                {
-                    c8* tok_str = pen::sub_string(js + t->start, t->end - t->start);
-                    result.ul = atoll(tok_str);
-                    pen::memory_free(tok_str);
-                }
-                break;
+            doc->skip[t] = t + 1;
+            return t + 1;
+        }
 
-                case JSON_U32_HEX:
-                {
-                    c8* tok_str = pen::sub_string(js + t->start, t->end - t->start);
-                    result.u = strtol(tok_str, NULL, 16);
-                    pen::memory_free(tok_str);
-                    break;
-                }
-                case JSON_F32:
-                {
-                    c8* tok_str = pen::sub_string(js + t->start, t->end - t->start);
-                    result.f = (f32)atof(tok_str);
-                    pen::memory_free(tok_str);
-                }
-                break;
-                case JSON_BOOL:
-                    if (*(js + t->start) == 't')
-                    {
-                        result.b = true;
-                        return true;
-                    }
-                    else if (*(js + t->start) == 'f')
-                    {
-                        result.b = false;
-                        return true;
-                    }
-                    return false;
-                    break;
+        // reserve contiguous slots before recursing so nested containers do not interleave
+        u32 base = num_children;
+        doc->first_child[t] = base;
+        num_children += tok.size;
+
+        u32 c = t + 1;
+        for (s32 i = 0; i < tok.size; ++i)
+        {
+            if (tok.type == JSMN_OBJECT)
+            {
+                // key tokens are leaves which parent their value
+                const jsmntok_t& key = doc->tokens[c];
+                doc->skip[c] = c + 1;
+                doc->key_hash[c] = PEN_HASH(doc->strings + key.start);
+                ++c;
             }
 
-            return true;
+            doc->children[base + i] = c;
+            c = build_tables(doc, c, num_children);
         }
 
-        return false;
+        doc->skip[t] = c;
+        return c;
     }
 
-    bool is_key(const char* js, size_t jsize, jsmntok_t* t, size_t count)
+    bool parse_doc(json_doc* doc)
     {
-        if (count < 1)
+        // count tokens first rather than retrying with a growing token buffer
+        jsmn_parser p;
+        jsmn_init(&p);
+        s32 num_tokens = jsmn_parse(&p, doc->data, doc->size, nullptr, 0);
+        if (num_tokens <= 0)
+        {
+            if (num_tokens < 0)
+                PEN_LOG("Failed to parse JSON: %d\n", num_tokens);
+            return false;
+        }
+
+        doc->tokens = (jsmntok_t*)pen::memory_alloc(sizeof(jsmntok_t) * num_tokens);
+
+        jsmn_init(&p);
+        doc->num_tokens = jsmn_parse(&p, doc->data, doc->size, doc->tokens, num_tokens);
+        if (doc->num_tokens <= 0)
+        {
+            PEN_LOG("Failed to parse JSON: %d\n", doc->num_tokens);
+            doc->num_tokens = 0;
             return false;
+        }
 
-        jsmntok_t* next = t + 1;
+        // terminate leaves in place in a copy, so strings and numbers can be read without allocating
+        doc->strings = (c8*)pen::memory_alloc(doc->size + 1);
+        memcpy(doc->strings, doc->data, doc->size);
+        doc->strings[doc->size] = '\0';
 
-        u32 num = next->start - t->end;
+        for (s32 i = 0; i < doc->num_tokens; ++i)
+        {
+            const jsmntok_t& tok = doc->tokens[i];
+            if (tok.type == JSMN_STRING || tok.type == JSMN_PRIMITIVE)
+                doc->strings[tok.end] = '\0';
+        }
 
-        static c8 buf[64];
-        pen::sub_string(js + t->end, buf, std::min<u32>(num, 63));
+        u32 nt = (u32)doc->num_tokens;
+        doc->skip = (u32*)pen::memory_alloc(sizeof(u32) * nt);
+        doc->first_child = (u32*)pen::memory_alloc(sizeof(u32) * nt);
+        doc->children = (u32*)pen::memory_alloc(sizeof(u32) * nt);
+        doc->key_hash = (hash_id*)pen::memory_alloc(sizeof(hash_id) * nt);
+        pen::memory_zero(doc->first_child, sizeof(u32) * nt);
+        pen::memory_zero(doc->key_hash, sizeof(hash_id) * nt);
 
-        for (u32 i = 0; i <= num; ++i)
-            if (buf[i] == ':')
-                return true;
+        // there is one child entry per token at most, the root is never a child
+        u32 num_children = 0;
+        u32 t = 0;
+        while (t < nt)
+            t = build_tables(doc, t, num_children);
 
-        return false;
+        return true;
     }
 
-    int enumerate(const char* js, size_t jsize, jsmntok_t* t, size_t count, int indent, const c8* search_name,
-                  s32 search_index, json_value& result, enumerate_params& ep)
+    void free_doc(json_doc* doc)
     {
-        if (ep.return_value != 0)
-            return ep.return_value;
+        pen::memory_free(doc->data);
+        pen::memory_free(doc->strings);
+        pen::memory_free(doc->tokens);
+        pen::memory_free(doc->skip);
+        pen::memory_free(doc->first_child);
+        pen::memory_free(doc->children);
+        pen::memory_free(doc->key_hash);
+        delete doc;
+    }
 
-        int i, j;
-        if (count == 0)
-            return 0;
+    json_doc* create_doc(c8* data, u32 size)
+    {
+        json_doc* doc = new json_doc();
+        doc->data = data;
+        doc->size = size;
 
-        if (t->type == JSMN_PRIMITIVE)
+        if (!parse_doc(doc))
         {
-            if (result.object.name)
-                pen::memory_free(result.object.name);
+            free_doc(doc);
+            return nullptr;
+        }
 
-            result.object.name = pen::sub_string(js + t->start, t->end - t->start);
+        return doc;
+    }
 
-            if (indent == 1)
-            {
-                if (search_name == nullptr)
-                {
-                    ep.get_next = true;
-                }
-                else if (jsoneq(js, t, search_name) == 0)
-                {
-                    if (is_key(js, jsize, t, count))
-                        ep.get_next = true;
-                }
-            }
-            return 1;
-        }
-        else if (t->type == JSMN_STRING)
-        {
-            if (result.object.name)
-                pen::memory_free(result.object.name);
+    bool is_leaf(const jsmntok_t& tok)
+    {
+        return tok.type == JSMN_STRING || tok.type == JSMN_PRIMITIVE;
+    }
+} // namespace
 
-            result.object.name = pen::sub_string(js + t->start, t->end - t->start);
+namespace pen
+{
+    //------------------------------------------------------------------------------
+    // Docs and Views
+    //------------------------------------------------------------------------------
+    json_doc* json_doc_load_from_file(const c8* filename)
+    {
+        void* data = nullptr;
+        u32   size = 0;
 
-            if (indent == 1)
-            {
-                if (search_name == nullptr)
-                {
-                    ep.get_next = true;
-                }
-                else if (jsoneq(js, t, search_name) == 0)
-                {
-                    if (is_key(js, jsize, t, count))
-                        ep.get_next = true;
-                }
-            }
-            return 1;
-        }
-        else if (t->type == JSMN_OBJECT)
-        {
-            j = 0;
-            for (i = 0; i < t->size; i++)
-            {
-                j += enumerate(js, jsize, t + 1 + j, count - j, indent + 1, search_name, search_index, result, ep);
+        pen_error err = pen::filesystem_read_file_to_buffer(filename, &data, size);
+        if (err != PEN_ERR_OK)
+            return nullptr;
 
-                if ((indent == 0 && search_index == i) || ep.get_next)
-                {
-                    jsmntok_t* at = t + 1 + j;
+        return create_doc((c8*)data, size);
+    }
 
-                    result.object.data = pen::sub_string(js + at->start, at->end - at->start);
-                    result.object.size = at->end - at->start;
+    json_doc* json_doc_load(const c8* json_str)
+    {
+        u32 len = pen::string_length(json_str);
+        return create_doc(pen::sub_string(json_str, len), len);
+    }
 
-                    create_json_object(result.object);
+    void json_doc_add_ref(json_doc* doc)
+    {
+        if (doc)
+            doc->ref_count++;
+    }
 
-                    ep.return_value = 1;
-                    ep.get_next = false;
-                    return 1;
-                }
+    void json_doc_release(json_doc* doc)
+    {
+        if (doc && --doc->ref_count == 0)
+            free_doc(doc);
+    }
 
-                j += enumerate(js, jsize, t + 1 + j, count - j, indent + 1, search_name, search_index, result, ep);
-            }
-            return j + 1;
-        }
-        else if (t->type == JSMN_ARRAY)
-        {
-            if (ep.get_next)
-            {
-                result.object.data = pen::sub_string(js + t->start, t->end - t->start);
-                result.object.size = t->end - t->start;
+    json_view json_doc_root(const json_doc* doc)
+    {
+        if (!doc)
+            return json_view();
 
-                create_json_object(result.object);
+        return json_view(doc, 0);
+    }
 
-                ep.return_value = 1;
-                ep.get_next = false;
-                return 1;
-            }
+    json_view::json_view() : m_doc(nullptr), m_token(-1), m_key_token(-1)
+    {
+    }
 
-            j = 0;
-            for (i = 0; i < t->size; i++)
-            {
-                if (indent == 0 && search_index == i)
-                {
-                    jsmntok_t* at = t + 1 + j;
+    json_view::json_view(const json_doc* doc, s32 token, s32 key_token)
+        : m_doc(doc), m_token(token), m_key_token(key_token)
+    {
+    }
 
-                    result.object.data = pen::sub_string(js + at->start, at->end - at->start);
-                    result.object.size = at->end - at->start;
+    jsmntype_t json_view::type() const
+    {
+        if (!m_doc || m_token < 0)
+            return JSMN_UNDEFINED;
 
-                    create_json_object(result.object);
+        return m_doc->tokens[m_token].type;
+    }
 
-                    ep.return_value = 1;
-                    ep.get_next = false;
-                    return 1;
-                }
+    bool json_view::is_null() const
+    {
+        return type() == JSMN_UNDEFINED;
+    }
 
-                j += enumerate(js, jsize, t + 1 + j, count - j, indent + 1, search_name, search_index, result, ep);
-            }
-            return j + 1;
-        }
+    u32 json_view::size() const
+    {
+        jsmntype_t t = type();
+        if (t == JSMN_ARRAY || t == JSMN_OBJECT)
+            return m_doc->tokens[m_token].size;
 
-        return ep.return_value;
+        return 0;
     }
 
-    bool as_value(json_value& jv, json_object* jo, PRIMITIVE_TYPE type)
+    json_view json_view::operator[](const c8* name) const
     {
-        if (jo->num_tokens <= 0 || jo->num_tokens > 1)
-        {
-            if (type == JSON_STR && jo->data)
-            {
-                jv.str = jo->data;
-                return true;
-            }
+        if (type() != JSMN_OBJECT)
+            return json_view();
 
-            return false;
+        // compare cached key hashes and confirm with the string in case of collisions
+        hash_id    h = PEN_HASH(name);
+        const u32* children = m_doc->children + m_doc->first_child[m_token];
+        u32        num = m_doc->tokens[m_token].size;
+        for (u32 i = 0; i < num; ++i)
+        {
+            u32 k = children[i] - 1;
+            if (m_doc->key_hash[k] == h && strcmp(m_doc->strings + m_doc->tokens[k].start, name) == 0)
+                return json_view(m_doc, children[i], k);
         }
 
-        return enumerate_primitve(jo->data, jo->tokens, jv, type);
+        return json_view();
     }
 
-    json_object get_object(json_object* jo, const c8* name, s32 index)
+    json_view json_view::operator[](const u32 index) const
     {
-        json_value jv;
-        jv.object.name = nullptr;
-        jv.object.tokens = nullptr;
-        jv.object.data = nullptr;
-        jv.object.num_tokens = 0;
+        jsmntype_t t = type();
+        if (t != JSMN_ARRAY && t != JSMN_OBJECT)
+            return json_view();
 
-        if (jo == NULL)
-            return jv.object;
+        if (index >= (u32)m_doc->tokens[m_token].size)
+            return json_view();
 
-        enumerate_params ep = {false, 0, nullptr};
+        u32 child = m_doc->children[m_doc->first_child[m_token] + index];
+        return json_view(m_doc, child, t == JSMN_OBJECT ? child - 1 : -1);
+    }
 
-        enumerate(jo->data, jo->size, jo->tokens, jo->num_tokens, 0, name, index, jv, ep);
+    json_view json_view::operator[](const s32 index) const
+    {
+        return this->operator[]((u32)index);
+    }
 
-        return jv.object;
+    const c8* json_view::key_cstr() const
+    {
+        if (!m_doc || m_key_token < 0)
+            return nullptr;
+
+        return m_doc->strings + m_doc->tokens[m_key_token].start;
     }
 
-    void create_json_object(json_object& jo)
+    Str json_view::key() const
     {
-        jsmn_parser p;
+        return Str(key_cstr());
+    }
 
-        // default try 64 tokens
-        u32 token_count = 64;
-        jo.tokens = new jsmntok_t[token_count];
+    Str json_view::name() const
+    {
+        return key();
+    }
 
-        bool loaded = false;
-        while (!loaded)
-        {
-            jsmn_init(&p);
-            jo.num_tokens = jsmn_parse(&p, jo.data, jo.size, jo.tokens, token_count);
-            if (jo.num_tokens < JSMN_ERROR_NOMEM)
-            {
-                PEN_LOG("Failed to parse JSON: %d\n", jo.num_tokens);
-                break;
-            }
-            else if (jo.num_tokens == JSMN_ERROR_NOMEM)
-            {
-                // allocate space for more tokens
-                delete jo.tokens;
+    Str json_view::raw() const
+    {
+        Str r;
+        if (is_null())
+            return r;
 
-                token_count <<= 1;
-                jo.tokens = new jsmntok_t[token_count];
+        const jsmntok_t& tok = m_doc->tokens[m_token];
+        r.append(m_doc->data + tok.start, m_doc->data + tok.end);
+        return r;
+    }
 
-                continue;
-            }
+    Str json_view::dumps() const
+    {
+        Str t;
+        if (is_null())
+            return t;
 
-            loaded = true;
-            break;
-        }
+        _dump(t, m_doc->data, m_doc->tokens + m_token, m_doc->skip[m_token] - m_token, 0);
+        return t;
+    }
 
-        if (!loaded)
-        {
-            delete jo.tokens;
-            jo.tokens = nullptr;
+    const c8* json_view::as_cstr(const c8* default_value) const
+    {
+        if (is_null() || !is_leaf(m_doc->tokens[m_token]))
+            return default_value;
 
-            jo.num_tokens = 0;
+        return m_doc->strings + m_doc->tokens[m_token].start;
+    }
 
-            pen::memory_free(jo.data);
-            jo.data = nullptr;
-        }
+    Str json_view::as_str(const c8* default_value) const
+    {
+        if (is_null())
+            return default_value;
+
+        if (!is_leaf(m_doc->tokens[m_token]))
+            return raw();
+
+        return m_doc->strings + m_doc->tokens[m_token].start;
     }
-} // namespace
 
-namespace pen
-{
-    Str json_object::get_name() const
+    hash_id json_view::as_hash_id(hash_id default_value) const
     {
-        return Str(this->name);
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return 0;
+
+        return PEN_HASH(cstr);
     }
 
-    json_object json_object::get_object_by_name(const c8* name)
+    u32 json_view::as_u32(u32 default_value) const
     {
-        return get_object(this, name, -1);
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
+
+        return (u32)atoll(cstr);
     }
 
-    json_object json_object::get_object_by_index(const u32 index)
+    s32 json_view::as_s32(s32 default_value) const
     {
-        return get_object(this, "__unused_ai__", index);
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
+
+        return (s32)atoll(cstr);
     }
 
-    //------------------------------------------------------------------------------
-    // C++ Public API
-    //------------------------------------------------------------------------------
-    json json::load_from_file(const c8* filename)
+    u64 json_view::as_u64(u64 default_value) const
     {
-        json new_json;
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
 
-        void* data = nullptr;
-        u32   size = 0;
+        return (u64)atoll(cstr);
+    }
 
-        pen_error err = pen::filesystem_read_file_to_buffer(filename, &data, size);
+    s64 json_view::as_s64(s64 default_value) const
+    {
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
 
-        if (err == PEN_ERR_OK)
-        {
-            new_json.m_internal_object = (json_object*)memory_alloc(sizeof(json_object));
-            new_json.m_internal_object->data = (c8*)data;
-            new_json.m_internal_object->size = size;
-            new_json.m_internal_object->name = nullptr;
+        return (s64)atoll(cstr);
+    }
 
-            create_json_object(*new_json.m_internal_object);
-        }
+    bool json_view::as_bool(bool default_value) const
+    {
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
 
-        return new_json;
+        if (cstr[0] == 't')
+            return true;
+        else if (cstr[0] == 'f')
+            return false;
+
+        return default_value;
     }
 
-    json json::load(const c8* json_str)
+    f32 json_view::as_f32(f32 default_value) const
     {
-        json new_json;
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
 
-        new_json.m_internal_object = (json_object*)memory_alloc(sizeof(json_object));
+        return (f32)atof(cstr);
+    }
 
-        new_json.m_internal_object->data = pen::sub_string(json_str, pen::string_length(json_str));
+    u8 json_view::as_u8_hex(u8 default_value) const
+    {
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
 
-        new_json.m_internal_object->size = pen::string_length(json_str);
-        new_json.m_internal_object->name = nullptr;
+        return (u8)strtol(cstr, NULL, 16);
+    }
 
-        create_json_object(*new_json.m_internal_object);
+    u32 json_view::as_u32_hex(u32 default_value) const
+    {
+        const c8* cstr = as_cstr();
+        if (!cstr)
+            return default_value;
+
+        return (u32)strtol(cstr, NULL, 16);
+    }
+
+    Str json_view::as_filename(const c8* default_value) const
+    {
+        Str fn = as_str(default_value);
+        fn = str_replace_chars(fn, '@', ':');
+        fn = str_replace_chars(fn, '\\', '/');
+
+        return fn;
+    }
+
+    //------------------------------------------------------------------------------
+    // C++ Public API
+    //------------------------------------------------------------------------------
+    json json::load_from_file(const c8* filename)
+    {
+        json_doc* doc = json_doc_load_from_file(filename);
+        json      new_json(doc, json_doc_root(doc));
+        json_doc_release(doc);
+        return new_json;
+    }
 
+    json json::load(const c8* json_str)
+    {
+        json_doc* doc = json_doc_load(json_str);
+        json      new_json(doc, json_doc_root(doc));
+        json_doc_release(doc);
         return new_json;
     }
 
@@ -533,7 +567,7 @@ namespace pen
                 JSON_NAME(json_string);
 
                 json_string.append(": ");
-                json_string.append(j1[i].m_internal_object->data);
+                json_string.append(j1[i].m_view.raw().c_str());
                 json_string.append(",\n");
             }
 
@@ -564,7 +598,7 @@ namespace pen
                 JSON_NAME(json_string);
 
                 json_string.append(": ");
-                json_string.append(j2[i].m_internal_object->data);
+                json_string.append(j2[i].m_view.raw().c_str());
                 json_string.append(",\n");
             }
         }
@@ -583,39 +617,22 @@ namespace pen
 
     u32 json::size() const
     {
-        if (m_internal_object->num_tokens > 0)
-            if (m_internal_object->tokens[0].type == JSMN_ARRAY || m_internal_object->tokens[0].type == JSMN_OBJECT)
-                return m_internal_object->tokens[0].size;
+        return m_view.size();
+    }
 
-        return 0;
+    json_view json::view() const
+    {
+        return m_view;
     }
 
     json json::operator[](const c8* name) const
     {
-        json new_json;
-
-        new_json.m_internal_object = (json_object*)memory_alloc(sizeof(json_object));
-        if(m_internal_object)
-        {
-            *new_json.m_internal_object = m_internal_object->get_object_by_name(name);
-        }
-        else
-        {
-            // construct a null object
-            memset(new_json.m_internal_object, 0x0, sizeof(json_object));
-        }
-
-        return new_json;
+        return json(m_doc, m_view[name]);
     }
 
     json json::operator[](const u32 index) const
     {
-        json new_json;
-
-        new_json.m_internal_object = (json_object*)memory_alloc(sizeof(json_object));
-
-        *new_json.m_internal_object = m_internal_object->get_object_by_index(index);
-        return new_json;
+        return json(m_doc, m_view[index]);
     }
 
     json json::operator[](const s32 index) const
@@ -625,44 +642,26 @@ namespace pen
 
     json::json()
     {
-        m_internal_object = nullptr;
+        m_doc = nullptr;
+        m_raw = nullptr;
     }
 
-    void json::copy(json* dst, const json& other)
+    json::json(json_doc* doc, const json_view& view)
     {
-        dst->m_internal_object = nullptr;
-
-        if (other.m_internal_object == nullptr)
-            return;
-
-        dst->m_internal_object = (json_object*)memory_alloc(sizeof(json_object));
-
-        // shallow copy default copy ctor
-        *dst->m_internal_object = *other.m_internal_object;
-
-        u32 num_tokens = other.m_internal_object->num_tokens;
-        dst->m_internal_object->tokens = new jsmntok_t[num_tokens];
-        memcpy(dst->m_internal_object->tokens, other.m_internal_object->tokens, sizeof(jsmntok_t) * num_tokens);
-
-        // deep copy take ownership of mem
-        if (other.m_internal_object->data)
-        {
-            s32 data_size = string_length(other.m_internal_object->data);
-
-            dst->m_internal_object->data = (c8*)memory_alloc(data_size + 1);
-            memcpy(dst->m_internal_object->data, other.m_internal_object->data, data_size);
-            dst->m_internal_object->data[data_size] = '\0';
-        }
-
-        // take ownership of name
-        if (other.m_internal_object->name)
-        {
-            s32 name_size = string_length(other.m_internal_object->name);
-            m_internal_object->name = (c8*)memory_alloc(name_size + 1);
-            m_internal_object->name[name_size] = '\0';
+        // null views do not keep the doc alive
+        m_doc = view.is_null() ? nullptr : doc;
+        m_view = view;
+        m_raw = nullptr;
+        json_doc_add_ref(m_doc);
+    }
 
-            memcpy(m_internal_object->name, other.m_internal_object->name, name_size);
-        }
+    void json::copy(json* dst, const json& other)
+    {
+        // docs are immutable so copies share them
+        json_doc_add_ref(other.m_doc);
+        dst->m_doc = other.m_doc;
+        dst->m_view = other.m_view;
+        dst->m_raw = nullptr;
     }
 
     json::json(const json& other)
@@ -672,6 +671,10 @@ namespace pen
 
     json& json::operator=(const json& other)
     {
+        if (this == &other)
+            return *this;
+
+        this->~json();
         copy(this, other);
 
         return *this;
@@ -679,157 +682,111 @@ namespace pen
 
     Str json::as_str(const c8* default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_STR))
-            return m_internal_object->data;
-
-        return default_value;
+        return m_view.as_str(default_value);
     }
 
     const c8* json::as_cstr(const c8* default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_STR))
-            return m_internal_object->data;
+        jsmntype_t t = m_view.type();
+        if (t != JSMN_OBJECT && t != JSMN_ARRAY)
+            return m_view.as_cstr(default_value);
 
-        return default_value;
+        // containers are not terminated in the doc, keep a copy of the text alive with this object
+        if (!m_raw)
+        {
+            Str r = m_view.raw();
+            u32 len = r.length();
+            m_raw = (c8*)pen::memory_alloc(len + 1);
+            memcpy(m_raw, r.c_str(), len);
+            m_raw[len] = '\0';
+        }
+
+        return m_raw;
     }
 
     hash_id json::as_hash_id(hash_id default_value) const
     {
-        const c8* cstr = as_cstr();
-        if (!cstr)
-            return 0;
-
-        return PEN_HASH(cstr);
+        return m_view.as_hash_id(default_value);
     }
 
     u32 json::as_u32(u32 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_U32))
-            return jv.u;
-
-        return default_value;
+        return m_view.as_u32(default_value);
     }
 
     s32 json::as_s32(s32 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_S32))
-            return jv.s;
-
-        return default_value;
+        return m_view.as_s32(default_value);
     }
 
     u64 json::as_u64(u64 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_U64))
-            return jv.ul;
-
-        return default_value;
+        return m_view.as_u64(default_value);
     }
 
     s64 json::as_s64(s64 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_S64))
-            return jv.sl;
-
-        return default_value;
+        return m_view.as_s64(default_value);
     }
 
     bool json::as_bool(bool default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_BOOL))
-            return jv.b;
-
-        return default_value;
+        return m_view.as_bool(default_value);
     }
 
     f32 json::as_f32(f32 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_F32))
-            return jv.f;
-
-        return default_value;
+        return m_view.as_f32(default_value);
     }
 
     u8 json::as_u8_hex(u8 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_U32_HEX))
-            return jv.u;
-
-        return default_value;
+        return m_view.as_u8_hex(default_value);
     }
 
     u32 json::as_u32_hex(u32 default_value) const
     {
-        json_value jv;
-        if (as_value(jv, m_internal_object, JSON_U32_HEX))
-            return jv.u;
-
-        return default_value;
+        return m_view.as_u32_hex(default_value);
     }
 
     Str json::as_filename(const c8* default_value) const
     {
-        Str fn = as_str(default_value);
-        fn = str_replace_chars(fn, '@', ':');
-        fn = str_replace_chars(fn, '\\', '/');
-
-        return fn;
+        return m_view.as_filename(default_value);
     }
 
     Str json::dumps() const
     {
-        Str t;
-        _dump(t, m_internal_object->data, m_internal_object->tokens, m_internal_object->num_tokens, 0);
-        return t;
+        return m_view.dumps();
     }
 
     Str json::name() const
     {
-        return m_internal_object->get_name();
+        return m_view.name();
     }
 
     Str json::key() const
     {
-        return m_internal_object->get_name();
+        return m_view.key();
     }
 
     jsmntype_t json::type() const
     {
-        if (!m_internal_object)
-            return JSMN_UNDEFINED;
-
-        if (m_internal_object->num_tokens <= 0)
-            return JSMN_UNDEFINED;
-
-        return m_internal_object->tokens[0].type;
+        return m_view.type();
     }
 
     bool json::is_null() const
     {
-        return type() == JSMN_UNDEFINED;
+        return m_view.is_null();
     }
 
     json::~json()
     {
-        if (m_internal_object)
-        {
-            delete[] m_internal_object->tokens;
-
-            pen::memory_free(m_internal_object->data);
-            pen::memory_free(m_internal_object->name);
-        }
+        json_doc_release(m_doc);
+        pen::memory_free(m_raw);
 
-        pen::memory_free(m_internal_object);
-        m_internal_object = nullptr;
+        m_doc = nullptr;
+        m_view = json_view();
+        m_raw = nullptr;
     }
 
     void json::set(const c8* name, const Str val)
@@ -844,7 +801,7 @@ namespace pen
 
         pen::json json_set = pen::json::load(new_json_object.c_str());
 
-        if (m_internal_object)
+        if (m_doc)
         {
             pen::json combined = combine(*this, json_set);
 
@@ -879,7 +836,7 @@ namespace pen
 
         pen::json json_set = pen::json::load(new_json_object.c_str());
 
-        if (m_internal_object)
+        if (m_doc)
         {
             pen::json combined = combine(*this, json_set);
 
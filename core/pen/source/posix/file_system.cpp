@@ -3,21 +3,30 @@
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "file_pack.h"
 #include "file_system.h"
 #include "memory.h"
 #include "os.h"
 #include "pen.h"
 #include "pen_string.h"
+#include "threads.h"
+
+#include <vector>
 
 #if PEN_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#define FILE_WATCHER_INOTIFY
 #define NO_MOUNT_POINTS
 #define get_mtime(s) s.st_mtime
 #define HOME_DIR "home"
@@ -74,10 +83,13 @@ namespace pen
     {
         WRITE_FILE_DEPENDENCIES(filename);
 
-        const Str resource_name = os_path_for_resource(filename);
-
         *p_buffer = NULL;
 
+        if (pack_read_file(filename, p_buffer, buffer_size))
+            return PEN_ERR_OK;
+
+        const Str resource_name = os_path_for_resource(filename);
+
         FILE* p_file = fopen(resource_name.c_str(), "rb");
 
         if (p_file)
@@ -103,6 +115,88 @@ namespace pen
         return PEN_ERR_FILE_NOT_FOUND;
     }
 
+    pen_error filesystem_map_file(const c8* filename, file_view& view)
+    {
+        view = file_view();
+
+#if PEN_PLATFORM_WEB
+        // no backing file to map from the preloaded data bundle, read it instead
+        u32       buffer_size = 0;
+        pen_error err = filesystem_read_file_to_buffer(filename, &view.data, buffer_size);
+        view.size = buffer_size;
+        return err;
+#else
+        WRITE_FILE_DEPENDENCIES(filename);
+
+        if (pack_map_file(filename, view))
+            return PEN_ERR_OK;
+
+        const Str resource_name = os_path_for_resource(filename);
+
+        s32 fd = open(resource_name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return PEN_ERR_FILE_NOT_FOUND;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            return PEN_ERR_FILE_NOT_FOUND;
+        }
+
+        // empty files are valid but cannot be mapped
+        if (st.st_size == 0)
+        {
+            close(fd);
+            return PEN_ERR_OK;
+        }
+
+        void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // the mapping keeps its own reference to the file
+        close(fd);
+
+        if (data == MAP_FAILED)
+            return PEN_ERR_FAILED;
+
+        view.data = data;
+        view.size = (size_t)st.st_size;
+        view.mapped = true;
+        return PEN_ERR_OK;
+#endif
+    }
+
+    void filesystem_release_pages(const file_view& view, size_t offset, size_t size)
+    {
+        if (!view.mapped || offset >= view.size)
+            return;
+
+        if (offset + size > view.size)
+            size = view.size - offset;
+
+        // only whole pages inside the range can be dropped, they fault back in from the file if touched again
+        static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        size_t              start = ((size_t)view.data + offset + page_size - 1) & ~(page_size - 1);
+        size_t              end = ((size_t)view.data + offset + size) & ~(page_size - 1);
+
+        if (end > start)
+            madvise((void*)start, end - start, MADV_DONTNEED);
+    }
+
+    void filesystem_unmap_file(file_view& view)
+    {
+        // packed views are owned by the pack
+        if (!view.packed)
+        {
+            if (view.mapped)
+                munmap(view.data, view.size);
+            else
+                pen::memory_free(view.data);
+        }
+
+        view = file_view();
+    }
+
     pen_error filesystem_enum_volumes(fs_tree_node& results)
     {
         static const c8* volumes_name = "Volumes";
@@ -342,4 +436,136 @@ namespace pen
         // directory depth 0 can be a slash
         return 0;
     }
+
+#ifdef FILE_WATCHER_INOTIFY
+    struct watched_dir
+    {
+        s32 wd;
+        Str path;
+    };
+
+    struct file_watcher
+    {
+        s32                      fd;
+        pen::mutex*              mutex;
+        std::vector<watched_dir> dirs;
+    };
+
+    file_watcher* filesystem_create_watcher()
+    {
+        s32 fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+
+        file_watcher* watcher = new file_watcher();
+        watcher->fd = fd;
+        watcher->mutex = pen::mutex_create();
+        return watcher;
+    }
+
+    void filesystem_destroy_watcher(file_watcher* watcher)
+    {
+        if (!watcher)
+            return;
+
+        close(watcher->fd);
+        pen::mutex_destroy(watcher->mutex);
+        delete watcher;
+    }
+
+    bool filesystem_watch_directory(file_watcher* watcher, const c8* directory)
+    {
+        // editors either write in place or write a temp file and rename over the original
+        s32 wd = inotify_add_watch(watcher->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+            return false;
+
+        pen::mutex_lock(watcher->mutex);
+
+        bool found = false;
+        for (auto& d : watcher->dirs)
+            if (d.wd == wd)
+                found = true;
+
+        if (!found)
+            watcher->dirs.push_back({wd, directory});
+
+        pen::mutex_unlock(watcher->mutex);
+        return true;
+    }
+
+    void filesystem_read_watcher(file_watcher* watcher, u32 timeout_ms, file_watcher_callback changed, void* user_data)
+    {
+        struct pollfd pfd;
+        pfd.fd = watcher->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1, (s32)timeout_ms) <= 0)
+            return;
+
+        alignas(struct inotify_event) c8 buf[4096];
+        for (;;)
+        {
+            ssize_t len = read(watcher->fd, buf, sizeof(buf));
+            if (len <= 0)
+                break;
+
+            for (c8* p = buf; p < buf + len;)
+            {
+                const struct inotify_event* ev = (const struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + ev->len;
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    changed(nullptr, user_data);
+                    continue;
+                }
+
+                if (ev->len == 0 || (ev->mask & IN_ISDIR))
+                    continue;
+
+                Str path;
+                pen::mutex_lock(watcher->mutex);
+                for (auto& d : watcher->dirs)
+                {
+                    if (d.wd == ev->wd)
+                    {
+                        path = d.path;
+                        break;
+                    }
+                }
+                pen::mutex_unlock(watcher->mutex);
+
+                if (path.empty())
+                    continue;
+
+                path.appendf("/%s", ev->name);
+                changed(path.c_str(), user_data);
+            }
+        }
+    }
+#else
+    struct file_watcher
+    {
+    };
+
+    file_watcher* filesystem_create_watcher()
+    {
+        return nullptr;
+    }
+
+    void filesystem_destroy_watcher(file_watcher* watcher)
+    {
+    }
+
+    bool filesystem_watch_directory(file_watcher* watcher, const c8* directory)
+    {
+        return false;
+    }
+
+    void filesystem_read_watcher(file_watcher* watcher, u32 timeout_ms, file_watcher_callback changed, void* user_data)
+    {
+    }
+#endif
 } // namespace pen
@@ -26,11 +26,7 @@ pen::resolve_resources             g_resolve_resources;
 
 using namespace pen;
 
-#if PEN_SINGLE_THREADED
-#define add_cmd(cmd) exec_cmd(cmd)
-#else
-#define add_cmd(cmd) _ctx->cmd_buffer.put(cmd)
-#endif
+#define add_cmd(cmd) push_cmd(cmd)
 
 namespace
 {
@@ -239,34 +235,134 @@ namespace
             c8*                              name;
             compute_dispatch_params          cs_dispatch;
             u8                               stencil_ref;
+            u64                              payload_reclaim_pos;
         };
 
         renderer_cmd(){};
     };
 
+    // linear ring of memory for command payloads (buffer updates, state descs, etc). the producer carves allocations
+    // from put_pos and the render thread reclaims everything up to the position recorded in the present command
+    struct cmd_payload_ring
+    {
+        u8*   data = nullptr;
+        u64   capacity = 0;
+        u64   put_pos = 0;
+        a_u64 reclaim_pos = {0};
+    };
+
     // front end render_ctx
     struct fe_render_ctx
     {
         pen::timer*               present_timer = nullptr;
         f64                       present_time = 0.0f;
         pen::resolve_resources    resolve_resources;
-        pen::semaphore*           consume_semaphore = nullptr;
         pen::semaphore*           continue_semaphore = nullptr;
         pen::slot_resources       renderer_slot_resources;
         ring_buffer<renderer_cmd> cmd_buffer;
         ring_buffer<renderer_cmd> release_cmd_buffer;
+        cmd_payload_ring          payload_ring;
+        pen::mutex*               slot_mutex = nullptr;
         u32*                      free_slots = nullptr;
-        a_s32                     wait;
+        a_u64                     frames_submitted = {0}; // written by the user thread in consume_cmd_buffer
+        a_u64                     frames_completed = {0}; // written by the render thread in end_frame_internal
     };
     static fe_render_ctx* _ctx;
     static render_ctx     _main_ctx;
 
+    // frames the user thread may run ahead of the render thread, can be set before or after init
+    const u32 k_max_frames_in_flight = 3;
+    a_u32     s_max_frames_in_flight = {1};
+
+    // when set, renderer_* calls on this thread append to the list instead of the ctx cmd buffer
+    thread_local pen::cmd_list* t_recording_list = nullptr;
+
 } // namespace
 
 namespace pen
 {
     void end_frame_internal();
     void new_frame_internal();
+    void exec_cmd(const renderer_cmd& cmd);
+
+    struct cmd_list
+    {
+        renderer_cmd* cmds = nullptr;
+        renderer_cmd* release_cmds = nullptr;
+    };
+
+    void push_cmd(const renderer_cmd& cmd)
+    {
+        if (t_recording_list)
+        {
+            sb_push(t_recording_list->cmds, cmd);
+            return;
+        }
+
+#if PEN_SINGLE_THREADED
+        exec_cmd(cmd);
+#else
+        _ctx->cmd_buffer.put(cmd);
+#endif
+    }
+
+    void push_release_cmd(const renderer_cmd& cmd)
+    {
+        if (t_recording_list)
+        {
+            sb_push(t_recording_list->release_cmds, cmd);
+            return;
+        }
+
+        _ctx->release_cmd_buffer.put(cmd);
+    }
+
+    // slots are allocated by any recording thread and freed by the render thread
+    u32 get_resource_slot()
+    {
+        mutex_lock(_ctx->slot_mutex);
+        u32 slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        mutex_unlock(_ctx->slot_mutex);
+        return slot;
+    }
+
+    // payloads larger than this fraction of the ring, or which do not fit, fall back to the heap
+    static const u64 k_payload_max_fraction = 4;
+
+    void* payload_alloc(size_t size)
+    {
+        // the ring has a single producer, lists recorded on other threads use the heap
+        cmd_payload_ring& ring = _ctx->payload_ring;
+        if (t_recording_list)
+            return memory_alloc(size);
+
+        u64 aligned = (size + 15) & ~15;
+        if (ring.capacity && aligned <= ring.capacity / k_payload_max_fraction)
+        {
+            // allocations are contiguous, skip the tail of the ring if it is too small
+            u64 offset = ring.put_pos % ring.capacity;
+            u64 pad = offset + aligned > ring.capacity ? ring.capacity - offset : 0;
+            u64 end = ring.put_pos + pad + aligned;
+
+            if (end - ring.reclaim_pos <= ring.capacity)
+            {
+                ring.put_pos = end;
+                return ring.data + (end - aligned) % ring.capacity;
+            }
+        }
+
+        return memory_alloc(size);
+    }
+
+    void payload_free(void* mem)
+    {
+        // ring memory is reclaimed wholesale at present
+        cmd_payload_ring& ring = _ctx->payload_ring;
+        if (mem >= ring.data && mem < ring.data + ring.capacity)
+            return;
+
+        memory_free(mem);
+    }
 
     void renderer_get_present_time(f32& cpu_ms, f32& gpu_ms)
     {
@@ -276,6 +372,14 @@ namespace pen
         gpu_ms = (f64)g_gpu_total / 1000.0 / 1000.0;
     }
 
+#if !defined(PEN_RENDERER_NULL) && !defined(PEN_RENDERER_OPENGL)
+    renderer_frame_stats renderer_get_frame_stats()
+    {
+        // only the null and opengl renderers gather stats
+        return renderer_frame_stats();
+    }
+#endif
+
     void exec_cmd(const renderer_cmd& cmd)
     {
         //PEN_LOG("CMD %i", cmd.command_index);
@@ -293,6 +397,7 @@ namespace pen
                 break;
             case CMD_PRESENT:
                 direct::renderer_present();
+                _ctx->payload_ring.reclaim_pos = cmd.payload_reclaim_pos;
                 end_frame_internal();
                 _ctx->present_time = timer_elapsed_ms(_ctx->present_timer);
                 timer_start(_ctx->present_timer);
@@ -300,8 +405,8 @@ namespace pen
 
             case CMD_LOAD_SHADER:
                 direct::renderer_load_shader(cmd.shader_load, cmd.resource_slot);
-                memory_free(cmd.shader_load.byte_code);
-                memory_free(cmd.shader_load.so_decl_entries);
+                payload_free(cmd.shader_load.byte_code);
+                payload_free(cmd.shader_load.so_decl_entries);
                 break;
 
             case CMD_SET_SHADER:
@@ -321,8 +426,8 @@ namespace pen
 
             case CMD_CREATE_INPUT_LAYOUT:
                 direct::renderer_create_input_layout(cmd.create_input_layout, cmd.resource_slot);
-                memory_free(cmd.create_input_layout.vs_byte_code);
-                memory_free(cmd.create_input_layout.input_layout);
+                payload_free(cmd.create_input_layout.vs_byte_code);
+                payload_free(cmd.create_input_layout.input_layout);
                 break;
 
             case CMD_SET_INPUT_LAYOUT:
@@ -331,16 +436,16 @@ namespace pen
 
             case CMD_CREATE_BUFFER:
                 direct::renderer_create_buffer(cmd.create_buffer, cmd.resource_slot);
-                memory_free(cmd.create_buffer.data);
+                payload_free(cmd.create_buffer.data);
                 break;
 
             case CMD_SET_VERTEX_BUFFER:
                 direct::renderer_set_vertex_buffers(cmd.set_vertex_buffer.buffer_indices, cmd.set_vertex_buffer.num_buffers,
                                                     cmd.set_vertex_buffer.start_slot, cmd.set_vertex_buffer.strides,
                                                     cmd.set_vertex_buffer.offsets);
-                memory_free(cmd.set_vertex_buffer.buffer_indices);
-                memory_free(cmd.set_vertex_buffer.strides);
-                memory_free(cmd.set_vertex_buffer.offsets);
+                payload_free(cmd.set_vertex_buffer.buffer_indices);
+                payload_free(cmd.set_vertex_buffer.strides);
+                payload_free(cmd.set_vertex_buffer.offsets);
                 break;
 
             case CMD_SET_INDEX_BUFFER:
@@ -366,7 +471,7 @@ namespace pen
 
             case CMD_CREATE_TEXTURE:
                 direct::renderer_create_texture(cmd.create_texture, cmd.resource_slot);
-                memory_free(cmd.create_texture.data);
+                payload_free(cmd.create_texture.data);
                 break;
 
             case CMD_CREATE_SAMPLER:
@@ -420,7 +525,7 @@ namespace pen
 
             case CMD_CREATE_BLEND_STATE:
                 direct::renderer_create_blend_state(cmd.create_blend_state, cmd.resource_slot);
-                memory_free(cmd.create_blend_state.render_targets);
+                payload_free(cmd.create_blend_state.render_targets);
                 break;
 
             case CMD_SET_BLEND_STATE:
@@ -440,12 +545,12 @@ namespace pen
             case CMD_UPDATE_BUFFER:
                 direct::renderer_update_buffer(cmd.update_buffer.buffer_index, cmd.update_buffer.data,
                                                cmd.update_buffer.data_size, cmd.update_buffer.offset);
-                memory_free(cmd.update_buffer.data);
+                payload_free(cmd.update_buffer.data);
                 break;
 
             case CMD_CREATE_DEPTH_STENCIL_STATE:
                 direct::renderer_create_depth_stencil_state(*cmd.p_create_depth_stencil_state, cmd.resource_slot);
-                memory_free(cmd.p_create_depth_stencil_state);
+                payload_free(cmd.p_create_depth_stencil_state);
                 break;
 
             case CMD_SET_DEPTH_STENCIL_STATE:
@@ -545,21 +650,42 @@ namespace pen
     void renderer_consume_cmd_buffer()
     {
 #if !PEN_SINGLE_THREADED
-        while (_ctx->wait > 0)
-            pen::thread_sleep_ms(1);
-
-        if (_ctx->consume_semaphore)
-        {
-            semaphore_post(_ctx->consume_semaphore, 1);
+        // the frame is fully submitted, block until the render thread is within max_frames_in_flight.
+        // continue_semaphore is posted after each completed frame, the count is re-checked after every wake
+        u64 submitted = ++_ctx->frames_submitted;
+        while (submitted - _ctx->frames_completed > s_max_frames_in_flight)
             semaphore_wait(_ctx->continue_semaphore);
-        }
 
         // sync on window surface
         direct::renderer_sync();
-        _ctx->wait++;
 #endif
     }
 
+    void renderer_set_max_frames_in_flight(u32 frames)
+    {
+        if (frames < 1)
+            frames = 1;
+        else if (frames > k_max_frames_in_flight)
+            frames = k_max_frames_in_flight;
+
+        s_max_frames_in_flight = frames;
+    }
+
+    u32 renderer_get_max_frames_in_flight()
+    {
+        return s_max_frames_in_flight;
+    }
+
+    u32 renderer_frames_in_flight()
+    {
+        if (!_ctx)
+            return 0;
+
+        u64 completed = _ctx->frames_completed;
+        u64 submitted = _ctx->frames_submitted;
+        return submitted > completed ? (u32)(submitted - completed) : 0;
+    }
+
     void renderer_consume_cmd_buffer_non_blocking()
     {
         for (;;)
@@ -581,10 +707,12 @@ namespace pen
     {
         // free slots we have now deleted the resources for
         u32 ns = sb_count(_ctx->free_slots);
+        mutex_lock(_ctx->slot_mutex);
         for (u32 i = 0; i < ns; ++i)
         {
             slot_resources_free(&_ctx->renderer_slot_resources, _ctx->free_slots[i]);
         }
+        mutex_unlock(_ctx->slot_mutex);
         sb_free(_ctx->free_slots);
         _ctx->free_slots = nullptr;
 
@@ -615,8 +743,8 @@ namespace pen
         }
 
         direct::renderer_end_frame();
+        _ctx->frames_completed++;
         semaphore_post(_ctx->continue_semaphore, 1);
-        _ctx->wait--;
     }
 
     void renderer_wait_for_jobs()
@@ -727,25 +855,32 @@ namespace pen
         g_resolve_resources = ctx->resolve_resources;
     }
 
-    render_ctx renderer_create_context(u32 max_commands)
+    render_ctx renderer_create_context(u32 max_commands, u32 cmd_payload_size)
     {
         fe_render_ctx* new_ctx = new fe_render_ctx();
         new_ctx->cmd_buffer.create(max_commands);
+
+        if (cmd_payload_size)
+        {
+            new_ctx->payload_ring.data = (u8*)memory_alloc(cmd_payload_size);
+            new_ctx->payload_ring.capacity = cmd_payload_size;
+        }
+
         new_ctx->release_cmd_buffer.create(1024);
         new_ctx->present_timer = timer_create();
         timer_start(new_ctx->present_timer);
         new_ctx->present_time = 0.0f;
-        new_ctx->consume_semaphore = semaphore_create(0, 1);
         new_ctx->continue_semaphore = semaphore_create(0, 1);
+        new_ctx->slot_mutex = mutex_create();
         slot_resources_init(&new_ctx->renderer_slot_resources, 2048);
 
         return (render_ctx*)new_ctx;
     }
 
-    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands)
+    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands, u32 cmd_payload_size)
     {
         // create main render context and bind it
-        _main_ctx = renderer_create_context(max_commands);
+        _main_ctx = renderer_create_context(max_commands, cmd_payload_size);
         _ctx = (fe_render_ctx*)_main_ctx;
 
         // bb is backbuffer depth and colour
@@ -911,6 +1046,66 @@ namespace pen
         return _main_ctx;
     }
 
+    cmd_list* renderer_cmd_list_create()
+    {
+        return new cmd_list();
+    }
+
+    void renderer_cmd_list_release(cmd_list* list)
+    {
+        // unsubmitted commands would leak their payloads
+        PEN_ASSERT(t_recording_list != list);
+        PEN_ASSERT(sb_count(list->cmds) == 0);
+
+        sb_free(list->cmds);
+        sb_free(list->release_cmds);
+        delete list;
+    }
+
+    void renderer_cmd_list_begin(cmd_list* list)
+    {
+        PEN_ASSERT(!t_recording_list);
+        t_recording_list = list;
+    }
+
+    void renderer_cmd_list_end(cmd_list* list)
+    {
+        PEN_ASSERT(t_recording_list == list);
+        t_recording_list = nullptr;
+    }
+
+    void renderer_cmd_list_submit(cmd_list* list)
+    {
+        PEN_ASSERT(!t_recording_list);
+
+        u32 nc = sb_count(list->cmds);
+        for (u32 i = 0; i < nc; ++i)
+        {
+            PEN_ASSERT(list->cmds[i].command_index != CMD_PRESENT);
+            push_cmd(list->cmds[i]);
+        }
+
+        // releases are deferred relative to the frame they are submitted in
+        u32 nr = sb_count(list->release_cmds);
+        for (u32 i = 0; i < nr; ++i)
+        {
+            list->release_cmds[i].frame_index = pen::_renderer_frame_index();
+            push_release_cmd(list->release_cmds[i]);
+        }
+
+        // keep the memory for the next recording
+        if (list->cmds)
+            stb__sbn(list->cmds) = 0;
+
+        if (list->release_cmds)
+            stb__sbn(list->release_cmds) = 0;
+    }
+
+    u32 renderer_cmd_list_size(const cmd_list* list)
+    {
+        return sb_count(list->cmds);
+    }
+
     //
     // command buffer api
     //
@@ -949,10 +1144,12 @@ namespace pen
 
     void renderer_present()
     {
+        PEN_ASSERT(!t_recording_list);
         pen::renderer_test_run();
 
         renderer_cmd cmd;
         cmd.command_index = CMD_PRESENT;
+        cmd.payload_reclaim_pos = _ctx->payload_ring.put_pos;
         add_cmd(cmd);
     }
 
@@ -967,7 +1164,7 @@ namespace pen
 
         if (params.byte_code)
         {
-            cmd.shader_load.byte_code = memory_alloc(params.byte_code_size);
+            cmd.shader_load.byte_code = payload_alloc(params.byte_code_size);
             memcpy(cmd.shader_load.byte_code, params.byte_code, params.byte_code_size);
         }
 
@@ -977,12 +1174,12 @@ namespace pen
             cmd.shader_load.so_num_entries = params.so_num_entries;
 
             u32 entries_size = sizeof(stream_out_decl_entry) * params.so_num_entries;
-            cmd.shader_load.so_decl_entries = (stream_out_decl_entry*)memory_alloc(entries_size);
+            cmd.shader_load.so_decl_entries = (stream_out_decl_entry*)payload_alloc(entries_size);
 
             memcpy(cmd.shader_load.so_decl_entries, params.so_decl_entries, entries_size);
         }
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1032,7 +1229,7 @@ namespace pen
             }
         }
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1063,16 +1260,16 @@ namespace pen
         cmd.create_input_layout.vs_byte_code_size = params.vs_byte_code_size;
 
         // copy buffer
-        cmd.create_input_layout.vs_byte_code = memory_alloc(params.vs_byte_code_size);
+        cmd.create_input_layout.vs_byte_code = payload_alloc(params.vs_byte_code_size);
         memcpy(cmd.create_input_layout.vs_byte_code, params.vs_byte_code, params.vs_byte_code_size);
 
         // copy array
         u32 input_layouts_size = sizeof(input_layout_desc) * params.num_elements;
-        cmd.create_input_layout.input_layout = (input_layout_desc*)memory_alloc(input_layouts_size);
+        cmd.create_input_layout.input_layout = (input_layout_desc*)payload_alloc(input_layouts_size);
 
         memcpy(cmd.create_input_layout.input_layout, params.input_layout, input_layouts_size);
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1100,11 +1297,11 @@ namespace pen
         if (params.data)
         {
             // make a copy of the buffers data
-            cmd.create_buffer.data = memory_alloc(params.buffer_size);
+            cmd.create_buffer.data = payload_alloc(params.buffer_size);
             memcpy(cmd.create_buffer.data, params.data, params.buffer_size);
         }
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1127,9 +1324,9 @@ namespace pen
         cmd.set_vertex_buffer.start_slot = start_slot;
         cmd.set_vertex_buffer.num_buffers = num_buffers;
 
-        cmd.set_vertex_buffer.buffer_indices = (u32*)memory_alloc(sizeof(u32) * num_buffers);
-        cmd.set_vertex_buffer.strides = (u32*)memory_alloc(sizeof(u32) * num_buffers);
-        cmd.set_vertex_buffer.offsets = (u32*)memory_alloc(sizeof(u32) * num_buffers);
+        cmd.set_vertex_buffer.buffer_indices = (u32*)payload_alloc(sizeof(u32) * num_buffers);
+        cmd.set_vertex_buffer.strides = (u32*)payload_alloc(sizeof(u32) * num_buffers);
+        cmd.set_vertex_buffer.offsets = (u32*)payload_alloc(sizeof(u32) * num_buffers);
 
         for (u32 i = 0; i < num_buffers; ++i)
         {
@@ -1208,7 +1405,7 @@ namespace pen
 
         memcpy(&cmd.create_render_target, (void*)&tcp, sizeof(texture_creation_params));
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1236,10 +1433,9 @@ namespace pen
 
         memcpy(&cmd.create_texture, (void*)&tcp, sizeof(texture_creation_params));
 
-        cmd.create_texture.data = memory_alloc(tcp.data_size);
-
         if (tcp.data)
         {
+            cmd.create_texture.data = payload_alloc(tcp.data_size);
             memcpy(cmd.create_texture.data, tcp.data, tcp.data_size);
         }
         else
@@ -1247,7 +1443,7 @@ namespace pen
             cmd.create_texture.data = nullptr;
         }
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1263,7 +1459,7 @@ namespace pen
 
         memcpy(&cmd.create_sampler, (void*)&scp, sizeof(sampler_creation_params));
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1293,7 +1489,7 @@ namespace pen
 
         memcpy(&cmd.create_raster_state, (void*)&rscp, sizeof(raster_state_creation_params));
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1354,12 +1550,12 @@ namespace pen
 
         // alloc and copy the render targets blend modes. to save space in the cmd buffer
         u32   render_target_modes_size = sizeof(render_target_blend) * bcp.num_render_targets;
-        void* mem = memory_alloc(render_target_modes_size);
+        void* mem = payload_alloc(render_target_modes_size);
         cmd.create_blend_state.render_targets = (render_target_blend*)mem;
 
         memcpy(cmd.create_blend_state.render_targets, (void*)bcp.render_targets, render_target_modes_size);
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1416,7 +1612,7 @@ namespace pen
         cmd.update_buffer.buffer_index = buffer_index;
         cmd.update_buffer.data_size = data_size;
         cmd.update_buffer.offset = offset;
-        cmd.update_buffer.data = memory_alloc(data_size);
+        cmd.update_buffer.data = payload_alloc(data_size);
         memcpy(cmd.update_buffer.data, data, data_size);
 
         add_cmd(cmd);
@@ -1429,11 +1625,11 @@ namespace pen
         cmd.command_index = CMD_CREATE_DEPTH_STENCIL_STATE;
 
         cmd.p_create_depth_stencil_state =
-            (depth_stencil_creation_params*)memory_alloc(sizeof(depth_stencil_creation_params));
+            (depth_stencil_creation_params*)payload_alloc(sizeof(depth_stencil_creation_params));
 
         memcpy(cmd.p_create_depth_stencil_state, &dscp, sizeof(depth_stencil_creation_params));
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
         cmd.resource_slot = resource_slot;
 
         add_cmd(cmd);
@@ -1488,7 +1684,7 @@ namespace pen
         cmd.set_shader.shader_index = shader_index;
         cmd.set_shader.shader_type = shader_type;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_buffer(u32 buffer_index)
@@ -1500,7 +1696,7 @@ namespace pen
         cmd.resource_slot = buffer_index;
         cmd.command_data_index = buffer_index;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_texture(u32 texture_index)
@@ -1512,7 +1708,7 @@ namespace pen
         cmd.command_data_index = texture_index;
         cmd.frame_index = pen::_renderer_frame_index();
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_blend_state(u32 blend_state)
@@ -1524,7 +1720,7 @@ namespace pen
         cmd.resource_slot = blend_state;
         cmd.command_data_index = blend_state;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_render_target(u32 render_target)
@@ -1536,7 +1732,7 @@ namespace pen
         cmd.resource_slot = render_target;
         cmd.command_data_index = render_target;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_clear_state(u32 clear_state)
@@ -1548,7 +1744,7 @@ namespace pen
         cmd.resource_slot = clear_state;
         cmd.command_data_index = clear_state;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_input_layout(u32 input_layout)
@@ -1560,7 +1756,7 @@ namespace pen
         cmd.resource_slot = input_layout;
         cmd.command_data_index = input_layout;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_sampler(u32 sampler)
@@ -1572,7 +1768,7 @@ namespace pen
         cmd.resource_slot = sampler;
         cmd.command_data_index = sampler;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_depth_stencil_state(u32 depth_stencil_state)
@@ -1584,7 +1780,7 @@ namespace pen
         cmd.resource_slot = depth_stencil_state;
         cmd.command_data_index = depth_stencil_state;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_release_raster_state(u32 raster_state_index)
@@ -1595,7 +1791,7 @@ namespace pen
         cmd.resource_slot = raster_state_index;
         cmd.command_data_index = raster_state_index;
 
-        _ctx->release_cmd_buffer.put(cmd);
+        push_release_cmd(cmd);
     }
 
     void renderer_set_stream_out_target(u32 buffer_index)
@@ -1666,7 +1862,7 @@ namespace pen
     {
         renderer_cmd cmd;
 
-        u32 resource_slot = slot_resources_get_next(&_ctx->renderer_slot_resources);
+        u32 resource_slot = get_resource_slot();
 
         cmd.command_index = CMD_CREATE_CLEAR_STATE;
         cmd.clear_state_params = cs;
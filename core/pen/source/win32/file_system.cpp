@@ -2,6 +2,7 @@
 // Copyright 2014 - 2023 Alex Dixon.
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
 
+#include "file_pack.h"
 #include "file_system.h"
 #include "memory.h"
 #include "pen_string.h"
@@ -90,10 +91,13 @@ namespace pen
 
     pen_error filesystem_read_file_to_buffer(const c8* filename, void** p_buffer, u32& buffer_size)
     {
-        c8* windir_filename = swap_slashes(filename);
-
         *p_buffer = NULL;
 
+        if (pack_read_file(filename, p_buffer, buffer_size))
+            return PEN_ERR_OK;
+
+        c8* windir_filename = swap_slashes(filename);
+
         FILE* p_file = nullptr;
         fopen_s(&p_file, windir_filename, "rb");
 
@@ -122,6 +126,82 @@ namespace pen
         return PEN_ERR_FILE_NOT_FOUND;
     }
 
+    pen_error filesystem_map_file(const c8* filename, file_view& view)
+    {
+        view = file_view();
+
+        if (pack_map_file(filename, view))
+            return PEN_ERR_OK;
+
+        c8* windir_filename = swap_slashes(filename);
+
+        HANDLE file = CreateFileA(windir_filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+
+        pen::memory_free(windir_filename);
+
+        if (file == INVALID_HANDLE_VALUE)
+            return PEN_ERR_FILE_NOT_FOUND;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            return PEN_ERR_FILE_NOT_FOUND;
+        }
+
+        // empty files are valid but cannot be mapped
+        if (size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return PEN_ERR_OK;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+
+        if (!mapping)
+            return PEN_ERR_FAILED;
+
+        // the view keeps its own reference to the mapping
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+
+        if (!data)
+            return PEN_ERR_FAILED;
+
+        view.data = data;
+        view.size = (size_t)size.QuadPart;
+        view.mapped = true;
+        return PEN_ERR_OK;
+    }
+
+    void filesystem_release_pages(const file_view& view, size_t offset, size_t size)
+    {
+        if (!view.mapped || offset >= view.size)
+            return;
+
+        if (offset + size > view.size)
+            size = view.size - offset;
+
+        // unlocking pages which are not locked removes them from the working set
+        VirtualUnlock((u8*)view.data + offset, size);
+    }
+
+    void filesystem_unmap_file(file_view& view)
+    {
+        // packed views are owned by the pack
+        if (!view.packed)
+        {
+            if (view.mapped)
+                UnmapViewOfFile(view.data);
+            else
+                pen::memory_free(view.data);
+        }
+
+        view = file_view();
+    }
+
     pen_error filesystem_enum_volumes(fs_tree_node& tree)
     {
         DWORD drive_bit_mask = GetLogicalDrives();
@@ -376,4 +456,26 @@ namespace pen
         return -1;
     }
 
+    // not implemented, the hot loader polls mtimes instead
+    struct file_watcher
+    {
+    };
+
+    file_watcher* filesystem_create_watcher()
+    {
+        return nullptr;
+    }
+
+    void filesystem_destroy_watcher(file_watcher* watcher)
+    {
+    }
+
+    bool filesystem_watch_directory(file_watcher* watcher, const c8* directory)
+    {
+        return false;
+    }
+
+    void filesystem_read_watcher(file_watcher* watcher, u32 timeout_ms, file_watcher_callback changed, void* user_data)
+    {
+    }
 } // namespace pen
@@ -159,7 +159,9 @@ namespace
         // renderer_init will enter a loop wait for rendering commands, and call os update
         HWND hwnd = (HWND)pen::window_get_primary_display_handle();
         create_ctx(hwnd);
-        pen::renderer_init((void*)&hwnd, true, s_ctx.creation_params.max_renderer_commands);
+        pen::renderer_set_max_frames_in_flight(s_ctx.creation_params.max_frames_in_flight);
+        pen::renderer_init((void*)&hwnd, true, s_ctx.creation_params.max_renderer_commands,
+                           s_ctx.creation_params.renderer_cmd_payload_size);
 
         return s_ctx.return_code;
     }
@@ -14,6 +14,9 @@ project "put"
     kind "StaticLib"
     language "C++"
 
+    -- must match the bullet lib, physics steps with bullet's multithreaded world
+    defines { "BT_THREADSAFE=1" }
+
     libdirs
     { 
         "../pen/lib/" .. platform_dir,
@@ -0,0 +1,1036 @@
+// ecs_anim.cpp
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "ecs/ecs_anim.h"
+#include "console.h"
+#include "ecs/ecs_cull.h"
+#include "memory.h"
+#include "pen.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// x86 paths are compiled with target attributes and selected at run time with simd_get_level
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#define ANIM_X86 1
+#define ANIM_TARGET_SSE
+#define ANIM_TARGET_AVX2
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ANIM_X86 1
+#define ANIM_TARGET_SSE __attribute__((target("sse2")))
+#define ANIM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ANIM_X86 0
+#endif
+
+namespace put
+{
+    namespace ecs
+    {
+        namespace
+        {
+            static const f32 k_sqrt2 = 1.41421356f;
+            static const f32 k_quat_range = 32767.0f; // 15 bits per smallest three component
+
+            f32 quat_dot(const quat& a, const quat& b)
+            {
+                return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3];
+            }
+
+            quat quat_negate(const quat& q)
+            {
+                quat r;
+                for (u32 i = 0; i < 4; ++i)
+                    r.v[i] = -q.v[i];
+                return r;
+            }
+
+            // the largest component is dropped and rebuilt from the unit length, its index is stored in the top bits
+            void encode_quat(const quat& q, u16* out)
+            {
+                f32 len = sqrtf(quat_dot(q, q));
+                f32 rcp = len > 0.0f ? 1.0f / len : 0.0f;
+
+                u32 largest = 0;
+                for (u32 i = 1; i < 4; ++i)
+                    if (fabsf(q.v[i]) > fabsf(q.v[largest]))
+                        largest = i;
+
+                // q and -q are the same rotation, keep the dropped component positive
+                f32 sign = q.v[largest] < 0.0f ? -rcp : rcp;
+
+                u32 c = 0;
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    if (i == largest)
+                        continue;
+
+                    f32 v = q.v[i] * sign * k_sqrt2; // [-1, 1]
+                    f32 u = (v * 0.5f + 0.5f) * k_quat_range + 0.5f;
+                    out[c++] = (u16)(u < 0.0f ? 0.0f : (u > k_quat_range ? k_quat_range : u));
+                }
+
+                out[0] |= (u16)((largest >> 1) << 15);
+                out[1] |= (u16)((largest & 1) << 15);
+            }
+
+            quat decode_quat(const u16* in)
+            {
+                u32 largest = ((in[0] >> 15) << 1) | (in[1] >> 15);
+
+                quat q;
+                f32  sum = 0.0f;
+                u32  c = 0;
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    if (i == largest)
+                        continue;
+
+                    f32 u = (f32)(in[c++] & 0x7fff) / k_quat_range;
+                    q.v[i] = (u * 2.0f - 1.0f) / k_sqrt2;
+                    sum += q.v[i] * q.v[i];
+                }
+
+                q.v[largest] = sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f);
+                return q;
+            }
+
+            u16 encode_component(f32 v, f32 range_min, f32 range_scale)
+            {
+                if (range_scale <= 0.0f)
+                    return 0;
+
+                f32 u = (v - range_min) / range_scale + 0.5f;
+                return (u16)(u < 0.0f ? 0.0f : (u > 65535.0f ? 65535.0f : u));
+            }
+
+            f32 decode_component(u16 v, f32 range_min, f32 range_scale)
+            {
+                return range_min + (f32)v * range_scale;
+            }
+
+            u32 reduce_track(const anim_track_source& src, u8* keep)
+            {
+                if (src.type == e_anim_track::rotate)
+                {
+                    const quat* q = src.rotation;
+                    auto        within = [q](u32 k0, u32 k1, u32 k, f32 t) {
+                        return anim_slerp_within(q[k0], q[k1], q[k], t, k_anim_rotate_tolerance);
+                    };
+
+                    u32 num_kept = anim_reduce_keys(src.times, src.num_keys, keep, within);
+
+                    // constant tracks only need a single key
+                    if (num_kept == 2 && within(0, src.num_keys - 1, src.num_keys - 1, 0.0f))
+                    {
+                        keep[src.num_keys - 1] = 0;
+                        num_kept = 1;
+                    }
+
+                    return num_kept;
+                }
+
+                f32               tolerance = src.type == e_anim_track::translate ? k_anim_translate_tolerance
+                                                                                   : k_anim_scale_tolerance;
+                const f32* const* c = src.components;
+                auto              within = [c, tolerance](u32 k0, u32 k1, u32 k, f32 t) {
+                    for (u32 i = 0; i < 3; ++i)
+                        if (c[i] && !anim_lerp_within(c[i][k0], c[i][k1], c[i][k], t, tolerance))
+                            return false;
+                    return true;
+                };
+
+                u32 num_kept = anim_reduce_keys(src.times, src.num_keys, keep, within);
+
+                if (num_kept == 2 && within(0, src.num_keys - 1, src.num_keys - 1, 0.0f))
+                {
+                    keep[src.num_keys - 1] = 0;
+                    num_kept = 1;
+                }
+
+                return num_kept;
+            }
+
+            // keys either side of t and the interpolation between them
+            void find_track_keys(const anim_clip& clip, const anim_track& track, f32 t, u32& cursor, const u16** a,
+                                 const u16** b, f32& it)
+            {
+                const f32* times = clip.times + track.key_offset;
+
+                u32 k0 = find_anim_key(times, track.num_keys, t, cursor);
+                u32 k1 = k0 + 1 < track.num_keys ? k0 + 1 : k0;
+                cursor = k0;
+
+                it = 0.0f;
+                if (k1 != k0)
+                {
+                    it = (t - times[k0]) / (times[k1] - times[k0]);
+                    it = it < 0.0f ? 0.0f : (it > 1.0f ? 1.0f : it);
+                }
+
+                *a = clip.keys + (track.key_offset + k0) * 3;
+                *b = clip.keys + (track.key_offset + k1) * 3;
+            }
+
+            void sample_track(const anim_clip& clip, const anim_track& track, f32 t, u32& cursor, anim_target& target)
+            {
+                const u16* a;
+                const u16* b;
+                f32        it;
+                find_track_keys(clip, track, t, cursor, &a, &b, it);
+
+                if (track.type == e_anim_track::rotate)
+                {
+                    quat qa = decode_quat(a);
+                    quat qb = decode_quat(b);
+
+                    // encoding can flip the sign of neighbouring keys, interpolate the short way
+                    if (quat_dot(qa, qb) < 0.0f)
+                        qb = quat_negate(qb);
+
+                    target.q = slerp(qa, qb, it) * target.q;
+                    target.flags |= track.flags;
+                    return;
+                }
+
+                u32 base = track.type == e_anim_track::translate ? 0 : 6;
+                for (u32 i = 0; i < 3; ++i)
+                {
+                    if (!(track.mask & (1 << i)))
+                        continue;
+
+                    f32 va = decode_component(a[i], track.range_min[i], track.range_scale[i]);
+                    f32 vb = decode_component(b[i], track.range_min[i], track.range_scale[i]);
+                    target.t[base + i] = va + (vb - va) * it;
+                }
+            }
+
+            //
+            // batched sampling
+            //
+
+            // rotation lanes hold the 3 encoded components and the index of the dropped one for both keys,
+            // vector lanes hold decoded translation or scale
+            enum batch_stream
+            {
+                rot_a0,
+                rot_a1,
+                rot_a2,
+                rot_ai,
+                rot_b0,
+                rot_b1,
+                rot_b2,
+                rot_bi,
+                rot_t,
+                rot_x,
+                rot_y,
+                rot_z,
+                rot_w,
+                vec_a0,
+                vec_a1,
+                vec_a2,
+                vec_b0,
+                vec_b1,
+                vec_b2,
+                vec_t,
+                vec_x,
+                vec_y,
+                vec_z,
+                num_batch_streams
+            };
+
+            static const u32 k_max_lanes = 8;
+            static const f32 k_decode_scale = 2.0f / (k_quat_range * k_sqrt2);
+            static const f32 k_decode_bias = -1.0f / k_sqrt2;
+
+            inline f32* stream(const anim_batch& batch, u32 s)
+            {
+                return batch.lanes + s * batch.capacity;
+            }
+
+            inline u32 pad_lanes(u32 n)
+            {
+                return (n + k_max_lanes - 1) & ~(k_max_lanes - 1);
+            }
+
+            void reserve_anim_batch(anim_batch& batch, u32 num_tracks)
+            {
+                u32 capacity = pad_lanes(num_tracks);
+                if (capacity <= batch.capacity)
+                    return;
+
+                free_anim_batch(batch);
+
+                batch.capacity = capacity;
+                batch.lanes = (f32*)pen::memory_alloc(sizeof(f32) * capacity * num_batch_streams);
+                batch.tracks = (u32*)pen::memory_alloc(sizeof(u32) * capacity * 2);
+
+                // padding lanes are interpolated along with the rest, keep them finite
+                memset(batch.lanes, 0x0, sizeof(f32) * capacity * num_batch_streams);
+            }
+
+            // the fixed up t makes nlerp follow slerp closely for rotations up to 180 degrees,
+            // see "Approximating slerp" by Arseny Kapoulkine
+            inline f32 nlerp_fixup_t(f32 d, f32 t)
+            {
+                f32 a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+                f32 b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+                f32 h = t - 0.5f;
+                f32 k = a * h * h + b;
+                return t + t * h * (t - 1.0f) * k;
+            }
+
+            inline void nlerp_scalar(const f32* a, const f32* b, f32 t, f32* out)
+            {
+                f32 d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+                f32 s = d < 0.0f ? -1.0f : 1.0f;
+
+                f32 ot = nlerp_fixup_t(fabsf(d), t);
+                f32 wa = 1.0f - ot;
+                f32 wb = ot * s;
+
+                f32 len2 = 0.0f;
+                for (u32 i = 0; i < 4; ++i)
+                {
+                    out[i] = a[i] * wa + b[i] * wb;
+                    len2 += out[i] * out[i];
+                }
+
+                f32 rcp = len2 > 0.0f ? 1.0f / sqrtf(len2) : 0.0f;
+                for (u32 i = 0; i < 4; ++i)
+                    out[i] *= rcp;
+            }
+
+            inline void decode_quat_lane(const f32* c0, const f32* c1, const f32* c2, const f32* ci, u32 i, f32* q)
+            {
+                f32 c[3] = {c0[i] * k_decode_scale + k_decode_bias, c1[i] * k_decode_scale + k_decode_bias,
+                            c2[i] * k_decode_scale + k_decode_bias};
+
+                f32 sum = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+                u32 largest = (u32)ci[i];
+                u32 cc = 0;
+                for (u32 j = 0; j < 4; ++j)
+                    q[j] = j == largest ? sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f) : c[cc++];
+            }
+
+            void interpolate_rotations_scalar(const anim_batch& batch, u32 start, u32 end)
+            {
+                const f32* rt = stream(batch, rot_t);
+                f32*       out[4] = {stream(batch, rot_x), stream(batch, rot_y), stream(batch, rot_z), stream(batch, rot_w)};
+
+                for (u32 i = start; i < end; ++i)
+                {
+                    f32 qa[4], qb[4], q[4];
+                    decode_quat_lane(stream(batch, rot_a0), stream(batch, rot_a1), stream(batch, rot_a2),
+                                     stream(batch, rot_ai), i, qa);
+                    decode_quat_lane(stream(batch, rot_b0), stream(batch, rot_b1), stream(batch, rot_b2),
+                                     stream(batch, rot_bi), i, qb);
+
+                    nlerp_scalar(qa, qb, rt[i], q);
+                    for (u32 c = 0; c < 4; ++c)
+                        out[c][i] = q[c];
+                }
+            }
+
+            void interpolate_vectors_scalar(const anim_batch& batch, u32 start, u32 end)
+            {
+                const f32* vt = stream(batch, vec_t);
+                for (u32 c = 0; c < 3; ++c)
+                {
+                    const f32* va = stream(batch, vec_a0 + c);
+                    const f32* vb = stream(batch, vec_b0 + c);
+                    f32*       vo = stream(batch, vec_x + c);
+
+                    for (u32 i = start; i < end; ++i)
+                        vo[i] = va[i] + (vb[i] - va[i]) * vt[i];
+                }
+            }
+
+            void blend_poses_scalar(const anim_pose& a, const anim_pose& b, f32 t, anim_pose& out, u32 start, u32 end)
+            {
+                for (u32 c = 0; c < 3; ++c)
+                {
+                    for (u32 i = start; i < end; ++i)
+                    {
+                        out.translation[c][i] = a.translation[c][i] + (b.translation[c][i] - a.translation[c][i]) * t;
+                        out.scale[c][i] = a.scale[c][i] + (b.scale[c][i] - a.scale[c][i]) * t;
+                    }
+                }
+
+                for (u32 i = start; i < end; ++i)
+                {
+                    f32 qa[4], qb[4], q[4];
+                    for (u32 c = 0; c < 4; ++c)
+                    {
+                        qa[c] = a.rotation[c][i];
+                        qb[c] = b.rotation[c][i];
+                    }
+
+                    nlerp_scalar(qa, qb, t, q);
+                    for (u32 c = 0; c < 4; ++c)
+                        out.rotation[c][i] = q[c];
+                }
+            }
+
+#if ANIM_X86
+            //
+            // sse 4 wide
+            //
+
+            ANIM_TARGET_SSE inline __m128 select_sse(__m128 mask, __m128 a, __m128 b)
+            {
+                return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+            }
+
+            ANIM_TARGET_SSE inline void decode_quat_sse(const f32* c0, const f32* c1, const f32* c2, const f32* ci,
+                                                        u32 i, __m128* q)
+            {
+                __m128 scale = _mm_set1_ps(k_decode_scale);
+                __m128 bias = _mm_set1_ps(k_decode_bias);
+
+                __m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c0 + i), scale), bias);
+                __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c1 + i), scale), bias);
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c2 + i), scale), bias);
+
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+                __m128 l = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sum), _mm_setzero_ps()));
+
+                // place the rebuilt component at its index, the others follow in order
+                __m128 idx = _mm_loadu_ps(ci + i);
+                __m128 m0 = _mm_cmpeq_ps(idx, _mm_set1_ps(0.0f));
+                __m128 m1 = _mm_cmpeq_ps(idx, _mm_set1_ps(1.0f));
+                __m128 m2 = _mm_cmpeq_ps(idx, _mm_set1_ps(2.0f));
+                __m128 m3 = _mm_cmpeq_ps(idx, _mm_set1_ps(3.0f));
+
+                q[0] = select_sse(m0, l, x);
+                q[1] = select_sse(m0, x, select_sse(m1, l, y));
+                q[2] = select_sse(_mm_or_ps(m0, m1), y, select_sse(m2, l, z));
+                q[3] = select_sse(m3, l, z);
+            }
+
+            ANIM_TARGET_SSE inline void nlerp_sse(const __m128* a, const __m128* b, __m128 t, __m128* out)
+            {
+                __m128 sign_bit = _mm_set1_ps(-0.0f);
+                __m128 half = _mm_set1_ps(0.5f);
+                __m128 one = _mm_set1_ps(1.0f);
+
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+                                      _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+
+                // interpolate the short way
+                __m128 flip = _mm_and_ps(d, sign_bit);
+                d = _mm_andnot_ps(sign_bit, d);
+
+                __m128 ka = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+                ka = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, ka));
+                ka = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, ka));
+
+                __m128 kb = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+                kb = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, kb));
+
+                __m128 h = _mm_sub_ps(t, half);
+                __m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ka, h), h), kb);
+                __m128 ot = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, h), _mm_sub_ps(t, one)), k));
+
+                __m128 wa = _mm_sub_ps(one, ot);
+                __m128 wb = _mm_xor_ps(ot, flip);
+
+                __m128 len2 = _mm_setzero_ps();
+                for (u32 c = 0; c < 4; ++c)
+                {
+                    out[c] = _mm_add_ps(_mm_mul_ps(a[c], wa), _mm_mul_ps(b[c], wb));
+                    len2 = _mm_add_ps(len2, _mm_mul_ps(out[c], out[c]));
+                }
+
+                // one newton step brings rsqrt to float precision
+                __m128 r = _mm_rsqrt_ps(len2);
+                r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(len2, r), r)));
+
+                for (u32 c = 0; c < 4; ++c)
+                    out[c] = _mm_mul_ps(out[c], r);
+            }
+
+            ANIM_TARGET_SSE void interpolate_rotations_sse(const anim_batch& batch, u32 start, u32 end)
+            {
+                for (u32 i = start; i < end; i += 4)
+                {
+                    __m128 qa[4], qb[4], q[4];
+                    decode_quat_sse(stream(batch, rot_a0), stream(batch, rot_a1), stream(batch, rot_a2),
+                                    stream(batch, rot_ai), i, qa);
+                    decode_quat_sse(stream(batch, rot_b0), stream(batch, rot_b1), stream(batch, rot_b2),
+                                    stream(batch, rot_bi), i, qb);
+
+                    nlerp_sse(qa, qb, _mm_loadu_ps(stream(batch, rot_t) + i), q);
+
+                    for (u32 c = 0; c < 4; ++c)
+                        _mm_storeu_ps(stream(batch, rot_x + c) + i, q[c]);
+                }
+            }
+
+            ANIM_TARGET_SSE void interpolate_vectors_sse(const anim_batch& batch, u32 start, u32 end)
+            {
+                for (u32 i = start; i < end; i += 4)
+                {
+                    __m128 t = _mm_loadu_ps(stream(batch, vec_t) + i);
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        __m128 va = _mm_loadu_ps(stream(batch, vec_a0 + c) + i);
+                        __m128 vb = _mm_loadu_ps(stream(batch, vec_b0 + c) + i);
+                        _mm_storeu_ps(stream(batch, vec_x + c) + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), t)));
+                    }
+                }
+            }
+
+            ANIM_TARGET_SSE void blend_poses_sse(const anim_pose& a, const anim_pose& b, f32 t, anim_pose& out,
+                                                 u32 start, u32 end)
+            {
+                __m128 tt = _mm_set1_ps(t);
+                for (u32 i = start; i < end; i += 4)
+                {
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        __m128 ta = _mm_loadu_ps(a.translation[c] + i);
+                        __m128 tb = _mm_loadu_ps(b.translation[c] + i);
+                        _mm_storeu_ps(out.translation[c] + i, _mm_add_ps(ta, _mm_mul_ps(_mm_sub_ps(tb, ta), tt)));
+
+                        __m128 sa = _mm_loadu_ps(a.scale[c] + i);
+                        __m128 sb = _mm_loadu_ps(b.scale[c] + i);
+                        _mm_storeu_ps(out.scale[c] + i, _mm_add_ps(sa, _mm_mul_ps(_mm_sub_ps(sb, sa), tt)));
+                    }
+
+                    __m128 qa[4], qb[4], q[4];
+                    for (u32 c = 0; c < 4; ++c)
+                    {
+                        qa[c] = _mm_loadu_ps(a.rotation[c] + i);
+                        qb[c] = _mm_loadu_ps(b.rotation[c] + i);
+                    }
+
+                    nlerp_sse(qa, qb, tt, q);
+
+                    for (u32 c = 0; c < 4; ++c)
+                        _mm_storeu_ps(out.rotation[c] + i, q[c]);
+                }
+            }
+
+            //
+            // avx2 8 wide
+            //
+
+            ANIM_TARGET_AVX2 inline void decode_quat_avx2(const f32* c0, const f32* c1, const f32* c2, const f32* ci,
+                                                          u32 i, __m256* q)
+            {
+                __m256 scale = _mm256_set1_ps(k_decode_scale);
+                __m256 bias = _mm256_set1_ps(k_decode_bias);
+
+                __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(c0 + i), scale), bias);
+                __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(c1 + i), scale), bias);
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(c2 + i), scale), bias);
+
+                __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+                __m256 l = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), sum), _mm256_setzero_ps()));
+
+                __m256 idx = _mm256_loadu_ps(ci + i);
+                __m256 m0 = _mm256_cmp_ps(idx, _mm256_set1_ps(0.0f), _CMP_EQ_OQ);
+                __m256 m1 = _mm256_cmp_ps(idx, _mm256_set1_ps(1.0f), _CMP_EQ_OQ);
+                __m256 m2 = _mm256_cmp_ps(idx, _mm256_set1_ps(2.0f), _CMP_EQ_OQ);
+                __m256 m3 = _mm256_cmp_ps(idx, _mm256_set1_ps(3.0f), _CMP_EQ_OQ);
+
+                q[0] = _mm256_blendv_ps(x, l, m0);
+                q[1] = _mm256_blendv_ps(_mm256_blendv_ps(y, l, m1), x, m0);
+                q[2] = _mm256_blendv_ps(_mm256_blendv_ps(z, l, m2), y, _mm256_or_ps(m0, m1));
+                q[3] = _mm256_blendv_ps(z, l, m3);
+            }
+
+            ANIM_TARGET_AVX2 inline void nlerp_avx2(const __m256* a, const __m256* b, __m256 t, __m256* out)
+            {
+                __m256 sign_bit = _mm256_set1_ps(-0.0f);
+                __m256 half = _mm256_set1_ps(0.5f);
+                __m256 one = _mm256_set1_ps(1.0f);
+
+                __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])),
+                                         _mm256_add_ps(_mm256_mul_ps(a[2], b[2]), _mm256_mul_ps(a[3], b[3])));
+
+                __m256 flip = _mm256_and_ps(d, sign_bit);
+                d = _mm256_andnot_ps(sign_bit, d);
+
+                __m256 ka = _mm256_sub_ps(_mm256_set1_ps(3.55645f), _mm256_mul_ps(d, _mm256_set1_ps(1.43519f)));
+                ka = _mm256_add_ps(_mm256_set1_ps(-3.2452f), _mm256_mul_ps(d, ka));
+                ka = _mm256_add_ps(_mm256_set1_ps(1.0904f), _mm256_mul_ps(d, ka));
+
+                __m256 kb = _mm256_add_ps(_mm256_set1_ps(-1.06021f), _mm256_mul_ps(d, _mm256_set1_ps(0.215638f)));
+                kb = _mm256_add_ps(_mm256_set1_ps(0.848013f), _mm256_mul_ps(d, kb));
+
+                __m256 h = _mm256_sub_ps(t, half);
+                __m256 k = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ka, h), h), kb);
+                __m256 ot =
+                    _mm256_add_ps(t, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, h), _mm256_sub_ps(t, one)), k));
+
+                __m256 wa = _mm256_sub_ps(one, ot);
+                __m256 wb = _mm256_xor_ps(ot, flip);
+
+                __m256 len2 = _mm256_setzero_ps();
+                for (u32 c = 0; c < 4; ++c)
+                {
+                    out[c] = _mm256_add_ps(_mm256_mul_ps(a[c], wa), _mm256_mul_ps(b[c], wb));
+                    len2 = _mm256_add_ps(len2, _mm256_mul_ps(out[c], out[c]));
+                }
+
+                __m256 r = _mm256_rsqrt_ps(len2);
+                r = _mm256_mul_ps(_mm256_mul_ps(half, r),
+                                  _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(len2, r), r)));
+
+                for (u32 c = 0; c < 4; ++c)
+                    out[c] = _mm256_mul_ps(out[c], r);
+            }
+
+            ANIM_TARGET_AVX2 void interpolate_rotations_avx2(const anim_batch& batch, u32 start, u32 end)
+            {
+                for (u32 i = start; i < end; i += 8)
+                {
+                    __m256 qa[4], qb[4], q[4];
+                    decode_quat_avx2(stream(batch, rot_a0), stream(batch, rot_a1), stream(batch, rot_a2),
+                                     stream(batch, rot_ai), i, qa);
+                    decode_quat_avx2(stream(batch, rot_b0), stream(batch, rot_b1), stream(batch, rot_b2),
+                                     stream(batch, rot_bi), i, qb);
+
+                    nlerp_avx2(qa, qb, _mm256_loadu_ps(stream(batch, rot_t) + i), q);
+
+                    for (u32 c = 0; c < 4; ++c)
+                        _mm256_storeu_ps(stream(batch, rot_x + c) + i, q[c]);
+                }
+            }
+
+            ANIM_TARGET_AVX2 void interpolate_vectors_avx2(const anim_batch& batch, u32 start, u32 end)
+            {
+                for (u32 i = start; i < end; i += 8)
+                {
+                    __m256 t = _mm256_loadu_ps(stream(batch, vec_t) + i);
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        __m256 va = _mm256_loadu_ps(stream(batch, vec_a0 + c) + i);
+                        __m256 vb = _mm256_loadu_ps(stream(batch, vec_b0 + c) + i);
+                        _mm256_storeu_ps(stream(batch, vec_x + c) + i,
+                                         _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(vb, va), t)));
+                    }
+                }
+            }
+
+            ANIM_TARGET_AVX2 void blend_poses_avx2(const anim_pose& a, const anim_pose& b, f32 t, anim_pose& out,
+                                                   u32 start, u32 end)
+            {
+                __m256 tt = _mm256_set1_ps(t);
+                for (u32 i = start; i < end; i += 8)
+                {
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        __m256 ta = _mm256_loadu_ps(a.translation[c] + i);
+                        __m256 tb = _mm256_loadu_ps(b.translation[c] + i);
+                        _mm256_storeu_ps(out.translation[c] + i,
+                                         _mm256_add_ps(ta, _mm256_mul_ps(_mm256_sub_ps(tb, ta), tt)));
+
+                        __m256 sa = _mm256_loadu_ps(a.scale[c] + i);
+                        __m256 sb = _mm256_loadu_ps(b.scale[c] + i);
+                        _mm256_storeu_ps(out.scale[c] + i, _mm256_add_ps(sa, _mm256_mul_ps(_mm256_sub_ps(sb, sa), tt)));
+                    }
+
+                    __m256 qa[4], qb[4], q[4];
+                    for (u32 c = 0; c < 4; ++c)
+                    {
+                        qa[c] = _mm256_loadu_ps(a.rotation[c] + i);
+                        qb[c] = _mm256_loadu_ps(b.rotation[c] + i);
+                    }
+
+                    nlerp_avx2(qa, qb, tt, q);
+
+                    for (u32 c = 0; c < 4; ++c)
+                        _mm256_storeu_ps(out.rotation[c] + i, q[c]);
+                }
+            }
+#endif
+
+            // lanes are padded so simd loops can run past the end
+            void interpolate_batch(const anim_batch& batch)
+            {
+                u32 nr = batch.num_rotations;
+                u32 nv = batch.num_vectors;
+
+#if ANIM_X86
+                simd_level level = simd_get_level();
+                if (level >= e_simd_level::avx2)
+                {
+                    interpolate_rotations_avx2(batch, 0, nr);
+                    interpolate_vectors_avx2(batch, 0, nv);
+                    return;
+                }
+
+                if (level >= e_simd_level::sse)
+                {
+                    interpolate_rotations_sse(batch, 0, nr);
+                    interpolate_vectors_sse(batch, 0, nv);
+                    return;
+                }
+#endif
+                interpolate_rotations_scalar(batch, 0, nr);
+                interpolate_vectors_scalar(batch, 0, nv);
+            }
+        } // namespace
+
+        bool anim_lerp_within(f32 a, f32 b, f32 v, f32 t, f32 tolerance)
+        {
+            return fabsf(a + (b - a) * t - v) <= tolerance;
+        }
+
+        bool anim_slerp_within(const quat& a, const quat& b, const quat& v, f32 t, f32 tolerance)
+        {
+            quat bb = quat_dot(a, b) < 0.0f ? quat_negate(b) : b;
+            quat s = slerp(a, bb, t);
+
+            // for small angles the distance between unit quaternions is half the angle between the rotations,
+            // which unlike acos of the dot product keeps its precision near zero
+            quat vv = quat_dot(s, v) < 0.0f ? quat_negate(v) : v;
+            f32  d2 = 0.0f;
+            for (u32 i = 0; i < 4; ++i)
+                d2 += (s.v[i] - vv.v[i]) * (s.v[i] - vv.v[i]);
+
+            return d2 <= tolerance * tolerance * 0.25f;
+        }
+
+        u32 find_anim_key(const f32* times, u32 num_keys, f32 t, u32 cursor)
+        {
+            if (num_keys <= 1 || t <= times[0])
+                return 0;
+
+            u32 last = num_keys - 1;
+            if (t >= times[last])
+                return last;
+
+            // playback moves forward by at most a key or two per update
+            if (cursor < last && times[cursor] <= t)
+            {
+                if (t < times[cursor + 1])
+                    return cursor;
+
+                if (cursor + 2 <= last && t < times[cursor + 2])
+                    return cursor + 1;
+            }
+
+            // times[lo] <= t < times[hi]
+            u32 lo = 0;
+            u32 hi = last;
+            while (hi - lo > 1)
+            {
+                u32 mid = (lo + hi) / 2;
+                if (times[mid] <= t)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+
+            return lo;
+        }
+
+        void build_anim_clip(const anim_track_source* sources, u32 num_sources, anim_clip& clip)
+        {
+            free_anim_clip(clip);
+
+            std::vector<anim_track> tracks;
+            std::vector<f32>        times;
+            std::vector<u16>        keys;
+            std::vector<u8>         keep;
+
+            for (u32 s = 0; s < num_sources; ++s)
+            {
+                const anim_track_source& src = sources[s];
+                if (src.num_keys == 0)
+                    continue;
+
+                keep.resize(src.num_keys);
+                reduce_track(src, keep.data());
+
+                anim_track track;
+                memset(&track, 0x0, sizeof(anim_track));
+                track.channel = src.channel;
+                track.type = src.type;
+                track.flags = src.flags;
+                track.key_offset = (u32)times.size();
+
+                if (src.type != e_anim_track::rotate)
+                {
+                    // quantise over the range of the kept keys
+                    for (u32 i = 0; i < 3; ++i)
+                    {
+                        if (!src.components[i])
+                            continue;
+
+                        track.mask |= 1 << i;
+
+                        f32 mn = FLT_MAX;
+                        f32 mx = -FLT_MAX;
+                        for (u32 k = 0; k < src.num_keys; ++k)
+                        {
+                            if (!keep[k])
+                                continue;
+
+                            mn = fminf(mn, src.components[i][k]);
+                            mx = fmaxf(mx, src.components[i][k]);
+                        }
+
+                        track.range_min[i] = mn;
+                        track.range_scale[i] = (mx - mn) / 65535.0f;
+                    }
+                }
+
+                for (u32 k = 0; k < src.num_keys; ++k)
+                {
+                    if (!keep[k])
+                        continue;
+
+                    times.push_back(src.times[k]);
+
+                    u16 key[3] = {0, 0, 0};
+                    if (src.type == e_anim_track::rotate)
+                    {
+                        encode_quat(src.rotation[k], key);
+                    }
+                    else
+                    {
+                        for (u32 i = 0; i < 3; ++i)
+                            if (track.mask & (1 << i))
+                                key[i] = encode_component(src.components[i][k], track.range_min[i], track.range_scale[i]);
+                    }
+
+                    keys.insert(keys.end(), key, key + 3);
+                    track.num_keys++;
+                }
+
+                tracks.push_back(track);
+            }
+
+            clip.num_tracks = (u32)tracks.size();
+            clip.num_keys = (u32)times.size();
+
+            clip.tracks = (anim_track*)pen::memory_alloc(sizeof(anim_track) * clip.num_tracks);
+            clip.times = (f32*)pen::memory_alloc(sizeof(f32) * clip.num_keys);
+            clip.keys = (u16*)pen::memory_alloc(sizeof(u16) * 3 * clip.num_keys);
+
+            memcpy(clip.tracks, tracks.data(), sizeof(anim_track) * clip.num_tracks);
+            memcpy(clip.times, times.data(), sizeof(f32) * clip.num_keys);
+            memcpy(clip.keys, keys.data(), sizeof(u16) * 3 * clip.num_keys);
+
+            clip.size = sizeof(anim_track) * clip.num_tracks + (sizeof(f32) + sizeof(u16) * 3) * clip.num_keys;
+        }
+
+        void free_anim_clip(anim_clip& clip)
+        {
+            pen::memory_free(clip.tracks);
+            pen::memory_free(clip.times);
+            pen::memory_free(clip.keys);
+            clip = anim_clip();
+        }
+
+        void sample_anim_clip(const anim_clip& clip, f32 t, u32* cursors, const anim_sampler* samplers,
+                              anim_target* targets)
+        {
+            for (u32 i = 0; i < clip.num_tracks; ++i)
+            {
+                const anim_track& track = clip.tracks[i];
+
+                u32 joint = samplers[track.channel].joint;
+                if (joint == PEN_INVALID_HANDLE)
+                    continue;
+
+                sample_track(clip, track, t, cursors[i], targets[joint]);
+            }
+        }
+
+        void sample_anim_clip_batch(const anim_clip& clip, f32 t, u32* cursors, const anim_sampler* samplers,
+                                    anim_target* targets, anim_batch& batch, const u8* joint_depth, u32 max_depth)
+        {
+            reserve_anim_batch(batch, clip.num_tracks);
+
+            batch.num_rotations = 0;
+            batch.num_vectors = 0;
+
+            u32* rotation_tracks = batch.tracks;
+            u32* vector_tracks = batch.tracks + batch.capacity;
+
+            // gather keys into lanes, key search stays scalar
+            for (u32 i = 0; i < clip.num_tracks; ++i)
+            {
+                const anim_track& track = clip.tracks[i];
+
+                u32 joint = samplers[track.channel].joint;
+                if (joint == PEN_INVALID_HANDLE)
+                    continue;
+
+                if (joint_depth && joint_depth[joint] > max_depth)
+                    continue;
+
+                const u16* a;
+                const u16* b;
+                f32        it;
+                find_track_keys(clip, track, t, cursors[i], &a, &b, it);
+
+                if (track.type == e_anim_track::rotate)
+                {
+                    u32 r = batch.num_rotations++;
+                    for (u32 c = 0; c < 3; ++c)
+                    {
+                        stream(batch, rot_a0 + c)[r] = (f32)(a[c] & 0x7fff);
+                        stream(batch, rot_b0 + c)[r] = (f32)(b[c] & 0x7fff);
+                    }
+
+                    stream(batch, rot_ai)[r] = (f32)(((a[0] >> 15) << 1) | (a[1] >> 15));
+                    stream(batch, rot_bi)[r] = (f32)(((b[0] >> 15) << 1) | (b[1] >> 15));
+                    stream(batch, rot_t)[r] = it;
+                    rotation_tracks[r] = i;
+                    continue;
+                }
+
+                u32 v = batch.num_vectors++;
+                for (u32 c = 0; c < 3; ++c)
+                {
+                    stream(batch, vec_a0 + c)[v] = decode_component(a[c], track.range_min[c], track.range_scale[c]);
+                    stream(batch, vec_b0 + c)[v] = decode_component(b[c], track.range_min[c], track.range_scale[c]);
+                }
+
+                stream(batch, vec_t)[v] = it;
+                vector_tracks[v] = i;
+            }
+
+            interpolate_batch(batch);
+
+            // scatter in track order, rotations of a joint are concatenated in the order they are stored
+            for (u32 r = 0; r < batch.num_rotations; ++r)
+            {
+                const anim_track& track = clip.tracks[rotation_tracks[r]];
+                anim_target&      target = targets[samplers[track.channel].joint];
+
+                quat q;
+                for (u32 c = 0; c < 4; ++c)
+                    q.v[c] = stream(batch, rot_x + c)[r];
+
+                target.q = q * target.q;
+                target.flags |= track.flags;
+            }
+
+            for (u32 v = 0; v < batch.num_vectors; ++v)
+            {
+                const anim_track& track = clip.tracks[vector_tracks[v]];
+                anim_target&      target = targets[samplers[track.channel].joint];
+
+                u32 base = track.type == e_anim_track::translate ? 0 : 6;
+                for (u32 c = 0; c < 3; ++c)
+                    if (track.mask & (1 << c))
+                        target.t[base + c] = stream(batch, vec_x + c)[v];
+            }
+        }
+
+        void free_anim_batch(anim_batch& batch)
+        {
+            pen::memory_free(batch.lanes);
+            pen::memory_free(batch.tracks);
+            batch = anim_batch();
+        }
+
+        void resize_anim_pose(anim_pose& pose, u32 num_joints)
+        {
+            u32 capacity = pad_lanes(num_joints);
+            if (capacity > pose.capacity)
+            {
+                free_anim_pose(pose);
+
+                // 10 streams in a single allocation
+                f32* data = (f32*)pen::memory_alloc(sizeof(f32) * capacity * 10);
+                memset(data, 0x0, sizeof(f32) * capacity * 10);
+
+                for (u32 c = 0; c < 3; ++c)
+                {
+                    pose.translation[c] = data + capacity * c;
+                    pose.scale[c] = data + capacity * (3 + c);
+                }
+
+                for (u32 c = 0; c < 4; ++c)
+                    pose.rotation[c] = data + capacity * (6 + c);
+
+                pose.capacity = capacity;
+            }
+
+            pose.num_joints = num_joints;
+        }
+
+        void free_anim_pose(anim_pose& pose)
+        {
+            pen::memory_free(pose.translation[0]);
+            pose = anim_pose();
+        }
+
+        void copy_anim_pose(const anim_pose& src, anim_pose& dst)
+        {
+            resize_anim_pose(dst, src.num_joints);
+
+            u32 n = src.num_joints;
+            for (u32 c = 0; c < 3; ++c)
+            {
+                memcpy(dst.translation[c], src.translation[c], sizeof(f32) * n);
+                memcpy(dst.scale[c], src.scale[c], sizeof(f32) * n);
+            }
+
+            for (u32 c = 0; c < 4; ++c)
+                memcpy(dst.rotation[c], src.rotation[c], sizeof(f32) * n);
+        }
+
+        void set_anim_pose_joint(anim_pose& pose, u32 joint, const vec3f& translation, const quat& rotation,
+                                 const vec3f& scale)
+        {
+            for (u32 c = 0; c < 3; ++c)
+            {
+                pose.translation[c][joint] = translation[c];
+                pose.scale[c][joint] = scale[c];
+            }
+
+            for (u32 c = 0; c < 4; ++c)
+                pose.rotation[c][joint] = rotation.v[c];
+        }
+
+        void get_anim_pose_joint(const anim_pose& pose, u32 joint, vec3f& translation, quat& rotation, vec3f& scale)
+        {
+            for (u32 c = 0; c < 3; ++c)
+            {
+                translation[c] = pose.translation[c][joint];
+                scale[c] = pose.scale[c][joint];
+            }
+
+            for (u32 c = 0; c < 4; ++c)
+                rotation.v[c] = pose.rotation[c][joint];
+        }
+
+        void blend_anim_poses(const anim_pose& a, const anim_pose& b, f32 t, anim_pose& out)
+        {
+            PEN_ASSERT(a.num_joints == b.num_joints && a.num_joints == out.num_joints);
+
+            u32 n = a.num_joints;
+
+#if ANIM_X86
+            simd_level level = simd_get_level();
+            if (level >= e_simd_level::avx2)
+            {
+                blend_poses_avx2(a, b, t, out, 0, n);
+                return;
+            }
+
+            if (level >= e_simd_level::sse)
+            {
+                blend_poses_sse(a, b, t, out, 0, n);
+                return;
+            }
+#endif
+            blend_poses_scalar(a, b, t, out, 0, n);
+        }
+    } // namespace ecs
+} // namespace put
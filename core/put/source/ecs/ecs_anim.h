@@ -0,0 +1,180 @@
+// ecs_anim.h
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Compressed runtime animation clips.
+// Each track (translation, scale or one rotation of a channel) stores its keys contiguously, translation and scale are
+// quantised to 16 bits over the range of the track and rotations use a 48 bit smallest three encoding. Keys which can
+// be reproduced by interpolating their neighbours are removed when the clip is built. Sampling keeps a cursor per track
+// so playback steps forward without searching, loops and seeks fall back to a binary search.
+// The batched sampler gathers the keys of every track into soa lanes and interpolates them 4 or 8 at a time, rotations
+// use a normalised lerp with a corrected t which stays close to slerp. Sampled joints are kept in soa anim_pose form so
+// poses can be blended with the same kernels.
+
+#pragma once
+
+#include "maths/quat.h"
+#include "types.h"
+
+namespace put
+{
+    namespace ecs
+    {
+        namespace e_anim_track
+        {
+            enum anim_track_t
+            {
+                translate,
+                scale,
+                rotate
+            };
+        }
+        typedef e_anim_track::anim_track_t anim_track_type;
+
+        // tolerances for keyframe reduction, rotation is in radians
+        static const f32 k_anim_translate_tolerance = 0.0001f;
+        static const f32 k_anim_scale_tolerance = 0.0001f;
+        static const f32 k_anim_rotate_tolerance = 0.001f;
+
+        struct anim_sampler
+        {
+            u32 joint;
+            u32 flags;
+        };
+
+        struct anim_target
+        {
+            f32  t[9]; // translate xyz, scale xyz.
+            quat q;
+            u32  flags = 0;
+        };
+
+        struct anim_track
+        {
+            u32 channel;    // sampler index
+            u32 type;       // e_anim_track
+            u32 flags;      // e_anim_flags applied to the target
+            u32 mask;       // translate / scale components which are animated
+            u32 num_keys;
+            u32 key_offset; // into anim_clip times, keys are at key_offset * 3
+            f32 range_min[3];
+            f32 range_scale[3];
+        };
+
+        struct anim_clip
+        {
+            u32         num_tracks = 0;
+            anim_track* tracks = nullptr;
+            f32*        times = nullptr;
+            u16*        keys = nullptr; // 3 per key
+            u32         num_keys = 0;
+            u32         size = 0; // bytes
+        };
+
+        // joint transforms in soa form, each stream holds capacity floats which is padded to the widest simd lane count
+        struct anim_pose
+        {
+            u32  num_joints = 0;
+            u32  capacity = 0;
+            f32* translation[3] = {};
+            f32* rotation[4] = {};
+            f32* scale[3] = {};
+        };
+
+        // scratch for sample_anim_clip_batch, one per thread
+        struct anim_batch
+        {
+            u32  capacity = 0; // lanes
+            u32  num_rotations = 0;
+            u32  num_vectors = 0;
+            f32* lanes = nullptr;  // soa streams, see ecs_anim.cpp
+            u32* tracks = nullptr; // track index of each rotation lane followed by each vector lane
+        };
+
+        // uncompressed keys for one track, components or rotation are supplied depending on type
+        struct anim_track_source
+        {
+            u32         channel;
+            u32         type;
+            u32         flags;
+            u32         num_keys;
+            const f32*  times;
+            const f32*  components[3]; // null when the component is not animated
+            const quat* rotation;
+        };
+
+        void build_anim_clip(const anim_track_source* sources, u32 num_sources, anim_clip& clip);
+        void free_anim_clip(anim_clip& clip);
+
+        // samples every track at time t into the target of its sampler, cursors has one entry per track
+        void sample_anim_clip(const anim_clip& clip, f32 t, u32* cursors, const anim_sampler* samplers,
+                              anim_target* targets);
+
+        // same result as sample_anim_clip within a small rotation error, using the widest simd level detected.
+        // when joint_depth is supplied tracks of joints deeper than max_depth are skipped
+        void sample_anim_clip_batch(const anim_clip& clip, f32 t, u32* cursors, const anim_sampler* samplers,
+                                    anim_target* targets, anim_batch& batch, const u8* joint_depth = nullptr,
+                                    u32 max_depth = -1);
+        void free_anim_batch(anim_batch& batch);
+
+        // poses keep their contents when resized to the same number of joints
+        void resize_anim_pose(anim_pose& pose, u32 num_joints);
+        void free_anim_pose(anim_pose& pose);
+        void copy_anim_pose(const anim_pose& src, anim_pose& dst);
+        void set_anim_pose_joint(anim_pose& pose, u32 joint, const vec3f& translation, const quat& rotation,
+                                 const vec3f& scale);
+        void get_anim_pose_joint(const anim_pose& pose, u32 joint, vec3f& translation, quat& rotation, vec3f& scale);
+
+        // out = lerp(a, b, t) per joint, a, b and out must have the same number of joints
+        void blend_anim_poses(const anim_pose& a, const anim_pose& b, f32 t, anim_pose& out);
+
+        // index of the last key at or before t, starting the search from cursor
+        u32 find_anim_key(const f32* times, u32 num_keys, f32 t, u32 cursor);
+
+        // interpolation error tests used for keyframe reduction
+        bool anim_lerp_within(f32 a, f32 b, f32 v, f32 t, f32 tolerance);
+        bool anim_slerp_within(const quat& a, const quat& b, const quat& v, f32 t, f32 tolerance);
+
+        // greedy keyframe reduction, keeps the first and last key and any key which can not be reproduced within
+        // tolerance by interpolating between the kept keys either side. within(k0, k1, k, t) tests key k against
+        // the interpolation of k0 and k1 at t, keep receives 1 for kept keys and the number kept is returned
+        template <typename T>
+        u32 anim_reduce_keys(const f32* times, u32 num_keys, u8* keep, T within)
+        {
+            static const u32 k_max_span = 256;
+
+            if (num_keys == 0)
+                return 0;
+
+            keep[0] = 1;
+            u32 num_kept = 1;
+            u32 k0 = 0;
+
+            for (u32 i = 1; i + 1 < num_keys; ++i)
+            {
+                // try to drop key i, every key between the last kept and i + 1 must still be reproduced
+                u32  k1 = i + 1;
+                f32  span = times[k1] - times[k0];
+                bool drop = span > 0.0f && k1 - k0 < k_max_span;
+
+                for (u32 k = k0 + 1; k < k1 && drop; ++k)
+                    drop = within(k0, k1, k, (times[k] - times[k0]) / span);
+
+                keep[i] = drop ? 0 : 1;
+                if (!drop)
+                {
+                    k0 = i;
+                    num_kept++;
+                }
+            }
+
+            if (num_keys > 1)
+            {
+                keep[num_keys - 1] = 1;
+                num_kept++;
+            }
+
+            return num_kept;
+        }
+    } // namespace ecs
+} // namespace put
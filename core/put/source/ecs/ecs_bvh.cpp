@@ -0,0 +1,540 @@
+// ecs_bvh.cpp
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "ecs/ecs_bvh.h"
+#include "maths/maths.h"
+#include "memory.h"
+#include "pen.h"
+#include "data_struct.h"
+
+#include <float.h>
+#include <math.h>
+#include <utility>
+
+namespace put
+{
+    namespace ecs
+    {
+        namespace
+        {
+            // fat bounds are expanded by a fraction of the size plus a constant so small objects can still move a bit
+            static const f32 k_fat_scale = 0.1f;
+            static const f32 k_fat_margin = 0.1f;
+            static const u32 k_max_stack = 256;
+
+            bool is_leaf(const bvh_node& node)
+            {
+                return node.left == -1;
+            }
+
+            f32 surface_area(const vec3f& min, const vec3f& max)
+            {
+                vec3f d = max - min;
+                return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+            }
+
+            bool contains(const bvh_node& node, const vec3f& min, const vec3f& max)
+            {
+                return min.x >= node.min.x && min.y >= node.min.y && min.z >= node.min.z && max.x <= node.max.x &&
+                       max.y <= node.max.y && max.z <= node.max.z;
+            }
+
+            void grow_entities(bvh* tree, u32 entity)
+            {
+                if (entity < tree->entity_capacity)
+                    return;
+
+                u32 new_capacity = tree->entity_capacity ? tree->entity_capacity : 64;
+                while (new_capacity <= entity)
+                    new_capacity *= 2;
+
+                tree->entity_leaf = (s32*)pen::memory_realloc(tree->entity_leaf, sizeof(s32) * new_capacity);
+                tree->entity_stamp = (u32*)pen::memory_realloc(tree->entity_stamp, sizeof(u32) * new_capacity);
+
+                for (u32 i = tree->entity_capacity; i < new_capacity; ++i)
+                {
+                    tree->entity_leaf[i] = -1;
+                    tree->entity_stamp[i] = 0;
+                }
+
+                tree->entity_capacity = new_capacity;
+            }
+
+            s32 alloc_node(bvh* tree)
+            {
+                if (tree->free_list == -1)
+                {
+                    u32 new_capacity = tree->capacity ? tree->capacity * 2 : 64;
+                    tree->nodes = (bvh_node*)pen::memory_realloc(tree->nodes, sizeof(bvh_node) * new_capacity);
+
+                    // chain the new nodes into the free list
+                    for (u32 i = tree->capacity; i < new_capacity; ++i)
+                    {
+                        tree->nodes[i].parent = i + 1 < new_capacity ? (s32)(i + 1) : -1;
+                        tree->nodes[i].height = -1;
+                    }
+
+                    tree->free_list = tree->capacity;
+                    tree->capacity = new_capacity;
+                }
+
+                s32 index = tree->free_list;
+                bvh_node& node = tree->nodes[index];
+                tree->free_list = node.parent;
+
+                node.parent = -1;
+                node.left = -1;
+                node.right = -1;
+                node.height = 0;
+                node.entity = -1;
+
+                ++tree->num_nodes;
+                return index;
+            }
+
+            void free_node(bvh* tree, s32 index)
+            {
+                tree->nodes[index].parent = tree->free_list;
+                tree->nodes[index].height = -1;
+                tree->free_list = index;
+                --tree->num_nodes;
+            }
+
+            void fit_node(bvh* tree, s32 index)
+            {
+                bvh_node& node = tree->nodes[index];
+                const bvh_node& l = tree->nodes[node.left];
+                const bvh_node& r = tree->nodes[node.right];
+                node.min = min_union(l.min, r.min);
+                node.max = max_union(l.max, r.max);
+                node.height = 1 + (l.height > r.height ? l.height : r.height);
+            }
+
+            // performs a left or right rotation if node a is imbalanced, returns the new root of the subtree
+            s32 balance(bvh* tree, s32 ia)
+            {
+                bvh_node* nodes = tree->nodes;
+                bvh_node& a = nodes[ia];
+                if (is_leaf(a) || a.height < 2)
+                    return ia;
+
+                s32 ib = a.left;
+                s32 ic = a.right;
+                s32 bal = nodes[ic].height - nodes[ib].height;
+
+                // the taller child is rotated up, its taller grandchild stays beneath it
+                if (bal > 1 || bal < -1)
+                {
+                    s32 iup = bal > 1 ? ic : ib;
+                    s32 iother = bal > 1 ? ib : ic;
+                    bvh_node& up = nodes[iup];
+
+                    s32 i_f = up.left;
+                    s32 i_g = up.right;
+
+                    up.left = ia;
+                    up.parent = a.parent;
+                    a.parent = iup;
+
+                    if (up.parent != -1)
+                    {
+                        if (nodes[up.parent].left == ia)
+                            nodes[up.parent].left = iup;
+                        else
+                            nodes[up.parent].right = iup;
+                    }
+                    else
+                    {
+                        tree->root = iup;
+                    }
+
+                    s32 keep = nodes[i_f].height > nodes[i_g].height ? i_f : i_g;
+                    s32 give = keep == i_f ? i_g : i_f;
+
+                    up.right = keep;
+                    nodes[give].parent = ia;
+                    if (bal > 1)
+                    {
+                        a.left = iother;
+                        a.right = give;
+                    }
+                    else
+                    {
+                        a.left = give;
+                        a.right = iother;
+                    }
+
+                    fit_node(tree, ia);
+                    fit_node(tree, iup);
+                    return iup;
+                }
+
+                return ia;
+            }
+
+            void insert_leaf(bvh* tree, s32 leaf)
+            {
+                bvh_node* nodes = tree->nodes;
+                if (tree->root == -1)
+                {
+                    tree->root = leaf;
+                    nodes[leaf].parent = -1;
+                    return;
+                }
+
+                // descend choosing the child which minimises the increase in surface area
+                vec3f lmin = nodes[leaf].min;
+                vec3f lmax = nodes[leaf].max;
+                s32   index = tree->root;
+                while (!is_leaf(nodes[index]))
+                {
+                    const bvh_node& node = nodes[index];
+                    f32 area = surface_area(node.min, node.max);
+                    f32 combined = surface_area(min_union(node.min, lmin), max_union(node.max, lmax));
+
+                    f32 cost = 2.0f * combined;
+                    f32 inheritance = 2.0f * (combined - area);
+
+                    f32 child_cost[2];
+                    s32 children[2] = {node.left, node.right};
+                    for (u32 c = 0; c < 2; ++c)
+                    {
+                        const bvh_node& child = nodes[children[c]];
+                        f32 a = surface_area(min_union(child.min, lmin), max_union(child.max, lmax));
+                        if (!is_leaf(child))
+                            a -= surface_area(child.min, child.max);
+                        child_cost[c] = a + inheritance;
+                    }
+
+                    if (cost < child_cost[0] && cost < child_cost[1])
+                        break;
+
+                    index = child_cost[0] < child_cost[1] ? node.left : node.right;
+                }
+
+                // new parent for the sibling and leaf
+                s32 sibling = index;
+                s32 old_parent = nodes[sibling].parent;
+                s32 new_parent = alloc_node(tree);
+                nodes = tree->nodes;
+
+                nodes[new_parent].parent = old_parent;
+                nodes[new_parent].left = sibling;
+                nodes[new_parent].right = leaf;
+                nodes[sibling].parent = new_parent;
+                nodes[leaf].parent = new_parent;
+
+                if (old_parent != -1)
+                {
+                    if (nodes[old_parent].left == sibling)
+                        nodes[old_parent].left = new_parent;
+                    else
+                        nodes[old_parent].right = new_parent;
+                }
+                else
+                {
+                    tree->root = new_parent;
+                }
+
+                // refit and rebalance up to the root
+                index = new_parent;
+                while (index != -1)
+                {
+                    fit_node(tree, index);
+                    index = balance(tree, index);
+                    index = nodes[index].parent;
+                }
+            }
+
+            void remove_leaf(bvh* tree, s32 leaf)
+            {
+                bvh_node* nodes = tree->nodes;
+                if (leaf == tree->root)
+                {
+                    tree->root = -1;
+                    return;
+                }
+
+                s32 parent = nodes[leaf].parent;
+                s32 grand_parent = nodes[parent].parent;
+                s32 sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+                free_node(tree, parent);
+
+                if (grand_parent == -1)
+                {
+                    tree->root = sibling;
+                    nodes[sibling].parent = -1;
+                    return;
+                }
+
+                // sibling takes the place of the parent
+                if (nodes[grand_parent].left == parent)
+                    nodes[grand_parent].left = sibling;
+                else
+                    nodes[grand_parent].right = sibling;
+
+                nodes[sibling].parent = grand_parent;
+
+                s32 index = grand_parent;
+                while (index != -1)
+                {
+                    index = balance(tree, index);
+                    fit_node(tree, index);
+                    index = nodes[index].parent;
+                }
+            }
+
+            void set_leaf_bounds(bvh_node& node, const vec3f& pos, const vec3f& extent)
+            {
+                vec3f fat = extent * (1.0f + k_fat_scale) + vec3f(k_fat_margin);
+                node.pos = pos;
+                node.extent = extent;
+                node.min = pos - fat;
+                node.max = pos + fat;
+            }
+
+            // 0 = outside, 1 = intersecting, 2 = inside, same plane test as frustum_cull_aabb_scalar
+            u32 classify(const frustum& frust, const f32* pd, const vec3f& pos, const vec3f& extent)
+            {
+                u32 result = 2;
+                for (s32 p = 0; p < 6; ++p)
+                {
+                    const vec3f& n = frust.n[p];
+                    f32 d = pos.x * n.x + pos.y * n.y + pos.z * n.z + pd[p];
+                    f32 r = extent.x * fabsf(n.x) + extent.y * fabsf(n.y) + extent.z * fabsf(n.z);
+
+                    if (d - r > 0.0f)
+                        return 0;
+
+                    if (d + r > 0.0f)
+                        result = 1;
+                }
+                return result;
+            }
+
+            bool ray_vs_box(const vec3f& origin, const vec3f& inv_dir, const vec3f& min, const vec3f& max, f32 t_max,
+                            f32& t_out)
+            {
+                f32 t0 = 0.0f;
+                f32 t1 = t_max;
+                for (u32 i = 0; i < 3; ++i)
+                {
+                    f32 ta = (min[i] - origin[i]) * inv_dir[i];
+                    f32 tb = (max[i] - origin[i]) * inv_dir[i];
+                    if (ta > tb)
+                        std::swap(ta, tb);
+
+                    t0 = ta > t0 ? ta : t0;
+                    t1 = tb < t1 ? tb : t1;
+                    if (t0 > t1)
+                        return false;
+                }
+
+                t_out = t0;
+                return true;
+            }
+        } // namespace
+
+        bool bvh_contains(const bvh* tree, u32 entity)
+        {
+            return entity < tree->entity_capacity && tree->entity_leaf[entity] != -1;
+        }
+
+        void bvh_insert(bvh* tree, u32 entity, const vec3f& pos, const vec3f& extent)
+        {
+            if (bvh_contains(tree, entity))
+            {
+                bvh_update(tree, entity, pos, extent);
+                return;
+            }
+
+            grow_entities(tree, entity);
+
+            s32 leaf = alloc_node(tree);
+            bvh_node& node = tree->nodes[leaf];
+            node.entity = entity;
+            set_leaf_bounds(node, pos, extent);
+
+            insert_leaf(tree, leaf);
+
+            tree->entity_leaf[entity] = leaf;
+            tree->entity_stamp[entity] = tree->stamp;
+            ++tree->num_leaves;
+        }
+
+        void bvh_update(bvh* tree, u32 entity, const vec3f& pos, const vec3f& extent)
+        {
+            if (!bvh_contains(tree, entity))
+            {
+                bvh_insert(tree, entity, pos, extent);
+                return;
+            }
+
+            s32 leaf = tree->entity_leaf[entity];
+            tree->entity_stamp[entity] = tree->stamp;
+
+            bvh_node& node = tree->nodes[leaf];
+            if (contains(node, pos - extent, pos + extent))
+            {
+                // fat bounds still enclose, only the tight bounds for leaf tests change
+                node.pos = pos;
+                node.extent = extent;
+                return;
+            }
+
+            remove_leaf(tree, leaf);
+            set_leaf_bounds(tree->nodes[leaf], pos, extent);
+            insert_leaf(tree, leaf);
+        }
+
+        void bvh_remove(bvh* tree, u32 entity)
+        {
+            if (!bvh_contains(tree, entity))
+                return;
+
+            s32 leaf = tree->entity_leaf[entity];
+            remove_leaf(tree, leaf);
+            free_node(tree, leaf);
+
+            tree->entity_leaf[entity] = -1;
+            --tree->num_leaves;
+        }
+
+        void bvh_remove_stale(bvh* tree)
+        {
+            for (u32 e = 0; e < tree->entity_capacity; ++e)
+                if (tree->entity_leaf[e] != -1 && tree->entity_stamp[e] != tree->stamp)
+                    bvh_remove(tree, e);
+
+            ++tree->stamp;
+        }
+
+        void bvh_clear(bvh* tree)
+        {
+            // rebuild the free list keeping the node memory
+            for (u32 i = 0; i < tree->capacity; ++i)
+            {
+                tree->nodes[i].parent = i + 1 < tree->capacity ? (s32)(i + 1) : -1;
+                tree->nodes[i].height = -1;
+            }
+
+            for (u32 e = 0; e < tree->entity_capacity; ++e)
+                tree->entity_leaf[e] = -1;
+
+            tree->free_list = tree->capacity ? 0 : -1;
+            tree->root = -1;
+            tree->num_nodes = 0;
+            tree->num_leaves = 0;
+        }
+
+        void bvh_free(bvh* tree)
+        {
+            pen::memory_free(tree->nodes);
+            pen::memory_free(tree->entity_leaf);
+            pen::memory_free(tree->entity_stamp);
+            *tree = bvh();
+        }
+
+        void bvh_query_frustum(const bvh* tree, const frustum& frust, u32** entities_out)
+        {
+            if (tree->root == -1)
+                return;
+
+            f32 pd[6];
+            for (s32 p = 0; p < 6; ++p)
+                pd[p] = maths::plane_distance(frust.p[p], frust.n[p]);
+
+            // top bit marks a subtree already known to be fully inside
+            static const u32 k_inside = 1u << 31;
+
+            u32 stack[k_max_stack];
+            u32 sp = 0;
+            stack[sp++] = tree->root;
+
+            const bvh_node* nodes = tree->nodes;
+            while (sp > 0)
+            {
+                u32             item = stack[--sp];
+                const bvh_node& node = nodes[item & ~k_inside];
+                u32             inside = item & k_inside;
+
+                if (is_leaf(node))
+                {
+                    if (inside || classify(frust, pd, node.pos, node.extent) != 0)
+                        sb_push(*entities_out, node.entity);
+                    continue;
+                }
+
+                if (!inside)
+                {
+                    u32 c = classify(frust, pd, (node.min + node.max) * 0.5f, (node.max - node.min) * 0.5f);
+                    if (c == 0)
+                        continue;
+
+                    if (c == 2)
+                        inside = k_inside;
+                }
+
+                PEN_ASSERT(sp + 2 <= k_max_stack);
+                stack[sp++] = node.right | inside;
+                stack[sp++] = node.left | inside;
+            }
+        }
+
+        u32 bvh_ray_nearest(const bvh* tree, const vec3f& origin, const vec3f& dir, f32* t_out)
+        {
+            u32 nearest = -1;
+            f32 t_nearest = FLT_MAX;
+
+            if (tree->root == -1)
+                return nearest;
+
+            vec3f inv_dir;
+            for (u32 i = 0; i < 3; ++i)
+                inv_dir[i] = dir[i] != 0.0f ? 1.0f / dir[i] : FLT_MAX;
+
+            s32 stack[k_max_stack];
+            u32 sp = 0;
+            stack[sp++] = tree->root;
+
+            const bvh_node* nodes = tree->nodes;
+            while (sp > 0)
+            {
+                const bvh_node& node = nodes[stack[--sp]];
+
+                f32 t;
+                if (!ray_vs_box(origin, inv_dir, node.min, node.max, t_nearest, t))
+                    continue;
+
+                if (is_leaf(node))
+                {
+                    if (ray_vs_box(origin, inv_dir, node.pos - node.extent, node.pos + node.extent, t_nearest, t))
+                    {
+                        t_nearest = t;
+                        nearest = node.entity;
+                    }
+                    continue;
+                }
+
+                PEN_ASSERT(sp + 2 <= k_max_stack);
+                stack[sp++] = node.right;
+                stack[sp++] = node.left;
+            }
+
+            if (t_out)
+                *t_out = t_nearest;
+
+            return nearest;
+        }
+
+        s32 bvh_height(const bvh* tree)
+        {
+            if (tree->root == -1)
+                return 0;
+
+            return tree->nodes[tree->root].height;
+        }
+    } // namespace ecs
+} // namespace put
@@ -0,0 +1,66 @@
+// ecs_bvh.h
+// Copyright 2014 - 2023 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Dynamic aabb tree used as an optional spatial index over the scene renderables.
+// Leaves store a fat aabb which is only re-inserted when the tight bounds move outside of it, so static or slowly moving
+// entities cost nothing to maintain. Internal nodes are kept balanced with tree rotations (as in box2d b2DynamicTree)
+
+#pragma once
+
+#include "camera.h"
+#include "types.h"
+
+namespace put
+{
+    namespace ecs
+    {
+        struct bvh_node
+        {
+            vec3f min;    // fat bounds
+            vec3f max;    // fat bounds
+            vec3f pos;    // leaf only, tight centre from pos_extent
+            vec3f extent; // leaf only, tight half size from pos_extent
+            s32   parent; // or next free node
+            s32   left;
+            s32   right;
+            s32   height; // leaf = 0, free = -1
+            u32   entity;
+        };
+
+        struct bvh
+        {
+            bvh_node* nodes = nullptr;
+            u32       num_nodes = 0;
+            u32       capacity = 0;
+            s32       root = -1;
+            s32       free_list = -1;
+            s32*      entity_leaf = nullptr;  // entity -> leaf node or -1
+            u32*      entity_stamp = nullptr; // frame the entity was last synced, to remove stale leaves
+            u32       entity_capacity = 0;
+            u32       stamp = 0;
+            u32       num_leaves = 0;
+        };
+
+        // inserts or refits an entity, reinserts only when the tight bounds leave the fat bounds
+        void bvh_insert(bvh* tree, u32 entity, const vec3f& pos, const vec3f& extent);
+        void bvh_update(bvh* tree, u32 entity, const vec3f& pos, const vec3f& extent);
+        void bvh_remove(bvh* tree, u32 entity);
+        bool bvh_contains(const bvh* tree, u32 entity);
+
+        // removes entities which have not been inserted or updated since the last call, and begins a new sync
+        void bvh_remove_stale(bvh* tree);
+
+        void bvh_clear(bvh* tree);
+        void bvh_free(bvh* tree);
+
+        // appends entities whose tight aabb is inside frust, subtrees fully inside are accepted without leaf tests
+        void bvh_query_frustum(const bvh* tree, const frustum& frust, u32** entities_out);
+
+        // returns the entity with the nearest aabb hit along the ray or -1, t_out is the distance along dir
+        u32 bvh_ray_nearest(const bvh* tree, const vec3f& origin, const vec3f& dir, f32* t_out = nullptr);
+
+        // max depth of the tree for debugging
+        s32 bvh_height(const bvh* tree);
+    } // namespace ecs
+} // namespace put
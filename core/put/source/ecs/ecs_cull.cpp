@@ -1,6 +1,7 @@
 #include "ecs_cull.h"
 
 #include "ecs_scene.h"
+#include "threads.h"
 #include "timer.h"
 
 #if __SSE2__ || __AVX2__ || __AVX__
@@ -8,6 +9,25 @@
 #include <xmmintrin.h>
 #endif
 
+// x86 paths are compiled with target attributes and selected at run time with cpuid
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define CULL_X86 1
+#define CULL_TARGET_SSE
+#define CULL_TARGET_AVX2
+#define CULL_TARGET_AVX512
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define CULL_X86 1
+#define CULL_TARGET_SSE __attribute__((target("sse2")))
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#define CULL_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CULL_X86 0
+#endif
+
 using namespace ::pen;
 
 namespace put
@@ -526,8 +546,530 @@ namespace put
         {
         }
 #endif
-        void frustum_cull_simd_init()
+        //
+        // soa stream implementations
+        //
+
+        namespace
+        {
+            struct stream_planes
+            {
+                f32 nx[6];
+                f32 ny[6];
+                f32 nz[6];
+                f32 anx[6]; // abs normal, for the extent along the normal
+                f32 any[6];
+                f32 anz[6];
+                f32 pd[6];
+            };
+
+            // culls stream entities [start, end) writing survivors to out and returning the count written.
+            // start must be a multiple of 16, out must have room for (end - start) rounded up to 16.
+            typedef u32 (*cull_range_func)(const cull_stream*, const stream_planes&, u32, u32, u32*);
+
+            static const u32 k_cull_block_size = 2048; // multiple of 16, bounds of a block stay in cache for every frustum
+
+            simd_level s_simd_level = e_simd_level::scalar;
+
+            // lane indices to pack the set bits of an 8 bit mask to the front of a register
+            u8 s_compress_lut[256][8];
+
+            // survivors per frustum per block for batched culling
+            u32* s_multi_scratch = nullptr;
+            u32  s_multi_scratch_size = 0;
+
+            struct multi_cull_context
+            {
+                const cull_stream*   stream;
+                const stream_planes* planes;
+                u32                  num_frusta;
+                u32*                 counts; // num_blocks * num_frusta
+                cull_range_func      func;
+            };
+
+            // the aabb is outside a plane when: dot(pos, n) - dot(extent, abs(n)) + pd > 0
+            // equivalent to the pos + extent * -sgn(n) test in frustum_cull_aabb_scalar
+            void get_stream_planes(const camera* cam, stream_planes& planes)
+            {
+                const frustum& frust = cam->camera_frustum;
+                for (s32 p = 0; p < 6; ++p)
+                {
+                    planes.nx[p] = frust.n[p].x;
+                    planes.ny[p] = frust.n[p].y;
+                    planes.nz[p] = frust.n[p].z;
+                    planes.anx[p] = fabs(frust.n[p].x);
+                    planes.any[p] = fabs(frust.n[p].y);
+                    planes.anz[p] = fabs(frust.n[p].z);
+                    planes.pd[p] = maths::plane_distance(frust.p[p], frust.n[p]);
+                }
+            }
+
+            u32 valid_lanes_mask(u32 remaining, u32 width)
+            {
+                return remaining >= width ? (1u << width) - 1 : (1u << remaining) - 1;
+            }
+
+            u32 count_bits(u32 v)
+            {
+                v = v - ((v >> 1) & 0x55555555);
+                v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+                return (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+            }
+
+            u32 cull_range_scalar(const cull_stream* stream, const stream_planes& planes, u32 start, u32 end, u32* out)
+            {
+                u32 written = 0;
+                for (u32 i = start; i < end; ++i)
+                {
+                    bool inside = true;
+                    for (s32 p = 0; p < 6; ++p)
+                    {
+                        // same order of operations as the simd versions, results only differ if the compiler contracts to fma
+                        f32 d = stream->pos_x[i] * planes.nx[p] + planes.pd[p];
+                        d = stream->pos_y[i] * planes.ny[p] + d;
+                        d = stream->pos_z[i] * planes.nz[p] + d;
+                        d = d - stream->extent_x[i] * planes.anx[p];
+                        d = d - stream->extent_y[i] * planes.any[p];
+                        d = d - stream->extent_z[i] * planes.anz[p];
+
+                        if (d > 0.0f)
+                            inside = false;
+                    }
+
+                    out[written] = stream->entities[i];
+                    written += inside ? 1 : 0;
+                }
+
+                return written;
+            }
+
+#if CULL_X86
+            CULL_TARGET_SSE
+            u32 cull_range_sse(const cull_stream* stream, const stream_planes& planes, u32 start, u32 end, u32* out)
+            {
+                __m128 nx[6], ny[6], nz[6], anx[6], any[6], anz[6], pd[6];
+                for (s32 p = 0; p < 6; ++p)
+                {
+                    nx[p] = _mm_set1_ps(planes.nx[p]);
+                    ny[p] = _mm_set1_ps(planes.ny[p]);
+                    nz[p] = _mm_set1_ps(planes.nz[p]);
+                    anx[p] = _mm_set1_ps(planes.anx[p]);
+                    any[p] = _mm_set1_ps(planes.any[p]);
+                    anz[p] = _mm_set1_ps(planes.anz[p]);
+                    pd[p] = _mm_set1_ps(planes.pd[p]);
+                }
+
+                __m128 zero = _mm_setzero_ps();
+
+                u32 written = 0;
+                for (u32 i = start; i < end; i += 4)
+                {
+                    __m128 px = _mm_load_ps(stream->pos_x + i);
+                    __m128 py = _mm_load_ps(stream->pos_y + i);
+                    __m128 pz = _mm_load_ps(stream->pos_z + i);
+                    __m128 ex = _mm_load_ps(stream->extent_x + i);
+                    __m128 ey = _mm_load_ps(stream->extent_y + i);
+                    __m128 ez = _mm_load_ps(stream->extent_z + i);
+
+                    __m128 outside = zero;
+                    for (s32 p = 0; p < 6; ++p)
+                    {
+                        __m128 d = _mm_add_ps(_mm_mul_ps(px, nx[p]), pd[p]);
+                        d = _mm_add_ps(_mm_mul_ps(py, ny[p]), d);
+                        d = _mm_add_ps(_mm_mul_ps(pz, nz[p]), d);
+                        d = _mm_sub_ps(d, _mm_mul_ps(ex, anx[p]));
+                        d = _mm_sub_ps(d, _mm_mul_ps(ey, any[p]));
+                        d = _mm_sub_ps(d, _mm_mul_ps(ez, anz[p]));
+
+                        outside = _mm_or_ps(outside, _mm_cmpgt_ps(d, zero));
+                    }
+
+                    // branchless compress, every lane is written but only survivors advance the cursor
+                    u32 keep = ~(u32)_mm_movemask_ps(outside) & valid_lanes_mask(end - i, 4);
+                    for (u32 j = 0; j < 4; ++j)
+                    {
+                        out[written] = stream->entities[i + j];
+                        written += (keep >> j) & 1;
+                    }
+                }
+
+                return written;
+            }
+
+            CULL_TARGET_AVX2
+            u32 cull_range_avx2(const cull_stream* stream, const stream_planes& planes, u32 start, u32 end, u32* out)
+            {
+                __m256 nx[6], ny[6], nz[6], anx[6], any[6], anz[6], pd[6];
+                for (s32 p = 0; p < 6; ++p)
+                {
+                    nx[p] = _mm256_set1_ps(planes.nx[p]);
+                    ny[p] = _mm256_set1_ps(planes.ny[p]);
+                    nz[p] = _mm256_set1_ps(planes.nz[p]);
+                    anx[p] = _mm256_set1_ps(planes.anx[p]);
+                    any[p] = _mm256_set1_ps(planes.any[p]);
+                    anz[p] = _mm256_set1_ps(planes.anz[p]);
+                    pd[p] = _mm256_set1_ps(planes.pd[p]);
+                }
+
+                __m256 zero = _mm256_setzero_ps();
+
+                u32 written = 0;
+                for (u32 i = start; i < end; i += 8)
+                {
+                    __m256 px = _mm256_load_ps(stream->pos_x + i);
+                    __m256 py = _mm256_load_ps(stream->pos_y + i);
+                    __m256 pz = _mm256_load_ps(stream->pos_z + i);
+                    __m256 ex = _mm256_load_ps(stream->extent_x + i);
+                    __m256 ey = _mm256_load_ps(stream->extent_y + i);
+                    __m256 ez = _mm256_load_ps(stream->extent_z + i);
+
+                    __m256 outside = zero;
+                    for (s32 p = 0; p < 6; ++p)
+                    {
+                        __m256 d = _mm256_add_ps(_mm256_mul_ps(px, nx[p]), pd[p]);
+                        d = _mm256_add_ps(_mm256_mul_ps(py, ny[p]), d);
+                        d = _mm256_add_ps(_mm256_mul_ps(pz, nz[p]), d);
+                        d = _mm256_sub_ps(d, _mm256_mul_ps(ex, anx[p]));
+                        d = _mm256_sub_ps(d, _mm256_mul_ps(ey, any[p]));
+                        d = _mm256_sub_ps(d, _mm256_mul_ps(ez, anz[p]));
+
+                        outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, zero, _CMP_GT_OQ));
+                    }
+
+                    // compress store emulated with a permute, survivors are packed to the front
+                    u32     keep = ~(u32)_mm256_movemask_ps(outside) & valid_lanes_mask(end - i, 8);
+                    __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)s_compress_lut[keep]));
+                    __m256i ents = _mm256_load_si256((const __m256i*)(stream->entities + i));
+
+                    _mm256_storeu_si256((__m256i*)(out + written), _mm256_permutevar8x32_epi32(ents, lanes));
+                    written += count_bits(keep);
+                }
+
+                return written;
+            }
+
+            CULL_TARGET_AVX512
+            u32 cull_range_avx512(const cull_stream* stream, const stream_planes& planes, u32 start, u32 end, u32* out)
+            {
+                __m512 nx[6], ny[6], nz[6], anx[6], any[6], anz[6], pd[6];
+                for (s32 p = 0; p < 6; ++p)
+                {
+                    nx[p] = _mm512_set1_ps(planes.nx[p]);
+                    ny[p] = _mm512_set1_ps(planes.ny[p]);
+                    nz[p] = _mm512_set1_ps(planes.nz[p]);
+                    anx[p] = _mm512_set1_ps(planes.anx[p]);
+                    any[p] = _mm512_set1_ps(planes.any[p]);
+                    anz[p] = _mm512_set1_ps(planes.anz[p]);
+                    pd[p] = _mm512_set1_ps(planes.pd[p]);
+                }
+
+                __m512 zero = _mm512_setzero_ps();
+
+                u32 written = 0;
+                for (u32 i = start; i < end; i += 16)
+                {
+                    __m512 px = _mm512_load_ps(stream->pos_x + i);
+                    __m512 py = _mm512_load_ps(stream->pos_y + i);
+                    __m512 pz = _mm512_load_ps(stream->pos_z + i);
+                    __m512 ex = _mm512_load_ps(stream->extent_x + i);
+                    __m512 ey = _mm512_load_ps(stream->extent_y + i);
+                    __m512 ez = _mm512_load_ps(stream->extent_z + i);
+
+                    __mmask16 outside = 0;
+                    for (s32 p = 0; p < 6; ++p)
+                    {
+                        __m512 d = _mm512_add_ps(_mm512_mul_ps(px, nx[p]), pd[p]);
+                        d = _mm512_add_ps(_mm512_mul_ps(py, ny[p]), d);
+                        d = _mm512_add_ps(_mm512_mul_ps(pz, nz[p]), d);
+                        d = _mm512_sub_ps(d, _mm512_mul_ps(ex, anx[p]));
+                        d = _mm512_sub_ps(d, _mm512_mul_ps(ey, any[p]));
+                        d = _mm512_sub_ps(d, _mm512_mul_ps(ez, anz[p]));
+
+                        outside |= _mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ);
+                    }
+
+                    __mmask16 keep = (__mmask16)(~outside & valid_lanes_mask(end - i, 16));
+                    __m512i   ents = _mm512_load_si512((const void*)(stream->entities + i));
+
+                    _mm512_mask_compressstoreu_epi32(out + written, keep, ents);
+                    written += count_bits(keep);
+                }
+
+                return written;
+            }
+
+            void cpuid(u32 leaf, u32 sub_leaf, u32 regs[4])
+            {
+#ifdef _MSC_VER
+                __cpuidex((int*)regs, leaf, sub_leaf);
+#else
+                __cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+            }
+
+            u64 xgetbv()
+            {
+#ifdef _MSC_VER
+                return _xgetbv(0);
+#else
+                u32 lo, hi;
+                __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+                return ((u64)hi << 32) | lo;
+#endif
+            }
+
+            simd_level detect_simd_level()
+            {
+                u32 regs[4];
+                cpuid(0, 0, regs);
+                u32 max_leaf = regs[0];
+
+                cpuid(1, 0, regs);
+                bool sse2 = regs[3] & (1 << 26);
+                bool fma = regs[2] & (1 << 12);
+                bool osxsave = regs[2] & (1 << 27);
+                bool avx = regs[2] & (1 << 28);
+
+                if (!sse2)
+                    return e_simd_level::scalar;
+
+                // os must save ymm (and zmm) registers on context switch
+                if (!osxsave || !avx || !fma || max_leaf < 7)
+                    return e_simd_level::sse;
+
+                u64 xcr0 = xgetbv();
+                if ((xcr0 & 0x6) != 0x6)
+                    return e_simd_level::sse;
+
+                cpuid(7, 0, regs);
+                bool avx2 = regs[1] & (1 << 5);
+                bool avx512f = regs[1] & (1 << 16);
+
+                if (!avx2)
+                    return e_simd_level::sse;
+
+                if (avx512f && (xcr0 & 0xe6) == 0xe6)
+                    return e_simd_level::avx512;
+
+                return e_simd_level::avx2;
+            }
+#else
+            simd_level detect_simd_level()
+            {
+                return e_simd_level::scalar;
+            }
+#endif
+
+            // indexed by simd_level, only levels up to the detected level are used
+#if CULL_X86
+            cull_range_func s_cull_range[] = {cull_range_scalar, cull_range_sse, cull_range_avx2, cull_range_avx512};
+#else
+            cull_range_func s_cull_range[] = {cull_range_scalar, cull_range_scalar, cull_range_scalar, cull_range_scalar};
+#endif
+
+            // widest supported implementation up to the requested level
+            cull_range_func get_cull_range(simd_level level)
+            {
+                return s_cull_range[std::min<u32>(level, s_simd_level)];
+            }
+
+            void cull_stream_range(const cull_stream* stream, const camera* cam, u32** entities_out, cull_range_func func)
+            {
+                if (stream->count == 0)
+                    return;
+
+                stream_planes planes;
+                get_stream_planes(cam, planes);
+
+                // make room to write a full simd register past the last survivor
+                stb__sbmaybegrow(*entities_out, stream->count + 16);
+                u32* out = *entities_out + sb_count(*entities_out);
+
+                stb__sbn(*entities_out) += func(stream, planes, 0, stream->count, out);
+            }
+
+            void cull_multi_blocks(void* user_data, u32 start, u32 end, u32 thread_index)
+            {
+                multi_cull_context* ctx = (multi_cull_context*)user_data;
+
+                u32 count = ctx->stream->count;
+                u32 cap = ctx->stream->capacity;
+
+                for (u32 b = start; b < end; ++b)
+                {
+                    u32 bs = b * k_cull_block_size;
+                    u32 be = std::min<u32>(bs + k_cull_block_size, count);
+
+                    for (u32 f = 0; f < ctx->num_frusta; ++f)
+                    {
+                        u32* out = s_multi_scratch + f * cap + bs;
+                        ctx->counts[b * ctx->num_frusta + f] = ctx->func(ctx->stream, ctx->planes[f], bs, be, out);
+                    }
+                }
+            }
+        } // namespace
+
+        void build_cull_stream(const ecs_scene* scene, const u32* entities_in, cull_stream* stream_out)
+        {
+            u32 n = sb_count(entities_in);
+
+            if (n > stream_out->capacity)
+            {
+                free_cull_stream(stream_out);
+
+                u32 cap = PEN_ALIGN(n, 16);
+                stream_out->pos_x = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->pos_y = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->pos_z = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->extent_x = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->extent_y = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->extent_z = (f32*)pen::memory_alloc_align(cap * sizeof(f32), 64);
+                stream_out->entities = (u32*)pen::memory_alloc_align(cap * sizeof(u32), 64);
+                stream_out->capacity = cap;
+            }
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                u32                   e = entities_in[i];
+                const cmp_pos_extent& pe = scene->pos_extent[e];
+
+                stream_out->pos_x[i] = pe.pos.x;
+                stream_out->pos_y[i] = pe.pos.y;
+                stream_out->pos_z[i] = pe.pos.z;
+                stream_out->extent_x[i] = pe.extent.x;
+                stream_out->extent_y[i] = pe.extent.y;
+                stream_out->extent_z[i] = pe.extent.z;
+                stream_out->entities[i] = e;
+            }
+
+            // padding lanes are masked off, but keep them initialised
+            for (u32 i = n; i < PEN_ALIGN(n, 16); ++i)
+            {
+                stream_out->pos_x[i] = stream_out->pos_y[i] = stream_out->pos_z[i] = 0.0f;
+                stream_out->extent_x[i] = stream_out->extent_y[i] = stream_out->extent_z[i] = 0.0f;
+                stream_out->entities[i] = 0;
+            }
+
+            stream_out->count = n;
+        }
+
+        void free_cull_stream(cull_stream* stream)
+        {
+            if (stream->capacity == 0)
+                return;
+
+            pen::memory_free_align(stream->pos_x);
+            pen::memory_free_align(stream->pos_y);
+            pen::memory_free_align(stream->pos_z);
+            pen::memory_free_align(stream->extent_x);
+            pen::memory_free_align(stream->extent_y);
+            pen::memory_free_align(stream->extent_z);
+            pen::memory_free_align(stream->entities);
+
+            *stream = cull_stream();
+        }
+
+        void frustum_cull_aabb_stream_scalar(const cull_stream* stream, const camera* cam, u32** entities_out)
+        {
+            cull_stream_range(stream, cam, entities_out, cull_range_scalar);
+        }
+
+        void frustum_cull_aabb_stream_sse(const cull_stream* stream, const camera* cam, u32** entities_out)
+        {
+            cull_stream_range(stream, cam, entities_out, get_cull_range(e_simd_level::sse));
+        }
+
+        void frustum_cull_aabb_stream_avx2(const cull_stream* stream, const camera* cam, u32** entities_out)
+        {
+            cull_stream_range(stream, cam, entities_out, get_cull_range(e_simd_level::avx2));
+        }
+
+        void frustum_cull_aabb_stream_avx512(const cull_stream* stream, const camera* cam, u32** entities_out)
+        {
+            cull_stream_range(stream, cam, entities_out, get_cull_range(e_simd_level::avx512));
+        }
+
+        void frustum_cull_aabb_stream(const cull_stream* stream, const camera* cam, u32** entities_out)
+        {
+            cull_stream_range(stream, cam, entities_out, get_cull_range(e_simd_level::avx512));
+        }
+
+        void frustum_cull_aabb_stream_multi(const cull_stream* stream, const camera* cams, u32 num_cams, u32** visible_out)
+        {
+            if (stream->count == 0 || num_cams == 0)
+                return;
+
+            u32 num_blocks = (stream->count + k_cull_block_size - 1) / k_cull_block_size;
+
+            // each frustum has a region the size of the stream, blocks write into it at their own offset
+            u32 scratch_size = stream->capacity * num_cams;
+            if (scratch_size > s_multi_scratch_size)
+            {
+                s_multi_scratch = (u32*)pen::memory_realloc(s_multi_scratch, scratch_size * sizeof(u32));
+                s_multi_scratch_size = scratch_size;
+            }
+
+            stream_planes* planes = nullptr;
+            u32*           counts = nullptr;
+            sb_add(planes, num_cams);
+            sb_add(counts, num_blocks * num_cams);
+
+            for (u32 f = 0; f < num_cams; ++f)
+                get_stream_planes(&cams[f], planes[f]);
+
+            multi_cull_context ctx;
+            ctx.stream = stream;
+            ctx.planes = planes;
+            ctx.num_frusta = num_cams;
+            ctx.counts = counts;
+            ctx.func = get_cull_range(e_simd_level::avx512);
+
+            pen::task_counter counter;
+            pen::tasks_parallel_for(num_blocks, 1, cull_multi_blocks, &ctx, &counter);
+            pen::tasks_wait(&counter);
+
+            // stitch blocks together in order, so output matches a single view cull
+            for (u32 f = 0; f < num_cams; ++f)
+            {
+                u32 total = 0;
+                for (u32 b = 0; b < num_blocks; ++b)
+                    total += counts[b * num_cams + f];
+
+                if (total == 0)
+                    continue;
+
+                u32* dst = sb_add(visible_out[f], total);
+                for (u32 b = 0; b < num_blocks; ++b)
+                {
+                    u32 c = counts[b * num_cams + f];
+                    memcpy(dst, s_multi_scratch + f * stream->capacity + b * k_cull_block_size, c * sizeof(u32));
+                    dst += c;
+                }
+            }
+
+            sb_free(planes);
+            sb_free(counts);
+        }
+
+        void simd_init()
+        {
+            for (u32 m = 0; m < 256; ++m)
+            {
+                u32 c = 0;
+                for (u32 b = 0; b < 8; ++b)
+                    if (m & (1 << b))
+                        s_compress_lut[m][c++] = b;
+
+                while (c < 8)
+                    s_compress_lut[m][c++] = 0;
+            }
+
+            s_simd_level = detect_simd_level();
+        }
+
+        simd_level simd_get_level()
         {
+            return s_simd_level;
         }
 
         void frustum_cull_aabb(const ecs_scene* scene, const camera* cam, u32* entities_in, u32** entities_out)
@@ -8,9 +8,23 @@ namespace put
     namespace ecs
     {
         struct ecs_scene;
+        struct cull_stream;
+
+        namespace e_simd_level
+        {
+            enum simd_level_t
+            {
+                scalar,
+                sse,    // 4 wide
+                avx2,   // 8 wide
+                avx512, // 16 wide
+            };
+        }
+        typedef e_simd_level::simd_level_t simd_level;
 
         // run time detect of simd extensions and setup function pointers to the fastest implementation
-        void simd_init();
+        void       simd_init();
+        simd_level simd_get_level();
 
         // frustum_cull_xxx_scalar versions scalar float cross platform implementations,
         void filter_entities_scalar(const ecs_scene* scene, u32** filtered_entities_out);
@@ -20,5 +34,22 @@ namespace put
         // frustum_cull_xxx functions are replaced by simd where available and fall back to scalar if no simd is available
         void frustum_cull_aabb(const ecs_scene* scene, const camera* cam, u32* entities_in, u32** entities_out);
         void frustum_cull_sphere(const ecs_scene* scene, const camera* cam, u32* entities_in, u32** entities_out);
+
+        // packs the pos_extent of entities_in into a contiguous soa stream so it can be loaded without gathering
+        void build_cull_stream(const ecs_scene* scene, const u32* entities_in, cull_stream* stream_out);
+        void free_cull_stream(cull_stream* stream);
+
+        // stream culling, explicit implementations for benchmarking, simd versions fall back to scalar if unsupported
+        void frustum_cull_aabb_stream_scalar(const cull_stream* stream, const camera* cam, u32** entities_out);
+        void frustum_cull_aabb_stream_sse(const cull_stream* stream, const camera* cam, u32** entities_out);
+        void frustum_cull_aabb_stream_avx2(const cull_stream* stream, const camera* cam, u32** entities_out);
+        void frustum_cull_aabb_stream_avx512(const cull_stream* stream, const camera* cam, u32** entities_out);
+
+        // selects the widest implementation detected in simd_init
+        void frustum_cull_aabb_stream(const cull_stream* stream, const camera* cam, u32** entities_out);
+
+        // culls the stream against num_cams frusta in one sweep split over task workers, appends to visible_out[i] for
+        // cams[i]. blocks of the stream are tested against every frustum while in cache, output order matches single cull
+        void frustum_cull_aabb_stream_multi(const cull_stream* stream, const camera* cams, u32 num_cams, u32** visible_out);
     } // namespace ecs
 } // namespace put
@@ -211,6 +211,12 @@ namespace put
                         dev_ui::set_program_preference("grid_size", s_model_view_controller.grid_size);
                 }
 
+                if (ImGui::CollapsingHeader("Culling"))
+                {
+                    ImGui::CheckboxFlags("Spatial Index (BVH)", &scene->flags, e_scene_flags::spatial_index);
+                    ImGui::Text("Leaves: %u, Height: %i", scene->spatial.num_leaves, bvh_height(&scene->spatial));
+                }
+
                 ImGui::End();
             }
         }
@@ -384,7 +390,7 @@ namespace put
                     clone_entity(scene, scene->selection_list[i], nn++, start, e_clone_mode::move, vec3f::zero(), "");
             }
 
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
         }
 
         void clear_selection(ecs_scene* scene)
@@ -401,6 +407,31 @@ namespace put
             scene->flags |= e_scene_flags::invalidate_scene_tree;
         }
 
+        // the renderables held by the spatial index, see filter_entities_scalar
+        bool in_spatial_index(const ecs_scene* scene, u32 node)
+        {
+            u32 accept = e_cmp::geometry | e_cmp::material;
+            if ((scene->entities[node] & accept) != accept)
+                return false;
+
+            if (scene->entities[node] & e_cmp::sub_instance)
+                return false;
+
+            return !(scene->state_flags[node] & e_state::hidden);
+        }
+
+        bool box_select_entity(const ecs_scene* scene, u32 node, const vec3f* p, const vec3f* n)
+        {
+            const vec3f& min = scene->bounding_volumes[node].transformed_min_extents;
+            const vec3f& max = scene->bounding_volumes[node].transformed_max_extents;
+
+            for (s32 i = 0; i < 6; ++i)
+                if (maths::aabb_vs_plane(min, max, p[i], n[i]) == maths::INFRONT)
+                    return false;
+
+            return true;
+        }
+
         void add_selection(ecs_scene* scene, u32 index, u32 select_mode)
         {
             if (pen::input_is_key_down(PK_CONTROL))
@@ -468,7 +499,7 @@ namespace put
 
             initialise_free_list(scene);
 
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
         }
 
         void enumerate_selection_ui(const ecs_scene* scene, bool* opened)
@@ -569,31 +600,72 @@ namespace put
                         pm = e_select_mode::add;
                     }
 
-                    for (s32 node = 0; node < scene->num_entities; ++node)
+                    if (scene->flags & e_scene_flags::spatial_index)
                     {
-                        if (!(scene->entities[node] & e_cmp::allocated))
-                            continue;
+                        // only visits the subtrees overlapping the selection frustum
+                        frustum select_frustum;
+                        for (s32 i = 0; i < 6; ++i)
+                        {
+                            select_frustum.n[i] = n[i];
+                            select_frustum.p[i] = p[i];
+                        }
 
-                        if (!(scene->entities[node] & e_cmp::geometry))
-                            continue;
+                        u32* candidates = nullptr;
+                        bvh_query_frustum(&scene->spatial, select_frustum, &candidates);
 
-                        bool selected = true;
-                        for (s32 i = 0; i < 6; ++i)
+                        // leaves have fat bounds, so candidates get the same test as the linear path
+                        u32 nc = sb_count(candidates);
+                        for (u32 c = 0; c < nc; ++c)
+                            if ((scene->entities[candidates[c]] & e_cmp::geometry) &&
+                                box_select_entity(scene, candidates[c], p, n))
+                                add_selection(scene, candidates[c], e_select_mode::add_multi);
+
+                        sb_free(candidates);
+
+                        // hidden, sub instance and material-less geometry is not in the index but is still selectable
+                        for (s32 node = 0; node < scene->num_entities; ++node)
+                        {
+                            if (!(scene->entities[node] & e_cmp::allocated))
+                                continue;
+
+                            if (!(scene->entities[node] & e_cmp::geometry))
+                                continue;
+
+                            if (in_spatial_index(scene, node))
+                                continue;
+
+                            if (box_select_entity(scene, node, p, n))
+                                add_selection(scene, node, e_select_mode::add_multi);
+                        }
+                    }
+                    else
+                    {
+                        for (s32 node = 0; node < scene->num_entities; ++node)
                         {
-                            vec3f& min = scene->bounding_volumes[node].transformed_min_extents;
-                            vec3f& max = scene->bounding_volumes[node].transformed_max_extents;
+                            if (!(scene->entities[node] & e_cmp::allocated))
+                                continue;
 
-                            u32 c = maths::aabb_vs_plane(min, max, p[i], n[i]);
-                            if (c == maths::INFRONT)
+                            if (!(scene->entities[node] & e_cmp::geometry))
+                                continue;
+
+                            bool selected = true;
+                            for (s32 i = 0; i < 6; ++i)
                             {
-                                selected = false;
-                                break;
+                                vec3f& min = scene->bounding_volumes[node].transformed_min_extents;
+                                vec3f& max = scene->bounding_volumes[node].transformed_max_extents;
+
+                                u32 c = maths::aabb_vs_plane(min, max, p[i], n[i]);
+                                if (c == maths::INFRONT)
+                                {
+                                    selected = false;
+                                    break;
+                                }
                             }
-                        }
 
-                        if (selected)
-                        {
-                            add_selection(scene, node, e_select_mode::add_multi);
+                            if (selected)
+                            {
+                                add_selection(scene, node, e_select_mode::add_multi);
+                            }
                         }
                     }
 
@@ -661,6 +733,20 @@ namespace put
                     if (!rt)
                     {
                         picking_state = e_picking_state::ready;
+
+                        // without a picking buffer fall back to a ray cast against the spatial index
+                        if (scene->flags & e_scene_flags::spatial_index)
+                        {
+                            vec2i vpi;
+                            pen::window_get_size(vpi.x, vpi.y);
+
+                            mat4  view_proj = cam->proj * cam->view;
+                            vec3f r0 = maths::unproject_sc(vec3f(cur_mouse, 0.0f), view_proj, vpi);
+                            vec3f r1 = maths::unproject_sc(vec3f(cur_mouse, 1.0f), view_proj, vpi);
+
+                            add_selection(scene, bvh_ray_nearest(&scene->spatial, r0, normalize(r1 - r0)));
+                        }
+
                         return;
                     }
 
@@ -955,6 +1041,10 @@ namespace put
             static bool dynamic_timestep = dev_ui::get_program_preference("dynamic_timestep").as_bool(true);
             static f32  fixed_timestep = dev_ui::get_program_preference("fixed_timestep").as_f32(1.0f / 60.0f);
 
+            static f32  physics_fixed_timestep = dev_ui::get_program_preference("physics_fixed_timestep").as_f32(0.0f);
+            static s32  physics_max_substeps = dev_ui::get_program_preference("physics_max_substeps").as_s32(4);
+            static bool physics_interpolate = dev_ui::get_program_preference("physics_interpolate").as_bool(true);
+
             if (ImGui::Begin("Settings", opened))
             {
                 Str setting_str;
@@ -991,6 +1081,26 @@ namespace put
                     }
                 }
 
+                // 0 steps physics once per frame
+                if (ImGui::InputFloat("Physics Fixed Timestep", &physics_fixed_timestep))
+                {
+                    physics_fixed_timestep = std::max(physics_fixed_timestep, 0.0f);
+                    dev_ui::set_program_preference("physics_fixed_timestep", physics_fixed_timestep);
+                }
+
+                if (physics_fixed_timestep > 0.0f)
+                {
+                    if (ImGui::SliderInt("Physics Max Substeps", &physics_max_substeps, 1, 16))
+                    {
+                        dev_ui::set_program_preference("physics_max_substeps", physics_max_substeps);
+                    }
+
+                    if (ImGui::Checkbox("Physics Interpolation", &physics_interpolate))
+                    {
+                        dev_ui::set_program_preference("physics_interpolate", physics_interpolate);
+                    }
+                }
+
                 if (ImGui::Button("Set Project Dir"))
                 {
                     set_project_dir = true;
@@ -1166,7 +1276,7 @@ namespace put
                 if (scene->flags & e_scene_flags::pause_update)
                 {
                     if (ImGui::Button(ICON_FA_PLAY))
-                        scene->flags &= (~scene->flags);
+                        scene->flags &= ~e_scene_flags::pause_update;
                 }
                 else
                 {
@@ -2132,6 +2242,29 @@ namespace put
                         ImGui::Text("%s", res->name.c_str());
                     }
 
+                    ImGui::Checkbox("Anim LOD", &controller.lod_enabled);
+                    if (controller.lod_enabled)
+                    {
+                        ImGui::Text("Current LOD: %u", controller.lod);
+
+                        for (u32 l = 0; l < k_num_anim_lods; ++l)
+                        {
+                            anim_lod& lod = controller.lods[l];
+
+                            ImGui::PushID(l);
+                            ImGui::Text("LOD %u", l);
+                            ImGui::InputFloat("Min Screen Coverage", &lod.min_coverage);
+
+                            s32 rate = lod.update_rate;
+                            if (ImGui::InputInt("Update Rate (Frames)", &rate))
+                                lod.update_rate = std::max<s32>(rate, 1);
+
+                            // -1 keeps every joint
+                            ImGui::InputInt("Max Joint Depth", (s32*)&lod.max_joint_depth);
+                            ImGui::PopID();
+                        }
+                    }
+
                     static bool add_anim = false;
                     if (ImGui::Button("Add Animation"))
                     {
@@ -2340,6 +2473,7 @@ namespace put
                     {
                         s32 s = selected_index;
                         scene->world_matrices[s] = mat4::create_identity();
+                        scene->state_flags[s] |= e_state::transform_dirty;
                     }
                 }
                 else
@@ -62,6 +62,7 @@ namespace
         u8*              data_start = nullptr;
         void*            file_data = nullptr;
         u32              file_size = 0;
+        pen::file_view   view;
         std::vector<u32> scene_offsets;
         std::vector<u32> material_offsets;
         std::vector<Str> material_names;
@@ -105,6 +106,7 @@ namespace
         u32                      num_meshes;
         std::vector<Str>         mat_names;
         std::vector<pmm_submesh> submeshes;
+        bool                     owns_data = true; // otherwise submesh data points into the file
     };
 
     struct volume_instance
@@ -119,16 +121,114 @@ namespace
     std::vector<material_resource*> s_material_resources;
     std::vector<animation_resource> s_animation_resources;
 
-    bool parse_pmm_contents(const c8* filename, pmm_contents& contents)
+    // registries over the resources above, keyed by hash
+    pen::hash_map<hash_id, geometry_resource*> s_geometry_lookup;      // hash -> first submesh resource
+    pen::hash_map<hash_id, geometry_resource*> s_geometry_file_lookup; // geom_hash -> first submesh, for duplicate loads
+    pen::hash_map<hash_id, material_resource*> s_material_lookup;
+    pen::hash_map<hash_id, anim_handle>        s_animation_lookup; // id_name -> index into s_animation_resources
+
+    // baked transform animation keys are split into translation, rotation and scale
+    void decompose_anim_matrix(const mat4& mat, vec3f& trans, quat& rot, vec3f& scale)
     {
-        // read in file from disk
-        pen_error err = pen::filesystem_read_file_to_buffer(filename, &contents.file_data, contents.file_size);
-        if (err != PEN_ERR_OK || contents.file_size == 0)
+        trans = mat.get_translation();
+        rot.from_matrix(mat);
+
+        f32 sx = mag((vec3f)mat.get_row(0).xyz);
+        f32 sy = mag((vec3f)mat.get_row(1).xyz);
+        f32 sz = mag((vec3f)mat.get_row(2).xyz);
+
+        scale = vec3f(sx, sy, sz);
+    }
+
+    struct pma_source
+    {
+        u32        semantic;
+        u32        type;
+        u32        target;
+        u32        num_elements;
+        const u32* data;
+        u32        stride; // elements per key
+
+        // decomposed transform keys
+        std::vector<vec3f> translation;
+        std::vector<quat>  rotation;
+        std::vector<vec3f> scale;
+    };
+
+    f32 pma_source_tolerance(const pma_source& src)
+    {
+        switch (src.target)
         {
-            dev_ui::log_level(dev_ui::console_level::error, "[error] load pmm - failed to find file: %s", filename);
-            return false;
+            case e_anim_target::rotate:
+            case e_anim_target::rotate_x:
+            case e_anim_target::rotate_y:
+            case e_anim_target::rotate_z:
+                return k_anim_rotate_tolerance;
+            case e_anim_target::scale:
+            case e_anim_target::scale_x:
+            case e_anim_target::scale_y:
+            case e_anim_target::scale_z:
+                return k_anim_scale_tolerance;
+            default:
+                return k_anim_translate_tolerance;
+        }
+    }
+
+    bool pma_key_within(const pma_source& src, u32 k0, u32 k1, u32 k, f32 t)
+    {
+        if (src.semantic == e_anim_semantics::time || src.semantic == e_anim_semantics::interpolation)
+            return true;
+
+        if (src.type == e_anim_data::type_float4x4)
+        {
+            for (u32 i = 0; i < 3; ++i)
+            {
+                if (!anim_lerp_within(src.translation[k0][i], src.translation[k1][i], src.translation[k][i], t,
+                                      k_anim_translate_tolerance))
+                    return false;
+
+                if (!anim_lerp_within(src.scale[k0][i], src.scale[k1][i], src.scale[k][i], t, k_anim_scale_tolerance))
+                    return false;
+            }
+
+            return anim_slerp_within(src.rotation[k0], src.rotation[k1], src.rotation[k], t, k_anim_rotate_tolerance);
+        }
+
+        if (src.type == e_anim_data::type_float)
+        {
+            const f32* d = (const f32*)src.data;
+            f32        tolerance = pma_source_tolerance(src);
+            for (u32 e = 0; e < src.stride; ++e)
+                if (!anim_lerp_within(d[k0 * src.stride + e], d[k1 * src.stride + e], d[k * src.stride + e], t,
+                                      tolerance))
+                    return false;
         }
 
+        return true;
+    }
+
+    void register_geometry_resource(geometry_resource* gr)
+    {
+        s_geometry_resources.push_back(gr);
+
+        if (!s_geometry_lookup.find(gr->hash))
+            s_geometry_lookup.insert(gr->hash, gr);
+
+        if (!s_geometry_file_lookup.find(gr->geom_hash))
+            s_geometry_file_lookup.insert(gr->geom_hash, gr);
+    }
+
+    void register_material_resource(material_resource* mr)
+    {
+        s_material_resources.push_back(mr);
+
+        if (!s_material_lookup.find(mr->hash))
+            s_material_lookup.insert(mr->hash, mr);
+    }
+
+    // parses the header from contents.file_data, touches no shared state so it can run on any thread
+    void parse_pmm_header(pmm_contents& contents)
+    {
         // start reading file
         const u32* p_u32reader = (u32*)contents.file_data;
 
@@ -159,15 +259,68 @@ namespace
 
         // start of sub resource data
         contents.data_start = (u8*)p_u32reader;
+    }
+
+    void set_pmm_view(pmm_contents& contents, const pen::file_view& view)
+    {
+        contents.view = view;
+        contents.file_data = view.data;
+        contents.file_size = (u32)view.size;
+    }
+
+    // map_file = false reads into memory, for tools which may write the file back in place
+    bool parse_pmm_contents(const c8* filename, pmm_contents& contents, bool map_file)
+    {
+        // read in file from disk
+        pen::file_view view;
+        pen_error      err = PEN_ERR_OK;
+        if (map_file)
+        {
+            err = pen::filesystem_map_file(filename, view);
+        }
+        else
+        {
+            u32 size = 0;
+            err = pen::filesystem_read_file_to_buffer(filename, &view.data, size);
+            view.size = size;
+        }
+
+        set_pmm_view(contents, view);
+
+        if (err != PEN_ERR_OK || contents.file_size == 0)
+        {
+            dev_ui::log_level(dev_ui::console_level::error, "[error] load pmm - failed to find file: %s", filename);
+            return false;
+        }
+
+        parse_pmm_header(contents);
         return true;
     }
 
-    bool parse_pmm_geometry(pmm_contents& contents, std::vector<pmm_geometry>& geom)
+    void release_pmm_contents(pmm_contents& contents)
+    {
+        pen::filesystem_unmap_file(contents.view);
+        set_pmm_view(contents, pen::file_view());
+    }
+
+    void* read_pmm_data(const u32* p_reader, size_t size, bool copy_data)
+    {
+        if (!copy_data)
+            return (void*)p_reader;
+
+        void* data = pen::memory_alloc(size);
+        memcpy(data, p_reader, size);
+        return data;
+    }
+
+    // copy_data = false points submesh data into contents, create_pmm_geometry copies what the geometry keeps
+    bool parse_pmm_geometry(pmm_contents& contents, std::vector<pmm_geometry>& geom, bool copy_data)
     {
         // load geometry resources
         for (u32 g = 0; g < contents.num_geometry; ++g)
         {
             pmm_geometry og;
+            og.owns_data = copy_data;
 
             // read small header
             u32* p_reader = (u32*)(contents.data_start + contents.geometry_offsets[g]);
@@ -212,33 +365,28 @@ namespace
                 {
                     sm.vertex_size = sizeof(vertex_model_skinned);
                     sm.joint_data_size = sizeof(f32) * sm.num_joint_floats;
-                    sm.joint_data = pen::memory_alloc(sm.joint_data_size);
-                    memcpy(sm.joint_data, p_reader, sm.joint_data_size);
+                    sm.joint_data = read_pmm_data(p_reader, sm.joint_data_size, copy_data);
                     p_reader += sm.num_joint_floats;
                 }
 
                 // first is position only buffer
                 sm.pos_data_size = sm.num_pos_verts * sizeof(vec4f);
-                sm.pos_data = pen::memory_alloc(sm.pos_data_size);
-                memcpy(sm.pos_data, p_reader, sm.pos_data_size);
+                sm.pos_data = read_pmm_data(p_reader, sm.pos_data_size, copy_data);
                 p_reader += sm.pos_data_size / sizeof(f32);
 
                 // second is model vertex buffer (skinned or unskinned)
                 sm.vertex_data_size = sm.vertex_size * sm.num_verts;
-                sm.vertex_data = pen::memory_alloc(sm.vertex_data_size);
-                memcpy(sm.vertex_data, p_reader, sm.vertex_data_size);
+                sm.vertex_data = read_pmm_data(p_reader, sm.vertex_data_size, copy_data);
                 p_reader += sm.vertex_data_size / sizeof(f32);
 
                 // position index data
                 sm.pos_index_data_size = sm.num_pos_indices * sm.pos_index_size;
-                sm.pos_index_data = pen::memory_alloc(sm.pos_index_data_size);
-                memcpy(sm.pos_index_data, p_reader, sm.pos_index_data_size);
+                sm.pos_index_data = read_pmm_data(p_reader, sm.pos_index_data_size, copy_data);
                 p_reader = (u32*)((c8*)p_reader + sm.pos_index_data_size);
 
                 // index data
                 sm.index_data_size = sm.num_indices * sm.index_size;
-                sm.index_data = pen::memory_alloc(sm.index_data_size);
-                memcpy(sm.index_data, p_reader, sm.index_data_size);
+                sm.index_data = read_pmm_data(p_reader, sm.index_data_size, copy_data);
                 p_reader = (u32*)((c8*)p_reader + sm.index_data_size);
 
                 og.submeshes.push_back(sm);
@@ -250,11 +398,29 @@ namespace
         return true;
     }
 
-    void load_pmm_geometry(const c8* filename, pmm_contents& contents)
+    void free_pmm_geometry(std::vector<pmm_geometry>& geom)
+    {
+        for (auto& g : geom)
+        {
+            if (!g.owns_data)
+                continue;
+
+            for (auto& sm : g.submeshes)
+            {
+                pen::memory_free(sm.joint_data);
+                pen::memory_free(sm.pos_data);
+                pen::memory_free(sm.vertex_data);
+                pen::memory_free(sm.pos_index_data);
+                pen::memory_free(sm.index_data);
+            }
+        }
+
+        geom.clear();
+    }
+
+    // creates geometry resources from parsed geometry, which may have been parsed on another thread
+    void create_pmm_geometry(const c8* filename, pmm_contents& contents, std::vector<pmm_geometry>& geom)
     {
-        std::vector<pmm_geometry> geom;
-        parse_pmm_geometry(contents, geom);
-        
         u32 first_bone_offset = -1;
 
         for (u32 g = 0; g < contents.num_geometry; ++g)
@@ -270,9 +436,8 @@ namespace
             hash_id geom_hash = hm.end();
 
             // check for existing
-            for (s32 g = 0; g < s_geometry_resources.size(); ++g)
-                if (geom_hash == s_geometry_resources[g]->geom_hash)
-                    return;
+            if (s_geometry_file_lookup.find(geom_hash))
+                return;
 
             for (u32 submesh = 0; submesh < geom[g].submeshes.size(); ++submesh)
             {
@@ -311,12 +476,13 @@ namespace
                     bone_offset -= first_bone_offset;
                     
                     p_geometry->p_skin = (cmp_skin*)pen::memory_alloc(sizeof(cmp_skin));
-                    p_geometry->p_skin->bone_cbuffer = PEN_INVALID_HANDLE;
                     p_geometry->p_skin->bind_shape_matrix = sm.bind_shape_matrix;
                     p_geometry->p_skin->bone_offset = bone_offset;
                     p_geometry->p_skin->num_joints = sm.num_joint_floats / k_matrix_floats;
-                    memset(p_geometry->p_skin->joint_bind_matrices, 0x0, sizeof(p_geometry->p_skin->joint_bind_matrices));
-                    memcpy(p_geometry->p_skin->joint_bind_matrices, sm.joint_data, sm.joint_data_size);
+
+                    u32 joints_size = sizeof(mat4) * p_geometry->p_skin->num_joints;
+                    p_geometry->p_skin->joint_bind_matrices = (mat4*)pen::memory_alloc(joints_size);
+                    memcpy(p_geometry->p_skin->joint_bind_matrices, sm.joint_data, joints_size);
                 }
 
                 pmm_renderable& vr = p_geometry->renderable[e_pmm_renderable::full_vertex_buffer];
@@ -329,41 +495,72 @@ namespace
                 pr.num_indices = sm.num_pos_indices;
                 pr.vertex_size = sizeof(vec4f);
                 pr.index_type = sm.pos_index_size == 2 ? PEN_FORMAT_R16_UINT : PEN_FORMAT_R32_UINT;
-                pr.cpu_vertex_buffer = sm.pos_data;
-                pr.cpu_index_buffer = sm.pos_index_data;
 
                 // vertex
                 vr.num_vertices = sm.num_verts;
                 vr.num_indices = sm.num_indices;
                 vr.vertex_size = sm.vertex_size;
                 vr.index_type = sm.index_size == 2 ? PEN_FORMAT_R16_UINT : PEN_FORMAT_R32_UINT;
-                vr.cpu_vertex_buffer = sm.vertex_data;
-                vr.cpu_index_buffer = sm.index_data;
+
+                // buffer data is copied by renderer_create_buffer, so data in the file is uploaded from in place
+                void* vertex_data[e_pmm_renderable::COUNT];
+                void* index_data[e_pmm_renderable::COUNT];
+                vertex_data[e_pmm_renderable::full_vertex_buffer] = sm.vertex_data;
+                vertex_data[e_pmm_renderable::position_only] = sm.pos_data;
+                index_data[e_pmm_renderable::full_vertex_buffer] = sm.index_data;
+                index_data[e_pmm_renderable::position_only] = sm.pos_index_data;
+
+                if (gg.owns_data)
+                {
+                    pr.cpu_vertex_buffer = sm.pos_data;
+                    pr.cpu_index_buffer = sm.pos_index_data;
+                    vr.cpu_vertex_buffer = sm.vertex_data;
+                    vr.cpu_index_buffer = sm.index_data;
+                }
+                else
+                {
+                    // the file is unmapped after load, keep copies of the positions used for picking and volumes
+                    pr.cpu_vertex_buffer = pen::memory_alloc(sm.pos_data_size);
+                    pr.cpu_index_buffer = pen::memory_alloc(sm.pos_index_data_size);
+                    memcpy(pr.cpu_vertex_buffer, sm.pos_data, sm.pos_data_size);
+                    memcpy(pr.cpu_index_buffer, sm.pos_index_data, sm.pos_index_data_size);
+                    vr.cpu_vertex_buffer = nullptr;
+                    vr.cpu_index_buffer = nullptr;
+                }
 
                 pen::buffer_creation_params bcp;
-                for (auto& r : p_geometry->renderable)
+                for (u32 r = 0; r < e_pmm_renderable::COUNT; ++r)
                 {
+                    pmm_renderable& rr = p_geometry->renderable[r];
+
                     bcp.usage_flags = PEN_USAGE_DEFAULT;
                     bcp.bind_flags = PEN_BIND_VERTEX_BUFFER;
                     bcp.cpu_access_flags = 0;
-                    bcp.buffer_size = r.vertex_size * r.num_vertices;
-                    bcp.data = r.cpu_vertex_buffer;
-                    r.vertex_buffer = pen::renderer_create_buffer(bcp);
+                    bcp.buffer_size = rr.vertex_size * rr.num_vertices;
+                    bcp.data = vertex_data[r];
+                    rr.vertex_buffer = pen::renderer_create_buffer(bcp);
 
                     bcp.usage_flags = PEN_USAGE_DEFAULT;
                     bcp.bind_flags = PEN_BIND_INDEX_BUFFER;
                     bcp.cpu_access_flags = 0;
-                    bcp.buffer_size = r.num_indices * sm.index_size;
-                    bcp.data = r.cpu_index_buffer;
-                    r.index_buffer = pen::renderer_create_buffer(bcp);
+                    bcp.buffer_size = rr.num_indices * sm.index_size;
+                    bcp.data = index_data[r];
+                    rr.index_buffer = pen::renderer_create_buffer(bcp);
                 }
 
-                s_geometry_resources.push_back(p_geometry);
+                register_geometry_resource(p_geometry);
             }
         }
     }
 
-    void load_material_resource(const c8* filename, const c8* material_name, const void* data)
+    void load_pmm_geometry(const c8* filename, pmm_contents& contents)
+    {
+        std::vector<pmm_geometry> geom;
+        parse_pmm_geometry(contents, geom, false);
+        create_pmm_geometry(filename, contents, geom);
+    }
+
+    void load_material_resource(const c8* filename, const c8* material_name, const void* data, bool stream_textures = false)
     {
         pen::hash_murmur hm;
         hm.begin();
@@ -371,9 +568,8 @@ namespace
         hm.add(material_name, pen::string_length(material_name));
         hash_id hash = hm.end();
 
-        for (s32 m = 0; m < s_material_resources.size(); ++m)
-            if (s_material_resources[m]->hash == hash)
-                return;
+        if (s_material_lookup.find(hash))
+            return;
 
         const u32* p_reader = (u32*)data;
 
@@ -429,10 +625,13 @@ namespace
                 texture_name = base_dir;
             }
 
-            p_mat->texture_handles[map_type] = put::load_texture(texture_name.c_str());
+            if (stream_textures)
+                p_mat->texture_handles[map_type] = put::load_texture_async(texture_name.c_str());
+            else
+                p_mat->texture_handles[map_type] = put::load_texture(texture_name.c_str());
         }
 
-        s_material_resources.push_back(p_mat);
+        register_material_resource(p_mat);
 
         return;
     }
@@ -796,27 +995,28 @@ namespace put
     {
         void add_material_resource(material_resource* mr)
         {
-            s_material_resources.push_back(mr);
+            register_material_resource(mr);
         }
 
         void add_geometry_resource(geometry_resource* gr)
         {
-            for (auto*& g : s_geometry_resources)
-                if (gr->hash == g->hash)
-                {
-                    g = gr;
-                }
-                    
-            s_geometry_resources.push_back(gr);
+            // replaces any existing resources with the same hash
+            if (s_geometry_lookup.find(gr->hash))
+            {
+                for (auto*& g : s_geometry_resources)
+                    if (gr->hash == g->hash)
+                        g = gr;
+
+                s_geometry_lookup.insert(gr->hash, gr);
+            }
+
+            register_geometry_resource(gr);
         }
 
         geometry_resource* get_geometry_resource(hash_id hash)
         {
-            for (auto* g : s_geometry_resources)
-                if (hash == g->hash)
-                    return g;
-
-            return nullptr;
+            geometry_resource** g = s_geometry_lookup.find(hash);
+            return g ? *g : nullptr;
         }
 
         geometry_resource* get_geometry_resource_by_index(hash_id id_filename, u32 index)
@@ -839,11 +1039,8 @@ namespace put
 
         material_resource* get_material_resource(hash_id hash)
         {
-            for (auto* m : s_material_resources)
-                if (m->hash == hash)
-                    return m;
-
-            return nullptr;
+            material_resource** m = s_material_lookup.find(hash);
+            return m ? *m : nullptr;
         }
 
         void instantiate_constraint(ecs_scene* scene, u32 entity_index)
@@ -1000,6 +1197,7 @@ namespace put
             bv->min_extents = gr->min_extents;
             bv->max_extents = gr->max_extents;
             bv->radius = mag(bv->max_extents - bv->min_extents) * 0.5f;
+            scene->state_flags[entity_index] |= e_state::transform_dirty;
 
             scene->geometry_names[entity_index] = gr->geometry_name;
             scene->id_geometry[entity_index] = gr->hash;
@@ -1177,6 +1375,8 @@ namespace put
                 
                 controller.root_joint_ref = ecs::get_ref_from_index(scene, joints_offset);
                 controller.playback_rate = 1.0f;
+                controller.lod_enabled = true;
+                memcpy(controller.lods, k_default_anim_lods, sizeof(controller.lods));
 
                 scene->entities[entity_index] |= e_cmp::anim_controller;
             }
@@ -1333,12 +1533,18 @@ namespace put
 
         void permutation_flags_from_vertex_class(u32& permutation, hash_id vertex_class)
         {
-            u32 clear_vertex = ~(e_shader_permutation::skinned | e_shader_permutation::instanced);
+            u32 clear_vertex =
+                ~(e_shader_permutation::skinned | e_shader_permutation::instanced | e_shader_permutation::bone_palette);
             permutation &= clear_vertex;
 
             if (vertex_class == ID_VERTEX_CLASS_SKINNED)
+            {
                 permutation |= e_shader_permutation::skinned;
 
+                if (pen::renderer_get_info().caps & PEN_CAPS_STRUCTURED_BUFFER)
+                    permutation |= e_shader_permutation::bone_palette;
+            }
+
             if (vertex_class == ID_VERTEX_CLASS_INSTANCED)
                 permutation |= e_shader_permutation::instanced;
         }
@@ -1436,14 +1642,9 @@ namespace put
             hash_id filename_hash = PEN_HASH(stipped_filename.c_str());
 
             // search for existing
-            s32 num_anims = s_animation_resources.size();
-            for (s32 i = 0; i < num_anims; ++i)
-            {
-                if (s_animation_resources[i].id_name == filename_hash)
-                {
-                    return (anim_handle)i;
-                }
-            }
+            anim_handle* existing = s_animation_lookup.find(filename_hash);
+            if (existing)
+                return *existing;
 
             void* anim_file;
             u32   anim_file_size;
@@ -1471,6 +1672,7 @@ namespace put
 
             new_animation.name = stipped_filename;
             new_animation.id_name = filename_hash;
+            s_animation_lookup.insert(filename_hash, (anim_handle)s_animation_resources.size() - 1);
 
             u32 num_channels = *p_u32reader++;
 
@@ -1479,8 +1681,6 @@ namespace put
 
             new_animation.length = 0.0f;
 
-            u32 max_frames = 0;
-
             for (u32 i = 0; i < num_channels; ++i)
             {
                 Str bone_name = read_parsable_string(&p_u32reader);
@@ -1559,19 +1759,9 @@ namespace put
 
                                 for (u32 m = 0; m < num_mats; ++m)
                                 {
-                                    mat4& mat = new_animation.channels[i].matrices[m];
-
-                                    vec3f trans = mat.get_translation();
-                                    quat  rot;
-                                    rot.from_matrix(mat);
-
-                                    tq[0][m] = rot;
-
-                                    f32 sx = mag((vec3f)mat.get_row(0).xyz);
-                                    f32 sy = mag((vec3f)mat.get_row(1).xyz);
-                                    f32 sz = mag((vec3f)mat.get_row(2).xyz);
-
-                                    vec3f scale = vec3f(sx, sy, sz);
+                                    vec3f trans;
+                                    vec3f scale;
+                                    decompose_anim_matrix(new_animation.channels[i].matrices[m], trans, tq[0][m], scale);
 
                                     for (u32 t = 0; t < 3; ++t)
                                     {
@@ -1647,104 +1837,54 @@ namespace put
                     f32* times = new_animation.channels[i].times;
                     new_animation.length = fmax(times[t], new_animation.length);
                 }
-
-                max_frames = std::max<u32>(new_animation.channels[i].num_frames, max_frames);
             }
 
             // free file mem
             pen::memory_free(anim_file);
 
-            // bake animations into soa.
-
-            // allocate vertical arrays
-            soa_anim& soa = new_animation.soa;
-            soa.data = new f32*[max_frames];
-            soa.channels = new anim_channel[num_channels];
-            soa.info = new anim_info*[max_frames];
-            soa.num_channels = num_channels;
-
-            // null ptrs
-            memset(soa.data, 0x0, max_frames * sizeof(f32*));
-            memset(soa.info, 0x0, max_frames * sizeof(f32*));
-
-            // push channels into horizontal contiguous arrays
+            // build the compressed clip, one track for translation, scale and each rotation of a channel
+            std::vector<anim_track_source> sources;
             for (u32 c = 0; c < num_channels; ++c)
             {
                 animation_channel& channel = new_animation.channels[c];
 
-                // setup sampler
-                soa.channels[c].num_frames = channel.num_frames;
-
-                u32 elm = 0;
+                anim_track_source src = {};
+                src.channel = c;
+                src.num_keys = channel.num_frames;
+                src.times = channel.times;
+                src.flags = channel.matrices ? e_anim_flags::baked_quaternion : 0;
 
-                // translate
-                for (u32 i = 0; i < 3; ++i)
-                    if (channel.offset[i])
-                        soa.channels[c].element_offset[elm++] = e_anim_output::translate_x + i;
-
-                // scale
-                for (u32 i = 0; i < 3; ++i)
-                    if (channel.scale[i])
-                        soa.channels[c].element_offset[elm++] = e_anim_output::scale_x + i;
+                anim_track_source translate = src;
+                anim_track_source scale = src;
+                translate.type = e_anim_track::translate;
+                scale.type = e_anim_track::scale;
 
-                // quaternion
                 for (u32 i = 0; i < 3; ++i)
-                    if (channel.rotation[i])
-                        for (u32 q = 0; q < 4; ++q)
-                            soa.channels[c].element_offset[elm++] = e_anim_output::quaternion;
-
-                if (channel.matrices)
                 {
-                    // baked
-                    soa.channels[c].flags = e_anim_flags::baked_quaternion;
+                    translate.components[i] = channel.offset[i];
+                    scale.components[i] = channel.scale[i];
                 }
 
-                soa.channels[c].element_count = elm;
-
-                for (u32 t = 0; t < channel.num_frames; ++t)
-                {
-                    u32 start_offset = sb_count(soa.data[t]);
-
-                    // translate
-                    for (u32 i = 0; i < 3; ++i)
-                        if (channel.offset[i])
-                            sb_push(soa.data[t], channel.offset[i][t]);
-
-                    // scale
-                    for (u32 i = 0; i < 3; ++i)
-                        if (channel.scale[i])
-                            sb_push(soa.data[t], channel.scale[i][t]);
+                if (channel.offset[0] || channel.offset[1] || channel.offset[2])
+                    sources.push_back(translate);
 
-                    // quat
-                    for (u32 i = 0; i < 3; ++i)
-                        if (channel.rotation[i])
-                        {
-                            sb_push(soa.data[t], channel.rotation[i][t].x);
-                            sb_push(soa.data[t], channel.rotation[i][t].y);
-                            sb_push(soa.data[t], channel.rotation[i][t].z);
-                            sb_push(soa.data[t], channel.rotation[i][t].w);
-                        }
-
-                    u32 end_offset = sb_count(soa.data[t]);
+                if (channel.scale[0] || channel.scale[1] || channel.scale[2])
+                    sources.push_back(scale);
 
-                    soa.channels[c].element_count = end_offset - start_offset;
-
-                    anim_info ai;
-                    ai.offset = start_offset;
-                    ai.time = channel.times[t];
-                    sb_push(soa.info[t], ai);
-                }
-
-                // pad sparse info array
-                for (u32 t = channel.num_frames; t < max_frames; ++t)
+                for (u32 i = 0; i < 3; ++i)
                 {
-                    anim_info ai;
-                    ai.offset = -1;
-                    ai.time = 0.0f;
-                    sb_push(soa.info[t], ai);
+                    if (!channel.rotation[i])
+                        continue;
+
+                    anim_track_source rotate = src;
+                    rotate.type = e_anim_track::rotate;
+                    rotate.rotation = channel.rotation[i];
+                    sources.push_back(rotate);
                 }
             }
 
+            build_anim_clip(sources.data(), (u32)sources.size(), new_animation.clip);
+
             return (anim_handle)s_animation_resources.size() - 1;
         }
 
@@ -1794,11 +1934,14 @@ namespace put
         void optimise_pmm(const c8* input_filename, const c8* output_filename)
         {
             pmm_contents contents;
-            if (!parse_pmm_contents(input_filename, contents))
+            if (!parse_pmm_contents(input_filename, contents, false))
+            {
+                release_pmm_contents(contents);
                 return;
+            }
 
             std::vector<pmm_geometry> geom;
-            parse_pmm_geometry(contents, geom);
+            parse_pmm_geometry(contents, geom, true);
 
             // perform optimisations on each submesh
             std::vector<intptr_t> reductions;
@@ -2020,34 +2163,204 @@ namespace put
                     pen::memory_free(sm.joint_data);
                 }
             }
-            pen::memory_free(contents.file_data);
+            release_pmm_contents(contents);
         }
 
+        // removes keys which linear interpolation of their neighbours reproduces, the file format is unchanged.
+        // keys are shared by all sources of a channel so a key is only removed if every source can lose it
         void optimise_pma(const c8* input_filename, const c8* output_filename)
         {
+            void* anim_file;
+            u32   anim_file_size;
+
+            pen_error err = pen::filesystem_read_file_to_buffer(input_filename, &anim_file, anim_file_size);
+            if (err != PEN_ERR_OK || anim_file_size < sizeof(u32) * 2)
+            {
+                PEN_LOG("[error] optimise_pma - unable to read %s", input_filename);
+                return;
+            }
+
+            const u32* p_u32reader = (u32*)anim_file;
+            const u32* p_end = p_u32reader + anim_file_size / sizeof(u32);
+
+            std::vector<u32> output;
+            u32              version = *p_u32reader++;
+            u32              num_channels = *p_u32reader++;
+            output.push_back(version);
+            output.push_back(num_channels);
+
+            u32  total_keys = 0;
+            u32  total_kept = 0;
+            bool valid = true;
+
+            for (u32 c = 0; c < num_channels && valid; ++c)
+            {
+                // bone name
+                if (p_u32reader >= p_end || *p_u32reader + 2 > (u32)(p_end - p_u32reader))
+                {
+                    valid = false;
+                    break;
+                }
+
+                u32 name_len = *p_u32reader;
+                output.insert(output.end(), p_u32reader, p_u32reader + name_len + 1);
+                p_u32reader += name_len + 1;
+
+                u32 num_sources = *p_u32reader++;
+                output.push_back(num_sources);
+
+                // each source has at least a 4 u32 header
+                if (num_sources > (u32)(p_end - p_u32reader) / 4)
+                {
+                    valid = false;
+                    break;
+                }
+
+                std::vector<pma_source> sources(num_sources);
+                const f32*              times = nullptr;
+                u32                     num_keys = 0;
 
-            // todo
+                for (auto& src : sources)
+                {
+                    if (p_end - p_u32reader < 4)
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    src.semantic = *p_u32reader++;
+                    src.type = *p_u32reader++;
+                    src.target = *p_u32reader++;
+                    src.num_elements = *p_u32reader++;
+                    src.data = p_u32reader;
+                    src.stride = 0;
+
+                    if (src.num_elements > (u32)(p_end - p_u32reader))
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    p_u32reader += src.num_elements;
+
+                    if (src.semantic == e_anim_semantics::time)
+                    {
+                        times = (const f32*)src.data;
+                        num_keys = src.num_elements;
+                    }
+                }
+
+                if (!valid)
+                    break;
+
+                // every source must have a whole number of elements per key to be reduced
+                bool reducible = times && num_keys > 2;
+                for (auto& src : sources)
+                {
+                    if (!reducible)
+                        break;
+
+                    if (src.num_elements % num_keys != 0)
+                    {
+                        reducible = false;
+                        break;
+                    }
+
+                    src.stride = src.num_elements / num_keys;
+
+                    if (src.type == e_anim_data::type_float4x4)
+                    {
+                        if (src.stride != k_matrix_floats)
+                        {
+                            reducible = false;
+                            break;
+                        }
+
+                        src.translation.resize(num_keys);
+                        src.rotation.resize(num_keys);
+                        src.scale.resize(num_keys);
+
+                        for (u32 k = 0; k < num_keys; ++k)
+                        {
+                            mat4 mat;
+                            memcpy(&mat, src.data + k * k_matrix_floats, sizeof(mat4));
+                            decompose_anim_matrix(mat, src.translation[k], src.rotation[k], src.scale[k]);
+                        }
+                    }
+                }
+
+                std::vector<u8> keep(num_keys, 1);
+                u32             num_kept = num_keys;
+                if (reducible)
+                {
+                    num_kept = anim_reduce_keys(times, num_keys, keep.data(), [&sources](u32 k0, u32 k1, u32 k, f32 t) {
+                        for (auto& src : sources)
+                            if (!pma_key_within(src, k0, k1, k, t))
+                                return false;
+                        return true;
+                    });
+                }
+
+                total_keys += num_keys;
+                total_kept += num_kept;
+
+                for (auto& src : sources)
+                {
+                    output.push_back(src.semantic);
+                    output.push_back(src.type);
+                    output.push_back(src.target);
+
+                    if (!reducible)
+                    {
+                        output.push_back(src.num_elements);
+                        output.insert(output.end(), src.data, src.data + src.num_elements);
+                        continue;
+                    }
+
+                    output.push_back(num_kept * src.stride);
+                    for (u32 k = 0; k < num_keys; ++k)
+                        if (keep[k])
+                            output.insert(output.end(), src.data + k * src.stride, src.data + (k + 1) * src.stride);
+                }
+            }
+
+            pen::memory_free(anim_file);
+
+            if (!valid)
+            {
+                PEN_LOG("[error] optimise_pma - %s is truncated or corrupt", input_filename);
+                return;
+            }
+
+            PEN_LOG("    keys: %u, old %u", total_kept, total_keys);
+
+            std::ofstream ofs(output_filename, std::ofstream::binary);
+            ofs.write((const c8*)output.data(), output.size() * sizeof(u32));
+            ofs.close();
         }
 
-        s32 load_pmm(const c8* filename, ecs_scene* scene, u32 load_flags)
+        // geom is pre-parsed by async loads, otherwise geometry is parsed here
+        s32 create_pmm_resources(const c8* filename, ecs_scene* scene, u32 load_flags, pmm_contents& contents,
+                                 std::vector<pmm_geometry>* geom, bool stream_textures)
         {
-            // pmm contains scene node, material, and geometry resources
-            pmm_contents contents;
-            parse_pmm_contents(filename, contents);
-
             // load material resources
             if (load_flags & e_pmm_load_flags::material)
             {
                 for (u32 m = 0; m < contents.num_materials; ++m)
                 {
                     u32* p_mat_data = (u32*)(contents.data_start + contents.material_offsets[m]);
-                    load_material_resource(filename, contents.material_names[m].c_str(), p_mat_data);
+                    load_material_resource(filename, contents.material_names[m].c_str(), p_mat_data, stream_textures);
                 }
             }
 
             // load geometry resources
             if (load_flags & e_pmm_load_flags::geometry)
-                load_pmm_geometry(filename, contents);
+            {
+                if (geom)
+                    create_pmm_geometry(filename, contents, *geom);
+                else
+                    load_pmm_geometry(filename, contents);
+            }
 
             // load nodes.. we need to do this last because they depend on the material and geometry resources.
             s32 root = PEN_INVALID_HANDLE;
@@ -2064,13 +2377,95 @@ namespace put
                 // invalidate trees to rebuild
                 if (contents.num_scene > 0)
                     if (scene)
-                        scene->flags |= e_scene_flags::invalidate_scene_tree;
+                        scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
+            }
+
+            return root;
+        }
+
+        s32 load_pmm(const c8* filename, ecs_scene* scene, u32 load_flags)
+        {
+            // pmm contains scene node, material, and geometry resources
+            pmm_contents contents;
+            if (!parse_pmm_contents(filename, contents, true))
+            {
+                release_pmm_contents(contents);
+                return PEN_INVALID_HANDLE;
             }
 
-            pen::memory_free(contents.file_data);
+            s32 root = create_pmm_resources(filename, scene, load_flags, contents, nullptr, false);
+
+            release_pmm_contents(contents);
             return root;
         }
 
+        struct async_pmm
+        {
+            Str                       filename;
+            ecs_scene*                scene;
+            u32                       load_flags;
+            pmm_contents              contents;
+            std::vector<pmm_geometry> geom;
+        };
+
+        void* async_pmm_decode(const pen::file_view& view, void* ctx)
+        {
+            async_pmm* ap = (async_pmm*)ctx;
+            set_pmm_view(ap->contents, view);
+
+            parse_pmm_header(ap->contents);
+
+            // geometry is the bulk of the file, parse it here rather than on the user thread
+            if (ap->load_flags & e_pmm_load_flags::geometry)
+            {
+                if (!parse_pmm_geometry(ap->contents, ap->geom, false))
+                    return nullptr;
+            }
+
+            return ap;
+        }
+
+        s32 async_pmm_finalise(void* decoded, void* ctx)
+        {
+            async_pmm* ap = (async_pmm*)decoded;
+
+            // textures referenced by materials stream in behind placeholders
+            s32 root = create_pmm_resources(ap->filename.c_str(), ap->scene, ap->load_flags, ap->contents, &ap->geom, true);
+
+            release_pmm_contents(ap->contents);
+            delete ap;
+            return root;
+        }
+
+        void async_pmm_discard(void* decoded, void* ctx)
+        {
+            async_pmm* ap = (async_pmm*)ctx;
+            free_pmm_geometry(ap->geom);
+            release_pmm_contents(ap->contents);
+            delete ap;
+        }
+
+        async_load_handle load_pmm_async(const c8* filename, ecs_scene* scene, u32 load_flags, load_priority priority,
+                                         async_load_callback callback, void* user_data)
+        {
+            async_pmm* ap = new async_pmm();
+            ap->filename = filename;
+            ap->scene = scene;
+            ap->load_flags = load_flags;
+
+            async_load_params params;
+            params.filename = filename;
+            params.priority = priority;
+            params.decode = async_pmm_decode;
+            params.finalise = async_pmm_finalise;
+            params.discard = async_pmm_discard;
+            params.ctx = ap;
+            params.callback = callback;
+            params.user_data = user_data;
+
+            return async_load(params);
+        }
+
         s32 load_pmv(const c8* filename, ecs_scene* scene)
         {
             pen::json pmv = pen::json::load_from_file(filename);
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "ecs/ecs_anim.h"
 #include "ecs/ecs_scene.h"
 
 namespace put
@@ -120,53 +121,15 @@ namespace put
             };
         }
 
-        struct anim_info
-        {
-            f32 time;
-            u32 interpolation;
-            u32 offset;
-        };
-
-        struct anim_channel
-        {
-            u32 num_frames;
-            u32 element_count;
-            u32 element_offset[21];
-            u32 flags = 0;
-        };
-
-        struct soa_anim
-        {
-            u32           num_channels = 0;
-            anim_channel* channels = nullptr;
-            anim_info**   info = nullptr; // [frame][samplers]
-            f32**         data = nullptr; // [frame][sampler offset]
-        };
-
-        struct anim_sampler
-        {
-            u32 pos;
-            u32 joint;
-            u32 flags;
-            f32 cur_t;
-            f32 prev_t;
-        };
-
-        struct anim_target
-        {
-            f32  t[9]; // translate xyz, scale xyz.
-            quat q;
-            u32  flags = 0;
-        };
-
         struct anim_instance
         {
             u32            flags = 0;
-            soa_anim       soa;
+            anim_clip      clip;
+            u32*           cursors = nullptr; // per clip track
             f32            time = 0.0f;
             f32            length = 0.0f; // length in time
             anim_target*   targets = nullptr;
-            cmp_transform* joints = nullptr;
+            anim_pose      pose; // last sampled joint transforms
             anim_sampler*  samplers = nullptr;
             vec3f          root_translation;
             vec3f          root_delta = vec3f::zero();
@@ -199,7 +162,7 @@ namespace put
             f32 length;
             Str name;
 
-            soa_anim soa;
+            anim_clip clip;
         };
 
         struct pmm_renderable // resouce may contain full vb and position only
@@ -271,6 +234,13 @@ namespace put
         void load_scene(const c8* filename, ecs_scene* scene, bool merge = false);
 
         s32 load_pmm(const c8* model_scene_name, ecs_scene* scene = nullptr, u32 load_flags = e_pmm_load_flags::all);
+
+        // parsing happens on task workers, resources and nodes are created in put::poll_async_loads.
+        // the callback resource is the root entity, scene must outlive the request
+        async_load_handle load_pmm_async(const c8* model_scene_name, ecs_scene* scene = nullptr,
+                                         u32 load_flags = e_pmm_load_flags::all,
+                                         load_priority priority = e_load_priority::normal,
+                                         async_load_callback callback = nullptr, void* user_data = nullptr);
         s32 load_pma(const c8* model_scene_name);
         s32 load_pmv(const c8* filename, ecs_scene* scene);
 
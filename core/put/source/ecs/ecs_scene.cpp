@@ -14,6 +14,7 @@
 #include "input.h"
 #include "os.h"
 #include "pmfx.h"
+#include "renderer_shared.h"
 #include "str/Str.h"
 #include "str_utilities.h"
 #include "timer.h"
@@ -31,6 +32,19 @@ namespace put
     {
         static std::vector<ecs_scene_instance> s_scenes;
 
+        // render a pre culled list of entities
+        void render_scene_view_entities(const scene_view& view, const u32* entities);
+
+        void free_visibility_lists(u32**& lists)
+        {
+            u32 n = sb_count(lists);
+            for (u32 i = 0; i < n; ++i)
+                sb_free(lists[i]);
+
+            sb_free(lists);
+            lists = nullptr;
+        }
+
         void register_ecs_extension(ecs_scene* scene, const ecs_extension& ext)
         {
             sb_push(scene->extensions, ext);
@@ -161,6 +175,11 @@ namespace put
 
                 for (s32 i = 0; i < scene->num_entities; ++i)
                     delete_entity_second_pass(scene, i);
+
+                scene->renderables.count = 0;
+                bvh_clear(&scene->spatial);
+                free_visibility_lists(scene->shadow_visibility);
+                free_visibility_lists(scene->omni_shadow_visibility);
             }
 
             // Free component array memory
@@ -200,10 +219,13 @@ namespace put
             // delete skinng buffers, sub_geomtry share their parents
             if(!(scene->entities[node_index] & e_cmp::sub_geometry))
                 if (is_valid_non_null(scene->bone_cbuffer[node_index]))
-                    pen::renderer_release_buffer(scene->cbuffer[node_index]);
+                    pen::renderer_release_buffer(scene->bone_cbuffer[node_index]);
 
             // zero
             zero_entity_components(scene, node_index);
+
+            // parents need their extents re-calculating without this child
+            scene->flags |= e_scene_flags::invalidate_transforms;
         }
 
         void delete_entity_first_pass(ecs_scene* scene, u32 node_index)
@@ -275,6 +297,7 @@ namespace put
             }
 
             zero_entity_components(scene, temp);
+            scene->flags |= e_scene_flags::invalidate_transforms;
         }
 
         u32 clone_entity(ecs_scene* scene, u32 src, s32 dst, s32 parent, clone_mode mode, vec3f offset, const c8* suffix)
@@ -323,6 +346,7 @@ namespace put
 
             vec3f translation = p_sn->local_matrices[dst].get_translation();
             p_sn->local_matrices[dst].set_translation(translation + offset);
+            p_sn->state_flags[dst] |= e_state::transform_dirty;
 
             if (mode == e_clone_mode::instantiate)
             {
@@ -388,6 +412,8 @@ namespace put
             pmfx::register_scene_view_renderer(svr_omni_shadow_maps);
             pmfx::register_scene_view_renderer(svr_area_light_textures);
             pmfx::register_scene_view_renderer(svr_volume_gi);
+
+            simd_init();
         }
 
         ecs_scene* create_scene(const c8* name)
@@ -455,6 +481,19 @@ namespace put
         {
             free_scene_buffers(scene);
 
+            if (is_valid(scene->bone_palette_buffer))
+                pen::renderer_release_buffer(scene->bone_palette_buffer);
+
+            pen::memory_free(scene->bone_palette);
+            scene->bone_palette = nullptr;
+            scene->bone_palette_buffer = PEN_INVALID_HANDLE;
+            scene->bone_palette_capacity = 0;
+
+            free_cull_stream(&scene->renderables);
+            bvh_free(&scene->spatial);
+            free_visibility_lists(scene->shadow_visibility);
+            free_visibility_lists(scene->omni_shadow_visibility);
+
             // todo release resource refs
             // geom
             // anim
@@ -651,7 +690,12 @@ namespace put
                     pen::renderer_set_constant_buffer(cb_light, 10, pen::CBUFFER_BIND_PS);
                 }
 
-                render_scene_view(vv);
+                // visibility is batch culled for all shadow views in update_scene
+                u32 si = shadow_index - 1;
+                if (si < (u32)sb_count(scene->shadow_visibility))
+                    render_scene_view_entities(vv, scene->shadow_visibility[si]);
+                else
+                    render_scene_view(vv);
             }
 
             // update cbuffer
@@ -710,7 +754,11 @@ namespace put
                 vv.camera = &cam_omni_shadow;
                 vv.cb_view = cam_omni_shadow.cbuffer;
 
-                render_scene_view(vv);
+                // visibility is batch culled for all omni faces in update_scene
+                if (view.array_index < (u32)sb_count(scene->omni_shadow_visibility))
+                    render_scene_view_entities(vv, scene->omni_shadow_visibility[view.array_index]);
+                else
+                    render_scene_view(vv);
             }
         }
 
@@ -898,10 +946,278 @@ namespace put
             pen::renderer_set_texture(0, 0, 2, pen::TEXTURE_BIND_CS);
         }
 
-        void render_scene_view(const scene_view& view)
+        namespace
         {
-            // PEN_PERF_SCOPE_PRINT(render_scene_view);
+            struct draw_key
+            {
+                u64 key;
+                u32 entity;
+                u32 instances;       // > 1 auto instanced run head, 0 when drawn as part of a previous run
+                u32 instance_offset; // in instances into the auto instance buffer
+            };
+
+            struct auto_instance_buffer
+            {
+                u32 handle;
+                u32 capacity; // in instances
+            };
+
+            draw_key* s_draw_keys = nullptr;
+            draw_key* s_draw_keys_scratch = nullptr;
+            u32       s_draw_keys_capacity = 0;
+
+            // instance data is written once per render_scene_view_entities call, each call gets its own buffer per frame
+            static const u32                  k_min_auto_instances = 2;
+            cmp_draw_call*                    s_auto_instance_data = nullptr;
+            u32                               s_auto_instance_data_capacity = 0;
+            std::vector<auto_instance_buffer> s_auto_instance_buffers;
+            u32                               s_auto_instance_buffer_pos = 0;
+            u64                               s_auto_instance_frame = -1;
+
+            // lsd radix sort 8 bits at a time, passes where every key has the same byte are skipped
+            void radix_sort_draw_keys(u32 count)
+            {
+                u32 hist[8][256] = {};
+                for (u32 i = 0; i < count; ++i)
+                    for (u32 b = 0; b < 8; ++b)
+                        ++hist[b][(s_draw_keys[i].key >> (b * 8)) & 0xff];
+
+                for (u32 b = 0; b < 8; ++b)
+                {
+                    u32* h = hist[b];
+                    if (h[(s_draw_keys[0].key >> (b * 8)) & 0xff] == count)
+                        continue;
+
+                    u32 offset = 0;
+                    for (u32 j = 0; j < 256; ++j)
+                    {
+                        u32 c = h[j];
+                        h[j] = offset;
+                        offset += c;
+                    }
+
+                    for (u32 i = 0; i < count; ++i)
+                        s_draw_keys_scratch[h[(s_draw_keys[i].key >> (b * 8)) & 0xff]++] = s_draw_keys[i];
+
+                    std::swap(s_draw_keys, s_draw_keys_scratch);
+                }
+            }
+
+            // positive floats sort as integers, the top 16 bits keep sign, exponent and 7 bits of mantissa
+            u64 depth_bits(f32 d)
+            {
+                u32 bits;
+                memcpy(&bits, &d, sizeof(u32));
+                return bits >> 16;
+            }
+
+            u64 fold_bits(u32 v, u32 num_bits)
+            {
+                u32 mask = (1 << num_bits) - 1;
+                u32 r = 0;
+                while (v)
+                {
+                    r ^= v & mask;
+                    v >>= num_bits;
+                }
+                return r;
+            }
+        } // namespace
+
+        // builds and sorts a key per drawable entity into s_draw_keys, returns the number of keys
+        // opaque: [63] layer, [62:53] shader, [52:45] technique, [44:37] permutation, [36:27] id_material, [26:16] vb, [15:0] depth
+        // alpha blended: [63] layer, [62:47] inverted depth so far draws first, state in the low bits as a tie break
+        u32 build_draw_keys(const scene_view& view, const u32* entities, u32 count)
+        {
+            ecs_scene* scene = view.scene;
+
+            if (count > s_draw_keys_capacity)
+            {
+                s_draw_keys = (draw_key*)pen::memory_realloc(s_draw_keys, sizeof(draw_key) * count);
+                s_draw_keys_scratch = (draw_key*)pen::memory_realloc(s_draw_keys_scratch, sizeof(draw_key) * count);
+                s_draw_keys_capacity = count;
+            }
+
+            bool  blended = view.render_flags & pmfx::e_scene_render_flags::alpha_blended;
+            vec3f eye = view.camera ? view.camera->pos : vec3f::zero();
+
+            u32 num_keys = 0;
+            for (u32 i = 0; i < count; ++i)
+            {
+                u32 n = entities[i];
+
+                // skip 0 instance buffers
+                if (scene->entities[n] & e_cmp::master_instance)
+                    if (scene->master_instances[n].num_instances == 0)
+                        continue;
+
+                cmp_geometry* p_geom = &scene->geometries[n];
+                if (!(scene->entities[n] & e_cmp::skinned))
+                    if (view.render_flags & pmfx::e_scene_render_flags::shadow_map)
+                        p_geom = &scene->position_geometries[n];
+
+                const cmp_material& mat = scene->materials[n];
+                u32                 shader = mat.shader;
+                u32                 technique = mat.technique_index;
+                if (is_valid(view.pmfx_shader))
+                {
+                    shader = view.pmfx_shader;
+                    technique = 0;
+                }
+
+                u64 state = fold_bits(shader, 10) << 37;
+                state |= fold_bits(technique, 8) << 29;
+                state |= fold_bits(scene->material_permutation[n], 8) << 21;
+                state |= fold_bits((u32)scene->id_material[n], 10) << 11;
+                state |= fold_bits(p_geom->vertex_buffer, 11);
 
+                vec3f v = scene->pos_extent[n].pos.xyz - eye;
+                u64   depth = depth_bits(dot(v, v));
+
+                u64 key;
+                if (blended)
+                    key = (1ull << 63) | ((~depth & 0xffff) << 47) | (state >> 1);
+                else
+                    key = (state << 16) | depth;
+
+                s_draw_keys[num_keys].key = key;
+                s_draw_keys[num_keys].entity = n;
+                s_draw_keys[num_keys].instances = 1;
+                s_draw_keys[num_keys].instance_offset = 0;
+                ++num_keys;
+            }
+
+            if (num_keys > 1)
+                radix_sort_draw_keys(num_keys);
+
+            return num_keys;
+        }
+
+        bool can_auto_instance(const ecs_scene* scene, u32 n)
+        {
+            const u32 manual = e_cmp::master_instance | e_cmp::sub_instance | e_cmp::custom_instance_buffer;
+            return !(scene->entities[n] & (manual | e_cmp::skinned));
+        }
+
+        // entities can share an instanced draw when geometry, material and any per entity overrides are identical
+        bool same_auto_instance(const ecs_scene* scene, u32 a, u32 b)
+        {
+            if (scene->id_geometry[a] != scene->id_geometry[b] || scene->id_material[a] != scene->id_material[b])
+                return false;
+
+            if (scene->material_permutation[a] != scene->material_permutation[b])
+                return false;
+
+            const cmp_geometry& ga = scene->geometries[a];
+            const cmp_geometry& gb = scene->geometries[b];
+            if (ga.vertex_buffer != gb.vertex_buffer || ga.index_buffer != gb.index_buffer)
+                return false;
+
+            if (scene->materials[a].shader != scene->materials[b].shader ||
+                scene->materials[a].technique_index != scene->materials[b].technique_index)
+                return false;
+
+            if (memcmp(&scene->material_data[a], &scene->material_data[b], sizeof(cmp_material_data)) != 0)
+                return false;
+
+            return memcmp(&scene->samplers[a], &scene->samplers[b], sizeof(cmp_samplers)) == 0;
+        }
+
+        // technique index for the instanced permutation of the entity or view shader, invalid if there is none
+        u32 get_auto_instance_technique(const scene_view& view, u32 n)
+        {
+            ecs_scene* scene = view.scene;
+            u32        permutation = scene->material_permutation[n] | e_shader_permutation::instanced;
+
+            if (is_valid(view.pmfx_shader))
+                return pmfx::get_technique_index_perm(view.pmfx_shader, view.id_technique, permutation);
+
+            hash_id id_technique = scene->material_resources[n].id_technique;
+            return pmfx::get_technique_index_perm(scene->materials[n].shader, id_technique, permutation);
+        }
+
+        // finds runs of identical draws in the sorted keys and packs their draw call data into a per frame instance buffer
+        u32 build_auto_instances(const scene_view& view, u32 num_keys)
+        {
+            ecs_scene* scene = view.scene;
+
+            if (num_keys > s_auto_instance_data_capacity)
+            {
+                s_auto_instance_data =
+                    (cmp_draw_call*)pen::memory_realloc(s_auto_instance_data, sizeof(cmp_draw_call) * num_keys);
+                s_auto_instance_data_capacity = num_keys;
+            }
+
+            u32 num_instances = 0;
+            for (u32 i = 0; i < num_keys;)
+            {
+                u32 n = s_draw_keys[i].entity;
+
+                u32 end = i + 1;
+                if (can_auto_instance(scene, n))
+                {
+                    while (end < num_keys && can_auto_instance(scene, s_draw_keys[end].entity) &&
+                           same_auto_instance(scene, n, s_draw_keys[end].entity))
+                        ++end;
+                }
+
+                u32 run = end - i;
+                if (run >= k_min_auto_instances && is_valid(get_auto_instance_technique(view, n)))
+                {
+                    s_draw_keys[i].instances = run;
+                    s_draw_keys[i].instance_offset = num_instances;
+
+                    for (u32 j = i; j < end; ++j)
+                    {
+                        s_auto_instance_data[num_instances++] = scene->draw_call_data[s_draw_keys[j].entity];
+                        if (j > i)
+                            s_draw_keys[j].instances = 0;
+                    }
+                }
+
+                i = end;
+            }
+
+            if (num_instances == 0)
+                return PEN_INVALID_HANDLE;
+
+            // buffers are recycled each frame
+            u64 frame = pen::_renderer_frame_index();
+            if (frame != s_auto_instance_frame)
+            {
+                s_auto_instance_frame = frame;
+                s_auto_instance_buffer_pos = 0;
+            }
+
+            if (s_auto_instance_buffer_pos == s_auto_instance_buffers.size())
+                s_auto_instance_buffers.push_back({PEN_INVALID_HANDLE, 0});
+
+            auto_instance_buffer& buf = s_auto_instance_buffers[s_auto_instance_buffer_pos++];
+            if (buf.capacity < num_instances)
+            {
+                if (is_valid(buf.handle))
+                    pen::renderer_release_buffer(buf.handle);
+
+                buf.capacity = std::max<u32>(64, buf.capacity);
+                while (buf.capacity < num_instances)
+                    buf.capacity *= 2;
+
+                pen::buffer_creation_params bcp;
+                bcp.usage_flags = PEN_USAGE_DYNAMIC;
+                bcp.bind_flags = PEN_BIND_VERTEX_BUFFER;
+                bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+                bcp.buffer_size = sizeof(cmp_draw_call) * buf.capacity;
+                bcp.data = nullptr;
+
+                buf.handle = pen::renderer_create_buffer(bcp);
+            }
+
+            pen::renderer_update_buffer(buf.handle, s_auto_instance_data, sizeof(cmp_draw_call) * num_instances);
+            return buf.handle;
+        }
+
+        void render_scene_view_entities(const scene_view& view, const u32* entities)
+        {
             ecs_scene* scene = view.scene;
             if (scene->view_flags & e_scene_view_flags::hide)
                 return;
@@ -927,6 +1243,11 @@ namespace put
                 pen::renderer_set_texture(ltc_mag, clamp_linear, 12, pen::TEXTURE_BIND_PS);
             }
 
+            // bones of every skin
+            if (is_valid(scene->bone_palette_buffer))
+                pen::renderer_set_structured_buffer(scene->bone_palette_buffer, k_bone_palette_unit,
+                                                    pen::SBUFFER_BIND_VS | pen::SBUFFER_BIND_READ);
+
             // sdf shadows
             pen::renderer_set_constant_buffer(scene->sdf_shadow_buffer, 5, pen::CBUFFER_BIND_PS);
             for (u32 n = 0; n < scene->num_entities; ++n)
@@ -953,29 +1274,32 @@ namespace put
             static u32     blue_noise = put::load_texture("data/textures/noise/blue_noise_ldr_rgba_0.dds");
             pen::renderer_set_texture(blue_noise, wrap_point, 5, pen::TEXTURE_BIND_PS);
 
-            // filter and cull
-            u32* filtered_entities = nullptr;
-            u32* culled_entities = nullptr;
-            filter_entities_scalar(scene, &filtered_entities);
-            frustum_cull_aabb_scalar(scene, view.camera, filtered_entities, &culled_entities);
-            
+            // sort by state to minimise binds, then depth within matching state
+            u32 vc = sb_count(entities);
+            u32 num_keys = build_draw_keys(view, entities, vc);
+
+            // runs of identical geometry and material are drawn instanced
+            u32 auto_instance_buffer = build_auto_instances(view, num_keys);
+
             // track to prevent redundant state changes.
             u32 cur_shader = -1;
             u32 cur_technique = -1;
             u32 cur_permutation = -1;
             u32 cur_vb = -1;
             u32 cur_ib = -1;
-            u32 vc = sb_count(culled_entities);
-            
+            u32 cur_mcb = -1;
+
+            pmfx::scene_view_stats stats;
+
             // render
-            for (u32 i = 0; i < vc; ++i)
+            for (u32 i = 0; i < num_keys; ++i)
             {
-                u32 n = culled_entities[i];
-                
-                // skip 0 instance buffers
-                if (scene->entities[n] & e_cmp::master_instance)
-                    if(scene->master_instances[n].num_instances == 0)
-                        continue;
+                u32 n = s_draw_keys[i].entity;
+
+                // drawn by the head of an auto instanced run
+                u32 instances = s_draw_keys[i].instances;
+                if (instances == 0)
+                    continue;
 
                 cmp_geometry* p_geom = &scene->geometries[n];
                 if (!(scene->entities[n] & e_cmp::skinned))
@@ -984,34 +1308,47 @@ namespace put
 
                 cmp_material* p_mat = &scene->materials[n];
                 u32           permutation = scene->material_permutation[n];
+                u32           shader = p_mat->shader;
+                u32           technique = p_mat->technique_index;
+
+                if (instances > 1)
+                {
+                    permutation |= e_shader_permutation::instanced;
+                    technique = get_auto_instance_technique(view, n);
+                }
+
+                // per pass material but with permutation specialisation (instanced, skinned etc)
+                if (is_valid(view.pmfx_shader))
+                {
+                    shader = view.pmfx_shader;
+                    technique = view.id_technique;
+                }
 
                 // set shader / technique only if we need to change
-                if (p_mat->shader != cur_shader || p_mat->technique_index != cur_technique || permutation != cur_permutation)
+                if (shader != cur_shader || technique != cur_technique || permutation != cur_permutation)
                 {
                     if (!is_valid(view.pmfx_shader))
-                    {
-                        // per entity material
-                        pmfx::set_technique(p_mat->shader, p_mat->technique_index);
-                        cur_shader = p_mat->shader;
-                        cur_technique = p_mat->technique_index;
-                        cur_permutation = permutation;
-                    }
+                        pmfx::set_technique(shader, technique);
                     else
-                    {
-                        // per pass material but with permutation specialisation (instanced, skinned etc)
-                        pmfx::set_technique_perm(view.pmfx_shader, view.id_technique, permutation);
-                        cur_shader = view.pmfx_shader;
-                        cur_technique = view.id_technique;
-                        cur_permutation = permutation;
-                    }
+                        pmfx::set_technique_perm(shader, technique, permutation);
+
+                    cur_shader = shader;
+                    cur_technique = technique;
+                    cur_permutation = permutation;
 
                     // if we change pipeline, we need to rebind buffers
                     cur_vb = -1;
                     cur_ib = -1;
+                    cur_mcb = -1;
+                    ++stats.binds_issued;
+                }
+                else
+                {
+                    ++stats.binds_avoided;
                 }
 
-                // bind skinning
-                if (scene->entities[n] & e_cmp::skinned)
+                // bind skinning, the bone palette is bound once for the view
+                if ((scene->entities[n] & e_cmp::skinned) && !is_valid(scene->bone_palette_buffer))
                 {
                     pen::renderer_set_constant_buffer(scene->bone_cbuffer[n], 2, pen::CBUFFER_BIND_VS);
                 }
@@ -1020,7 +1357,16 @@ namespace put
                 u32 mcb = scene->materials[n].material_cbuffer;
                 if (is_valid(mcb))
                 {
-                    pen::renderer_set_constant_buffer(mcb, 7, pen::CBUFFER_BIND_PS | pen::CBUFFER_BIND_VS);
+                    if (cur_mcb != mcb)
+                    {
+                        pen::renderer_set_constant_buffer(mcb, 7, pen::CBUFFER_BIND_PS | pen::CBUFFER_BIND_VS);
+                        cur_mcb = mcb;
+                        ++stats.binds_issued;
+                    }
+                    else
+                    {
+                        ++stats.binds_avoided;
+                    }
                 }
 
                 // draw call cb
@@ -1049,6 +1395,17 @@ namespace put
 
                     pen::renderer_set_vertex_buffers(vbs, 2, 0, strides, offsets);
                     cur_vb = vbs[0];
+                    ++stats.binds_issued;
+                }
+                else if (instances > 1)
+                {
+                    u32 vbs[2] = {p_geom->vertex_buffer, auto_instance_buffer};
+                    u32 strides[2] = {p_geom->vertex_size, sizeof(cmp_draw_call)};
+                    u32 offsets[2] = {0, s_draw_keys[i].instance_offset * (u32)sizeof(cmp_draw_call)};
+
+                    pen::renderer_set_vertex_buffers(vbs, 2, 0, strides, offsets);
+                    cur_vb = vbs[0];
+                    ++stats.binds_issued;
                 }
                 else
                 {
@@ -1056,6 +1413,11 @@ namespace put
                     {
                         pen::renderer_set_vertex_buffer(p_geom->vertex_buffer, 0, p_geom->vertex_size, 0);
                         cur_vb = p_geom->vertex_buffer;
+                        ++stats.binds_issued;
+                    }
+                    else
+                    {
+                        ++stats.binds_avoided;
                     }
                 }
 
@@ -1064,17 +1426,26 @@ namespace put
                 {
                     pen::renderer_set_index_buffer(p_geom->index_buffer, p_geom->index_type, 0);
                     cur_ib = p_geom->index_buffer;
+                    ++stats.binds_issued;
+                }
+                else
+                {
+                    ++stats.binds_avoided;
                 }
 
+                ++stats.draws;
+
                 // instances
                 if (scene->entities[n] & e_cmp::master_instance)
                 {
                     pen::renderer_draw_indexed_instanced(
                         scene->master_instances[n].num_instances, 0, p_geom->num_indices, 0, 0, PEN_PT_TRIANGLELIST);
-                    
-                    if(!(scene->entities[n] & e_cmp::custom_instance_buffer))
-                        n += scene->master_instances[n].num_instances;
-                        
+                    continue;
+                }
+
+                if (instances > 1)
+                {
+                    pen::renderer_draw_indexed_instanced(instances, 0, p_geom->num_indices, 0, 0, PEN_PT_TRIANGLELIST);
                     continue;
                 }
 
@@ -1082,241 +1453,426 @@ namespace put
                 pen::renderer_draw_indexed(p_geom->num_indices, 0, 0, PEN_PT_TRIANGLELIST);
             }
 
-            if (filtered_entities)
+            if (view.stats)
             {
-                sb_free(filtered_entities);
+                view.stats->draws += stats.draws;
+                view.stats->binds_issued += stats.binds_issued;
+                view.stats->binds_avoided += stats.binds_avoided;
             }
+        }
 
-            if (culled_entities)
-            {
-                sb_free(culled_entities);
-            }
+        void render_scene_view(const scene_view& view)
+        {
+            // PEN_PERF_SCOPE_PRINT(render_scene_view);
+
+            ecs_scene* scene = view.scene;
+            if (scene->view_flags & e_scene_view_flags::hide)
+                return;
+
+            // cull the renderables packed in update_scene
+            u32* culled_entities = nullptr;
+            if (scene->flags & e_scene_flags::spatial_index)
+                bvh_query_frustum(&scene->spatial, view.camera->camera_frustum, &culled_entities);
+            else
+                frustum_cull_aabb_stream(&scene->renderables, view.camera, &culled_entities);
+
+            render_scene_view_entities(view, culled_entities);
+
+            sb_free(culled_entities);
         }
 
-        void update_animations(ecs_scene* scene, f32 dt)
+        // animation update
+        // controllers are independent and are updated in parallel task ranges when there are enough of them, only
+        // the instances feeding the blend are sampled. root motion moves the parent of a controller which may be
+        // shared, so it is recorded per controller and applied serially once the tasks have completed.
+        // distant controllers sample less often and interpolate between their last two outputs, see anim_lod.
+        namespace
         {
-            for (u32 n = 0; n < scene->num_entities; ++n)
-            {
-                if (!(scene->entities[n] & e_cmp::anim_controller))
-                    continue;
+            static const u32 k_anim_grain_size = 4;
+            static const u32 k_parallel_anim_threshold = 8;
 
-                cmp_anim_controller_v2 controller = scene->anim_controller_v2[n];
-                u32 root = ecs::get_index_from_ref(scene, controller.root_joint_ref);
-                
-                // rig may be scaled
-                u32 p = scene->parents[n];
-                vec3f parent_scale = scene->transforms[p].scale;
+            struct anim_scratch
+            {
+                anim_batch batch;
+                anim_pose  blended;
+            };
 
-                u32 num_anims = sb_count(controller.anim_instances);
-                for (u32 ai = 0; ai < num_anims; ++ai)
-                {
-                    anim_instance& instance = controller.anim_instances[ai];
+            struct anim_root_motion
+            {
+                u32   parent;
+                quat  rotation;
+                vec3f translation;
+                bool  active;
+            };
 
-                    if (instance.flags & e_anim_flags::paused)
-                        continue;
+            struct anim_context
+            {
+                ecs_scene*        scene = nullptr;
+                const camera*     cam = nullptr; // lod view point
+                f32               dt = 0.0f;
+                u32*              controllers = nullptr; // entity index of each controller
+                anim_root_motion* root_motion = nullptr; // per controller
+            };
+            anim_context s_anim_ctx;
 
-                    soa_anim& soa = instance.soa;
-                    u32       num_channels = soa.num_channels;
-                    f32       anim_t = instance.time;
+            // per thread rather than per thread_index, threads outside the task pool share an index
+            thread_local anim_scratch t_anim_scratch;
 
-                    bool looped = false;
+            // rolls on time and returns true if the anim looped
+            bool advance_anim_instance(anim_instance& instance, f32 dt)
+            {
+                bool looped = false;
 
-                    // roll on time
-                    instance.time += dt * controller.playback_rate;
-                    
-                    //
-                    if (instance.flags & e_anim_flags::clamp)
-                    {
-                        instance.time = min(instance.time, instance.length);
-                    }
-                    else
-                    {
-                        if (instance.time >= instance.length)
-                        {
-                            instance.time = 0.0f;
-                            looped = true;
-                        }
-                    }
+                instance.time += dt;
 
-                    if (instance.flags & e_anim_flags::looped)
+                if (instance.flags & e_anim_flags::clamp)
+                {
+                    instance.time = min(instance.time, instance.length);
+                }
+                else
+                {
+                    if (instance.time >= instance.length)
                     {
-                        instance.flags &= ~e_anim_flags::looped;
+                        instance.time = 0.0f;
                         looped = true;
                     }
+                }
 
-                    u32 num_joints = sb_count(instance.joints);
-
-                    // reset rotations
-                    for (u32 j = 0; j < num_joints; ++j)
-                        instance.targets[j].q = quat(0.0f, 0.0f, 0.0f);
-
-                    for (u32 c = 0; c < num_channels; ++c)
-                    {
-                        anim_sampler& sampler = instance.samplers[c];
-                        anim_channel& channel = soa.channels[c];
+                if (instance.flags & e_anim_flags::looped)
+                {
+                    instance.flags &= ~e_anim_flags::looped;
+                    looped = true;
+                }
 
-                        if (sampler.joint == PEN_INVALID_HANDLE)
-                            continue;
+                return looped;
+            }
 
-                        // find the frame we are on..
-                        for (; sampler.pos < channel.num_frames; sampler.pos++)
-                            if (anim_t <= soa.info[sampler.pos][c].time)
-                            {
-                                sampler.pos -= 1;
-                                break;
-                            }
+            void sample_anim_instance(ecs_scene* scene, const cmp_anim_controller_v2& controller, u32 root,
+                                      const vec3f& parent_scale, anim_instance& instance, f32 anim_t, bool looped,
+                                      u32 max_joint_depth, anim_batch& batch)
+            {
+                u32 num_joints = instance.pose.num_joints;
 
-                        //reset flag
-                        sampler.flags &= ~e_anim_flags::looped;
+                // reset rotations
+                for (u32 j = 0; j < num_joints; ++j)
+                    instance.targets[j].q = quat(0.0f, 0.0f, 0.0f);
 
-                        if (sampler.pos >= channel.num_frames || looped)
-                        {
-                            sampler.pos = 0;
-                            sampler.flags = e_anim_flags::looped;
-                        }
+                // root motion inherits the previous translation on the frame an anim loops
+                u32 num_samplers = sb_count(instance.samplers);
+                for (u32 c = 0; c < num_samplers; ++c)
+                {
+                    instance.samplers[c].flags &= ~e_anim_flags::looped;
+                    if (looped)
+                        instance.samplers[c].flags |= e_anim_flags::looped;
+                }
 
-                        u32 next = (sampler.pos + 1) % channel.num_frames;
+                sample_anim_clip_batch(instance.clip, anim_t, instance.cursors, instance.samplers, instance.targets,
+                                       batch, controller.joint_depth, max_joint_depth);
 
-                        // get anim data
-                        anim_info& info1 = soa.info[sampler.pos][c];
-                        anim_info& info2 = soa.info[next][c];
+                // bake anim target into the pose for joint
+                u32 tj = PEN_INVALID_HANDLE;
+                for (u32 j = 0; j < num_joints; ++j)
+                {
+                    u32 jnode = controller.joint_indices[j] + root;
 
-                        f32* d1 = &soa.data[sampler.pos][info1.offset];
-                        f32* d2 = &soa.data[next][info2.offset];
+                    if (scene->entities[jnode] & e_cmp::anim_trajectory)
+                    {
+                        tj = j;
+                        continue;
+                    }
 
-                        f32 a = (anim_t - info1.time);
-                        f32 b = (info2.time - info1.time);
+                    if (controller.joint_depth[j] > max_joint_depth)
+                        continue;
 
-                        f32 it = min(max(a / b, 0.0f), 1.0f);
+                    const anim_target& target = instance.targets[j];
+                    const f32*         f = &target.t[0];
 
-                        sampler.prev_t = sampler.cur_t;
-                        sampler.cur_t = it;
+                    vec3f translation = vec3f(f[e_anim_output::translate_x], f[e_anim_output::translate_y],
+                                              f[e_anim_output::translate_z]);
 
-                        for (u32 e = 0; e < channel.element_count; ++e)
-                        {
-                            u32 eo = channel.element_offset[e];
+                    vec3f scale = vec3f(f[e_anim_output::scale_x], f[e_anim_output::scale_y], f[e_anim_output::scale_z]);
 
-                            // slerp quats
-                            if (eo == e_anim_output::quaternion)
-                            {
-                                quat q1;
-                                quat q2;
+                    quat rotation = target.q;
+                    if (!(target.flags & e_anim_flags::baked_quaternion))
+                        rotation = scene->initial_transform[jnode].rotation * target.q;
 
-                                memcpy(&q1.v[0], &d1[e], 16);
-                                memcpy(&q2.v[0], &d2[e], 16);
+                    set_anim_pose_joint(instance.pose, j, translation, rotation, scale);
+                }
 
-                                quat ql = slerp(q1, q2, it);
+                // root motion.. todo rotation
+                if (tj != PEN_INVALID_HANDLE)
+                {
+                    f32*  f = &instance.targets[tj].t[0];
+                    vec3f tt = vec3f(f[0], f[1], f[2]) * parent_scale;
 
-                                instance.targets[sampler.joint].q = ql * instance.targets[sampler.joint].q;
-                                instance.targets[sampler.joint].flags |= channel.flags;
-                                e += 3;
-                            }
-                            else
-                            {
-                                // lerp translation / scale
-                                f32 lf = (1 - it) * d1[e] + it * d2[e];
-                                instance.targets[sampler.joint].t[eo] = lf;
-                            }
-                        }
+                    if (instance.samplers[0].flags & e_anim_flags::looped)
+                    {
+                        // inherit prev root motion
+                        instance.root_translation = tt;
                     }
-
-                    // bake anim target into a cmp transform for joint
-                    u32 tj = PEN_INVALID_HANDLE;
-                    for (u32 j = 0; j < num_joints; ++j)
+                    else
                     {
-                        u32 jnode = controller.joint_indices[j] + root;
+                        instance.root_delta = tt - instance.root_translation;
+                        instance.root_translation = tt;
+                    }
+                }
+            }
+
+            // depth of each joint below the root joint, joints are stored parents first
+            void update_joint_depth(const ecs_scene* scene, cmp_anim_controller_v2& controller, u32 root)
+            {
+                u32 num_joints = sb_count(controller.joint_indices);
+                if (sb_count(controller.joint_depth) == num_joints)
+                    return;
+
+                sb_free(controller.joint_depth);
+                controller.joint_depth = nullptr;
+
+                for (u32 j = 0; j < num_joints; ++j)
+                {
+                    u32 p = scene->parents[controller.joint_indices[j] + root];
 
-                        if (scene->entities[jnode] & e_cmp::anim_trajectory)
+                    u8 depth = 0;
+                    for (u32 k = 0; k < j; ++k)
+                    {
+                        if (controller.joint_indices[k] + root == p)
                         {
-                            tj = j;
-                            continue;
+                            depth = (u8)std::min<u32>(controller.joint_depth[k] + 1, 255);
+                            break;
                         }
+                    }
+
+                    sb_push(controller.joint_depth, depth);
+                }
+            }
 
-                        f32* f = &instance.targets[j].t[0];
+            u32 select_anim_lod(const anim_context& ctx, const cmp_anim_controller_v2& controller, u32 n)
+            {
+                const camera* cam = ctx.cam;
+                if (!controller.lod_enabled || !cam || cam->fov <= 0.0f)
+                    return 0;
 
-                        instance.joints[j].translation = vec3f(f[e_anim_output::translate_x], f[e_anim_output::translate_y],
-                                                               f[e_anim_output::translate_z]);
+                ecs_scene* scene = ctx.scene;
+                f32        dist = mag(scene->world_matrices[n].get_translation() - cam->pos);
+                f32        half_height = dist * tan(maths::deg_to_rad(cam->fov) * 0.5f);
+                if (half_height <= 0.0f)
+                    return 0;
 
-                        instance.joints[j].scale =
-                            vec3f(f[e_anim_output::scale_x], f[e_anim_output::scale_y], f[e_anim_output::scale_z]);
+                f32 coverage = scene->bounding_volumes[n].radius / half_height;
+                for (u32 l = 0; l < k_num_anim_lods; ++l)
+                    if (coverage >= controller.lods[l].min_coverage)
+                        return l;
 
-                        if (instance.targets[j].flags & e_anim_flags::baked_quaternion)
-                            instance.joints[j].rotation = instance.targets[j].q;
-                        else
-                            instance.joints[j].rotation = scene->initial_transform[jnode].rotation * instance.targets[j].q;
+                return k_num_anim_lods - 1;
+            }
+
+            void update_anim_controller(anim_context& ctx, u32 ci, anim_scratch& scratch)
+            {
+                ecs_scene*        scene = ctx.scene;
+                u32               n = ctx.controllers[ci];
+                anim_root_motion& rm = ctx.root_motion[ci];
+
+                rm.active = false;
+
+                cmp_anim_controller_v2& controller = scene->anim_controller_v2[n];
+                u32                     root = ecs::get_index_from_ref(scene, controller.root_joint_ref);
+
+                // rig may be scaled
+                u32   p = scene->parents[n];
+                vec3f parent_scale = scene->transforms[p].scale;
+
+                u32 num_anims = sb_count(controller.anim_instances);
+                if (num_anims == 0)
+                    return;
+
+                update_joint_depth(scene, controller, root);
+
+                controller.lod = select_anim_lod(ctx, controller, n);
+                const anim_lod& lod = controller.lod_enabled ? controller.lods[controller.lod] : k_full_anim_lod;
+                u32             period = std::max<u32>(lod.update_rate, 1);
+
+                // sample once the previous period has elapsed, or straight away when moving to a finer lod
+                bool sample = controller.lod_step >= controller.lod_period || period < controller.lod_period;
+
+                u32  ia = controller.blend.anim_a;
+                u32  ib = controller.blend.anim_b;
+                f32  t = controller.blend.ratio;
+                bool blend_b = ib != ia && t > 0.0f;
+
+                for (u32 ai = 0; ai < num_anims; ++ai)
+                {
+                    anim_instance& instance = controller.anim_instances[ai];
+
+                    if (instance.flags & e_anim_flags::paused)
+                        continue;
+
+                    f32  anim_t = instance.time;
+                    bool looped = advance_anim_instance(instance, ctx.dt * controller.playback_rate);
+
+                    if (ai != ia && !(ai == ib && blend_b))
+                    {
+                        // not contributing to the blend, root motion starts again when it is next sampled
+                        instance.flags |= e_anim_flags::looped;
+                        instance.root_delta = vec3f::zero();
+                        continue;
                     }
 
-                    // root motion.. todo rotation
-                    if (tj != PEN_INVALID_HANDLE)
+                    if (!sample)
                     {
-                        f32*  f = &instance.targets[tj].t[0];
-                        vec3f tt = vec3f(f[0], f[1], f[2]) * parent_scale;
+                        // keep the loop for the next sample
+                        if (looped)
+                            instance.flags |= e_anim_flags::looped;
 
-                        if (instance.samplers[0].flags & e_anim_flags::looped)
-                        {
-                            // inherit prev root motion
-                            instance.root_translation = tt;
-                        }
-                        else
-                        {
-                            instance.root_delta = tt - instance.root_translation;
-                            instance.root_translation = tt;
-                        }
+                        continue;
                     }
+
+                    sample_anim_instance(scene, controller, root, parent_scale, instance, anim_t, looped,
+                                         lod.max_joint_depth, scratch.batch);
                 }
-                
 
-                // for active controller.anim_instances, make trans, quat, scale
-                //      blend tree
-                if (num_anims > 0)
+                anim_instance&   a = controller.anim_instances[ia];
+                anim_instance&   b = controller.anim_instances[ib];
+                u32              num_joints = a.pose.num_joints;
+                const anim_pose* out = &scratch.blended;
+
+                if (sample)
                 {
-                    anim_instance& a = controller.anim_instances[controller.blend.anim_a];
-                    anim_instance& b = controller.anim_instances[controller.blend.anim_b];
-                    f32            t = controller.blend.ratio;
+                    // blend tree
+                    const anim_pose* pose = &a.pose;
+                    if (blend_b)
+                    {
+                        resize_anim_pose(scratch.blended, num_joints);
+                        blend_anim_poses(a.pose, b.pose, t, scratch.blended);
+                        pose = &scratch.blended;
+                    }
+
+                    // throttled lods interpolate from the previous output
+                    if (period > 1)
+                    {
+                        if (controller.lod_period <= 1 || controller.lod_next.num_joints != num_joints)
+                            copy_anim_pose(*pose, controller.lod_next);
 
-                    u32 num_joints = sb_count(a.joints);
+                        std::swap(controller.lod_prev, controller.lod_next);
+                        copy_anim_pose(*pose, controller.lod_next);
+                    }
+                    else
+                    {
+                        out = pose;
+                    }
+
+                    // root motion covers the time since the last sample and is spread over the next period
+                    vec3f root_motion = vec3f::zero();
                     for (u32 j = 0; j < num_joints; ++j)
                     {
                         u32 jnode = controller.joint_indices[j] + root;
+                        if (!(scene->entities[jnode] & e_cmp::anim_trajectory))
+                            continue;
 
-                        cmp_transform& tc = scene->transforms[jnode];
-                        cmp_transform& ta = a.joints[j];
-                        cmp_transform& tb = b.joints[j];
+                        vec3f lerp_delta = lerp(a.root_delta, b.root_delta, t);
 
-                        if (scene->entities[jnode] & e_cmp::anim_trajectory)
-                        {
-                            vec3f lerp_delta = lerp(a.root_delta, b.root_delta, t);
+                        mat4 rot_mat;
+                        scene->initial_transform[jnode].rotation.get_matrix(rot_mat);
+                        root_motion += rot_mat.transform_vector(lerp_delta);
+                    }
 
-                            mat4 rot_mat;
-                            quat q = scene->initial_transform[jnode].rotation;
-                            q.get_matrix(rot_mat);
+                    controller.lod_root_motion = root_motion / (f32)period;
+                    controller.lod_period = period;
+                    controller.lod_step = 0;
+                }
 
-                            vec3f transform_translation = rot_mat.transform_vector(lerp_delta);
-                            
-                            // apply to parent so we bring along sub or sibling meshes
-                            u32 p = scene->parents[n];
+                controller.lod_step++;
 
-                            // apply root motion to the root controller, so we bring along the meshes
-                            scene->transforms[p].rotation = q;
-                            scene->transforms[p].translation += transform_translation;
-                            scene->entities[p] |= e_cmp::transform;
+                if (controller.lod_period > 1)
+                {
+                    resize_anim_pose(scratch.blended, num_joints);
+                    blend_anim_poses(controller.lod_prev, controller.lod_next,
+                                     (f32)controller.lod_step / (f32)controller.lod_period, scratch.blended);
+                }
 
-                            continue;
-                        }
+                for (u32 j = 0; j < num_joints; ++j)
+                {
+                    u32 jnode = controller.joint_indices[j] + root;
 
-                        tc.translation = lerp(ta.translation, tb.translation, t);
-                        tc.rotation = slerp(ta.rotation, tb.rotation, t);
-                        tc.scale = lerp(ta.scale, tb.scale, t);
-                        
-                        if(scene->entities[jnode] & e_cmp::additive_rotation)
-                        {
-                            tc.rotation *= scene->additive_rotation[jnode];
-                        }
+                    if (scene->entities[jnode] & e_cmp::anim_trajectory)
+                    {
+                        // apply to parent so we bring along sub or sibling meshes
+                        rm.active = true;
+                        rm.parent = p;
+                        rm.rotation = scene->initial_transform[jnode].rotation;
+                        rm.translation = controller.lod_root_motion;
+                        continue;
+                    }
+
+                    if (controller.joint_depth[j] > lod.max_joint_depth)
+                        continue;
 
-                        scene->entities[jnode] |= e_cmp::transform;
+                    cmp_transform& tc = scene->transforms[jnode];
+                    get_anim_pose_joint(*out, j, tc.translation, tc.rotation, tc.scale);
+
+                    if (scene->entities[jnode] & e_cmp::additive_rotation)
+                    {
+                        tc.rotation *= scene->additive_rotation[jnode];
                     }
+
+                    scene->entities[jnode] |= e_cmp::transform;
                 }
             }
+
+            void update_anim_controller_range(void* user_data, u32 start, u32 end, u32 thread_index)
+            {
+                anim_context* ctx = (anim_context*)user_data;
+                for (u32 i = start; i < end; ++i)
+                    update_anim_controller(*ctx, i, t_anim_scratch);
+            }
+        } // namespace
+
+        void update_animations(ecs_scene* scene, f32 dt)
+        {
+            anim_context& ctx = s_anim_ctx;
+            ctx.scene = scene;
+            ctx.dt = dt;
+
+            // lods are chosen from the first controller with a camera, usually the editor or game camera
+            ctx.cam = nullptr;
+            u32 num_ecs_controllers = sb_count(scene->controllers);
+            for (u32 c = 0; c < num_ecs_controllers && !ctx.cam; ++c)
+                ctx.cam = scene->controllers[c].camera;
+
+            sb_clear(ctx.controllers);
+            for (u32 n = 0; n < scene->num_entities; ++n)
+                if (scene->entities[n] & e_cmp::anim_controller)
+                    sb_push(ctx.controllers, n);
+
+            u32 num_controllers = sb_count(ctx.controllers);
+            if (num_controllers == 0)
+                return;
+
+            sb_clear(ctx.root_motion);
+            sb_add(ctx.root_motion, num_controllers);
+
+            if (num_controllers >= k_parallel_anim_threshold && pen::tasks_num_threads() > 1)
+            {
+                pen::task_counter counter;
+                pen::tasks_parallel_for(num_controllers, k_anim_grain_size, update_anim_controller_range, &ctx,
+                                        &counter);
+                pen::tasks_wait(&counter);
+            }
+            else
+            {
+                update_anim_controller_range(&ctx, 0, num_controllers, 0);
+            }
+
+            // root motion in controller order, so controllers sharing a parent accumulate deterministically
+            for (u32 i = 0; i < num_controllers; ++i)
+            {
+                const anim_root_motion& rm = ctx.root_motion[i];
+                if (!rm.active)
+                    continue;
+
+                scene->transforms[rm.parent].rotation = rm.rotation;
+                scene->transforms[rm.parent].translation += rm.translation;
+                scene->entities[rm.parent] |= e_cmp::transform;
+            }
         }
 
         void update(f32 dt)
@@ -1332,6 +1888,19 @@ namespace put
                 dt = ft;
             }
 
+            // physics can step at its own fixed rate, outputs are interpolated between the last 2 steps
+            static physics::step_params s_physics_step;
+            physics::step_params        psp;
+            psp.fixed_timestep = dev_ui::get_program_preference("physics_fixed_timestep").as_f32(0.0f);
+            psp.max_substeps = dev_ui::get_program_preference("physics_max_substeps").as_s32(4);
+            psp.interpolate = dev_ui::get_program_preference("physics_interpolate").as_bool(true);
+            if (psp.fixed_timestep != s_physics_step.fixed_timestep || psp.max_substeps != s_physics_step.max_substeps ||
+                psp.interpolate != s_physics_step.interpolate)
+            {
+                physics::set_step_params(psp);
+                s_physics_step = psp;
+            }
+
             for (auto& si : s_scenes)
             {
                 update_scene(si.scene, dt);
@@ -1363,197 +1932,781 @@ namespace put
 
                     scene->entities[i] |= e_cmp::transform;
 
-                    // reset velocity
-                    physics::set_v3(scene->physics_handles[i], vec3f::zero(), physics::e_cmd::set_linear_velocity);
-                    physics::set_v3(scene->physics_handles[i], vec3f::zero(), physics::e_cmd::set_angular_velocity);
-                }
+                    // reset velocity
+                    physics::set_v3(scene->physics_handles[i], vec3f::zero(), physics::e_cmd::set_linear_velocity);
+                    physics::set_v3(scene->physics_handles[i], vec3f::zero(), physics::e_cmd::set_angular_velocity);
+                }
+            }
+        }
+
+        // parallel transform update
+        // only entities flagged transform_dirty (and their descendants) are updated each frame.
+        // dirty entities are bucketed by hierarchy depth so each level only reads world matrices from levels above it,
+        // levels are dispatched in order as parallel_for tasks.
+        namespace
+        {
+            static const u32 k_transform_grain_size = 256;
+            static const u32 k_parallel_transform_threshold = 4096;
+
+            struct transform_context
+            {
+                ecs_scene* scene = nullptr;
+                u32        capacity = 0;
+                u32*       depth = nullptr;
+                u32*       sorted = nullptr;
+                u32*       dirty = nullptr;     // entities whose world matrix needs updating, in soa order
+                u32*       ancestors = nullptr; // ancestors of dirty entities which only need bounds updating
+                u32        num_dirty = 0;
+                u32        num_ancestors = 0;
+                u32*       level_offsets = nullptr;
+                u32        num_levels = 0;
+                u32        level_start = 0;
+                bool       ordered = true;
+            };
+            transform_context s_transform_ctx;
+
+            static vec3f s_bv_corners[] = {vec3f(0.0f, 0.0f, 0.0f),
+
+                                           vec3f(1.0f, 0.0f, 0.0f), vec3f(0.0f, 1.0f, 0.0f), vec3f(0.0f, 0.0f, 1.0f),
+
+                                           vec3f(1.0f, 1.0f, 0.0f), vec3f(0.0f, 1.0f, 1.0f), vec3f(1.0f, 0.0f, 1.0f),
+
+                                           vec3f(1.0f, 1.0f, 1.0f)};
+
+            // transform local extents by the world matrix, before children are merged in
+            void update_entity_bounds(ecs_scene* scene, u32 n)
+            {
+                vec3f min = scene->bounding_volumes[n].min_extents;
+                vec3f max = scene->bounding_volumes[n].max_extents - min;
+
+                vec3f& tmin = scene->bounding_volumes[n].transformed_min_extents;
+                vec3f& tmax = scene->bounding_volumes[n].transformed_max_extents;
+
+                if (scene->entities[n] & e_cmp::bone)
+                {
+                    tmin = tmax = scene->world_matrices[n].get_translation();
+                    return;
+                }
+
+                tmax = -vec3f::flt_max();
+                tmin = vec3f::flt_max();
+
+                for (s32 c = 0; c < 8; ++c)
+                {
+                    vec3f p = scene->world_matrices[n].transform_vector(min + max * s_bv_corners[c]);
+
+                    tmax = max_union(tmax, p);
+                    tmin = min_union(tmin, p);
+                }
+
+                f32& trad = scene->bounding_volumes[n].radius;
+                trad = mag(tmax - tmin) * 0.5f;
+
+                // pos extent for faster aabb and sphere culling
+                auto& pe = scene->pos_extent[n];
+                pe.pos.xyz = tmin + (tmax - tmin) * 0.5f;
+                pe.extent.xyz = tmax - pe.pos.xyz;
+                pe.extent.w = trad;
+            }
+
+            // local matrix, world matrix and transformed bounds of a single entity,
+            // physics commands are issued before this is called so it is safe to run from any thread
+            void update_entity_transform(ecs_scene* scene, u32 n)
+            {
+                bool update_world = true;
+
+                // controlled transform
+                if (scene->entities[n] & e_cmp::transform)
+                {
+                    cmp_transform& t = scene->transforms[n];
+
+                    // generate matrix from transform
+                    mat4 rot_mat;
+                    t.rotation.get_matrix(rot_mat);
+
+                    mat4 translation_mat = mat::create_translation(t.translation);
+
+                    mat4 scale_mat = mat::create_scale(t.scale);
+
+                    scene->local_matrices[n] = translation_mat * rot_mat * scale_mat;
+
+                    // local matrix will be baked
+                    scene->entities[n] &= ~e_cmp::transform;
+                }
+                else if (scene->entities[n] & e_cmp::physics)
+                {
+                    if (physics::has_rb_matrix(n))
+                    {
+                        cmp_transform& t = scene->transforms[n];
+                        cmp_transform& pt = scene->physics_offset[n];
+
+                        mat4 scale_mat = mat::create_scale(t.scale);
+
+                        vec3f os = t.scale;
+                        t = physics::get_rb_transform(scene->physics_handles[n]);
+                        t.scale = os;
+
+                        mat4 rot_mat;
+                        t.rotation.get_matrix(rot_mat);
+
+                        mat4 translation_mat = mat::create_translation(t.translation - pt.translation);
+
+                        scene->local_matrices[n] = translation_mat * rot_mat * scale_mat;
+                    }
+                    else
+                    {
+                        update_world = false;
+                    }
+                }
+
+                // heirarchical scene transform
+                if (update_world)
+                {
+                    u32 parent = scene->parents[n];
+                    if (parent == n)
+                        scene->world_matrices[n] = scene->local_matrices[n];
+                    else
+                        scene->world_matrices[n] = scene->world_matrices[parent] * scene->local_matrices[n];
+                }
+
+                update_entity_bounds(scene, n);
+            }
+
+            // bucket dirty entities by depth in the dirty hierarchy
+            void build_transform_levels(transform_context& ctx, ecs_scene* scene)
+            {
+                // depth of each entity, parents always precede children in the soa
+                u32 num_levels = 0;
+                for (u32 i = 0; i < ctx.num_dirty; ++i)
+                {
+                    u32 n = ctx.dirty[i];
+                    u32 p = scene->parents[n];
+
+                    if (p != n && (scene->state_flags[p] & e_state::transform_dirty))
+                        ctx.depth[n] = ctx.depth[p] + 1;
+                    else
+                        ctx.depth[n] = 0;
+
+                    num_levels = std::max<u32>(num_levels, ctx.depth[n] + 1);
+                }
+
+                // counting sort by depth, keeps soa order within a level
+                sb_clear(ctx.level_offsets);
+                for (u32 l = 0; l < num_levels + 1; ++l)
+                    sb_push(ctx.level_offsets, 0);
+
+                for (u32 i = 0; i < ctx.num_dirty; ++i)
+                    ctx.level_offsets[ctx.depth[ctx.dirty[i]] + 1]++;
+
+                for (u32 l = 0; l < num_levels; ++l)
+                    ctx.level_offsets[l + 1] += ctx.level_offsets[l];
+
+                // scatter into the sorted list
+                u32* cursor = nullptr;
+                for (u32 l = 0; l < num_levels; ++l)
+                    sb_push(cursor, ctx.level_offsets[l]);
+
+                for (u32 i = 0; i < ctx.num_dirty; ++i)
+                {
+                    u32 n = ctx.dirty[i];
+                    ctx.sorted[cursor[ctx.depth[n]]++] = n;
+                }
+
+                sb_free(cursor);
+
+                ctx.num_levels = num_levels;
+            }
+
+            void update_transform_range(void* user_data, u32 start, u32 end, u32 thread_index)
+            {
+                transform_context* ctx = (transform_context*)user_data;
+
+                u32* level = &ctx->sorted[ctx->level_start];
+                for (u32 i = start; i < end; ++i)
+                    update_entity_transform(ctx->scene, level[i]);
+            }
+
+            // physics commands are not thread safe so are issued in order here, while gathering dirty entities
+            bool gather_dirty_transforms(transform_context& ctx, ecs_scene* scene)
+            {
+                u32 ne = (u32)scene->num_entities;
+
+                if (ctx.capacity < ne)
+                {
+                    ctx.capacity = scene->soa_size;
+                    ctx.depth = (u32*)pen::memory_realloc(ctx.depth, sizeof(u32) * ctx.capacity);
+                    ctx.sorted = (u32*)pen::memory_realloc(ctx.sorted, sizeof(u32) * ctx.capacity);
+                    ctx.dirty = (u32*)pen::memory_realloc(ctx.dirty, sizeof(u32) * ctx.capacity);
+                    ctx.ancestors = (u32*)pen::memory_realloc(ctx.ancestors, sizeof(u32) * ctx.capacity);
+                }
+
+                bool invalidate = scene->flags & e_scene_flags::invalidate_transforms;
+                scene->flags &= ~e_scene_flags::invalidate_transforms;
+
+                bool ordered = true;
+                bool geometry_dirty = invalidate;
+                ctx.num_dirty = 0;
+                ctx.num_ancestors = 0;
+
+                for (u32 n = 0; n < ne; ++n)
+                {
+                    u64& sf = scene->state_flags[n];
+
+                    // force physics entity to sync and ignore controlled transform
+                    if (sf & e_state::sync_physics_transform)
+                    {
+                        sf &= ~e_state::sync_physics_transform;
+                        scene->entities[n] &= ~e_cmp::transform;
+                    }
+
+                    bool dirty = invalidate || (sf & e_state::transform_dirty);
+
+                    if (scene->entities[n] & e_cmp::transform)
+                    {
+                        dirty = true;
+
+                        if (scene->entities[n] & e_cmp::physics)
+                        {
+                            if (scene->physics_data[n].type == e_physics_type::rigid_body)
+                            {
+                                cmp_transform& t = scene->transforms[n];
+                                cmp_transform& pt = scene->physics_offset[n];
+                                physics::set_transform(scene->physics_handles[n], t.translation + pt.translation,
+                                                       t.rotation);
+                                physics::set_v3(scene->physics_handles[n], vec3f::zero(),
+                                                physics::e_cmd::set_angular_velocity);
+                                physics::set_v3(scene->physics_handles[n], vec3f::zero(),
+                                                physics::e_cmd::set_linear_velocity);
+                            }
+                        }
+                    }
+                    else if (!dirty && (scene->entities[n] & e_cmp::physics))
+                    {
+                        // only sync bodies which have moved
+                        if (physics::has_rb_matrix(n))
+                        {
+                            const cmp_transform& t = scene->transforms[n];
+                            cmp_transform        rbt = physics::get_rb_transform(scene->physics_handles[n]);
+
+                            if (memcmp(&t.translation, &rbt.translation, sizeof(vec3f)) != 0 ||
+                                memcmp(&t.rotation, &rbt.rotation, sizeof(quat)) != 0)
+                                dirty = true;
+                        }
+                    }
+
+                    // propagate to descendants
+                    u32 p = scene->parents[n];
+                    if (p > n)
+                        ordered = false;
+                    else if (p != n && (scene->state_flags[p] & e_state::transform_dirty))
+                        dirty = true;
+
+                    if (!dirty)
+                        continue;
+
+                    sf |= e_state::transform_dirty | e_state::extents_dirty;
+                    ctx.dirty[ctx.num_dirty++] = n;
+
+                    if (scene->entities[n] & e_cmp::geometry)
+                        geometry_dirty = true;
+
+                    // ancestors need their extents re-expanding
+                    u32 c = n;
+                    while (p != c && !(scene->state_flags[p] & e_state::extents_dirty))
+                    {
+                        scene->state_flags[p] |= e_state::extents_dirty;
+                        ctx.ancestors[ctx.num_ancestors++] = p;
+                        c = p;
+                        p = scene->parents[p];
+                    }
+                }
+
+                // out of order hierarchies can only be updated with a full serial walk
+                if (!ordered)
+                {
+                    for (u32 i = 0; i < ctx.num_dirty; ++i)
+                        scene->state_flags[ctx.dirty[i]] &= ~(e_state::transform_dirty | e_state::extents_dirty);
+
+                    for (u32 i = 0; i < ctx.num_ancestors; ++i)
+                        scene->state_flags[ctx.ancestors[i]] &= ~e_state::extents_dirty;
+
+                    ctx.num_ancestors = 0;
+                    ctx.num_dirty = ne;
+
+                    for (u32 n = 0; n < ne; ++n)
+                    {
+                        scene->state_flags[n] |= e_state::transform_dirty | e_state::extents_dirty;
+                        ctx.dirty[n] = n;
+                    }
+
+                    geometry_dirty = true;
+                }
+
+                ctx.scene = scene;
+                ctx.ordered = ordered;
+                return geometry_dirty;
+            }
+        } // namespace
+
+        void update_transforms(ecs_scene* scene)
+        {
+            transform_context& ctx = s_transform_ctx;
+
+            bool geometry_dirty = gather_dirty_transforms(ctx, scene);
+
+            // world matrices and bounds of dirty entities
+            if (ctx.ordered && ctx.num_dirty >= k_parallel_transform_threshold && pen::tasks_num_threads() > 1)
+            {
+                build_transform_levels(ctx, scene);
+
+                // each level must complete before its children can read the parent world matrices
+                for (u32 l = 0; l < ctx.num_levels; ++l)
+                {
+                    pen::task_counter counter;
+                    ctx.level_start = ctx.level_offsets[l];
+                    pen::tasks_parallel_for(ctx.level_offsets[l + 1] - ctx.level_start, k_transform_grain_size,
+                                            update_transform_range, &ctx, &counter);
+                    pen::tasks_wait(&counter);
+                }
+            }
+            else
+            {
+                // serial fallback, dirty list is in soa order so parents are updated before children
+                for (u32 i = 0; i < ctx.num_dirty; ++i)
+                    update_entity_transform(scene, ctx.dirty[i]);
+            }
+
+            // ancestors of dirty entities have not moved, but need their extents resetting before expanding
+            for (u32 i = 0; i < ctx.num_ancestors; ++i)
+                update_entity_bounds(scene, ctx.ancestors[i]);
+
+            if (geometry_dirty)
+            {
+                scene->renderable_extents.min = vec3f::flt_max();
+                scene->renderable_extents.max = -vec3f::flt_max();
+
+                for (size_t n = 0; n < scene->num_entities; ++n)
+                {
+                    if (!(scene->entities[n] & e_cmp::geometry))
+                        continue;
+
+                    const cmp_pos_extent& pe = scene->pos_extent[n];
+                    scene->renderable_extents.min = min_union(pe.pos.xyz - pe.extent.xyz, scene->renderable_extents.min);
+                    scene->renderable_extents.max = max_union(pe.pos.xyz + pe.extent.xyz, scene->renderable_extents.max);
+                }
+            }
+
+            if (ctx.num_dirty == 0)
+                return;
+
+            // reverse iterate over scene and expand parents extents by children
+            for (intptr_t n = scene->num_entities - 1; n > 0; --n)
+            {
+                if (!(scene->entities[n] & e_cmp::allocated))
+                    continue;
+
+                u32 p = scene->parents[n];
+                if (p == n)
+                    continue;
+
+                if (!(scene->state_flags[p] & e_state::extents_dirty))
+                    continue;
+
+                vec3f& parent_tmin = scene->bounding_volumes[p].transformed_min_extents;
+                vec3f& parent_tmax = scene->bounding_volumes[p].transformed_max_extents;
+
+                vec3f& tmin = scene->bounding_volumes[n].transformed_min_extents;
+                vec3f& tmax = scene->bounding_volumes[n].transformed_max_extents;
+
+                if (scene->entities[p] & e_cmp::anim_controller)
+                {
+                    vec3f pad = vec3f(0.0f);
+
+                    parent_tmin = min_union(parent_tmin, tmin - pad);
+                    parent_tmax = max_union(parent_tmax, tmax + pad);
+                }
+                else
+                {
+                    parent_tmin = min_union(parent_tmin, tmin);
+                    parent_tmax = max_union(parent_tmax, tmax);
+                }
+            }
+        }
+
+        void clear_transforms_dirty(ecs_scene* scene)
+        {
+            transform_context& ctx = s_transform_ctx;
+            if (ctx.scene != scene)
+                return;
+
+            for (u32 i = 0; i < ctx.num_dirty; ++i)
+                scene->state_flags[ctx.dirty[i]] &= ~(e_state::transform_dirty | e_state::extents_dirty);
+
+            for (u32 i = 0; i < ctx.num_ancestors; ++i)
+                scene->state_flags[ctx.ancestors[i]] &= ~e_state::extents_dirty;
+
+            ctx.num_dirty = 0;
+            ctx.num_ancestors = 0;
+        }
+
+        struct spatial_cull_ctx
+        {
+            ecs_scene*    scene;
+            const camera* cams;
+            u32**         visible_out;
+        };
+
+        void spatial_cull_range(void* user_data, u32 start, u32 end, u32 thread_index)
+        {
+            spatial_cull_ctx* ctx = (spatial_cull_ctx*)user_data;
+            for (u32 i = start; i < end; ++i)
+                bvh_query_frustum(&ctx->scene->spatial, ctx->cams[i].camera_frustum, &ctx->visible_out[i]);
+        }
+
+        // keeps the bvh in sync with the renderables, entities whose bounds stay within their fat bounds cost a compare
+        void update_spatial_index(ecs_scene* scene, const u32* renderables)
+        {
+            if (!(scene->flags & e_scene_flags::spatial_index))
+            {
+                if (scene->spatial.num_leaves)
+                    bvh_clear(&scene->spatial);
+                return;
+            }
+
+            u32 n = sb_count(renderables);
+            for (u32 i = 0; i < n; ++i)
+            {
+                u32 e = renderables[i];
+                bvh_update(&scene->spatial, e, scene->pos_extent[e].pos.xyz, scene->pos_extent[e].extent.xyz);
+            }
+
+            bvh_remove_stale(&scene->spatial);
+        }
+
+        // shadow maps and omni shadow faces are culled together in a single sweep over the renderables
+        void cull_shadow_views(ecs_scene* scene)
+        {
+            static std::vector<camera> cams;
+            cams.clear();
+
+            free_visibility_lists(scene->shadow_visibility);
+            free_visibility_lists(scene->omni_shadow_visibility);
+
+            // in the same order as render_shadow_views and render_omni_shadow_views
+            u32 num_shadow_views = 0;
+            for (u32 n = 0; n < scene->num_entities; ++n)
+            {
+                if (!(scene->entities[n] & e_cmp::light))
+                    continue;
+
+                if (!(scene->lights[n].flags & (e_light_flags::shadow_map | e_light_flags::global_illumination)))
+                    continue;
+
+                camera cam;
+                shadow_camera_from_entity(cam, scene, n);
+                cams.push_back(cam);
+                ++num_shadow_views;
+            }
+
+            for (u32 n = 0; n < scene->num_entities; ++n)
+            {
+                if (!(scene->entities[n] & e_cmp::light))
+                    continue;
+
+                if (!(scene->lights[n].flags & e_light_flags::omni_shadow_map))
+                    continue;
+
+                camera cam;
+                cam.pos = scene->transforms[n].translation;
+                put::camera_create_cubemap(&cam, 0.1f, scene->lights[n].radius * 2.0f);
+
+                for (u32 f = 0; f < 6; ++f)
+                {
+                    put::camera_set_cubemap_face(&cam, f);
+                    put::camera_update_frustum(&cam);
+                    cams.push_back(cam);
+                }
+            }
+
+            u32 num_views = (u32)cams.size();
+            if (num_views == 0)
+                return;
+
+            u32** visibility = nullptr;
+            sb_add(visibility, num_views);
+            memset(visibility, 0x0, sizeof(u32*) * num_views);
+
+            if (scene->flags & e_scene_flags::spatial_index)
+            {
+                // each view walks the tree independently
+                spatial_cull_ctx ctx = {scene, cams.data(), visibility};
+
+                pen::task_counter counter;
+                pen::tasks_parallel_for(num_views, 1, spatial_cull_range, &ctx, &counter);
+                pen::tasks_wait(&counter);
+            }
+            else
+            {
+                frustum_cull_aabb_stream_multi(&scene->renderables, cams.data(), num_views, visibility);
+            }
+
+            for (u32 i = 0; i < num_views; ++i)
+            {
+                if (i < num_shadow_views)
+                    sb_push(scene->shadow_visibility, visibility[i]);
+                else
+                    sb_push(scene->omni_shadow_visibility, visibility[i]);
             }
+
+            sb_free(visibility);
         }
 
-        void update_scene(ecs_scene* scene, f32 dt)
+        namespace
         {
-            // static anim time to pass into draw calls etc..
-            f32 anim_time = pen::get_time_ms() / 1000.0f;
+            // bone matrices only change when a joint of the skin, or anything above it, moved this frame
+            bool skin_joints_dirty(ecs_scene* scene, u32 n)
+            {
+                const cmp_skin* skin = scene->geometries[n].p_skin;
 
-            u32 num_controllers = sb_count(scene->controllers);
-            u32 num_extensions = sb_count(scene->extensions);
+                u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
+                s32 joints_offset = ecs::get_index_from_ref(scene, rjr) + skin->bone_offset;
 
-            // pre update controllers
-            for (u32 c = 0; c < num_controllers; ++c)
-                if (scene->controllers[c].funcs.update_func)
-                    scene->controllers[c].funcs.update_func(scene->controllers[c], scene, dt);
+                for (u32 i = 0; i < skin->num_joints; ++i)
+                    if (scene->state_flags[joints_offset + i] & e_state::transform_dirty)
+                        return true;
 
-            if (scene->flags & e_scene_flags::pause_update)
-            {
-                physics::set_paused(1);
+                return false;
             }
-            else
+
+            void skin_bones(ecs_scene* scene, u32 n, mat4* bones, u32 num_bones)
             {
-                physics::set_paused(0);
-                update_animations(scene, dt);
-            }
+                const cmp_skin* skin = scene->geometries[n].p_skin;
 
-            // extension component update
-            for (u32 e = 0; e < num_extensions; ++e)
-                if (scene->extensions[e].funcs.update_func)
-                    scene->extensions[e].funcs.update_func(scene->extensions[e], scene, dt);
+                u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
+                s32 joints_offset = ecs::get_index_from_ref(scene, rjr) + skin->bone_offset;
 
-            static pen::timer* timer = pen::timer_create();
-            pen::timer_start(timer);
+                for (u32 i = 0; i < num_bones; ++i)
+                    bones[i] = scene->world_matrices[joints_offset + i] * skin->joint_bind_matrices[i];
+            }
 
-            // scene node transform
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            // packs the bones of every skin into one palette with a single upload, each skin's first bone is written to
+            // draw call user data z and sub geometry shares the bones of its parent
+            void update_bone_palette(ecs_scene* scene)
             {
-                // force physics entity to sync and ignore controlled transform
-                if (scene->state_flags[n] & e_state::sync_physics_transform)
-                {
-                    scene->state_flags[n] &= ~e_state::sync_physics_transform;
-                    scene->entities[n] &= ~e_cmp::transform;
-                }
+                u32  num_bones = 0;
+                bool dirty = false;
 
-                // controlled transform
-                if (scene->entities[n] & e_cmp::transform)
+                for (size_t n = 0; n < scene->num_entities; ++n)
                 {
-                    cmp_transform& t = scene->transforms[n];
+                    if (!(scene->entities[n] & (e_cmp::skinned | e_cmp::pre_skinned)))
+                        continue;
 
-                    // generate matrix from transform
-                    mat4 rot_mat;
-                    t.rotation.get_matrix(rot_mat);
+                    if (scene->entities[n] & e_cmp::sub_geometry)
+                    {
+                        scene->draw_call_data[n].v1.z = scene->draw_call_data[scene->parents[n]].v1.z;
+                        continue;
+                    }
 
-                    mat4 translation_mat = mat::create_translation(t.translation);
+                    const cmp_skin* skin = scene->geometries[n].p_skin;
+                    if (!skin)
+                        continue;
 
-                    mat4 scale_mat = mat::create_scale(t.scale);
+                    u32 required = num_bones + skin->num_joints;
+                    if (required > scene->bone_palette_capacity)
+                    {
+                        u32 capacity = std::max<u32>(required, scene->bone_palette_capacity * 2);
+                        scene->bone_palette = (mat4*)pen::memory_realloc(scene->bone_palette, sizeof(mat4) * capacity);
+                        scene->bone_palette_capacity = capacity;
 
-                    scene->local_matrices[n] = translation_mat * rot_mat * scale_mat;
+                        // gpu buffer is recreated at the new size below
+                        if (is_valid(scene->bone_palette_buffer))
+                            pen::renderer_release_buffer(scene->bone_palette_buffer);
+
+                        scene->bone_palette_buffer = PEN_INVALID_HANDLE;
+                    }
 
-                    if (scene->entities[n] & e_cmp::physics)
+                    // skins which have not moved keep their bones from the last frame, unless their offset changed
+                    f32 offset = (f32)num_bones;
+                    if (scene->draw_call_data[n].v1.z != offset || !is_valid(scene->bone_palette_buffer) ||
+                        skin_joints_dirty(scene, n))
                     {
-                        if (scene->physics_data[n].type == e_physics_type::rigid_body)
-                        {
-                            cmp_transform& pt = scene->physics_offset[n];
-                            physics::set_transform(scene->physics_handles[n], t.translation + pt.translation, t.rotation);
-                            physics::set_v3(scene->physics_handles[n], vec3f::zero(), physics::e_cmd::set_angular_velocity);
-                            physics::set_v3(scene->physics_handles[n], vec3f::zero(), physics::e_cmd::set_linear_velocity);
-                        }
+                        scene->draw_call_data[n].v1.z = offset;
+                        skin_bones(scene, n, &scene->bone_palette[num_bones], skin->num_joints);
+                        dirty = true;
                     }
 
-                    // local matrix will be baked
-                    scene->entities[n] &= ~e_cmp::transform;
+                    num_bones = required;
                 }
-                else if (scene->entities[n] & e_cmp::physics)
+
+                if (num_bones == 0)
+                    return;
+
+                if (!is_valid(scene->bone_palette_buffer))
+                {
+                    pen::buffer_creation_params bcp;
+                    bcp.usage_flags = PEN_USAGE_DYNAMIC;
+                    bcp.bind_flags = PEN_BIND_SHADER_RESOURCE;
+                    bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+                    bcp.buffer_size = sizeof(mat4) * scene->bone_palette_capacity;
+                    bcp.stride = sizeof(mat4);
+                    bcp.data = nullptr;
+
+                    scene->bone_palette_buffer = pen::renderer_create_buffer(bcp);
+                }
+
+                if (dirty)
+                    pen::renderer_update_buffer(scene->bone_palette_buffer, scene->bone_palette, sizeof(mat4) * num_bones);
+            }
+
+            // one constant buffer per skin, used when the bone palette is not supported
+            void update_bone_cbuffers(ecs_scene* scene)
+            {
+                static mat4 bb[k_max_cbuffer_joints];
+
+                for (size_t n = 0; n < scene->num_entities; ++n)
                 {
-                    if (!physics::has_rb_matrix(n))
+                    if (!(scene->entities[n] & (e_cmp::skinned | e_cmp::pre_skinned)))
                         continue;
 
-                    cmp_transform& t = scene->transforms[n];
-                    cmp_transform& pt = scene->physics_offset[n];
+                    // sub geom share bones with parent
+                    if (scene->entities[n] & e_cmp::sub_geometry)
+                    {
+                        scene->bone_cbuffer[n] = scene->bone_cbuffer[scene->parents[n]];
+                        continue;
+                    }
 
-                    mat4 scale_mat = mat::create_scale(t.scale);
+                    cmp_skin* skin = scene->geometries[n].p_skin;
+                    if (!skin)
+                        continue;
 
-                    vec3f os = t.scale;
-                    t = physics::get_rb_transform(scene->physics_handles[n]);
-                    t.scale = os;
+                    if (!is_valid_non_null(scene->bone_cbuffer[n]))
+                    {
+                        pen::buffer_creation_params bcp;
+                        bcp.usage_flags = PEN_USAGE_DYNAMIC;
+                        bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
+                        bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+                        bcp.buffer_size = sizeof(bb);
+                        bcp.data = nullptr;
 
-                    mat4 rot_mat;
-                    t.rotation.get_matrix(rot_mat);
+                        scene->bone_cbuffer[n] = pen::renderer_create_buffer(bcp);
 
-                    mat4 translation_mat = mat::create_translation(t.translation - pt.translation);
+                        // warn once when the skin is first set up
+                        if (skin->num_joints > k_max_cbuffer_joints)
+                            PEN_LOG("[warning] skin has %i joints, only %i are supported without a bone palette",
+                                    skin->num_joints, k_max_cbuffer_joints);
+                    }
+                    else if (!skin_joints_dirty(scene, n))
+                    {
+                        // pose and rig have not moved since the last upload
+                        continue;
+                    }
 
-                    scene->local_matrices[n] = translation_mat * rot_mat * scale_mat;
+                    skin_bones(scene, n, bb, std::min<u32>(skin->num_joints, k_max_cbuffer_joints));
+                    pen::renderer_update_buffer(scene->bone_cbuffer[n], bb, sizeof(bb));
                 }
-
-                // heirarchical scene transform
-                u32 parent = scene->parents[n];
-                if (parent == n)
-                    scene->world_matrices[n] = scene->local_matrices[n];
-                else
-                    scene->world_matrices[n] = scene->world_matrices[parent] * scene->local_matrices[n];
             }
 
-            // bounding volume transform
-            static vec3f corners[] = {vec3f(0.0f, 0.0f, 0.0f),
+            // skins pre skinned geometry into its vertex buffers with stream out, only when the bones have moved
+            void update_pre_skinned_geometry(ecs_scene* scene, bool bone_palette)
+            {
+                static u32 shader = pmfx::load_shader("forward_render");
+
+                static hash_id id_pre_skin[] = {
+                    PEN_HASH("pre_skin"),
+                    PEN_HASH("pre_skin_position")
+                };
 
-                                      vec3f(1.0f, 0.0f, 0.0f), vec3f(0.0f, 1.0f, 0.0f), vec3f(0.0f, 0.0f, 1.0f),
+                u32 permutation = bone_palette ? e_shader_permutation::bone_palette : 0;
 
-                                      vec3f(1.0f, 1.0f, 0.0f), vec3f(0.0f, 1.0f, 1.0f), vec3f(1.0f, 0.0f, 1.0f),
+                if (bone_palette)
+                    pen::renderer_set_structured_buffer(scene->bone_palette_buffer, k_bone_palette_unit,
+                                                        pen::SBUFFER_BIND_VS | pen::SBUFFER_BIND_READ);
 
-                                      vec3f(1.0f, 1.0f, 1.0f)};
+                for (size_t n = 0; n < scene->num_entities; ++n)
+                {
+                    if (!(scene->entities[n] & e_cmp::pre_skinned))
+                        continue;
 
-            scene->renderable_extents.min = vec3f::flt_max();
-            scene->renderable_extents.max = -vec3f::flt_max();
+                    // sub geom share bones with parent, skinned vertices from the last update are still valid
+                    u32 p = scene->entities[n] & e_cmp::sub_geometry ? scene->parents[n] : n;
+                    if (!skin_joints_dirty(scene, p))
+                        continue;
 
-            // transform extents by transform
-            for (size_t n = 0; n < scene->num_entities; ++n)
-            {
-                vec3f min = scene->bounding_volumes[n].min_extents;
-                vec3f max = scene->bounding_volumes[n].max_extents - min;
+                    cmp_geometry& geom = scene->geometries[n];
+                    cmp_geometry& pos_geom = scene->position_geometries[n];
 
-                vec3f& tmin = scene->bounding_volumes[n].transformed_min_extents;
-                vec3f& tmax = scene->bounding_volumes[n].transformed_max_extents;
+                    u32 pre_skin_target[2] = {
+                        geom.vertex_buffer,
+                        pos_geom.vertex_buffer
+                    };
 
-                if (scene->entities[n] & e_cmp::bone)
-                {
-                    tmin = tmax = scene->world_matrices[n].get_translation();
-                    continue;
-                }
+                    for (u32 b = 0; b < 2; ++b)
+                    {
+                        // set pre skin technique
+                        pmfx::set_technique_perm(shader, id_pre_skin[b], permutation);
 
-                tmax = -vec3f::flt_max();
-                tmin = vec3f::flt_max();
+                        // bind stream out targets
+                        cmp_pre_skin& pre_skin = scene->pre_skin[n];
+                        pen::renderer_set_stream_out_target(pre_skin_target[b]);
 
-                for (s32 c = 0; c < 8; ++c)
-                {
-                    vec3f p = scene->world_matrices[n].transform_vector(min + max * corners[c]);
+                        pen::renderer_set_vertex_buffer(pre_skin.vertex_buffer, 0, pre_skin.vertex_size, 0);
 
-                    tmax = max_union(tmax, p);
-                    tmin = min_union(tmin, p);
+                        // palette offset is in the draw call, otherwise the bones have their own cbuffer
+                        if (bone_palette)
+                            pen::renderer_set_constant_buffer(scene->cbuffer[n], 1, pen::CBUFFER_BIND_VS);
+                        else
+                            pen::renderer_set_constant_buffer(scene->bone_cbuffer[n], 2, pen::CBUFFER_BIND_VS);
+
+                        // render point list
+                        pen::renderer_draw(pre_skin.num_verts, 0, PEN_PT_POINTLIST);
+                        pen::renderer_set_stream_out_target(0);
+                    }
                 }
+            }
+        } // namespace
 
-                f32& trad = scene->bounding_volumes[n].radius;
-                trad = mag(tmax - tmin) * 0.5f;
+        void update_scene(ecs_scene* scene, f32 dt)
+        {
+            // static anim time to pass into draw calls etc..
+            f32 anim_time = pen::get_time_ms() / 1000.0f;
 
-                // pos extent for faster aabb and sphere culling
-                auto& pe = scene->pos_extent[n];
-                pe.pos.xyz = tmin + (tmax - tmin) * 0.5f;
-                pe.extent.xyz = tmax - pe.pos.xyz;
-                pe.extent.w = trad;
+            u32 num_controllers = sb_count(scene->controllers);
+            u32 num_extensions = sb_count(scene->extensions);
 
-                if (!(scene->entities[n] & e_cmp::geometry))
-                    continue;
+            // pre update controllers
+            for (u32 c = 0; c < num_controllers; ++c)
+                if (scene->controllers[c].funcs.update_func)
+                    scene->controllers[c].funcs.update_func(scene->controllers[c], scene, dt);
 
-                // also set scene extents
-                scene->renderable_extents.min = min_union(tmin, scene->renderable_extents.min);
-                scene->renderable_extents.max = max_union(tmax, scene->renderable_extents.max);
+            if (scene->flags & e_scene_flags::pause_update)
+            {
+                physics::set_paused(1);
             }
-
-            // reverse iterate over scene and expand parents extents by children
-            for (intptr_t n = scene->num_entities - 1; n > 0; --n)
+            else
             {
-                if (!(scene->entities[n] & e_cmp::allocated))
-                    continue;
+                physics::set_paused(0);
+                update_animations(scene, dt);
+            }
 
-                u32 p = scene->parents[n];
-                if (p == n)
-                    continue;
+            // extension component update
+            for (u32 e = 0; e < num_extensions; ++e)
+                if (scene->extensions[e].funcs.update_func)
+                    scene->extensions[e].funcs.update_func(scene->extensions[e], scene, dt);
 
-                vec3f& parent_tmin = scene->bounding_volumes[p].transformed_min_extents;
-                vec3f& parent_tmax = scene->bounding_volumes[p].transformed_max_extents;
+            static pen::timer* timer = pen::timer_create();
+            pen::timer_start(timer);
 
-                vec3f& tmin = scene->bounding_volumes[n].transformed_min_extents;
-                vec3f& tmax = scene->bounding_volumes[n].transformed_max_extents;
+            // scene node transform, world matrices and bounds of dirty entities
+            update_transforms(scene);
 
-                if (scene->entities[p] & e_cmp::anim_controller)
-                {
-                    vec3f pad = vec3f(0.0f);
+            // pack renderable bounds for culling each view
+            u32* filtered_entities = nullptr;
+            filter_entities_scalar(scene, &filtered_entities);
+            build_cull_stream(scene, filtered_entities, &scene->renderables);
+            update_spatial_index(scene, filtered_entities);
+            sb_free(filtered_entities);
 
-                    parent_tmin = min_union(parent_tmin, tmin - pad);
-                    parent_tmax = max_union(parent_tmax, tmax + pad);
-                }
-                else
-                {
-                    parent_tmin = min_union(parent_tmin, tmin);
-                    parent_tmax = max_union(parent_tmax, tmax);
-                }
-            }
+            cull_shadow_views(scene);
 
             // Forward light buffer
             static forward_light_buffer light_buffer;
@@ -1574,8 +2727,12 @@ namespace put
                     continue;
 
                 // update bv and transform
-                scene->bounding_volumes[n].min_extents = -vec3f(FLT_MAX);
-                scene->bounding_volumes[n].max_extents = vec3f(FLT_MAX);
+                if (scene->bounding_volumes[n].max_extents.x != FLT_MAX)
+                {
+                    scene->bounding_volumes[n].min_extents = -vec3f(FLT_MAX);
+                    scene->bounding_volumes[n].max_extents = vec3f(FLT_MAX);
+                    scene->flags |= e_scene_flags::invalidate_transforms;
+                }
 
                 if (num_lights >= e_scene_limits::max_forward_lights)
                     break;
@@ -1837,126 +2994,12 @@ namespace put
                 }
             }
 
-            // update pre skinned vertex buffers
-            for (size_t n = 0; n < scene->num_entities; ++n)
-            {
-                if (!(scene->entities[n] & e_cmp::pre_skinned))
-                    continue;
-                
-                u32 cbuffer = -1;
-                cmp_geometry& geom = scene->geometries[n];
-                cmp_geometry& pos_geom = scene->position_geometries[n];
-                
-                if(scene->entities[n] & e_cmp::sub_geometry)
-                {
-                    // sub geom share bones with parent
-                    u32 p = scene->parents[n];
-                    cbuffer = scene->geometries[p].p_skin->bone_cbuffer;
-                }
-                else
-                {
-                    // create bone cbuffer
-                    static mat4 bb[85];
-                    if (geom.p_skin->bone_cbuffer == PEN_INVALID_HANDLE)
-                    {
-                        pen::buffer_creation_params bcp;
-                        bcp.usage_flags = PEN_USAGE_DYNAMIC;
-                        bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
-                        bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
-                        bcp.buffer_size = sizeof(mat4) * 85;
-                        bcp.data = nullptr;
-
-                        geom.p_skin->bone_cbuffer = pen::renderer_create_buffer(bcp);
-                    }
-
-                    // update bone cbuffer
-                    u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
-                    s32 joints_offset = ecs::get_index_from_ref(scene, rjr);
-                    joints_offset += geom.p_skin->bone_offset;
-                    
-                    for (u32 i = 0; i < geom.p_skin->num_joints; ++i)
-                        bb[i] = scene->world_matrices[joints_offset + i] * geom.p_skin->joint_bind_matrices[i];
-
-                    pen::renderer_update_buffer(geom.p_skin->bone_cbuffer, bb, sizeof(bb));
-                    
-                    cbuffer = geom.p_skin->bone_cbuffer;
-                }
-                
-                // bind shaders, skin position and full vertex buffer
-                static u32 shader = pmfx::load_shader("forward_render");
-            
-                static hash_id id_pre_skin[] = {
-                    PEN_HASH("pre_skin"),
-                    PEN_HASH("pre_skin_position")
-                };
-                
-                u32 pre_skin_target[2] = {
-                    geom.vertex_buffer,
-                    pos_geom.vertex_buffer
-                };
-
-                for(u32 b = 0; b < 2; ++b)
-                {
-                    // set pre skin technique
-                    pmfx::set_technique_perm(shader, id_pre_skin[b]);
-                    
-                    // bind stream out targets
-                    cmp_pre_skin& pre_skin = scene->pre_skin[n];
-                    pen::renderer_set_stream_out_target(pre_skin_target[b]);
-                    
-                    pen::renderer_set_vertex_buffer(pre_skin.vertex_buffer, 0, pre_skin.vertex_size, 0);
-                    pen::renderer_set_constant_buffer(cbuffer, 2, pen::CBUFFER_BIND_VS);
-
-                    // render point list
-                    pen::renderer_draw(pre_skin.num_verts, 0, PEN_PT_POINTLIST);
-                    pen::renderer_set_stream_out_target(0);
-                }
-            }
-            
-            // update skinning buffers
-            for (size_t n = 0; n < scene->num_entities; ++n)
-            {
-                if (scene->entities[n] & e_cmp::pre_skinned)
-                    continue;
-                    
-                if (scene->entities[n] & e_cmp::skinned)
-                {
-                    // sub geom share bones with parent
-                    if(scene->entities[n] & e_cmp::sub_geometry)
-                    {
-                        u32 p = scene->parents[n];
-                        scene->bone_cbuffer[n] = scene->bone_cbuffer[p];
-                        continue;
-                    }
-                    
-                    static mat4 bb[85];
-                    cmp_geometry* p_geom = &scene->geometries[n];
-                    if (!scene->bone_cbuffer[n])
-                    {
-                        pen::buffer_creation_params bcp;
-                        bcp.usage_flags = PEN_USAGE_DYNAMIC;
-                        bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
-                        bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
-                        bcp.buffer_size = sizeof(mat4) * 85;
-                        bcp.data = nullptr;
-
-                        scene->bone_cbuffer[n] = pen::renderer_create_buffer(bcp);
-                    }
-                    
-                    u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
-                    s32 joints_offset = ecs::get_index_from_ref(scene, rjr);
-                    joints_offset += p_geom->p_skin->bone_offset;
-                    
-                    for (u32 i = 0; i < p_geom->p_skin->num_joints; ++i)
-                    {
-                        mat4& joint_matrix = scene->world_matrices[joints_offset + i];
-                        mat4& bind_matrix = p_geom->p_skin->joint_bind_matrices[i];
-                        bb[i] = joint_matrix * bind_matrix;
-                    }
-
-                    pen::renderer_update_buffer(scene->bone_cbuffer[n], bb, sizeof(bb));
-                }
-            }
+            // bone palettes, offsets are written to the draw call data uploaded below
+            bool bone_palette = pen::renderer_get_info().caps & PEN_CAPS_STRUCTURED_BUFFER;
+            if (bone_palette)
+                update_bone_palette(scene);
+            else
+                update_bone_cbuffers(scene);
 
             // update draw call data
             for (size_t n = 0; n < scene->num_entities; ++n)
@@ -2014,6 +3057,8 @@ namespace put
                 n += scene->master_instances[n].num_instances;
             }
 
+            update_pre_skinned_geometry(scene, bone_palette);
+
             // update physics running 1 frame behind to allow the sets to take effect
             physics::step(dt);
             physics::physics_consume_command_buffer();
@@ -2023,6 +3068,9 @@ namespace put
                 if (scene->controllers[c].funcs.post_update_func)
                     scene->controllers[c].funcs.post_update_func(scene->controllers[c], scene, dt);
 
+            // dirty state is visible to everything in this update, reset for the next
+            clear_transforms_dirty(scene);
+
             f64 elapsed = pen::timer_elapsed_ms(timer);
             PEN_UNUSED(elapsed);
             // PEN_LOG("scene update: %f(ms)", elapsed);
@@ -2349,7 +3397,7 @@ namespace put
 
         void load_scene(const c8* filename, ecs_scene* scene, bool merge)
         {
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
             bool      error = false;
             const c8* wd = pen::os_get_user_info().working_directory;
             Str       project_dir = dev_ui::get_program_preference_filename("project_dir", wd);
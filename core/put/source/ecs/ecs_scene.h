@@ -5,6 +5,8 @@
 #pragma once
 
 #include "camera.h"
+#include "ecs/ecs_anim.h"
+#include "ecs/ecs_bvh.h"
 #include "loader.h"
 #include "physics/physics.h"
 #include "pmfx.h"
@@ -61,7 +63,9 @@ namespace put
             {
                 none = 0,
                 invalidate_scene_tree = 1 << 1,
-                pause_update = 1 << 2
+                pause_update = 1 << 2,
+                invalidate_transforms = 1 << 3, // forces all world matrices and extents to update
+                spatial_index = 1 << 4          // maintain a bvh of renderables and use it for culling and picking
             };
         }
         typedef u32 scene_flags;
@@ -78,6 +82,8 @@ namespace put
                 samplers_initialised = (1 << 5),
                 apply_anim_transform = (1 << 6),
                 sync_physics_transform = (1 << 7),
+                transform_dirty = (1 << 8), // world matrix and extents update this frame, propagates to children
+                extents_dirty = (1 << 9),   // extents re-expand by children this frame, propagates to parents
                 alpha_blended = (1 << 0)
             };
         }
@@ -189,13 +195,18 @@ namespace put
             mat4  world_matrix_inv_transpose;
         };
 
+        // bones per skin when the renderer can not bind the bone palette as a structured buffer
+        static const u32 k_max_cbuffer_joints = 85;
+
+        // structured buffer unit the bone palette is bound to, user data z of a skinned draw call is its first bone
+        static const u32 k_bone_palette_unit = 16;
+
         struct cmp_skin
         {
-            u32  num_joints;
-            mat4 bind_shape_matrix;
-            mat4 joint_bind_matrices[85];
-            u32  bone_cbuffer = PEN_INVALID_HANDLE;
-            u32  bone_offset = 0;
+            u32   num_joints;
+            mat4  bind_shape_matrix;
+            mat4* joint_bind_matrices = nullptr; // num_joints
+            u32   bone_offset = 0;
         };
 
         // contains handles and data to re-create a material from scratch
@@ -266,6 +277,20 @@ namespace put
             vec3f max;
         };
 
+        // soa copy of renderable entity pos_extent, arrays are 64 byte aligned and padded to 16 for wide simd culling
+        struct cull_stream
+        {
+            f32* pos_x = nullptr;
+            f32* pos_y = nullptr;
+            f32* pos_z = nullptr;
+            f32* extent_x = nullptr;
+            f32* extent_y = nullptr;
+            f32* extent_z = nullptr;
+            u32* entities = nullptr;
+            u32  count = 0;
+            u32  capacity = 0;
+        };
+
         struct cmp_geometry
         {
             u32       position_buffer; // 
@@ -301,6 +326,24 @@ namespace put
             f32 ratio = 0.0f;
         };
 
+        // lods are chosen by the screen coverage of the controller, the ratio of its bounding radius to the half height of
+        // the view at its distance. far lods sample less often and interpolate between samples, joints deeper than
+        // max_joint_depth below the root joint keep their last transform.
+        static const u32 k_num_anim_lods = 4;
+        static const u32 k_all_joints = -1;
+
+        struct anim_lod
+        {
+            f32 min_coverage;
+            u32 update_rate; // frames per sample
+            u32 max_joint_depth;
+        };
+
+        // components are zeroed rather than constructed, instantiate_anim_controller_v2 copies these in
+        static const anim_lod k_default_anim_lods[k_num_anim_lods] = {
+            {0.25f, 1, k_all_joints}, {0.1f, 2, k_all_joints}, {0.03f, 4, 8}, {0.0f, 8, 5}};
+        static const anim_lod k_full_anim_lod = {0.0f, 1, k_all_joints}; // used when lod is disabled
+
         struct cmp_anim_controller_v2
         {
             anim_instance* anim_instances = nullptr;
@@ -311,6 +354,17 @@ namespace put
             anim_blend     blend = {};
             ecs_ref        root_joint_ref = -1;
             f32            playback_rate = 1.0f;
+            bool           lod_enabled = true;
+            anim_lod       lods[k_num_anim_lods];
+
+            // lod state
+            u32       lod = 0;
+            u32       lod_period = 0; // update rate of the last sample
+            u32       lod_step = 0;   // frames since the last sample
+            anim_pose lod_prev;       // outputs of the last two samples, which are interpolated between
+            anim_pose lod_next;
+            vec3f     lod_root_motion = vec3f::zero(); // per frame
+            u8*       joint_depth = nullptr;           // per joint depth below the root joint
         };
 
         struct cmp_light
@@ -530,10 +584,17 @@ namespace put
             u32              area_light_buffer = PEN_INVALID_HANDLE;
             u32              shadow_map_buffer = PEN_INVALID_HANDLE;
             u32              gi_volume_buffer = PEN_INVALID_HANDLE;
+            u32              bone_palette_buffer = PEN_INVALID_HANDLE; // bones of every skin, updated once per frame
+            u32              bone_palette_capacity = 0;                // bones
+            mat4*            bone_palette = nullptr;
             s32              selected_index = -1;
             scene_flags      flags = 0;
             scene_view_flags view_flags = 0;
             extents          renderable_extents;
+            cull_stream      renderables;
+            bvh              spatial;                          // only maintained with e_scene_flags::spatial_index
+            u32**            shadow_visibility = nullptr;      // entities visible to each shadow map, culled in update_scene
+            u32**            omni_shadow_visibility = nullptr; // entities visible to each omni shadow face, light * 6 + face
             extents          shadow_extent_constraints = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
             u32*             selection_list = nullptr;
             u32              version = k_version;
@@ -131,7 +131,7 @@ namespace put
 
             //fully update free list
             initialise_free_list(scene);
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
         }
 
         void get_new_entities_append(ecs_scene* scene, s32 num, s32& start, s32& end)
@@ -165,6 +165,7 @@ namespace put
             }
 
             scene->num_entities = end;
+            scene->flags |= e_scene_flags::invalidate_transforms;
         }
 
         void get_new_entities_contiguous(ecs_scene* scene, s32 num, s32& start, s32& end)
@@ -221,6 +222,7 @@ namespace put
                 }
 
                 scene->num_entities = std::max<u32>(end, scene->num_entities);
+                scene->flags |= e_scene_flags::invalidate_transforms;
             }
         }
 
@@ -245,7 +247,7 @@ namespace put
 
             u32 i = ii;
 
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
 
             scene->num_entities = std::max<u32>(i + 1, scene->num_entities);
 
@@ -395,6 +397,7 @@ namespace put
             mat4 parent_mat = scene->world_matrices[parent];
 
             scene->local_matrices[child] = mat::inverse4x4(parent_mat) * scene->local_matrices[child];
+            scene->flags |= e_scene_flags::invalidate_transforms;
         }
 
         // set parent and also swap nodes to maintain valid heirarchy
@@ -486,7 +489,7 @@ namespace put
                 // pen::renderer_consume_cmd_buffer();
             }
 
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_transforms;
         }
 
         void instance_entity_range(ecs_scene* scene, u32 master_node, u32 num_nodes)
@@ -562,6 +565,13 @@ namespace put
                     return;
                 }
 
+                // geometry loaded from pmm only keeps position data on the cpu
+                if (!r.cpu_vertex_buffer || !r.cpu_index_buffer)
+                {
+                    dev_console_log("[error] can't bake vertex buffer without cpu vertex data.");
+                    return;
+                }
+
                 vertex_size = r.vertex_size;
                 num_vertices += r.num_vertices;
                 num_indices += r.num_indices;
@@ -690,21 +700,25 @@ namespace put
         {
             animation_resource* anim = get_animation_resource(anim_handle);
             anim_instance       anim_instance;
-            anim_instance.soa = anim->soa;
+            anim_instance.clip = anim->clip;
             anim_instance.length = anim->length;
 
+            // sampling cursors start at the first key
+            for (u32 t = 0; t < anim->clip.num_tracks; ++t)
+                sb_push(anim_instance.cursors, 0);
+
             cmp_anim_controller_v2& controller = scene->anim_controller_v2[node_index];
             u32 root = ecs::get_index_from_ref(scene, controller.root_joint_ref);
 
             // initialise anim with starting transform
             u32 num_joints = sb_count(controller.joint_indices);
+            resize_anim_pose(anim_instance.pose, num_joints);
             for (u32 j = 0; j < num_joints; ++j)
             {
                 u32 jnode = controller.joint_indices[j] + root;
 
-                // create space for trans quat scale
                 const cmp_transform& t = scene->initial_transform[jnode];
-                sb_push(anim_instance.joints, t);
+                set_anim_pose_joint(anim_instance.pose, j, t.translation, t.rotation, t.scale);
 
                 // create anim target txyz, rxyz, sxyz
                 anim_target at;
@@ -727,7 +741,7 @@ namespace put
             {
                 anim_sampler sampler;
                 sampler.joint = PEN_INVALID_HANDLE;
-                sampler.pos = 0;
+                sampler.flags = 0;
 
                 // find bone for channel
                 for (u32 j = 0; j < num_joints; ++j)
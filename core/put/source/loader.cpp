@@ -17,8 +17,10 @@
 #include "renderer.h"
 #include "str/Str.h"
 #include "str_utilities.h"
+#include "threads.h"
 #include "timer.h"
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -158,6 +160,31 @@ namespace
     // static vars
     std::vector<file_watch*>       k_file_watches;
     std::vector<texture_reference> k_texture_references;
+    pen::hash_map<hash_id, u32>    k_texture_lookup;        // id_name -> index into k_texture_references
+    pen::hash_map<u32, u32>        k_texture_handle_lookup; // handle -> index into k_texture_references
+
+    texture_reference* find_texture_reference(hash_id id_name)
+    {
+        u32* i = k_texture_lookup.find(id_name);
+        return i ? &k_texture_references[*i] : nullptr;
+    }
+
+    texture_reference* find_texture_reference_by_handle(u32 handle)
+    {
+        u32* i = k_texture_handle_lookup.find(handle);
+        return i ? &k_texture_references[*i] : nullptr;
+    }
+
+    void add_texture_reference(const texture_reference& tr)
+    {
+        u32 index = (u32)k_texture_references.size();
+        k_texture_references.push_back(tr);
+
+        // failed loads share handle 0, keep the first
+        k_texture_lookup.insert(tr.id_name, index);
+        if (!k_texture_handle_lookup.find(tr.handle))
+            k_texture_handle_lookup.insert(tr.handle, index);
+    }
 
     u32 calc_level_size(u32 width, u32 height, bool compressed, u32 block_size)
     {
@@ -301,21 +328,10 @@ namespace
         return pf;
     }
 
-    u32 load_texture_internal(const c8* filename, hash_id hh, pen::texture_creation_params& tcp)
+    // parses dds file data into tcp, tcp.data points into file_data so it must outlive texture creation.
+    // touches no shared state so it can run on any thread
+    void decode_dds(void* file_data, pen::texture_creation_params& tcp)
     {
-        // load a texture file from disk.
-        void* file_data = nullptr;
-        u32   file_data_size = 0;
-
-        u32 pen_err = pen::filesystem_read_file_to_buffer(filename, &file_data, file_data_size);
-
-        if (pen_err != PEN_ERR_OK)
-        {
-            dev_console_log_level(dev_ui::console_level::error, "[error] texture - unabled to find file: %s", filename);
-            pen::memory_free(file_data);
-            return 0;
-        }
-
         // parse dds header
         dds_header* ddsh = (dds_header*)file_data;
 
@@ -394,18 +410,29 @@ namespace
             tcp.data_size += data_size + ext_data_size;
         }
 
-        // allocate mem and copy
-        tcp.data = pen::memory_alloc(tcp.data_size);
+        // point straight at the image data, the renderer copies it on create
+        tcp.data = top_image_start;
+    }
+
+    u32 load_texture_internal(const c8* filename, hash_id hh, pen::texture_creation_params& tcp)
+    {
+        // map a texture file from disk.
+        pen::file_view view;
+        u32            pen_err = pen::filesystem_map_file(filename, view);
 
-        // copy texture data into the tcp storage
-        memcpy(tcp.data, top_image_start, tcp.data_size);
+        if (pen_err != PEN_ERR_OK || view.size == 0)
+        {
+            dev_console_log_level(dev_ui::console_level::error, "[error] texture - unabled to find file: %s", filename);
+            return 0;
+        }
 
-        // free the files contents
-        pen::memory_free(file_data);
+        decode_dds(view.data, tcp);
 
         u32 texture_index = pen::renderer_create_texture(tcp);
 
-        pen::memory_free(tcp.data);
+        // image data is copied into the command buffer, so the file can go
+        pen::filesystem_unmap_file(view);
+        tcp.data = nullptr;
 
         return texture_index;
     }
@@ -430,6 +457,157 @@ namespace
 
     pen::ring_buffer<hot_loader_cmd> s_hot_loader_cmd_buffer;
 
+    // file watching, inputs are looked up by path hash when the os reports a change
+    struct watched_input
+    {
+        file_watch* fw;
+        Str         filename;
+        hash_id     id_data_file;
+        s32         next; // next input with the same path, or -1
+    };
+
+    pen::file_watcher*           s_file_watcher = nullptr;
+    pen::ring_buffer<hash_id>    s_changed_files; // written by the hot loader thread, read in poll_hot_loader
+    a_bool                       s_changed_files_overflow;
+    std::vector<watched_input>   s_watched_inputs;
+    pen::hash_map<hash_id, s32>  s_watched_input_lookup; // path hash -> first index into s_watched_inputs
+    pen::hash_map<hash_id, bool> s_watched_dirs;
+    std::vector<hash_id>         s_deferred_changes; // changes to watches which are mid rebuild
+
+    void on_file_changed(const c8* path, void* user_data)
+    {
+        // null path means events were dropped, fall back to a full scan
+        u32 pp = s_changed_files.put_pos;
+        if (!path || (pp + 1) % s_changed_files._capacity == s_changed_files.get_pos)
+        {
+            s_changed_files_overflow = true;
+            return;
+        }
+
+        s_changed_files.put(PEN_HASH(path));
+    }
+
+    void watch_inputs(file_watch* fw)
+    {
+        if (!s_file_watcher)
+            return;
+
+        pen::json files = fw->dependencies["files"];
+        s32       num_files = files.size();
+        for (s32 i = 0; i < num_files; ++i)
+        {
+            pen::json outputs = files[i];
+            s32       num_inputs = outputs.size();
+            for (s32 j = 0; j < num_inputs; ++j)
+            {
+                Str     ifn = outputs[j]["name"].as_str();
+                hash_id id_input = PEN_HASH(ifn.c_str());
+
+                // skip inputs already registered to this watch
+                s32* head = s_watched_input_lookup.find(id_input);
+                s32  first = head ? *head : -1;
+                bool found = false;
+                for (s32 k = first; k != -1; k = s_watched_inputs[k].next)
+                    if (s_watched_inputs[k].fw == fw)
+                        found = true;
+
+                if (found)
+                    continue;
+
+                watched_input wi;
+                wi.fw = fw;
+                wi.filename = ifn;
+                wi.id_data_file = PEN_HASH(outputs[j]["data_file"].as_str().c_str());
+                wi.next = first;
+
+                s_watched_input_lookup.insert(id_input, (s32)s_watched_inputs.size());
+                s_watched_inputs.push_back(wi);
+
+                s32 loc = pen::str_find_reverse(ifn, "/");
+                if (loc <= 0)
+                    continue;
+
+                Str     dir = pen::str_substr(ifn, 0, loc);
+                hash_id id_dir = PEN_HASH(dir.c_str());
+                if (s_watched_dirs.find(id_dir))
+                    continue;
+
+                if (!pen::filesystem_watch_directory(s_file_watcher, dir.c_str()))
+                    dev_console_log_level(dev_ui::console_level::warning, "[file watcher] unable to watch %s", dir.c_str());
+
+                s_watched_dirs.insert(id_dir, true);
+            }
+        }
+    }
+
+    // compares an input against the dependency file and kicks off a rebuild if it is newer
+    void check_input(file_watch* fw, const Str& ifn, hash_id id_data_file)
+    {
+        u32 current_ts = 0;
+        Str fn = pen::os_path_for_resource(fw->filename.c_str());
+        if (pen::filesystem_getmtime(fn.c_str(), current_ts) != PEN_ERR_OK)
+            return;
+
+        u32 input_ts = 0;
+        if (pen::filesystem_getmtime(ifn.c_str(), input_ts) != PEN_ERR_OK)
+            return;
+
+        if (input_ts > current_ts)
+        {
+            dev_console_log("[file watcher] input file %s has changed", ifn.c_str());
+
+            fw->changes.push_back(id_data_file);
+            fw->rebuild_ts = input_ts;
+
+            fw->build_callback();
+            fw->invalidated = true;
+        }
+    }
+
+    void check_all_inputs()
+    {
+        for (auto* fw : k_file_watches)
+        {
+            if (fw->invalidated)
+                continue;
+
+            pen::json files = fw->dependencies["files"];
+            s32       num_files = files.size();
+            for (s32 i = 0; i < num_files && !fw->invalidated; ++i)
+            {
+                pen::json outputs = files[i];
+                s32       num_inputs = outputs.size();
+                for (s32 j = 0; j < num_inputs && !fw->invalidated; ++j)
+                {
+                    Str data_file = outputs[j]["data_file"].as_str();
+                    check_input(fw, outputs[j]["name"].as_str(), PEN_HASH(data_file.c_str()));
+                }
+            }
+        }
+    }
+
+    void check_changed_input(hash_id id_input, std::vector<hash_id>& deferred)
+    {
+        s32* head = s_watched_input_lookup.find(id_input);
+        if (!head)
+            return;
+
+        for (s32 k = *head; k != -1; k = s_watched_inputs[k].next)
+        {
+            watched_input& wi = s_watched_inputs[k];
+            if (wi.fw->invalidated)
+            {
+                // check again once the current rebuild completes
+                if (std::find(deferred.begin(), deferred.end(), id_input) == deferred.end())
+                    deferred.push_back(id_input);
+
+                continue;
+            }
+
+            check_input(wi.fw, wi.filename, wi.id_data_file);
+        }
+    }
+
     void* hot_loader_thread(void* params)
     {
         pen::job_thread_params* job_params = (pen::job_thread_params*)params;
@@ -464,8 +642,11 @@ namespace
             if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
                 break;
 
-            // plenty of sleep
-            pen::thread_sleep_ms(16);
+            // wait for file changes, or plenty of sleep when there is no os file watching
+            if (s_file_watcher)
+                pen::filesystem_read_watcher(s_file_watcher, 16, on_file_changed, nullptr);
+            else
+                pen::thread_sleep_ms(16);
         }
 
         pen::semaphore_post(p_thread_info->p_sem_continue, 1);
@@ -484,15 +665,187 @@ namespace
     {
         for (auto& d : dirty)
         {
-            for (auto& tr : k_texture_references)
+            texture_reference* tr = find_texture_reference(d);
+            if (!tr)
+                continue;
+
+            u32 new_handle = load_texture_internal(tr->filename.c_str(), tr->id_name, tr->tcp);
+            pen::renderer_replace_resource(tr->handle, new_handle, pen::RESOURCE_TEXTURE);
+        }
+    }
+
+    //
+    // Async loading
+    //
+
+    namespace e_async_state
+    {
+        enum async_state_t
+        {
+            queued,
+            loading,
+            decoded,
+            failed
+        };
+    }
+
+    struct async_request
+    {
+        async_load_params params;
+        Str               filename;
+        u32               handle;
+        u32               seq; // submission order within a priority
+        a_u32             state = {e_async_state::queued};
+        a_bool            cancelled = {false};
+        void*             decoded = nullptr;
+    };
+
+    struct async_context
+    {
+        async_request** requests = nullptr; // handle - 1 -> request, null once finished
+        async_request** queued = nullptr;
+        async_request** in_flight = nullptr;
+        u32             seq = 0;
+        u32             pending = 0;
+        pen::task_counter counter;
+    };
+    async_context s_async;
+
+    // reads and decodes on a task worker, the result is picked up by poll_async_loads on the user thread
+    void async_load_task(void* user_data, u32 thread_index)
+    {
+        async_request* req = (async_request*)user_data;
+
+        if (!req->cancelled)
+        {
+            pen::file_view view;
+            pen_error      err = pen::filesystem_map_file(req->filename.c_str(), view);
+            if (err == PEN_ERR_OK && view.size > 0)
             {
-                if (tr.id_name == d)
-                {
-                    u32 new_handle = load_texture_internal(tr.filename.c_str(), tr.id_name, tr.tcp);
-                    pen::renderer_replace_resource(tr.handle, new_handle, pen::RESOURCE_TEXTURE);
-                }
+                req->decoded = req->params.decode(view, req->params.ctx);
+                req->state = req->decoded ? e_async_state::decoded : e_async_state::failed;
+                return;
             }
+
+            pen::filesystem_unmap_file(view);
         }
+
+        req->state = e_async_state::failed;
+    }
+
+    bool async_request_before(const async_request* a, const async_request* b)
+    {
+        if (a->params.priority != b->params.priority)
+            return a->params.priority > b->params.priority;
+
+        return a->seq < b->seq;
+    }
+
+    void async_dispatch()
+    {
+        // io blocks the worker, so only occupy part of the pool
+        u32 max_in_flight = max<u32>(pen::tasks_num_threads() / 2, 1);
+
+        while (sb_count(s_async.in_flight) < max_in_flight && sb_count(s_async.queued) > 0)
+        {
+            // highest priority first, then submission order
+            u32 num_queued = sb_count(s_async.queued);
+            u32 best = 0;
+            for (u32 i = 1; i < num_queued; ++i)
+                if (async_request_before(s_async.queued[i], s_async.queued[best]))
+                    best = i;
+
+            async_request* req = s_async.queued[best];
+            s_async.queued[best] = s_async.queued[num_queued - 1];
+            stb__sbn(s_async.queued)--;
+
+            req->state = e_async_state::loading;
+            sb_push(s_async.in_flight, req);
+            pen::tasks_submit(async_load_task, req, &s_async.counter);
+        }
+    }
+
+    void async_finish(async_request* req, s32 resource, bool success)
+    {
+        if (req->params.callback)
+            req->params.callback(req->handle, resource, success, req->params.user_data);
+
+        s_async.requests[req->handle - 1] = nullptr;
+        s_async.pending--;
+        delete req;
+    }
+
+    //
+    // Async textures
+    //
+
+    struct async_texture
+    {
+        u32                          placeholder;
+        pen::texture_creation_params tcp;
+        pen::file_view               view;
+    };
+
+    void* async_texture_decode(const pen::file_view& view, void* ctx)
+    {
+        async_texture* at = (async_texture*)ctx;
+        at->view = view;
+        decode_dds(view.data, at->tcp);
+        return at;
+    }
+
+    s32 async_texture_finalise(void* decoded, void* ctx)
+    {
+        async_texture* at = (async_texture*)decoded;
+
+        u32 texture_index = pen::renderer_create_texture(at->tcp);
+        pen::filesystem_unmap_file(at->view);
+        at->tcp.data = nullptr;
+
+        // swap the real texture into the placeholder handle which may already be bound to materials
+        pen::renderer_replace_resource(at->placeholder, texture_index, pen::RESOURCE_TEXTURE);
+
+        texture_reference* tr = find_texture_reference_by_handle(at->placeholder);
+        if (tr)
+            tr->tcp = at->tcp;
+
+        u32 placeholder = at->placeholder;
+        delete at;
+        return placeholder;
+    }
+
+    void async_texture_discard(void* decoded, void* ctx)
+    {
+        async_texture* at = (async_texture*)ctx;
+        pen::filesystem_unmap_file(at->view);
+        delete at;
+    }
+
+    u32 create_placeholder_texture(pen::texture_creation_params& tcp)
+    {
+        // 1x1 mid grey, so lighting still reads while streaming
+        static u32 texel = 0xff808080;
+
+        tcp.width = 1;
+        tcp.height = 1;
+        tcp.format = PEN_TEX_FORMAT_RGBA8_UNORM;
+        tcp.num_mips = 1;
+        tcp.num_arrays = 1;
+        tcp.sample_count = 1;
+        tcp.sample_quality = 0;
+        tcp.usage = PEN_USAGE_DEFAULT;
+        tcp.bind_flags = PEN_BIND_SHADER_RESOURCE;
+        tcp.cpu_access_flags = 0;
+        tcp.flags = 0;
+        tcp.block_size = 4;
+        tcp.pixels_per_block = 1;
+        tcp.collection_type = pen::TEXTURE_COLLECTION_NONE;
+        tcp.data_size = sizeof(texel);
+        tcp.data = &texel;
+
+        u32 handle = pen::renderer_create_texture(tcp);
+        tcp.data = nullptr;
+        return handle;
     }
 } // namespace
 
@@ -502,6 +855,10 @@ namespace put
     {
         PEN_HOTLOADING_ENABLED;
 
+        s_changed_files.create(1024);
+        s_changed_files_overflow = true; // inputs may have changed before startup, scan once
+        s_file_watcher = pen::filesystem_create_watcher();
+
         pen::jobs_create_job(hot_loader_thread, 1024 * 1024, nullptr, pen::e_thread_start_flags::detached);
 
         pen::json pmbuild_config = pen::json::load_from_file("data/pmbuild_config.json");
@@ -539,6 +896,165 @@ namespace put
         return s_pmbuild_cmd;
     }
 
+    async_load_handle async_load(const async_load_params& params)
+    {
+        async_request* req = new async_request();
+        req->params = params;
+        req->filename = params.filename;
+        req->seq = s_async.seq++;
+
+        sb_push(s_async.requests, req);
+        req->handle = sb_count(s_async.requests);
+
+        sb_push(s_async.queued, req);
+        s_async.pending++;
+
+        async_dispatch();
+        return req->handle;
+    }
+
+    bool async_load_cancel(async_load_handle request)
+    {
+        if (request == 0 || request > sb_count(s_async.requests))
+            return false;
+
+        async_request* req = s_async.requests[request - 1];
+        if (!req)
+            return false;
+
+        // queued requests are removed now, in flight ones are discarded when the task completes
+        u32 num_queued = sb_count(s_async.queued);
+        for (u32 i = 0; i < num_queued; ++i)
+        {
+            if (s_async.queued[i] == req)
+            {
+                s_async.queued[i] = s_async.queued[num_queued - 1];
+                stb__sbn(s_async.queued)--;
+
+                if (req->params.discard)
+                    req->params.discard(nullptr, req->params.ctx);
+
+                req->params.callback = nullptr;
+                async_finish(req, PEN_INVALID_HANDLE, false);
+                return true;
+            }
+        }
+
+        req->cancelled = true;
+        return true;
+    }
+
+    bool async_load_complete(async_load_handle request)
+    {
+        if (request == 0 || request > sb_count(s_async.requests))
+            return true;
+
+        return s_async.requests[request - 1] == nullptr;
+    }
+
+    u32 async_loads_pending()
+    {
+        return s_async.pending;
+    }
+
+    void poll_async_loads()
+    {
+        for (u32 i = 0; i < sb_count(s_async.in_flight);)
+        {
+            async_request* req = s_async.in_flight[i];
+
+            u32 state = req->state;
+            if (state != e_async_state::decoded && state != e_async_state::failed)
+            {
+                ++i;
+                continue;
+            }
+
+            // remove from in flight keeping order
+            for (u32 j = i + 1; j < sb_count(s_async.in_flight); ++j)
+                s_async.in_flight[j - 1] = s_async.in_flight[j];
+            stb__sbn(s_async.in_flight)--;
+
+            if (req->cancelled)
+            {
+                if (req->params.discard)
+                    req->params.discard(req->decoded, req->params.ctx);
+
+                req->params.callback = nullptr;
+                async_finish(req, PEN_INVALID_HANDLE, false);
+                continue;
+            }
+
+            if (state == e_async_state::failed)
+            {
+                dev_console_log_level(dev_ui::console_level::error, "[error] async load - failed to load file: %s",
+                                      req->filename.c_str());
+
+                if (req->params.discard)
+                    req->params.discard(nullptr, req->params.ctx);
+
+                async_finish(req, PEN_INVALID_HANDLE, false);
+                continue;
+            }
+
+            s32 resource = req->params.finalise(req->decoded, req->params.ctx);
+            async_finish(req, resource, true);
+        }
+
+        async_dispatch();
+    }
+
+    void wait_async_loads()
+    {
+        while (s_async.pending > 0)
+        {
+            // waiting helps execute the load tasks
+            pen::tasks_wait(&s_async.counter);
+            poll_async_loads();
+        }
+    }
+
+    u32 load_texture_async(const c8* filename, load_priority priority, async_load_callback callback, void* user_data,
+                           async_load_handle* request_out)
+    {
+        if (request_out)
+            *request_out = 0;
+
+        // check for existing, which may itself still be streaming
+        hash_id            hh = PEN_HASH(filename);
+        texture_reference* existing = find_texture_reference(hh);
+        if (existing)
+        {
+            if (callback)
+                callback(0, existing->handle, true, user_data);
+
+            return existing->handle;
+        }
+
+        add_file_watcher(filename, texture_build, texture_hotload);
+
+        async_texture* at = new async_texture();
+        at->placeholder = create_placeholder_texture(at->tcp);
+
+        add_texture_reference({hh, filename, at->placeholder, at->tcp});
+
+        async_load_params params;
+        params.filename = filename;
+        params.priority = priority;
+        params.decode = async_texture_decode;
+        params.finalise = async_texture_finalise;
+        params.discard = async_texture_discard;
+        params.ctx = at;
+        params.callback = callback;
+        params.user_data = user_data;
+
+        async_load_handle request = async_load(params);
+        if (request_out)
+            *request_out = request;
+
+        return at->placeholder;
+    }
+
     void save_texture(const c8* filename, const texture_info& info)
     {
         // dds header
@@ -591,39 +1107,37 @@ namespace put
     u32 load_texture(const c8* filename)
     {
         // check for existing
-        hash_id hh = PEN_HASH(filename);
-        for (auto& t : k_texture_references)
-            if (t.id_name == hh)
-                return t.handle;
+        hash_id            hh = PEN_HASH(filename);
+        texture_reference* existing = find_texture_reference(hh);
+        if (existing)
+            return existing->handle;
 
         add_file_watcher(filename, texture_build, texture_hotload);
 
         pen::texture_creation_params tcp;
         u32                          texture_index = load_texture_internal(filename, hh, tcp);
 
-        k_texture_references.push_back({hh, filename, texture_index, tcp});
+        add_texture_reference({hh, filename, texture_index, tcp});
 
         return texture_index;
     }
 
     Str get_texture_filename(u32 handle)
     {
-        for (auto& t : k_texture_references)
-            if (t.handle == handle)
-                return t.filename;
+        texture_reference* tr = find_texture_reference_by_handle(handle);
+        if (tr)
+            return tr->filename;
 
         return "";
     }
 
     void get_texture_info(u32 handle, texture_info& info)
     {
-        for (auto& t : k_texture_references)
+        texture_reference* tr = find_texture_reference_by_handle(handle);
+        if (tr)
         {
-            if (t.handle == handle)
-            {
-                info = t.tcp;
-                return;
-            }
+            info = tr->tcp;
+            return;
         }
 
         // not found, not a texture handle.
@@ -672,6 +1186,8 @@ namespace put
         fw->build_callback = build_callback;
 
         k_file_watches.push_back(fw);
+
+        watch_inputs(fw);
     }
 
     void poll_hot_loader()
@@ -692,6 +1208,7 @@ namespace put
                     if (dep_ts >= fw->rebuild_ts)
                     {
                         fw->dependencies = pen::json::load_from_file(fw->filename.c_str());
+                        watch_inputs(fw);
 
                         // rebuild has succeeded
                         dev_console_log("[file watcher] rebuild for %s complete", fw->filename.c_str());
@@ -701,44 +1218,32 @@ namespace put
                     }
                 }
             }
-            else
-            {
-                pen::json files = fw->dependencies["files"];
-                s32       num_files = files.size();
-                for (s32 i = 0; i < num_files; ++i)
-                {
-                    pen::json outputs = files[i];
-                    s32       num_inputs = outputs.size();
-                    u32       current_ts = 0;
+        }
 
-                    Str fn = pen::os_path_for_resource(fw->filename.c_str());
-                    if (pen::filesystem_getmtime(fn.c_str(), current_ts) == PEN_ERR_OK)
-                    {
-                        for (s32 j = 0; j < num_inputs; ++j)
-                        {
-                            Str ifn = outputs[j]["name"].as_str();
-                            u32 input_ts = 0;
-                            if (pen::filesystem_getmtime(ifn.c_str(), input_ts) == PEN_ERR_OK)
-                            {
-                                if (!fw->invalidated)
-                                {
-                                    if (input_ts > current_ts)
-                                    {
-                                        dev_console_log("[file watcher] input file %s has changed", ifn.c_str());
-
-                                        Str data_file = outputs[j]["data_file"].as_str();
-                                        fw->changes.push_back(PEN_HASH(data_file.c_str()));
-                                        fw->rebuild_ts = input_ts;
-
-                                        fw->build_callback();
-                                        fw->invalidated = true;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+        // without os file watching, or if events were dropped, check the mtime of every input
+        if (!s_file_watcher || s_changed_files_overflow)
+        {
+            s_changed_files_overflow = false;
+            while (s_changed_files.get())
+                ;
+
+            s_deferred_changes.clear();
+            check_all_inputs();
+            return;
         }
+
+        std::vector<hash_id> deferred;
+        for (auto id_input : s_deferred_changes)
+            check_changed_input(id_input, deferred);
+
+        // copy before get, the slot can be reused once get_pos has moved on
+        while (hash_id* changed = s_changed_files.check())
+        {
+            hash_id id_input = *changed;
+            s_changed_files.get();
+            check_changed_input(id_input, deferred);
+        }
+
+        s_deferred_changes.swap(deferred);
     }
 } // namespace put
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "file_system.h"
 #include "pen.h"
 #include "renderer.h"
 #include "str/Str.h"
@@ -13,8 +14,59 @@ namespace put
 {
     typedef pen::texture_creation_params texture_info;
 
+    // Async loading
+    // Files are read and decoded on task workers in priority order, renderer resources are created on the user thread
+    // in poll_async_loads which should be called once per frame.
+    namespace e_load_priority
+    {
+        enum load_priority_t
+        {
+            low = 0,
+            normal,
+            high
+        };
+    }
+    typedef e_load_priority::load_priority_t load_priority;
+
+    typedef u32 async_load_handle; // 0 is invalid
+
+    // called from poll_async_loads, resource is the texture handle or pmm root entity. not called when cancelled
+    typedef void (*async_load_callback)(async_load_handle request, s32 resource, bool success, void* user_data);
+
+    struct async_load_params
+    {
+        const c8*     filename = nullptr;
+        load_priority priority = e_load_priority::normal;
+
+        // worker thread, takes ownership of the mapped file and returns the decoded payload or nullptr on failure
+        // the payload may point into the view, which discard must unmap if decode fails
+        void* (*decode)(const pen::file_view& view, void* ctx) = nullptr;
+
+        // user thread, creates resources from the decoded payload
+        s32 (*finalise)(void* decoded, void* ctx) = nullptr;
+
+        // user thread, when cancelled or failed, decoded is nullptr if decode did not run
+        void (*discard)(void* decoded, void* ctx) = nullptr;
+
+        void*               ctx = nullptr;
+        async_load_callback callback = nullptr;
+        void*               user_data = nullptr;
+    };
+
+    async_load_handle async_load(const async_load_params& params);
+    bool              async_load_cancel(async_load_handle request);
+    bool              async_load_complete(async_load_handle request);
+    u32               async_loads_pending();
+    void              poll_async_loads();
+    void              wait_async_loads();
+
     // Textures
     u32  load_texture(const c8* filename);
+    // returns a placeholder handle immediately, the real texture is swapped into the same handle when loaded.
+    // textures which are already referenced return the existing handle and invoke the callback immediately
+    u32  load_texture_async(const c8* filename, load_priority priority = e_load_priority::normal,
+                            async_load_callback callback = nullptr, void* user_data = nullptr,
+                            async_load_handle* request_out = nullptr);
     void save_texture(const c8* filename, const texture_info& tcp);
     void get_texture_info(u32 handle, texture_info& info);
     Str  get_texture_filename(u32 handle);
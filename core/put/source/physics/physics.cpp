@@ -179,6 +179,10 @@ namespace physics
                 physics_update(cmd.dt);
                 break;
 
+            case e_cmd::set_step_params:
+                set_step_params_internal(cmd.step_params);
+                break;
+
             default:
                 break;
         }
@@ -226,6 +230,9 @@ namespace physics
 
         p_physics_job_thread_info = p_thread_info;
 
+        // bullet's parallel work goes on a queue of its own, waiting here then never runs tasks from the user thread
+        pen::tasks_register_thread();
+
         pen::slot_resources_init(&s_physics_slot_resources, 1024);
         pen::slot_resources_init(&s_p2p_slot_resources, 16);
 
@@ -549,4 +556,17 @@ namespace physics
         pc.dt = dt;
         add_cmd(pc);
     }
+
+    void set_step_params(const step_params& params)
+    {
+        physics_cmd pc;
+        pc.command_index = e_cmd::set_step_params;
+        pc.step_params = params;
+        add_cmd(pc);
+    }
+
+    f32 get_step_alpha()
+    {
+        return g_readable_data.output_alpha.frontbuffer();
+    }
 } // namespace physics
@@ -49,7 +49,8 @@ namespace physics
             add_central_impulse,
             add_force,
             contact_test,
-            step
+            step,
+            set_step_params
         };
     }
 
@@ -328,6 +329,13 @@ namespace physics
         void (*callback)(const contact_test_results& result);
     };
 
+    struct step_params
+    {
+        f32  fixed_timestep = 0.0f; // seconds, 0 steps once per frame with the frame dt
+        u32  max_substeps = 4;      // fixed steps per frame, time beyond this is dropped
+        bool interpolate = true;    // fixed steps output transforms interpolated by get_step_alpha
+    };
+
     struct compound_rb_cmd
     {
         compound_rb_params params;
@@ -368,6 +376,7 @@ namespace physics
             ray_cast_params            ray_cast;
             sphere_cast_params         sphere_cast;
             contact_test_params        contact_test;
+            step_params                step_params;
             f32                        dt;
         };
 
@@ -400,6 +409,10 @@ namespace physics
     cast_result cast_sphere_immediate(const sphere_cast_params& scp);
 
     void step(f32 dt);
+    void set_step_params(const step_params& params);
+
+    // fraction of a fixed step between the last two steps that outputs are interpolated by, 1 with variable steps
+    f32 get_step_alpha();
     void set_v3(const u32& entity_index, const vec3f& v3, u32 cmd);
     void set_v3_v3(const u32& entity_index, const vec3f& v3a, const vec3f& v3b, u32 cmd);
     void set_float(const u32& entity_index, const f32& fval, u32 cmd);
@@ -6,8 +6,16 @@
 #include "console.h"
 #include "pen_string.h"
 #include "slot_resource.h"
+#include "threads.h"
 #include "timer.h"
 
+#if BT_THREADSAFE
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#endif
+
+#include <algorithm>
+
 namespace physics
 {
     pen_inline btVector3 from_vec3(const vec3f& v3)
@@ -43,6 +51,71 @@ namespace physics
     readable_data                 g_readable_data;
     static bullet_systems         s_bullet_systems;
     pen::res_pool<physics_entity> s_entities;
+    static step_params            s_step_params;
+    static f32                    s_step_accumulator = 0.0f;
+    static u32*                   s_moved_entities = nullptr; // moved outside of a step, output even if asleep
+
+#if BT_THREADSAFE
+    // runs bullet's parallel loops (island solving, narrowphase, integration) on the pen task pool
+    class pen_task_scheduler : public btITaskScheduler
+    {
+      public:
+        pen_task_scheduler() : btITaskScheduler("pen_tasks")
+        {
+            m_num_threads = getMaxNumThreads();
+        }
+
+        int getMaxNumThreads() const BT_OVERRIDE
+        {
+            return std::min<int>(std::max<u32>(pen::tasks_num_threads(), 1), BT_MAX_THREAD_COUNT);
+        }
+
+        int getNumThreads() const BT_OVERRIDE
+        {
+            return m_num_threads;
+        }
+
+        void setNumThreads(int num_threads) BT_OVERRIDE
+        {
+            m_num_threads = std::max<int>(1, std::min<int>(num_threads, getMaxNumThreads()));
+        }
+
+        void parallelFor(int begin, int end, int grain_size, const btIParallelForBody& body) BT_OVERRIDE
+        {
+            s32 count = end - begin;
+            if (count <= grain_size || m_num_threads <= 1)
+            {
+                body.forLoop(begin, end);
+                return;
+            }
+
+            parallel_for_range range = {&body, begin};
+
+            btPushThreadsAreRunning();
+
+            pen::task_counter counter;
+            pen::tasks_parallel_for((u32)count, (u32)grain_size, for_loop_range, &range, &counter);
+            pen::tasks_wait(&counter);
+
+            btPopThreadsAreRunning();
+        }
+
+      private:
+        struct parallel_for_range
+        {
+            const btIParallelForBody* body;
+            s32                       begin;
+        };
+
+        static void for_loop_range(void* user_data, u32 start, u32 end, u32 thread_index)
+        {
+            parallel_for_range* range = (parallel_for_range*)user_data;
+            range->body->forLoop(range->begin + (s32)start, range->begin + (s32)end);
+        }
+
+        int m_num_threads;
+    };
+#endif
 
     btTransform get_bttransform(const vec3f& p, const quat& q)
     {
@@ -247,14 +320,30 @@ namespace physics
         g_readable_data.output_matrices._data[1] = nullptr;
         g_readable_data.output_transforms._data[0] = nullptr;
         g_readable_data.output_transforms._data[1] = nullptr;
+        g_readable_data.output_alpha._data[0] = 1.0f;
+        g_readable_data.output_alpha._data[1] = 1.0f;
 
         s_bullet_systems.collision_config = new btDefaultCollisionConfiguration();
-        s_bullet_systems.dispatcher = new btCollisionDispatcher(s_bullet_systems.collision_config);
         s_bullet_systems.olp_cache = new btAxisSweep3(btVector3(-50.0f, -50.0f, -50.0f), btVector3(50.0f, 50.0f, 50.0f));
+
+#if BT_THREADSAFE
+        // the physics thread must be the first to ask bullet for its thread index so it is the main thread
+        static pen_task_scheduler s_task_scheduler;
+        btSetTaskScheduler(&s_task_scheduler);
+        btGetCurrentThreadIndex();
+
+        s_bullet_systems.dispatcher = new btCollisionDispatcherMt(s_bullet_systems.collision_config);
+        btConstraintSolverPoolMt* solver_pool = new btConstraintSolverPoolMt(s_task_scheduler.getMaxNumThreads());
+        s_bullet_systems.solver = solver_pool;
+        s_bullet_systems.dynamics_world = new btDiscreteDynamicsWorldMt(
+            s_bullet_systems.dispatcher, s_bullet_systems.olp_cache, solver_pool, s_bullet_systems.collision_config);
+#else
+        s_bullet_systems.dispatcher = new btCollisionDispatcher(s_bullet_systems.collision_config);
         s_bullet_systems.solver = new btSequentialImpulseConstraintSolver;
         s_bullet_systems.dynamics_world =
             new btDiscreteDynamicsWorld(s_bullet_systems.dispatcher, s_bullet_systems.olp_cache, s_bullet_systems.solver,
                                         s_bullet_systems.collision_config);
+#endif
 
         s_bullet_systems.dynamics_world->setGravity(btVector3(0, -10, 0));
     }
@@ -277,113 +366,216 @@ namespace physics
         }
     }
 
-    void update_output_matrices()
+    void write_output(mat4* bb_mats, maths::transform* bb_transforms, u32 i, const btTransform& bt)
     {
-        mat4*&             bb_mats = g_readable_data.output_matrices.backbuffer();
-        maths::transform*& bb_transforms = g_readable_data.output_transforms.backbuffer();
+        btScalar _mm[16];
+        bt.getOpenGLMatrix(_mm);
 
-        u32 num = sb_count(bb_mats);
+        for (s32 m = 0; m < 16; ++m)
+            bb_mats[i].m[m] = _mm[m];
 
-        for (u32 i = 0; i < s_entities._capacity; i++)
+        bb_mats[i].transpose();
+        bb_transforms[i] = from_bttransform(bt);
+    }
+
+    btTransform get_output_transform(const physics_entity& entity, const btRigidBody* p_rb, f32 alpha)
+    {
+        const btTransform& cur = p_rb->getWorldTransform();
+        if (alpha >= 1.0f)
+            return cur;
+
+        btTransform out;
+        out.setOrigin(lerp(entity.prev_transform.getOrigin(), cur.getOrigin(), alpha));
+        out.setRotation(slerp(entity.prev_transform.getRotation(), cur.getRotation(), alpha));
+        return out;
+    }
+
+    void update_entity_output(mat4* bb_mats, maths::transform* bb_transforms, u32 i, f32 alpha)
+    {
+        physics_entity& entity = s_entities.get(i);
+
+        switch (entity.type)
         {
-            if (i >= num)
+            case ENTITY_RIGID_BODY:
             {
-                ++num;
-                sb_push(bb_mats, mat4::create_identity());
-                sb_push(bb_transforms, maths::transform());
-            }
+                btRigidBody* p_rb = entity.rb.rigid_body;
+                if (!p_rb)
+                    return;
 
-            physics_entity& entity = s_entities.get(i);
+                write_output(bb_mats, bb_transforms, i, get_output_transform(entity, p_rb, alpha));
+            }
+            break;
 
-            switch (entity.type)
+            case ENTITY_COMPOUND_RIGID_BODY:
             {
-                case ENTITY_RIGID_BODY:
-                {
-                    btRigidBody* p_rb = entity.rb.rigid_body;
-                    if (!p_rb)
-                        continue;
+                btCompoundShape* p_compound = entity.compound_shape;
+                btRigidBody*     p_rb = entity.rb.rigid_body;
+                if (!p_rb)
+                    return;
 
-                    btTransform rb_transform = p_rb->getWorldTransform();
+                btTransform base = get_output_transform(entity, p_rb, alpha);
+                write_output(bb_mats, bb_transforms, i, base);
 
-                    btScalar _mm[16];
-
-                    rb_transform.getOpenGLMatrix(_mm);
+                if (p_compound)
+                {
+                    u32 num_shapes = p_compound->getNumChildShapes();
+                    for (u32 j = 0; j < num_shapes; ++j)
+                    {
+                        btTransform       child = p_compound->getChildTransform(j);
+                        btCollisionShape* shape = p_compound->getChildShape(j);
+                        u32               ph = shape->getUserIndex();
 
-                    for (s32 m = 0; m < 16; ++m)
-                        bb_mats[i].m[m] = _mm[m];
+                        if (!is_valid(ph))
+                            continue;
 
-                    bb_mats[i].transpose();
-                    bb_transforms[i] = from_bttransform(rb_transform);
+                        write_output(bb_mats, bb_transforms, ph, base * child);
+                    }
                 }
-                break;
-
-                case ENTITY_COMPOUND_RIGID_BODY:
-                {
-                    btCompoundShape* p_compound = entity.compound_shape;
-                    btRigidBody*     p_rb = entity.rb.rigid_body;
-
-                    btTransform rb_transform = p_rb->getWorldTransform();
+            }
+            break;
 
-                    btScalar _mm[16];
+            default:
+                break;
+        }
+    }
 
-                    rb_transform.getOpenGLMatrix(_mm);
+    // bodies which are not in the world are only output when moved by a command, bodies at rest are output until both
+    // buffers hold their final transform
+    void update_output_matrices(f32 alpha)
+    {
+        mat4*&             bb_mats = g_readable_data.output_matrices.backbuffer();
+        maths::transform*& bb_transforms = g_readable_data.output_transforms.backbuffer();
 
-                    for (s32 m = 0; m < 16; ++m)
-                        bb_mats[i].m[m] = _mm[m];
+        u32 num = sb_count(bb_mats);
+        for (; num < s_entities._capacity; ++num)
+        {
+            sb_push(bb_mats, mat4::create_identity());
+            sb_push(bb_transforms, maths::transform());
+        }
 
-                    bb_mats[i].transpose();
+        btCollisionObjectArray& objects = s_bullet_systems.dynamics_world->getCollisionObjectArray();
+        s32                     num_objects = objects.size();
 
-                    if (p_compound)
-                    {
-                        u32 num_shapes = p_compound->getNumChildShapes();
-                        for (u32 j = 0; j < num_shapes; ++j)
-                        {
-                            if (p_rb)
-                            {
-                                btTransform       base = p_rb->getWorldTransform();
-                                btTransform       child = p_compound->getChildTransform(j);
-                                btCollisionShape* shape = p_compound->getChildShape(j);
-                                u32               ph = shape->getUserIndex();
+        for (s32 o = 0; o < num_objects; ++o)
+        {
+            btCollisionObject* obj = objects[o];
+            u32                i = obj->getUserIndex();
+            if (i >= s_entities._capacity)
+                continue;
 
-                                if (!is_valid(ph))
-                                    continue;
+            physics_entity& entity = s_entities.get(i);
 
-                                btTransform child_world = base * child;
+            bool moving = obj->isActive() && !obj->isStaticObject();
+            if (moving)
+                entity.settled_outputs = 0;
+            else if (entity.settled_outputs >= 2)
+                continue;
+            else
+                entity.settled_outputs++;
 
-                                btScalar _mm[16];
+            update_entity_output(bb_mats, bb_transforms, i, alpha);
+        }
 
-                                child_world.getOpenGLMatrix(_mm);
+        // bodies outside of the world (ghosts) are output into both buffers after they move
+        u32 num_moved = sb_count(s_moved_entities);
+        u32 num_kept = 0;
+        for (u32 m = 0; m < num_moved; ++m)
+        {
+            u32 i = s_moved_entities[m];
+            if (i >= s_entities._capacity)
+                continue;
 
-                                for (s32 m = 0; m < 16; ++m)
-                                    bb_mats[ph].m[m] = _mm[m];
+            physics_entity& entity = s_entities.get(i);
+            if (entity.rb.rigid_body_in_world)
+                continue;
 
-                                bb_mats[ph].transpose();
-                                bb_transforms[ph] = from_bttransform(child_world);
-                            }
-                        }
-                    }
-                }
-                break;
+            update_entity_output(bb_mats, bb_transforms, i, alpha);
 
-                default:
-                    break;
-            }
+            if (++entity.settled_outputs < 2)
+                s_moved_entities[num_kept++] = i;
         }
+        if (s_moved_entities)
+            stb__sbn(s_moved_entities) = num_kept;
+
+        g_readable_data.output_alpha.backbuffer() = alpha;
 
         g_readable_data.output_matrices.swap_buffers();
         g_readable_data.output_transforms.swap_buffers();
+        g_readable_data.output_alpha.swap_buffers();
+    }
+
+    void store_prev_transforms()
+    {
+        btCollisionObjectArray& objects = s_bullet_systems.dynamics_world->getCollisionObjectArray();
+        s32                     num_objects = objects.size();
+
+        for (s32 o = 0; o < num_objects; ++o)
+        {
+            btCollisionObject* obj = objects[o];
+            u32                i = obj->getUserIndex();
+            if (i >= s_entities._capacity || !obj->isActive())
+                continue;
+
+            s_entities.get(i).prev_transform = obj->getWorldTransform();
+        }
     }
 
     void physics_update(f32 dt)
     {
+        f32 alpha = 1.0f;
+
         // step
         if (!g_readable_data.b_paused)
         {
-            s_bullet_systems.dynamics_world->stepSimulation(dt);
+            f32 fixed = s_step_params.fixed_timestep;
+            if (fixed > 0.0f)
+            {
+                s_step_accumulator += dt;
+
+                u32 num_steps = (u32)(s_step_accumulator / fixed);
+                if (num_steps > s_step_params.max_substeps)
+                {
+                    // drop the time we can not catch up on rather than falling further behind
+                    num_steps = s_step_params.max_substeps;
+                    s_step_accumulator = fixed * num_steps;
+                }
+
+                for (u32 i = 0; i < num_steps; ++i)
+                {
+                    if (s_step_params.interpolate && i == num_steps - 1)
+                        store_prev_transforms();
+
+                    s_bullet_systems.dynamics_world->stepSimulation(fixed, 0, fixed);
+                }
+
+                s_step_accumulator -= fixed * num_steps;
+
+                if (s_step_params.interpolate)
+                    alpha = std::min(s_step_accumulator / fixed, 1.0f);
+            }
+            else
+            {
+                s_bullet_systems.dynamics_world->stepSimulation(dt);
+            }
+        }
+        else if (s_step_params.interpolate && s_step_params.fixed_timestep > 0.0f)
+        {
+            // hold the interpolated pose while paused
+            alpha = g_readable_data.output_alpha.frontbuffer();
         }
 
         // update mats
-        update_output_matrices();
+        update_output_matrices(alpha);
+    }
+
+    void set_step_params_internal(const step_params& params)
+    {
+        s_step_params = params;
+        s_step_params.max_substeps = std::max<u32>(params.max_substeps, 1);
+        s_step_accumulator = 0.0f;
+
+        // interpolation restarts from the current transforms
+        store_prev_transforms();
     }
 
     void add_rb_internal(const rigid_body_params& params, u32 resource_slot, bool ghost)
@@ -403,7 +595,11 @@ namespace physics
 
         PEN_ASSERT(rb);
 
+        entity.prev_transform = rb->getWorldTransform();
+        entity.settled_outputs = 0;
         entity.type = ENTITY_RIGID_BODY;
+
+        sb_push(s_moved_entities, resource_slot);
     }
 
     void add_compound_rb_internal(const compound_rb_cmd& cmd, u32 resource_slot)
@@ -432,6 +628,8 @@ namespace physics
         entity.group = cmd.params.base.group;
         entity.mask = cmd.params.base.mask;
 
+        entity.prev_transform = entity.rb.rigid_body->getWorldTransform();
+        entity.settled_outputs = 0;
         entity.type = ENTITY_COMPOUND_RIGID_BODY;
     }
 
@@ -623,7 +821,8 @@ namespace physics
         bt_trans.setOrigin(bt_v3);
         bt_trans.setRotation(bt_quat);
 
-        btRigidBody* rb = s_entities.get(cmd.object_index).rb.rigid_body;
+        physics_entity& entity = s_entities.get(cmd.object_index);
+        btRigidBody*    rb = entity.rb.rigid_body;
 
         if (rb)
         {
@@ -636,6 +835,11 @@ namespace physics
                 rb->getMotionState()->setWorldTransform(bt_trans);
                 rb->setCenterOfMassTransform(bt_trans);
             }
+
+            // teleported, so nothing to interpolate from
+            entity.prev_transform = bt_trans;
+            entity.settled_outputs = 0;
+            sb_push(s_moved_entities, cmd.object_index);
         }
     }
 
@@ -901,6 +1105,8 @@ namespace physics
                 pe.type = ENTITY_RIGID_BODY;
 
                 rb.rigid_body->setWorldTransform(base * compound_child);
+                pe.prev_transform = base * compound_child;
+                pe.settled_outputs = 0;
             }
             else
             {
@@ -84,6 +84,9 @@ namespace physics
         u32 group;
         u32 mask;
 
+        btTransform prev_transform; // before the last fixed step, for interpolation
+        u32         settled_outputs; // outputs written since the body stopped moving
+
         physics_entity(){};
         ~physics_entity(){};
     };
@@ -121,11 +124,13 @@ namespace physics
         a_u32                                   b_paused;
         pen::multi_buffer<mat4*, 2>             output_matrices;
         pen::multi_buffer<maths::transform*, 2> output_transforms;
+        pen::multi_buffer<f32, 2>               output_alpha;
     };
 
     extern readable_data g_readable_data;
 
     void physics_update(f32 dt);
+    void set_step_params_internal(const step_params& params);
     void physics_initialise();
     void physics_shutdown();
 
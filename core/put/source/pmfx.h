@@ -53,11 +53,20 @@ namespace put
         enum shader_permutation_t
         {
             skinned = 1 << 31,
-            instanced = 1 << 30
+            instanced = 1 << 30,
+            bone_palette = 1 << 29 // skinned bones are read from the per frame palette buffer
         };
     }
     typedef u32 shader_permutation;
 
+    // per view counters written by scene render functions, reset each time the view renders
+    struct scene_view_stats
+    {
+        u32 draws = 0;
+        u32 binds_issued = 0;  // shader, vertex, index and material cbuffer binds made
+        u32 binds_avoided = 0; // binds skipped because the state was already set
+    };
+
     struct scene_view
     {
         u32             cb_view = PEN_INVALID_HANDLE;
@@ -74,6 +83,7 @@ namespace put
         hash_id         id_technique = 0;
         u32             permutation = 0;
         ecs::ecs_scene* scene = nullptr;
+        scene_view_stats* stats = nullptr;
     };
 
     typedef void (*svr_render_function)(const scene_view&);
@@ -300,6 +300,8 @@ namespace
         bool stash_output = false;
         u32  stashed_output_rt = PEN_INVALID_HANDLE;
         f32  stashed_rt_aspect = 0.0f;
+
+        scene_view_stats stats;
     };
 
     struct edited_post_process
@@ -375,6 +377,36 @@ namespace
     std::vector<Str>                     s_script_files;
     bool                                 s_reload = false;
 
+    // lookups into s_render_states, the first state added for a key wins
+    pen::hash_map<u64, u32> s_render_state_lookup;        // type | id_name -> index
+    pen::hash_map<u64, u32> s_render_state_hash_lookup;   // type | hash -> index
+    pen::hash_map<u32, u32> s_render_state_handle_lookup; // handle -> index
+
+    inline u64 render_state_key(u32 type, hash_id hh)
+    {
+        return ((u64)type << 32) | hh;
+    }
+
+    void add_render_state_lookups(const render_state& rs, u32 index)
+    {
+        u64 id_key = render_state_key(rs.type, rs.id_name);
+        if (!s_render_state_lookup.find(id_key))
+            s_render_state_lookup.insert(id_key, index);
+
+        u64 hash_key = render_state_key(rs.type, rs.hash);
+        if (!s_render_state_hash_lookup.find(hash_key))
+            s_render_state_hash_lookup.insert(hash_key, index);
+
+        if (!s_render_state_handle_lookup.find(rs.handle))
+            s_render_state_handle_lookup.insert(rs.handle, index);
+    }
+
+    void add_render_state(const render_state& rs)
+    {
+        s_render_states.push_back(rs);
+        add_render_state_lookups(rs, (u32)s_render_states.size() - 1);
+    }
+
     // ids
 } // namespace
 
@@ -481,44 +513,26 @@ namespace put
 
         render_state* get_state_by_hash(hash_id hash, u32 type)
         {
-            size_t num = s_render_states.size();
-            for (s32 i = 0; i < num; ++i)
-                if (s_render_states[i].hash == hash && s_render_states[i].type == type)
-                    return &s_render_states[i];
-
-            return nullptr;
+            u32* i = s_render_state_hash_lookup.find(render_state_key(type, hash));
+            return i ? &s_render_states[*i] : nullptr;
         }
 
         render_state* _get_render_state(hash_id id_name, u32 type)
         {
-            size_t num = s_render_states.size();
-            for (s32 i = 0; i < num; ++i)
-                if (s_render_states[i].type == type)
-                    if (s_render_states[i].id_name == id_name)
-                        return &s_render_states[i];
-
-            return nullptr;
+            u32* i = s_render_state_lookup.find(render_state_key(type, id_name));
+            return i ? &s_render_states[*i] : nullptr;
         }
 
         u32 get_render_state(hash_id id_name, u32 type)
         {
-            size_t num = s_render_states.size();
-            for (s32 i = 0; i < num; ++i)
-                if (s_render_states[i].type == type)
-                    if (s_render_states[i].id_name == id_name)
-                        return s_render_states[i].handle;
-
-            return 0;
+            u32* i = s_render_state_lookup.find(render_state_key(type, id_name));
+            return i ? s_render_states[*i].handle : 0;
         }
 
         Str get_render_state_name(u32 handle)
         {
-            size_t num = s_render_states.size();
-            for (s32 i = 0; i < num; ++i)
-                if (s_render_states[i].handle == handle)
-                    return s_render_states[i].name;
-
-            return "";
+            u32* i = s_render_state_handle_lookup.find(handle);
+            return i ? s_render_states[*i].name : "";
         }
 
         c8** get_render_state_list(u32 type)
@@ -691,7 +705,7 @@ namespace put
                     rs.handle = pen::renderer_create_sampler(scp);
                 }
 
-                s_render_states.push_back(rs);
+                add_render_state(rs);
             }
         }
 
@@ -736,7 +750,7 @@ namespace put
                     rs.handle = pen::renderer_create_raster_state(rcp);
                 }
 
-                s_render_states.push_back(rs);
+                add_render_state(rs);
             }
         }
 
@@ -793,7 +807,7 @@ namespace put
                 rs.handle = pen::renderer_create_blend_state(bcp);
                 rs.copy = false;
 
-                s_render_states.push_back(rs);
+                add_render_state(rs);
             }
         }
 
@@ -872,7 +886,7 @@ namespace put
                     rs.handle = pen::renderer_create_depth_stencil_state(dscp);
                 }
 
-                s_render_states.push_back(rs);
+                add_render_state(rs);
             }
         }
 
@@ -1043,7 +1057,7 @@ namespace put
                 rs.handle = pen::renderer_create_blend_state(bcp);
             }
 
-            s_render_states.push_back(rs);
+            add_render_state(rs);
 
             return rs.handle;
         }
@@ -2587,6 +2601,14 @@ namespace put
             for (s32 i = s_render_states.size() - 1; i >= 0; --i)
                 if (s_render_states[i].type != e_render_state::sampler)
                     s_render_states.erase(s_render_states.begin() + i);
+
+            // indices have moved
+            s_render_state_lookup.clear();
+            s_render_state_hash_lookup.clear();
+            s_render_state_handle_lookup.clear();
+
+            for (u32 i = 0; i < s_render_states.size(); ++i)
+                add_render_state_lookups(s_render_states[i], i);
         }
 
         void release_script_resources()
@@ -2948,6 +2970,9 @@ namespace put
             sv.cb_2d_view = cb_2d;
             sv.pmfx_shader = v.pmfx_shader;
             sv.permutation = v.technique_permutation;
+            sv.stats = &v.stats;
+
+            v.stats = scene_view_stats();
 
             // render passes.. multi pass for cubemaps or arrays
             for (u32 a = 0; a < v.num_arrays; ++a)
@@ -3155,6 +3180,9 @@ namespace put
                 ++isb;
             }
 
+            ImGui::Text("draws: %u, binds issued: %u, binds avoided: %u", v.stats.draws, v.stats.binds_issued,
+                        v.stats.binds_avoided);
+
             ImGui::TextWrapped("%s", v.info_json.c_str());
         }
 
@@ -0,0 +1,480 @@
+#include "../example_common.h"
+
+#include "ecs/ecs_anim.h"
+
+using namespace put;
+using namespace ecs;
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "anim_benchmark";
+        p.window_sample_count = 4;
+        p.user_thread_function = user_setup;
+        p.flags = pen::e_pen_create_flags::renderer;
+        return p;
+    }
+} // namespace pen
+
+namespace
+{
+    const u32 k_num_instances = 1000;
+    const f32 k_frame_time = 1.0f / 60.0f;
+
+    const c8* k_anim_files[] = {"data/models/characters/testcharacter/anims/testcharacter_idle.pma",
+                                "data/models/characters/testcharacter/anims/testcharacter_walk.pma"};
+
+    // the previous runtime layout for comparison, keys of every channel interleaved per frame
+    struct legacy_info
+    {
+        f32 time;
+        u32 interpolation;
+        u32 offset;
+    };
+
+    struct legacy_channel
+    {
+        u32 num_frames;
+        u32 element_count;
+        u32 element_offset[21];
+        u32 flags = 0;
+    };
+
+    struct legacy_anim
+    {
+        u32             num_channels = 0;
+        u32             max_frames = 0;
+        legacy_channel* channels = nullptr;
+        legacy_info**   info = nullptr; // [frame][channel]
+        f32**           data = nullptr; // [frame][channel offset]
+        size_t          size = 0;
+    };
+
+    struct anim_stats
+    {
+        Str    name;
+        size_t raw_size = 0;
+        size_t legacy_size = 0;
+        size_t clip_size = 0;
+        u32    raw_keys = 0;
+        u32    clip_keys = 0;
+        f32    legacy_play_ms = 0.0f;
+        f32    clip_play_ms = 0.0f;
+        f32    legacy_seek_ms = 0.0f;
+        f32    clip_seek_ms = 0.0f;
+        f32    batch_play_ms = 0.0f;
+        f32    blend_ms = 0.0f;
+        f32    max_translate_error = 0.0f;
+        f32    max_rotate_error = 0.0f;
+        f32    max_batch_translate_error = 0.0f;
+        f32    max_batch_rotate_error = 0.0f;
+    };
+
+    struct bench_anim
+    {
+        animation_resource* anim;
+        legacy_anim         legacy;
+        f32*                times = nullptr;             // per instance
+        f32*                seek_times = nullptr;        // per instance
+        u32*                legacy_pos = nullptr;        // per instance * channel
+        u32*                legacy_seek_pos = nullptr;   // per instance * channel
+        u32*                clip_cursors = nullptr;      // per instance * track
+        u32*                clip_seek_cursors = nullptr; // per instance * track
+        u32*                batch_cursors = nullptr;     // per instance * track
+        anim_target*        legacy_targets = nullptr;
+        anim_target*        clip_targets = nullptr;
+        anim_target*        batch_targets = nullptr;
+        anim_pose*          poses = nullptr; // per instance
+        anim_sampler*       samplers = nullptr;
+        anim_stats          stats;
+    };
+
+    std::vector<bench_anim> s_anims;
+    pen::timer*             s_timer = nullptr;
+    anim_batch              s_batch;
+    anim_pose               s_blended;
+
+    void bake_legacy(const animation_resource* anim, legacy_anim& soa)
+    {
+        u32 num_channels = anim->num_channels;
+        for (u32 c = 0; c < num_channels; ++c)
+            soa.max_frames = std::max<u32>(anim->channels[c].num_frames, soa.max_frames);
+
+        soa.num_channels = num_channels;
+        soa.channels = new legacy_channel[num_channels];
+        soa.data = new f32*[soa.max_frames];
+        soa.info = new legacy_info*[soa.max_frames];
+        memset(soa.data, 0x0, soa.max_frames * sizeof(f32*));
+        memset(soa.info, 0x0, soa.max_frames * sizeof(legacy_info*));
+
+        for (u32 c = 0; c < num_channels; ++c)
+        {
+            const animation_channel& channel = anim->channels[c];
+
+            soa.channels[c].num_frames = channel.num_frames;
+
+            u32 elm = 0;
+            for (u32 i = 0; i < 3; ++i)
+                if (channel.offset[i])
+                    soa.channels[c].element_offset[elm++] = e_anim_output::translate_x + i;
+
+            for (u32 i = 0; i < 3; ++i)
+                if (channel.scale[i])
+                    soa.channels[c].element_offset[elm++] = e_anim_output::scale_x + i;
+
+            for (u32 i = 0; i < 3; ++i)
+                if (channel.rotation[i])
+                    for (u32 q = 0; q < 4; ++q)
+                        soa.channels[c].element_offset[elm++] = e_anim_output::quaternion;
+
+            if (channel.matrices)
+                soa.channels[c].flags = e_anim_flags::baked_quaternion;
+
+            soa.channels[c].element_count = elm;
+
+            for (u32 t = 0; t < channel.num_frames; ++t)
+            {
+                u32 start_offset = sb_count(soa.data[t]);
+
+                for (u32 i = 0; i < 3; ++i)
+                    if (channel.offset[i])
+                        sb_push(soa.data[t], channel.offset[i][t]);
+
+                for (u32 i = 0; i < 3; ++i)
+                    if (channel.scale[i])
+                        sb_push(soa.data[t], channel.scale[i][t]);
+
+                for (u32 i = 0; i < 3; ++i)
+                {
+                    if (channel.rotation[i])
+                    {
+                        sb_push(soa.data[t], channel.rotation[i][t].x);
+                        sb_push(soa.data[t], channel.rotation[i][t].y);
+                        sb_push(soa.data[t], channel.rotation[i][t].z);
+                        sb_push(soa.data[t], channel.rotation[i][t].w);
+                    }
+                }
+
+                legacy_info ai;
+                ai.offset = start_offset;
+                ai.time = channel.times[t];
+                sb_push(soa.info[t], ai);
+            }
+
+            for (u32 t = channel.num_frames; t < soa.max_frames; ++t)
+            {
+                legacy_info ai;
+                ai.offset = -1;
+                ai.time = 0.0f;
+                sb_push(soa.info[t], ai);
+            }
+        }
+
+        // used sizes, stretchy buffer headers and growth slack are not counted
+        soa.size = sizeof(legacy_channel) * num_channels + (sizeof(f32*) + sizeof(legacy_info*)) * soa.max_frames;
+        for (u32 t = 0; t < soa.max_frames; ++t)
+            soa.size += sizeof(f32) * sb_count(soa.data[t]) + sizeof(legacy_info) * sb_count(soa.info[t]);
+    }
+
+    // the previous update_animations channel loop
+    void sample_legacy(const legacy_anim& soa, f32 anim_t, bool looped, u32* pos, anim_target* targets)
+    {
+        for (u32 c = 0; c < soa.num_channels; ++c)
+        {
+            const legacy_channel& channel = soa.channels[c];
+            u32&                  p = pos[c];
+
+            for (; p < channel.num_frames; p++)
+                if (anim_t <= soa.info[p][c].time)
+                {
+                    p -= 1;
+                    break;
+                }
+
+            if (p >= channel.num_frames || looped)
+                p = 0;
+
+            u32 next = (p + 1) % channel.num_frames;
+
+            const legacy_info& info1 = soa.info[p][c];
+            const legacy_info& info2 = soa.info[next][c];
+
+            const f32* d1 = &soa.data[p][info1.offset];
+            const f32* d2 = &soa.data[next][info2.offset];
+
+            f32 it = min(max((anim_t - info1.time) / (info2.time - info1.time), 0.0f), 1.0f);
+
+            for (u32 e = 0; e < channel.element_count; ++e)
+            {
+                u32 eo = channel.element_offset[e];
+                if (eo == e_anim_output::quaternion)
+                {
+                    quat q1;
+                    quat q2;
+                    memcpy(&q1.v[0], &d1[e], 16);
+                    memcpy(&q2.v[0], &d2[e], 16);
+
+                    targets[c].q = slerp(q1, q2, it) * targets[c].q;
+                    targets[c].flags |= channel.flags;
+                    e += 3;
+                }
+                else
+                {
+                    targets[c].t[eo] = (1 - it) * d1[e] + it * d2[e];
+                }
+            }
+        }
+    }
+
+    void reset_targets(anim_target* targets, u32 count)
+    {
+        for (u32 i = 0; i < count; ++i)
+        {
+            memset(targets[i].t, 0x0, sizeof(targets[i].t));
+            targets[i].q = quat(0.0f, 0.0f, 0.0f);
+            targets[i].flags = 0;
+        }
+    }
+
+    void compare_targets(const anim_target* a, const anim_target* b, u32 count, f32& max_translate_error,
+                         f32& max_rotate_error)
+    {
+        for (u32 i = 0; i < count; ++i)
+        {
+            for (u32 e = 0; e < 9; ++e)
+                max_translate_error = max(max_translate_error, fabsf(a[i].t[e] - b[i].t[e]));
+
+            f32 d = 0.0f;
+            for (u32 e = 0; e < 4; ++e)
+                d += a[i].q.v[e] * b[i].q.v[e];
+
+            f32 angle = 2.0f * acosf(min(fabsf(d), 1.0f));
+            max_rotate_error = max(max_rotate_error, angle);
+        }
+    }
+
+    // decomposed keys and times excluding the source matrices, num_keys counts a key per track
+    size_t raw_key_size(const animation_resource* anim, u32& num_keys)
+    {
+        size_t size = 0;
+        num_keys = 0;
+        for (u32 c = 0; c < anim->num_channels; ++c)
+        {
+            const animation_channel& channel = anim->channels[c];
+
+            u32    num_tracks = 0;
+            size_t key_size = sizeof(f32);
+            for (u32 i = 0; i < 3; ++i)
+            {
+                key_size += channel.offset[i] ? sizeof(f32) : 0;
+                key_size += channel.scale[i] ? sizeof(f32) : 0;
+                key_size += channel.rotation[i] ? sizeof(quat) : 0;
+                num_tracks += channel.rotation[i] ? 1 : 0;
+            }
+
+            num_tracks += (channel.offset[0] || channel.offset[1] || channel.offset[2]) ? 1 : 0;
+            num_tracks += (channel.scale[0] || channel.scale[1] || channel.scale[2]) ? 1 : 0;
+
+            num_keys += channel.num_frames * num_tracks;
+            size += key_size * channel.num_frames;
+        }
+
+        return size;
+    }
+} // namespace
+
+void example_setup(ecs::ecs_scene* scene, camera& cam)
+{
+    put::dev_ui::enable(true);
+
+    clear_scene(scene);
+
+    s_timer = pen::timer_create();
+
+    for (u32 f = 0; f < PEN_ARRAY_SIZE(k_anim_files); ++f)
+    {
+        anim_handle ah = load_pma(k_anim_files[f]);
+        if (!is_valid(ah))
+            continue;
+
+        bench_anim ba;
+        ba.anim = get_animation_resource(ah);
+        ba.stats.name = k_anim_files[f];
+
+        bake_legacy(ba.anim, ba.legacy);
+
+        u32 num_channels = ba.anim->num_channels;
+        u32 num_tracks = ba.anim->clip.num_tracks;
+
+        // instances are spread through the anim so they do not all sample the same keys
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            sb_push(ba.times, ba.anim->length * (f32)(rand() % 1000) / 1000.0f);
+            sb_push(ba.seek_times, ba.anim->length * (f32)(rand() % 1000) / 1000.0f);
+
+            for (u32 c = 0; c < num_channels; ++c)
+            {
+                sb_push(ba.legacy_pos, 0);
+                sb_push(ba.legacy_seek_pos, 0);
+
+                anim_target at;
+                sb_push(ba.legacy_targets, at);
+                sb_push(ba.clip_targets, at);
+                sb_push(ba.batch_targets, at);
+            }
+
+            for (u32 t = 0; t < num_tracks; ++t)
+            {
+                sb_push(ba.clip_cursors, 0);
+                sb_push(ba.clip_seek_cursors, 0);
+                sb_push(ba.batch_cursors, 0);
+            }
+
+            anim_pose pose;
+            resize_anim_pose(pose, num_channels);
+            sb_push(ba.poses, pose);
+        }
+
+        // every channel bound, one target per channel
+        for (u32 c = 0; c < num_channels; ++c)
+        {
+            anim_sampler sampler;
+            sampler.joint = c;
+            sampler.flags = 0;
+            sb_push(ba.samplers, sampler);
+        }
+
+        ba.stats.raw_size = raw_key_size(ba.anim, ba.stats.raw_keys);
+        ba.stats.legacy_size = ba.legacy.size;
+        ba.stats.clip_size = ba.anim->clip.size;
+        ba.stats.clip_keys = ba.anim->clip.num_keys;
+
+        s_anims.push_back(ba);
+    }
+}
+
+void example_update(ecs::ecs_scene* scene, camera& cam, f32 dt)
+{
+    for (auto& ba : s_anims)
+    {
+        u32 num_channels = ba.anim->num_channels;
+        u32 num_tracks = ba.anim->clip.num_tracks;
+        f32 length = ba.anim->length;
+
+        reset_targets(ba.legacy_targets, num_channels * k_num_instances);
+        reset_targets(ba.clip_targets, num_channels * k_num_instances);
+
+        // playback, each instance steps forward one frame
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+            sample_legacy(ba.legacy, ba.times[i], false, &ba.legacy_pos[i * num_channels],
+                          &ba.legacy_targets[i * num_channels]);
+        ba.stats.legacy_play_ms = pen::timer_elapsed_ms(s_timer);
+
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            sample_anim_clip(ba.anim->clip, ba.times[i], &ba.clip_cursors[i * num_tracks], ba.samplers,
+                             &ba.clip_targets[i * num_channels]);
+        }
+        ba.stats.clip_play_ms = pen::timer_elapsed_ms(s_timer);
+
+        reset_targets(ba.batch_targets, num_channels * k_num_instances);
+
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            sample_anim_clip_batch(ba.anim->clip, ba.times[i], &ba.batch_cursors[i * num_tracks], ba.samplers,
+                                   &ba.batch_targets[i * num_channels], s_batch);
+        }
+        ba.stats.batch_play_ms = pen::timer_elapsed_ms(s_timer);
+
+        compare_targets(ba.clip_targets, ba.batch_targets, num_channels * k_num_instances,
+                        ba.stats.max_batch_translate_error, ba.stats.max_batch_rotate_error);
+
+        // blend pairs of sampled instances
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            for (u32 c = 0; c < num_channels; ++c)
+            {
+                const anim_target& at = ba.batch_targets[i * num_channels + c];
+                set_anim_pose_joint(ba.poses[i], c, vec3f(at.t[0], at.t[1], at.t[2]), at.q,
+                                    vec3f(at.t[6], at.t[7], at.t[8]));
+            }
+        }
+
+        resize_anim_pose(s_blended, num_channels);
+
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+            blend_anim_poses(ba.poses[i], ba.poses[(i + 1) % k_num_instances], 0.5f, s_blended);
+        ba.stats.blend_ms = pen::timer_elapsed_ms(s_timer);
+
+        // the legacy scan restarts from the first frame when an anim loops
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            ba.times[i] += k_frame_time;
+            if (ba.times[i] >= length)
+            {
+                ba.times[i] = 0.0f;
+                memset(&ba.legacy_pos[i * num_channels], 0x0, sizeof(u32) * num_channels);
+            }
+        }
+
+        // random seeks, the legacy layout can only restart its scan from the first frame
+        reset_targets(ba.legacy_targets, num_channels * k_num_instances);
+        reset_targets(ba.clip_targets, num_channels * k_num_instances);
+
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            u32* pos = &ba.legacy_seek_pos[i * num_channels];
+            memset(pos, 0x0, sizeof(u32) * num_channels);
+            sample_legacy(ba.legacy, ba.seek_times[i], false, pos, &ba.legacy_targets[i * num_channels]);
+        }
+        ba.stats.legacy_seek_ms = pen::timer_elapsed_ms(s_timer);
+
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            sample_anim_clip(ba.anim->clip, ba.seek_times[i], &ba.clip_seek_cursors[i * num_tracks], ba.samplers,
+                             &ba.clip_targets[i * num_channels]);
+        }
+        ba.stats.clip_seek_ms = pen::timer_elapsed_ms(s_timer);
+
+        compare_targets(ba.legacy_targets, ba.clip_targets, num_channels * k_num_instances, ba.stats.max_translate_error,
+                        ba.stats.max_rotate_error);
+
+        for (u32 i = 0; i < k_num_instances; ++i)
+        {
+            f32 seek = ba.times[i] + length * 0.5f;
+            ba.seek_times[i] = seek >= length ? seek - length : seek;
+        }
+    }
+
+    ImGui::Begin("Anim Benchmark");
+    ImGui::Text("Instances: %u", k_num_instances);
+
+    for (auto& ba : s_anims)
+    {
+        anim_stats& st = ba.stats;
+
+        ImGui::Separator();
+        ImGui::Text("%s", st.name.c_str());
+        ImGui::Text("  %-10s %8u keys %10u bytes", "raw", st.raw_keys, (u32)st.raw_size);
+        ImGui::Text("  %-10s %8u keys %10u bytes", "legacy", st.raw_keys, (u32)st.legacy_size);
+        ImGui::Text("  %-10s %8u keys %10u bytes", "clip", st.clip_keys, (u32)st.clip_size);
+        ImGui::Text("  %-10s play %8.4f ms, seek %8.4f ms", "legacy", st.legacy_play_ms, st.legacy_seek_ms);
+        ImGui::Text("  %-10s play %8.4f ms, seek %8.4f ms", "clip", st.clip_play_ms, st.clip_seek_ms);
+        ImGui::Text("  %-10s play %8.4f ms, blend %8.4f ms", "batch", st.batch_play_ms, st.blend_ms);
+        ImGui::Text("  max error translate / scale %f, rotate %f rad", st.max_translate_error, st.max_rotate_error);
+        ImGui::Text("  batch vs clip translate / scale %f, rotate %f rad", st.max_batch_translate_error,
+                    st.max_batch_rotate_error);
+    }
+
+    ImGui::End();
+}
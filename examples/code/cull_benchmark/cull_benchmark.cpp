@@ -0,0 +1,125 @@
+#include "../example_common.h"
+
+#include "ecs/ecs_cull.h"
+
+using namespace put;
+using namespace ecs;
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "cull_benchmark";
+        p.window_sample_count = 4;
+        p.user_thread_function = user_setup;
+        p.flags = pen::e_pen_create_flags::renderer;
+        return p;
+    }
+} // namespace pen
+
+namespace
+{
+    const u32 k_num_entities = 100000;
+    const u32 k_iterations = 16;
+
+    typedef void (*stream_cull_func)(const cull_stream*, const camera*, u32**);
+
+    struct stream_path
+    {
+        const c8*        name;
+        stream_cull_func func;
+        simd_level       level;
+    };
+
+    stream_path s_stream_paths[] = {
+        {"stream scalar", frustum_cull_aabb_stream_scalar, e_simd_level::scalar},
+        {"stream sse 4", frustum_cull_aabb_stream_sse, e_simd_level::sse},
+        {"stream avx2 8", frustum_cull_aabb_stream_avx2, e_simd_level::avx2},
+        {"stream avx512 16", frustum_cull_aabb_stream_avx512, e_simd_level::avx512},
+    };
+
+    const c8* s_simd_level_names[] = {"scalar", "sse", "avx2", "avx512"};
+
+    u32*        s_entities = nullptr;
+    cull_stream s_stream;
+    pen::timer* s_timer = nullptr;
+} // namespace
+
+void example_setup(ecs::ecs_scene* scene, camera& cam)
+{
+    put::dev_ui::enable(true);
+
+    clear_scene(scene);
+
+    // boxes scattered through the camera range, they have no geometry so only bounds are updated
+    for (u32 i = 0; i < k_num_entities; ++i)
+    {
+        u32 e = get_new_entity(scene);
+        scene->transforms[e].rotation = quat();
+        scene->transforms[e].scale = vec3f(1.0f + (f32)(rand() % 4));
+        scene->transforms[e].translation = vec3f(rand() % 1000, rand() % 1000, rand() % 1000) - vec3f(500.0f);
+        scene->bounding_volumes[e].min_extents = -vec3f::one();
+        scene->bounding_volumes[e].max_extents = vec3f::one();
+        scene->parents[e] = e;
+        scene->entities[e] |= e_cmp::transform;
+
+        sb_push(s_entities, e);
+    }
+
+    s_timer = pen::timer_create();
+}
+
+void example_update(ecs::ecs_scene* scene, camera& cam, f32 dt)
+{
+    // gather from pos_extent through the index list
+    u32* culled = nullptr;
+    pen::timer_start(s_timer);
+    for (u32 i = 0; i < k_iterations; ++i)
+    {
+        sb_clear(culled);
+        frustum_cull_aabb_scalar(scene, &cam, s_entities, &culled);
+    }
+    f32 gather_ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+    u32 gather_count = sb_count(culled);
+    sb_free(culled);
+
+    // packing cost is paid once per frame and shared by all views
+    pen::timer_start(s_timer);
+    build_cull_stream(scene, s_entities, &s_stream);
+    f32 build_ms = pen::timer_elapsed_ms(s_timer);
+
+    ImGui::Begin("Cull Benchmark");
+    ImGui::Text("Entities: %u, Detected: %s", k_num_entities, s_simd_level_names[simd_get_level()]);
+    ImGui::Separator();
+    ImGui::Text("%-18s %8.4f ms, visible %u", "gather scalar", gather_ms, gather_count);
+    ImGui::Text("%-18s %8.4f ms", "build stream", build_ms);
+
+    for (u32 p = 0; p < PEN_ARRAY_SIZE(s_stream_paths); ++p)
+    {
+        stream_path& sp = s_stream_paths[p];
+        if (sp.level > simd_get_level())
+        {
+            ImGui::Text("%-18s unsupported", sp.name);
+            continue;
+        }
+
+        culled = nullptr;
+        pen::timer_start(s_timer);
+        for (u32 i = 0; i < k_iterations; ++i)
+        {
+            sb_clear(culled);
+            sp.func(&s_stream, &cam, &culled);
+        }
+        f32 ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+        u32 count = sb_count(culled);
+        sb_free(culled);
+
+        // all paths must agree with the scalar gather
+        ImGui::Text("%-18s %8.4f ms, visible %u %s", sp.name, ms, count, count == gather_count ? "" : "(mismatch)");
+    }
+
+    ImGui::End();
+}
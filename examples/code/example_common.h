@@ -128,6 +128,7 @@ namespace
 
         pmfx::poll_for_changes();
         put::poll_hot_loader();
+        put::poll_async_loads();
 
         if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
         {
@@ -0,0 +1,139 @@
+#include "../example_common.h"
+
+#include "pen_json.h"
+
+using namespace put;
+using namespace ecs;
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "json_benchmark";
+        p.window_sample_count = 4;
+        p.user_thread_function = user_setup;
+        p.flags = pen::e_pen_create_flags::renderer;
+        return p;
+    }
+} // namespace pen
+
+namespace
+{
+    const u32 k_iterations = 16;
+
+    c8**        s_sources = nullptr; // info.json text for every built pmfx
+    pen::timer* s_timer = nullptr;
+
+    // visit every value by index and every member by name, the access pattern of pmfx and material loading
+    template <typename T>
+    u32 walk(const T& j)
+    {
+        u32 visited = 1;
+        u32 num = j.size();
+        for (u32 i = 0; i < num; ++i)
+        {
+            T child = j[i];
+            visited += walk(child);
+
+            if (j.type() == JSMN_OBJECT)
+            {
+                T member = j[child.name().c_str()];
+                visited += member.is_null() ? 0 : 1;
+            }
+        }
+
+        return visited;
+    }
+} // namespace
+
+void example_setup(ecs::ecs_scene* scene, camera& cam)
+{
+    put::dev_ui::enable(true);
+
+    Str dir = "data/pmfx/";
+    dir.append(pen::renderer_get_shader_platform());
+
+    pen::fs_tree_node pmfx_dirs;
+    pen::filesystem_enum_directory(dir.c_str(), pmfx_dirs);
+
+    for (u32 i = 0; i < pmfx_dirs.num_children; ++i)
+    {
+        Str fn = dir;
+        fn.appendf("/%s/info.json", pmfx_dirs.children[i].name);
+
+        void* data = nullptr;
+        u32   size = 0;
+        if (pen::filesystem_read_file_to_buffer(fn.c_str(), &data, size) != PEN_ERR_OK)
+            continue;
+
+        c8* src = (c8*)pen::memory_alloc(size + 1);
+        memcpy(src, data, size);
+        src[size] = '\0';
+        pen::memory_free(data);
+
+        sb_push(s_sources, src);
+    }
+
+    pen::filesystem_enum_free_mem(pmfx_dirs);
+
+    s_timer = pen::timer_create();
+}
+
+void example_update(ecs::ecs_scene* scene, camera& cam, f32 dt)
+{
+    u32 num_files = sb_count(s_sources);
+
+    // parse
+    pen::timer_start(s_timer);
+    for (u32 i = 0; i < k_iterations; ++i)
+        for (u32 f = 0; f < num_files; ++f)
+            pen::json j = pen::json::load(s_sources[f]);
+    f32 json_parse_ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+
+    pen::timer_start(s_timer);
+    for (u32 i = 0; i < k_iterations; ++i)
+        for (u32 f = 0; f < num_files; ++f)
+            pen::json_doc_release(pen::json_doc_load(s_sources[f]));
+    f32 doc_parse_ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+
+    // lookups on already parsed files
+    pen::json*     jsons = new pen::json[num_files];
+    pen::json_doc** docs = new pen::json_doc*[num_files];
+    for (u32 f = 0; f < num_files; ++f)
+    {
+        jsons[f] = pen::json::load(s_sources[f]);
+        docs[f] = pen::json_doc_load(s_sources[f]);
+    }
+
+    u32 json_visited = 0;
+    pen::timer_start(s_timer);
+    for (u32 i = 0; i < k_iterations; ++i)
+        for (u32 f = 0; f < num_files; ++f)
+            json_visited += walk(jsons[f]);
+    f32 json_walk_ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+
+    u32 view_visited = 0;
+    pen::timer_start(s_timer);
+    for (u32 i = 0; i < k_iterations; ++i)
+        for (u32 f = 0; f < num_files; ++f)
+            view_visited += walk(pen::json_doc_root(docs[f]));
+    f32 view_walk_ms = pen::timer_elapsed_ms(s_timer) / (f32)k_iterations;
+
+    for (u32 f = 0; f < num_files; ++f)
+        pen::json_doc_release(docs[f]);
+
+    delete[] jsons;
+    delete[] docs;
+
+    ImGui::Begin("Json Benchmark");
+    ImGui::Text("pmfx info.json files: %u", num_files);
+    ImGui::Separator();
+    ImGui::Text("%-18s %8.4f ms", "parse json", json_parse_ms);
+    ImGui::Text("%-18s %8.4f ms", "parse json_doc", doc_parse_ms);
+    ImGui::Text("%-18s %8.4f ms, visited %u", "walk json", json_walk_ms, json_visited / k_iterations);
+    ImGui::Text("%-18s %8.4f ms, visited %u", "walk json_view", view_walk_ms, view_visited / k_iterations);
+    ImGui::End();
+}
@@ -0,0 +1,156 @@
+#include "../example_common.h"
+
+using namespace put;
+using namespace ecs;
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "streaming_benchmark";
+        p.window_sample_count = 4;
+        p.user_thread_function = user_setup;
+        p.flags = pen::e_pen_create_flags::renderer;
+        return p;
+    }
+} // namespace pen
+
+namespace
+{
+    // files are alternately loaded sync and async so both halves see a similar mix of sizes.
+    // sync loads block the frame for their full duration, async loads only block to create a placeholder
+    struct load_stats
+    {
+        u32 sync_count = 0;
+        f32 sync_ms = 0.0f;
+        u32 async_count = 0;
+        u32 async_completed = 0;
+        f32 async_issue_ms = 0.0f;
+        f32 async_total_ms = 0.0f;
+    };
+
+    load_stats  s_textures;
+    load_stats  s_models;
+    f32         s_max_frame_ms = 0.0f;
+    u32         s_frame = 0;
+    bool        s_streaming = true;
+    pen::timer* s_timer = nullptr;
+    pen::timer* s_stream_timer = nullptr;
+
+    void find_files(const Str& dir, const c8* ext, std::vector<Str>& files)
+    {
+        pen::fs_tree_node node;
+        if (pen::filesystem_enum_directory(dir.c_str(), node) != PEN_ERR_OK)
+            return;
+
+        for (u32 i = 0; i < node.num_children; ++i)
+        {
+            Str path = dir;
+            path.appendf("/%s", node.children[i].name);
+
+            if (pen::str_ends_with(path, ext))
+                files.push_back(path);
+            else
+                find_files(path, ext, files);
+        }
+
+        pen::filesystem_enum_free_mem(node);
+    }
+
+    void on_loaded(async_load_handle request, s32 resource, bool success, void* user_data)
+    {
+        load_stats* stats = (load_stats*)user_data;
+        stats->async_completed++;
+
+        if (stats->async_completed == stats->async_count)
+            stats->async_total_ms = pen::timer_elapsed_ms(s_stream_timer);
+    }
+
+    template <typename func>
+    void load_sync(const std::vector<Str>& files, load_stats& stats, func load)
+    {
+        for (u32 i = 0; i < files.size(); i += 2)
+        {
+            pen::timer_start(s_timer);
+            load(files[i].c_str());
+            stats.sync_ms += pen::timer_elapsed_ms(s_timer);
+            stats.sync_count++;
+        }
+    }
+
+    template <typename func>
+    void load_async(const std::vector<Str>& files, load_stats& stats, func load)
+    {
+        stats.async_count = (u32)files.size() / 2;
+
+        for (u32 i = 1; i < files.size(); i += 2)
+        {
+            pen::timer_start(s_timer);
+            load(files[i].c_str(), &stats);
+            stats.async_issue_ms += pen::timer_elapsed_ms(s_timer);
+        }
+    }
+
+    void show_stats(const c8* name, const load_stats& stats)
+    {
+        f32 sync_per_file = stats.sync_count ? stats.sync_ms / (f32)stats.sync_count : 0.0f;
+        f32 issue_per_file = stats.async_count ? stats.async_issue_ms / (f32)stats.async_count : 0.0f;
+
+        ImGui::Text("%s", name);
+        ImGui::Text("  sync  %4u files, blocking %8.3f ms, %6.3f ms per file", stats.sync_count, stats.sync_ms,
+                    sync_per_file);
+        ImGui::Text("  async %4u files, blocking %8.3f ms, %6.3f ms per file, complete %u/%u in %8.3f ms",
+                    stats.async_count, stats.async_issue_ms, issue_per_file, stats.async_completed, stats.async_count,
+                    stats.async_total_ms);
+    }
+} // namespace
+
+void example_setup(ecs::ecs_scene* scene, camera& cam)
+{
+    put::dev_ui::enable(true);
+
+    clear_scene(scene);
+
+    s_timer = pen::timer_create();
+    s_stream_timer = pen::timer_create();
+
+    std::vector<Str> textures;
+    std::vector<Str> models;
+    find_files("data/textures", ".dds", textures);
+    find_files("data/models", ".pmm", models);
+
+    load_sync(textures, s_textures, [](const c8* fn) { put::load_texture(fn); });
+    load_sync(models, s_models, [scene](const c8* fn) { load_pmm(fn, scene); });
+
+    // total async time runs from the first request until the last callback
+    pen::timer_start(s_stream_timer);
+
+    load_async(textures, s_textures, [](const c8* fn, load_stats* stats) {
+        put::load_texture_async(fn, e_load_priority::normal, on_loaded, stats);
+    });
+
+    load_async(models, s_models, [scene](const c8* fn, load_stats* stats) {
+        load_pmm_async(fn, scene, e_pmm_load_flags::all, e_load_priority::high, on_loaded, stats);
+    });
+}
+
+void example_update(ecs::ecs_scene* scene, camera& cam, f32 dt)
+{
+    // frame time while async loads complete, skipping the first frame which includes setup and the sync loads
+    if (s_streaming && s_frame++ > 0)
+    {
+        if (dt * 1000.0f > s_max_frame_ms)
+            s_max_frame_ms = dt * 1000.0f;
+        s_streaming = async_loads_pending() > 0;
+    }
+
+    ImGui::Begin("Streaming Benchmark");
+    show_stats("textures", s_textures);
+    show_stats("models", s_models);
+    ImGui::Separator();
+    ImGui::Text("pending %u, max frame while streaming %8.3f ms", async_loads_pending(), s_max_frame_ms);
+    ImGui::End();
+}
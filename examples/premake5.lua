@@ -57,6 +57,11 @@ create_app_example( "physics_constraints", script_path() )
 create_app_example( "complex_rigid_bodies", script_path() )
 create_app_example( "instancing", script_path() )
 create_app_example( "cull_sort", script_path() )
+create_app_example( "cull_benchmark", script_path() ) -- hide
+create_app_example( "cmd_lists", script_path() ) -- hide
+create_app_example( "json_benchmark", script_path() ) -- hide
+create_app_example( "streaming_benchmark", script_path() ) -- hide
+create_app_example( "anim_benchmark", script_path() ) -- hide
 create_app_example( "skinning", script_path() )
 create_app_example( "vertex_stream_out", script_path() )
 create_app_example( "shadow_maps", script_path() )
@@ -43,6 +43,8 @@ project "bullet_monolithic"
 	}
 	
 	includedirs { "include" }
+	
+	defines { "BT_THREADSAFE=1" }
 				
 	filter "configurations:Debug"
 		defines { "DEBUG" }
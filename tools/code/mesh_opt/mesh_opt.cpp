@@ -3,6 +3,7 @@
 #include "console.h"
 #include "file_system.h"
 #include "pen.h"
+#include "str_utilities.h"
 #include "threads.h"
 #include "os.h"
 
@@ -35,7 +36,7 @@ void show_help()
 {
     PEN_LOG("mesh_opt help");
     PEN_LOG("    -help <show this dialog>");
-    PEN_LOG("    -i <input file>");
+    PEN_LOG("    -i <input file> .pmm models are optimised for the vertex cache, .pma anims have redundant keys removed");
     PEN_LOG("    -o (optional) <output file>");
     PEN_LOG("      if -o is not supplied input file will be overwritten in place.");
 }
@@ -80,7 +81,10 @@ void* pen::user_entry(void* params)
     }
     
     PEN_LOG("optimising: %s", input_file.c_str());
-    optimise_pmm(input_file.c_str(), output_file.c_str());
+    if(pen::str_ends_with(input_file, ".pma"))
+        optimise_pma(input_file.c_str(), output_file.c_str());
+    else
+        optimise_pmm(input_file.c_str(), output_file.c_str());
     
 term:
     // signal to the engine the thread has finished
@@ -0,0 +1,300 @@
+#include "console.h"
+#include "file_pack.h"
+#include "file_system.h"
+#include "memory.h"
+#include "os.h"
+#include "pen.h"
+#include "str_utilities.h"
+#include "threads.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+using namespace pen;
+
+static std::vector<Str> s_args;
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        // unpack args
+        for (u32 i = 0; i < argc; ++i)
+            s_args.push_back(argv[i]);
+
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "pack_files";
+        p.window_sample_count = 4;
+        p.user_thread_function = user_entry;
+        p.flags = pen::e_pen_create_flags::console_app;
+        return p;
+    }
+} // namespace pen
+
+namespace
+{
+    struct pack_input
+    {
+        Str        path;
+        pack_entry entry;
+    };
+
+    void show_help()
+    {
+        PEN_LOG("pack_files help");
+        PEN_LOG("    -help <show this dialog>");
+        PEN_LOG("    -i <input directory or file>, can be supplied multiple times");
+        PEN_LOG("    -o (optional) <output file> defaults to data.pack");
+        PEN_LOG("    -compress (optional) compress entries which shrink by at least 1/8");
+        PEN_LOG("    -align (optional) <bytes> entry alignment, defaults to 4096 so entries can be mapped in place");
+        PEN_LOG("      paths are stored relative to the working directory, run from the directory containing data/");
+    }
+
+    void find_files(const Str& path, std::vector<pack_input>& files)
+    {
+        fs_tree_node node;
+        if (filesystem_enum_directory(path.c_str(), node) != PEN_ERR_OK)
+        {
+            // not a directory, or an empty one which is skipped when reading
+            pack_input pi;
+            pi.path = path;
+            files.push_back(pi);
+            return;
+        }
+
+        for (u32 i = 0; i < node.num_children; ++i)
+        {
+            Str child = path;
+            child.appendf("/%s", node.children[i].name);
+            find_files(child, files);
+        }
+
+        filesystem_enum_free_mem(node);
+    }
+
+    // empty files are skipped, as are empty directories which cannot be told apart from files by enumeration
+    bool is_loose_file(const c8* filename)
+    {
+        FILE* fp = fopen(filename, "rb");
+        if (!fp)
+            return false;
+
+        bool has_data = fgetc(fp) != EOF;
+        fclose(fp);
+        return has_data;
+    }
+
+    // reads loose files directly, so an existing pack is never packed into a new one
+    bool read_loose_file(const c8* filename, std::vector<u8>& data)
+    {
+        FILE* fp = fopen(filename, "rb");
+        if (!fp)
+            return false;
+
+        fseek(fp, 0L, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0L, SEEK_SET);
+
+        if (size <= 0)
+        {
+            fclose(fp);
+            return false;
+        }
+
+        data.resize((size_t)size);
+        size_t read = fread(data.data(), 1, data.size(), fp);
+        fclose(fp);
+
+        return read == data.size();
+    }
+
+    bool write_pack(const Str& output_file, std::vector<pack_input>& files, bool compress, u32 alignment)
+    {
+        FILE* fp = fopen(output_file.c_str(), "wb");
+        if (!fp)
+        {
+            PEN_LOG("[error] pack_files - unable to open output %s", output_file.c_str());
+            return false;
+        }
+
+        pack_header header;
+        header.magic = k_pack_magic;
+        header.version = k_pack_version;
+        header.num_entries = (u32)files.size();
+        header.alignment = alignment;
+
+        // toc is written again once offsets are known
+        std::vector<pack_entry> toc(files.size());
+        fwrite(&header, sizeof(pack_header), 1, fp);
+        fwrite(toc.data(), sizeof(pack_entry), toc.size(), fp);
+
+        u64             offset = sizeof(pack_header) + sizeof(pack_entry) * toc.size();
+        u64             total_size = 0;
+        u64             total_stored = 0;
+        std::vector<u8> data;
+        std::vector<u8> compressed;
+        static const u8 zero_pad[4096] = {0};
+
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            pack_input& pi = files[i];
+            if (!read_loose_file(pi.path.c_str(), data))
+            {
+                PEN_LOG("[error] pack_files - failed to read %s", pi.path.c_str());
+                fclose(fp);
+                return false;
+            }
+
+            // align
+            u64 aligned = (offset + alignment - 1) / alignment * alignment;
+            while (offset < aligned)
+            {
+                u64 pad = std::min<u64>(aligned - offset, sizeof(zero_pad));
+                fwrite(zero_pad, 1, (size_t)pad, fp);
+                offset += pad;
+            }
+
+            const u8* stored = data.data();
+            u32       stored_size = (u32)data.size();
+            pi.entry.flags = 0;
+
+            if (compress)
+            {
+                compressed.resize(pack_compress_bound((u32)data.size()));
+                u32 csize = pack_compress(data.data(), (u32)data.size(), compressed.data(), (u32)compressed.size());
+                if (csize > 0 && csize < data.size() - data.size() / 8)
+                {
+                    stored = compressed.data();
+                    stored_size = csize;
+                    pi.entry.flags |= e_pack_entry_flags::compressed;
+                }
+            }
+
+            fwrite(stored, 1, stored_size, fp);
+
+            pi.entry.size = (u32)data.size();
+            pi.entry.stored_size = stored_size;
+            pi.entry.offset = offset;
+            toc[i] = pi.entry;
+
+            offset += stored_size;
+            total_size += data.size();
+            total_stored += stored_size;
+        }
+
+        fseek(fp, sizeof(pack_header), SEEK_SET);
+        fwrite(toc.data(), sizeof(pack_entry), toc.size(), fp);
+        fclose(fp);
+
+        PEN_LOG("packed %u files into %s: %llu bytes -> %llu bytes stored, %llu bytes total", (u32)files.size(),
+                output_file.c_str(), (unsigned long long)total_size, (unsigned long long)total_stored,
+                (unsigned long long)offset);
+
+        return true;
+    }
+} // namespace
+
+void* pen::user_entry(void* params)
+{
+    // unpack the params passed to the thread and signal to the engine it ok to proceed
+    pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+    pen::job*               p_thread_info = job_params->job_info;
+    pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+    std::vector<Str>        inputs;
+    std::vector<pack_input> candidates;
+    std::vector<pack_input> files;
+    Str                     output_file = "data.pack";
+    bool                    compress = false;
+    u32                     alignment = 4096;
+
+    u32 argc = (u32)s_args.size();
+    for (u32 i = 0; i < argc; ++i)
+    {
+        if (s_args[i] == "-help")
+        {
+            break;
+        }
+        else if (s_args[i] == "-i" && i + 1 < argc)
+        {
+            inputs.push_back(s_args[i + 1]);
+        }
+        else if (s_args[i] == "-o" && i + 1 < argc)
+        {
+            output_file = s_args[i + 1];
+        }
+        else if (s_args[i] == "-compress")
+        {
+            compress = true;
+        }
+        else if (s_args[i] == "-align" && i + 1 < argc)
+        {
+            alignment = (u32)atoi(s_args[i + 1].c_str());
+        }
+    }
+
+    if (inputs.empty() || alignment == 0)
+    {
+        show_help();
+        goto term;
+    }
+
+    for (auto& input : inputs)
+    {
+        // strip trailing slashes so stored paths match what the loaders ask for
+        Str path = input;
+        while (path.length() > 1 && (path[path.length() - 1] == '/' || path[path.length() - 1] == '\\'))
+            path[path.length() - 1] = '\0';
+
+        find_files(path, candidates);
+    }
+
+    for (auto& pi : candidates)
+    {
+        if (pi.path == output_file)
+            continue;
+
+        if (!is_loose_file(pi.path.c_str()))
+            continue;
+
+        pi.entry.hash = pack_path_hash(pi.path.c_str());
+        pi.entry.check_hash = pack_path_hash(pi.path.c_str(), k_pack_check_seed);
+        pi.entry.mtime = 0;
+        filesystem_getmtime(pi.path.c_str(), pi.entry.mtime);
+        files.push_back(pi);
+    }
+
+    // sort for binary search at runtime, identical hashes would make entries unreachable
+    std::sort(files.begin(), files.end(),
+              [](const pack_input& a, const pack_input& b) { return a.entry.hash < b.entry.hash; });
+
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        if (files[i].entry.hash == files[i - 1].entry.hash)
+        {
+            if (files[i].path == files[i - 1].path)
+            {
+                // supplied twice by overlapping inputs
+                files.erase(files.begin() + i);
+                --i;
+                continue;
+            }
+
+            PEN_LOG("[error] pack_files - hash collision between %s and %s", files[i - 1].path.c_str(),
+                    files[i].path.c_str());
+            goto term;
+        }
+    }
+
+    write_pack(output_file, files, compress, alignment);
+
+term:
+    // signal to the engine the thread has finished
+    pen::os_terminate(0);
+    pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+
+    return PEN_THREAD_OK;
+}
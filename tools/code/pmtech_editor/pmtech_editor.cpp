@@ -217,6 +217,7 @@ namespace
         put::vgt::post_update();
         pmfx::poll_for_changes();
         put::poll_hot_loader();
+        put::poll_async_loads();
 
         if (pen::semaphore_try_wait(s_thread_info->p_sem_exit))
         {
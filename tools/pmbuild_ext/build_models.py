@@ -306,6 +306,11 @@ for file in file_list:
                 cmd = " -i " + full_path + ".pmm"
                 p = subprocess.Popen(mesh_opt + cmd, shell=True)
                 p.wait()
+                # keyframe reduction
+                if os.path.exists(full_path + ".pma"):
+                    cmd = " -i " + full_path + ".pma"
+                    p = subprocess.Popen(mesh_opt + cmd, shell=True)
+                    p.wait()
             dependencies.write_to_file_single(dep, depends_dest + ".dep")
 
 
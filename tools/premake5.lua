@@ -25,6 +25,9 @@ dofile "pmtech.lua"
 -- mesh optimiser
 create_app_example("mesh_opt", script_path())
 
+-- asset packer
+create_app_example("pack_files", script_path())
+
 -- dll to hot reload
 create_dll("live_lib", "live_lib", script_path())
 setup_live_lib("live_lib")